@@ -25,6 +25,8 @@ Bunch::bunch_t(Reference_particle const& reference_particle,
     , real_num(real_num)
     , parts{BunchParticles(PG::regular, total_num, -1, *comm),
             BunchParticles(PG::spectator, total_spectator_num, -1, *comm)}
+    , diag_async_depth(0)
+    , rebalance_threshold(0.0)
     , bunch_index(bunch_index)
     , bucket_index(bucket_index)
     , array_index(array_index)
@@ -42,6 +44,8 @@ Bunch::bunch_t()
     , real_num(1.0)
     , parts{BunchParticles(PG::regular, 0, 0, *comm),
             BunchParticles(PG::spectator, 0, 0, *comm)}
+    , diag_async_depth(0)
+    , rebalance_threshold(0.0)
     , bunch_index(0)
     , bucket_index(0)
     , array_index(0)
@@ -102,6 +102,13 @@ class bunch_t {
     std::unique_ptr<Diagnostics_worker> diag_aperture;
     std::unique_ptr<Diagnostics_worker> diag_zcut;
 
+    // queue depth of the async diagnostics writer, 0 for synchronous
+    size_t diag_async_depth;
+
+    // rebalance the particles across the ranks when the imbalance
+    // (largest local count over the average) exceeds it, 0 to disable
+    double rebalance_threshold;
+
     // bunch indicies
     int bunch_index;  // index in the train
     int bucket_index; // which bucket its occupying
@@ -356,18 +363,52 @@ class bunch_t {
     ///
     /// Update the total number and real number of particles after the local
     /// number has been changed. Requires comm_sptrunication.
+    /// With a rebalance threshold set, the particles are also rebalanced
+    /// when the counts across the ranks are too uneven.
     int
     update_total_num()
     {
-        get_bunch_particles(PG::spectator).update_total_num(*comm);
+        bool gather = rebalance_threshold > 0.0;
+
+        auto& sp = get_bunch_particles(PG::spectator);
+        sp.update_total_num(*comm, gather);
 
         auto& bp = get_bunch_particles(PG::regular);
-        int old_total = bp.update_total_num(*comm);
+        int old_total = bp.update_total_num(*comm, gather);
         real_num = old_total ? bp.num_total() * real_num / old_total : 0.0;
 
+        if (gather) {
+            if (sp.imbalance() > rebalance_threshold) sp.rebalance(*comm);
+            if (bp.imbalance() > rebalance_threshold) bp.rebalance(*comm);
+        }
+
         return old_total;
     }
 
+    /// Rebalance the particles across the ranks of the bunch in
+    /// update_total_num() when the largest local count is more than
+    /// threshold times the average (e.g., 1.2). 0 to disable
+    void
+    set_rebalance_threshold(double threshold)
+    {
+        rebalance_threshold = threshold;
+    }
+
+    double
+    get_rebalance_threshold() const
+    {
+        return rebalance_threshold;
+    }
+
+    /// Move particles between the ranks so that every rank holds an even
+    /// share of the valid particles. Collective
+    void
+    rebalance()
+    {
+        get_bunch_particles(PG::regular).rebalance(*comm);
+        get_bunch_particles(PG::spectator).rebalance(*comm);
+    }
+
     // assign particle ids for bunch particles
     void
     assign_particle_ids(int train_idx)
@@ -438,6 +479,31 @@ class bunch_t {
         return get_bunch_particles(pg).search_particle(pid, last_idx);
     }
 
+    // batched search_particle(), slots[i] is the local index of ids[i].
+    // O(n*k) for n particles and k ids unless enable_id_index() is on
+    void
+    search_particles(karray1i_row_dev const& ids,
+                     karray1i_row_dev const& slots,
+                     ParticleGroup pg = PG::regular) const
+    {
+        get_bunch_particles(pg).search_particles(ids, slots);
+    }
+
+    // keep an id -> index hash for the particle searches of both
+    // groups, for when many particles are searched (e.g., tracks)
+    void
+    enable_id_index(bool on = true)
+    {
+        get_bunch_particles(PG::regular).enable_id_index(on);
+        get_bunch_particles(PG::spectator).enable_id_index(on);
+    }
+
+    bool
+    has_id_index() const
+    {
+        return get_bunch_particles(PG::regular).has_id_index();
+    }
+
     void
     print_particle(size_t idx,
                    Logger& logger,
@@ -509,7 +575,7 @@ class bunch_t {
     std::pair<Diagnostics_handler, int>
     add_diagnostics(Diag const& diag)
     {
-        diags.emplace_back(diag, comm);
+        diags.emplace_back(diag, comm, diag_async_depth);
         return std::make_pair(Diagnostics_handler(diags.back(), *this),
                               diags.size() - 1);
     }
@@ -538,6 +604,24 @@ class bunch_t {
         get_diag(id).update_and_write();
     }
 
+    // write the diagnostics asynchronously: the reduced data of up to
+    // queue_depth updates is queued and written as one batch, on a
+    // background thread when the MPI and HDF5 libraries allow it.
+    // Applies to the diagnostics added after this call, 0 turns it off
+    void
+    set_diag_async(size_t queue_depth)
+    {
+        diag_async_depth = queue_depth;
+    }
+
+    // write out everything queued in the async diagnostics
+    void
+    diag_drain()
+    {
+        for (auto& diag : diags)
+            diag.drain();
+    }
+
     void
     set_diag_loss_aperture(std::string const& filename)
     {
@@ -604,10 +688,11 @@ class bunch_t {
                int num_part = -1,
                int offset = 0,
                int num_part_spec = 0,
-               int offset_spec = 0) const
+               int offset_spec = 0,
+               ParticleFileFormat const& format = {}) const
     {
         Hdf5_file file(filename, Hdf5_file::Flag::truncate, comm);
-        write_file(file, num_part, offset, num_part_spec, offset_spec);
+        write_file(file, num_part, offset, num_part_spec, offset_spec, format);
     }
 
     void
@@ -615,12 +700,13 @@ class bunch_t {
                int num_part,
                int offset,
                int num_part_spec,
-               int offset_spec) const
+               int offset_spec,
+               ParticleFileFormat const& format = {}) const
     {
         get_bunch_particles(PG::regular)
-            .write_file(file, num_part, offset, *comm);
+            .write_file(file, num_part, offset, *comm, format);
         get_bunch_particles(PG::spectator)
-            .write_file(file, num_part_spec, offset_spec, *comm);
+            .write_file(file, num_part_spec, offset_spec, *comm, format);
     }
 
     // checkpoint state
@@ -643,19 +729,60 @@ class bunch_t {
         ar(*this);
     }
 
-    // checkpoint partiles
+    // checkpoint partiles, see bunch_particles_t::save_checkpoint_particles()
+    void
+    save_checkpoint_particles(Hdf5_file& file, std::string const& prefix) const
+    {
+        get_bunch_particles(PG::regular).save_checkpoint_particles(file, prefix);
+        get_bunch_particles(PG::spectator)
+            .save_checkpoint_particles(file, prefix);
+    }
+
+    void
+    load_checkpoint_particles(Hdf5_file& file, std::string const& prefix)
+    {
+        get_bunch_particles(PG::regular)
+            .load_checkpoint_particles(file, prefix, *comm);
+        get_bunch_particles(PG::spectator)
+            .load_checkpoint_particles(file, prefix, *comm);
+    }
+
+    void
+    load_checkpoint_particles_legacy(Hdf5_file& file, int idx)
+    {
+        get_bunch_particles(PG::regular)
+            .load_checkpoint_particles_legacy(file, idx);
+        get_bunch_particles(PG::spectator)
+            .load_checkpoint_particles_legacy(file, idx);
+    }
+
+    // for the ranks not holding the bunch
+    static void
+    skip_checkpoint_particles(Hdf5_file& file,
+                              std::string const& prefix,
+                              bool saving)
+    {
+        bp_t::skip_checkpoint_particles(file, prefix, PG::regular, saving);
+        bp_t::skip_checkpoint_particles(file, prefix, PG::spectator, saving);
+    }
+
+    // the state that is the same on all ranks of the bunch, i.e., without
+    // the communicator, particles and diagnostics. For restoring a
+    // checkpoint with a different bunch to rank mapping
+    template <class AR>
     void
-    save_checkpoint_particles(Hdf5_file& file, int idx) const
+    save_shared_state(AR& ar) const
     {
-        get_bunch_particles(PG::regular).save_checkpoint_particles(file, idx);
-        get_bunch_particles(PG::spectator).save_checkpoint_particles(file, idx);
+        ar(boundary, boundary_param, ref_part, design_ref_part);
+        ar(particle_charge, real_num, bucket_index, rebalance_threshold);
     }
 
+    template <class AR>
     void
-    load_checkpoint_particles(Hdf5_file& file, int idx)
+    load_shared_state(AR& ar)
     {
-        get_bunch_particles(PG::regular).load_checkpoint_particles(file, idx);
-        get_bunch_particles(PG::spectator).load_checkpoint_particles(file, idx);
+        ar(boundary, boundary_param, ref_part, design_ref_part);
+        ar(particle_charge, real_num, bucket_index, rebalance_threshold);
     }
 
     // only for trigon bunches
@@ -685,6 +812,8 @@ class bunch_t {
         ar(CEREAL_NVP(diags));
         ar(CEREAL_NVP(diag_aperture));
         ar(CEREAL_NVP(diag_zcut));
+        ar(CEREAL_NVP(diag_async_depth));
+        ar(CEREAL_NVP(rebalance_threshold));
         ar(CEREAL_NVP(bunch_index));
         ar(CEREAL_NVP(bucket_index));
         ar(CEREAL_NVP(array_index));
@@ -738,6 +867,8 @@ inline bunch_t<PART>::bunch_t(Reference_particle const& reference_particle,
     , real_num(1.0)
     , parts{bunch_particles_t<PART>(PG::regular, total_num, -1, *comm),
             bunch_particles_t<PART>(PG::spectator, 0, -1, *comm)}
+    , diag_async_depth(0)
+    , rebalance_threshold(0.0)
     , bunch_index(0)
     , bucket_index(0)
     , array_index(0)
@@ -1,5 +1,7 @@
 
+#include <algorithm>
 #include <iomanip>
+#include <numeric>
 
 #include "synergia/bunch/bunch_particles.h"
 #include "synergia/utils/hdf5_file.h"
@@ -11,6 +13,10 @@ namespace bunch_particles_impl {
 }
 
 namespace {
+    // dataset names of the per coordinate particle files
+    const char* const coord_names[] =
+        {"x", "xp", "y", "yp", "cdt", "dpop", "id"};
+
     // Kokkos functors
     struct particle_copier_many {
         ConstParticles src;
@@ -75,6 +81,7 @@ namespace {
         }
     };
 
+    // index + 1 of the particle, 0 if not found
     struct particle_finder {
         ConstParticles parts;
         int pid;
@@ -83,7 +90,69 @@ namespace {
         void
         operator()(const int i, int& idx) const
         {
-            if (((int)parts(i, 6)) == pid) idx = i;
+            if (((int)parts(i, 6)) == pid) idx = i + 1;
+        }
+    };
+
+    // adds the slots [off, off+n) to the id index
+    template <class MAP>
+    struct id_index_inserter {
+        MAP map;
+        ConstParticles parts;
+        int off;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i) const
+        {
+            map.insert((int)parts(off + i, 6), off + i);
+        }
+    };
+
+    // slot + 1 of the particle, 0 if not found
+    template <class MAP>
+    struct id_index_lookup {
+        MAP map;
+        int pid;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int, int& slot) const
+        {
+            auto idx = map.find(pid);
+            if (map.valid_at(idx)) slot = map.value_at(idx) + 1;
+        }
+    };
+
+    template <class MAP>
+    struct id_index_finder {
+        MAP map;
+        karray1i_row_dev ids;
+        karray1i_row_dev slots;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i) const
+        {
+            auto idx = map.find(ids(i));
+            slots(i) = map.valid_at(idx) ? map.value_at(idx)
+                                         : BunchParticles::particle_index_null;
+        }
+    };
+
+    // one scan for all the ids, when there is no index. Each particle
+    // is compared against every id, O(n*k)
+    struct particles_finder {
+        ConstParticles parts;
+        karray1i_row_dev ids;
+        karray1i_row_dev slots;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i) const
+        {
+            for (int k = 0; k < (int)ids.extent(0); ++k)
+                if (((int)parts(i, 6)) == ids(k)) slots(k) = i;
         }
     };
 
@@ -111,6 +180,28 @@ namespace {
         }
     };
 
+    // packs the valid particles to the front of dst
+    struct particle_compactor {
+        typedef int value_type;
+
+        ConstParticles src;
+        ConstParticleMasks src_masks;
+        Particles dst;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i, int& pos, const bool final) const
+        {
+            if (!src_masks(i)) return;
+
+            if (final)
+                for (int j = 0; j < 7; ++j)
+                    dst(pos, j) = src(i, j);
+
+            ++pos;
+        }
+    };
+
     struct particle_injector {
         Particles dst;
         ParticleMasks dst_masks;
@@ -261,6 +352,28 @@ bunch_particles_t<double>::reserve(int n, Commxx const& comm)
     reserve_local(r);
 }
 
+template <>
+void
+bunch_particles_t<double>::update_id_index() const
+{
+    if (!id_index_on || !id_index_stale) return;
+
+    // capacity is rounded up by the map. A failed insert (only with
+    // repeated ids) retries with more room
+    int cap = n_active;
+
+    do {
+        id_index = id_index_t(cap);
+
+        id_index_inserter<id_index_t> ins{id_index, parts, 0};
+        Kokkos::parallel_for(n_active, ins);
+
+        cap = 2 * cap + 1;
+    } while (id_index.failed_insert());
+
+    id_index_stale = false;
+}
+
 template <>
 void
 bunch_particles_t<double>::assign_ids(int train_idx, int bunch_idx)
@@ -287,6 +400,8 @@ bunch_particles_t<double>::assign_ids(int train_idx, int bunch_idx)
 
     pid_assigner<parts_t> pia{parts, base + poffset};
     Kokkos::parallel_for(n_active, pia);
+
+    invalidate_id_index();
 }
 
 template <>
@@ -316,6 +431,17 @@ bunch_particles_t<double>::inject(bunch_particles_t const& o,
 
     Kokkos::parallel_for(o.n_active, pi);
 
+    // the injected particles are appended, the index only needs them
+    if (id_index_on && !id_index_stale) {
+        if (id_index.capacity() < n_active + o.n_active)
+            id_index.rehash(n_active + o.n_active);
+
+        id_index_inserter<id_index_t> ins{id_index, parts, n_active};
+        Kokkos::parallel_for(o.n_active, ins);
+
+        if (id_index.failed_insert()) invalidate_id_index();
+    }
+
     // update number of particles
     n_active += o.n_active;
     n_valid += o.n_valid;
@@ -412,6 +538,17 @@ template <>
 int
 bunch_particles_t<double>::search_particle(int pid, int last_idx) const
 {
+    if (id_index_on) {
+        update_id_index();
+
+        // the index lives in the device memory
+        int slot = 0;
+        id_index_lookup<id_index_t> lookup{id_index, pid};
+        Kokkos::parallel_reduce(1, lookup, slot);
+
+        return slot ? slot - 1 : particle_index_null;
+    }
+
     if (last_idx != particle_index_null) {
         int match = 0;
         particle_id_checker pic{parts, last_idx, pid};
@@ -420,11 +557,32 @@ bunch_particles_t<double>::search_particle(int pid, int last_idx) const
         if (match) return last_idx;
     }
 
-    int idx = particle_index_null;
+    // the reduction starts from 0, which is also a valid index
+    int idx = 0;
     particle_finder pf{parts, pid};
     Kokkos::parallel_reduce(n_active, pf, idx);
 
-    return idx;
+    return idx ? idx - 1 : particle_index_null;
+}
+
+template <>
+void
+bunch_particles_t<double>::search_particles(
+    karray1i_row_dev const& ids,
+    karray1i_row_dev const& slots) const
+{
+    if (id_index_on) {
+        update_id_index();
+
+        id_index_finder<id_index_t> f{id_index, ids, slots};
+        Kokkos::parallel_for(ids.extent(0), f);
+        return;
+    }
+
+    Kokkos::deep_copy(slots, particle_index_null);
+
+    particles_finder f{parts, ids, slots};
+    Kokkos::parallel_for(n_active, f);
 }
 
 template <>
@@ -556,13 +714,161 @@ bunch_particles_t<double>::update_valid_num()
 
 template <>
 int
-bunch_particles_t<double>::update_total_num(Commxx const& comm)
+bunch_particles_t<double>::update_total_num(Commxx const& comm,
+                                            bool gather_counts)
 {
     int old_total_num = n_total;
-    MPI_Allreduce(&n_valid, &n_total, 1, MPI_INT, MPI_SUM, comm);
+
+    if (!gather_counts) {
+        MPI_Allreduce(&n_valid, &n_total, 1, MPI_INT, MPI_SUM, comm);
+        valid_counts.clear();
+        return old_total_num;
+    }
+
+    // the total and the imbalance out of one collective
+    valid_counts.resize(comm.size());
+    MPI_Allgather(
+        &n_valid, 1, MPI_INT, valid_counts.data(), 1, MPI_INT, comm);
+
+    n_total = std::accumulate(valid_counts.begin(), valid_counts.end(), 0);
     return old_total_num;
 }
 
+template <>
+double
+bunch_particles_t<double>::imbalance() const
+{
+    if (valid_counts.empty() || n_total == 0) return 1.0;
+
+    int max = *std::max_element(valid_counts.begin(), valid_counts.end());
+    return 1.0 * max * valid_counts.size() / n_total;
+}
+
+template <>
+void
+bunch_particles_t<double>::rebalance(Commxx const& comm)
+{
+    const int mpi_size = comm.size();
+    const int mpi_rank = comm.rank();
+
+    // the valid numbers of all ranks, fresh
+    update_total_num(comm, true);
+
+    std::vector<int> offsets(mpi_size);
+    std::vector<int> targets(mpi_size);
+    decompose_1d(comm, n_total, offsets, targets);
+
+    // every rank works out the same transfer plan, the ranks with
+    // surplus send their last valid particles to the ranks short of
+    // particles, in rank order
+    std::vector<int> scounts(mpi_size, 0), sdispls(mpi_size, 0);
+    std::vector<int> rcounts(mpi_size, 0), rdispls(mpi_size, 0);
+
+    int moved = 0;
+
+    for (int src = 0, dst = 0; src < mpi_size; ++src) {
+        int surplus = valid_counts[src] - targets[src];
+
+        while (surplus > 0) {
+            while (valid_counts[dst] >= targets[dst])
+                ++dst;
+
+            int n = std::min(surplus, targets[dst] - valid_counts[dst]);
+
+            if (src == mpi_rank) scounts[dst] = n;
+            if (dst == mpi_rank) rcounts[src] = n;
+
+            surplus -= n;
+            valid_counts[dst] += n;
+            moved += n;
+        }
+    }
+
+    valid_counts.clear();
+
+    // nothing to move or to compact
+    if (!moved && n_valid == n_active) return;
+
+    const int local_valid = n_valid;
+    const int target = targets[mpi_rank];
+
+    // compact the valid particles to the front of the new arrays, with
+    // enough room for the incoming ones
+#ifdef NO_PADDING
+    auto alloc = Kokkos::view_alloc(label);
+#else
+    auto alloc = Kokkos::view_alloc(label, Kokkos::AllowPadding);
+#endif
+    Particles cparts(alloc, std::max(n_reserved, target));
+
+    particle_compactor pc{parts, masks, cparts};
+    Kokkos::parallel_scan(n_active, pc);
+
+    parts = cparts;
+    n_reserved = parts.stride(1);
+
+    masks = ParticleMasks(label + "_masks", n_reserved);
+    discards = ParticleMasks(label + "_discards", n_reserved);
+    Kokkos::deep_copy(Kokkos::subview(masks, std::make_pair(0, target)), 1);
+
+    hparts = Kokkos::create_mirror_view(parts);
+    hmasks = Kokkos::create_mirror_view(masks);
+    hdiscards = Kokkos::create_mirror_view(discards);
+
+    n_active = target;
+    n_valid = target;
+    n_last_discarded = 0;
+
+    invalidate_id_index();
+
+    // moved is the same on all ranks
+    if (!moved) return;
+
+    // the outgoing particles are the tail of the valid ones, the
+    // incoming go right after the valid ones. The rows are packed in
+    // their own buffers, one particle of 7 doubles after the other
+    const int ncols = 7;
+
+    for (int r = 0; r < mpi_size; ++r) {
+        scounts[r] *= ncols;
+        rcounts[r] *= ncols;
+    }
+
+    for (int r = 1; r < mpi_size; ++r) {
+        sdispls[r] = sdispls[r - 1] + scounts[r - 1];
+        rdispls[r] = rdispls[r - 1] + rcounts[r - 1];
+    }
+
+    const int nsend = std::max(local_valid - target, 0);
+    const int nrecv = std::max(target - local_valid, 0);
+
+    // one spare element, so that the buffers are never empty
+    std::vector<double> sbuf(nsend * ncols + 1);
+    std::vector<double> rbuf(nrecv * ncols + 1);
+
+    Kokkos::deep_copy(hparts, parts);
+
+    for (int p = 0; p < nsend; ++p)
+        for (int c = 0; c < ncols; ++c)
+            sbuf[p * ncols + c] = hparts(target + p, c);
+
+    MPI_Alltoallv(sbuf.data(),
+                  scounts.data(),
+                  sdispls.data(),
+                  MPI_DOUBLE,
+                  rbuf.data(),
+                  rcounts.data(),
+                  rdispls.data(),
+                  MPI_DOUBLE,
+                  comm);
+
+    for (int p = 0; p < nrecv; ++p)
+        for (int c = 0; c < ncols; ++c)
+            hparts(local_valid + p, c) = rbuf[p * ncols + c];
+
+    Kokkos::deep_copy(parts, hparts);
+}
+
 template <>
 void
 bunch_particles_t<double>::check_pz2_positive()
@@ -584,6 +890,36 @@ bunch_particles_t<double>::check_pz2_positive()
     }
 }
 
+template <>
+void
+bunch_particles_t<double>::realloc_local(int n)
+{
+    // allocation if capacity is smaller
+    if (n_reserved < n) {
+#ifdef NO_PADDING
+        auto alloc = Kokkos::view_alloc(label);
+#else
+        auto alloc = Kokkos::view_alloc(label, Kokkos::AllowPadding);
+#endif
+        parts = Particles(alloc, n);
+        n_reserved = parts.stride(1);
+
+        masks = ParticleMasks(label + "_masks", n_reserved);
+        discards = ParticleMasks(label + "_discards", n_reserved);
+
+        hparts = Kokkos::create_mirror_view(parts);
+        hmasks = Kokkos::create_mirror_view(masks);
+        hdiscards = Kokkos::create_mirror_view(discards);
+    }
+
+    // reset the pointers
+    n_valid = 0;
+    n_total = 0;
+    n_active = n;
+
+    invalidate_id_index();
+}
+
 template <>
 void
 bunch_particles_t<double>::read_file_legacy(Hdf5_file const& file,
@@ -631,8 +967,14 @@ template <>
 void
 bunch_particles_t<double>::read_file(Hdf5_file const& file, Commxx const& comm)
 {
-    auto dims = file.get_dims(label);
-    if (dims.size() != 2 || dims[1] != 7) {
+    // per coordinate datasets, or a single row major dataset
+    bool per_coord = file.has_dataset(label + "_" + coord_names[0]);
+
+    auto dims = file.get_dims(per_coord ? label + "_" + coord_names[0] : label);
+    bool bad_dims =
+        per_coord ? dims.size() != 1 : (dims.size() != 2 || dims[1] != 7);
+
+    if (bad_dims) {
         throw std::runtime_error(
             "BunchParticle::read_file(): wrong data dimensions in file");
     }
@@ -640,41 +982,33 @@ bunch_particles_t<double>::read_file(Hdf5_file const& file, Commxx const& comm)
     int file_total = dims[0];
     int file_num = decompose_1d_local(comm, file_total);
 
-    // allocation if capacity is smaller
-    if (n_reserved < file_num) {
-#ifdef NO_PADDING
-        auto alloc = Kokkos::view_alloc(label);
-#else
-        auto alloc = Kokkos::view_alloc(label, Kokkos::AllowPadding);
-#endif
-        parts = Particles(alloc, file_num);
-        n_reserved = parts.stride(1);
+    realloc_local(file_num);
 
-        masks = ParticleMasks(label + "_masks", n_reserved);
-        discards = ParticleMasks(label + "_discards", n_reserved);
+    // read from file
+    if (per_coord) {
+        // straight into the columns of hparts
+        for (int i = 0; i < 7; ++i) {
+            file.read(label + "_" + coord_names[i],
+                      hparts.data() + i * hparts.stride(1),
+                      file_num);
+        }
+    } else {
+        auto read_particles = file.read<karray2d_row>(label, file_num);
 
-        hparts = Kokkos::create_mirror_view(parts);
-        hmasks = Kokkos::create_mirror_view(masks);
-        hdiscards = Kokkos::create_mirror_view(discards);
+        // transpose: read_particles is row major, hparts is col major
+        auto hp = Kokkos::subview(
+            hparts, std::make_pair(0, file_num), Kokkos::ALL);
+        Kokkos::deep_copy(hp, read_particles);
     }
 
-    // reset the pointers
-    n_valid = 0;
-    n_total = 0;
-    n_active = file_num;
-
-    // read from file
-    auto read_particles = file.read<karray2d_row>(label, file_num);
-    auto read_masks = file.read<HostParticleMasks>(label + "_masks", file_num);
+    file.read(label + "_masks", hmasks.data(), file_num);
 
-    // transpose: read_particles is row major, hparts is col major
-    for (int part = 0; part < file_num; ++part) {
-        for (int i = 0; i < 7; ++i)
-            hparts(part, i) = read_particles(part, i);
-
-        hmasks(part) = read_masks(part);
-        if (hmasks(part)) ++n_valid;
-    }
+    // count the valid ones
+    auto hm = hmasks;
+    Kokkos::parallel_reduce(
+        Kokkos::RangePolicy<Kokkos::DefaultHostExecutionSpace>(0, file_num),
+        [hm](const int p, int& sum) { sum += hm(p) ? 1 : 0; },
+        n_valid);
 
     // now we have the actual local num, update the total number
     update_total_num(comm);
@@ -688,7 +1022,8 @@ void
 bunch_particles_t<double>::write_file(Hdf5_file const& file,
                                       int num_part,
                                       int offset,
-                                      Commxx const& comm) const
+                                      Commxx const& comm,
+                                      ParticleFileFormat const& format) const
 {
     int local_num_part = 0;
     int local_offset = 0;
@@ -707,9 +1042,48 @@ bunch_particles_t<double>::write_file(Hdf5_file const& file,
             "invalid num_part or offset for bunch_particles_t::write_file()");
     }
 
-    auto parts = get_particles_in_range_row(local_offset, local_num_part);
-    file.write_collective(label, parts.first);
-    file.write_collective(label + "_masks", parts.second);
+    syn::storage_t masks_storage{false, format.compression};
+
+    if (!format.per_coordinate) {
+        // particle ids do not survive the single precision
+        if (format.single_precision) {
+            throw std::runtime_error(
+                "bunch_particles_t::write_file(): single precision needs "
+                "the per coordinate format");
+        }
+
+        auto parts = get_particles_in_range_row(local_offset, local_num_part);
+        file.write_collective(label, parts.first, masks_storage);
+        file.write_collective(label + "_masks", parts.second, masks_storage);
+        return;
+    }
+
+    // only the range to write is copied to the host, each column of it
+    // is contiguous and written without a transpose. The copies go through
+    // scratch buffers, the host arrays may hold edits not checked in yet
+    auto range = std::make_pair(local_offset, local_offset + local_num_part);
+
+    karray1d_hst hcol("write_column", local_num_part);
+
+    for (int i = 0; i < 7; ++i) {
+        Kokkos::deep_copy(hcol, Kokkos::subview(parts, range, i));
+
+        // ids are always in double
+        syn::storage_t storage{format.single_precision && i != 6,
+                               format.compression};
+
+        file.write(label + "_" + coord_names[i],
+                   hcol.data(),
+                   local_num_part,
+                   true,
+                   storage);
+    }
+
+    HostParticleMasks hm("write_masks", local_num_part);
+    Kokkos::deep_copy(hm, Kokkos::subview(masks, range));
+
+    file.write(
+        label + "_masks", hm.data(), local_num_part, true, masks_storage);
 }
 
 template <>
@@ -729,23 +1103,97 @@ bunch_particles_t<double>::print_particle(size_t idx, Logger& logger) const
 
 template <>
 void
-bunch_particles_t<double>::save_checkpoint_particles(Hdf5_file& file,
-                                                     int idx) const
+bunch_particles_t<double>::save_checkpoint_particles(
+    Hdf5_file& file,
+    std::string const& prefix) const
 {
     checkout_particles();
 
-    std::stringstream ss;
-    ss << "bunch_particles_" << label << "_parts_" << idx;
-    file.write(ss.str(), hparts.data(), hparts.span(), true);
+    auto name = prefix + "_" + label;
 
-    ss.str("");
-    ss << "bunch_particles_" << label << "_masks_" << idx;
-    file.write(ss.str(), hmasks.data(), hmasks.span(), true);
+    // columns of hparts are contiguous, written as they are
+    file.write(name + "_counts", &n_active, 1, true);
+
+    for (int i = 0; i < 7; ++i) {
+        file.write(name + "_" + coord_names[i],
+                   hparts.data() + i * hparts.stride(1),
+                   n_active,
+                   true);
+    }
+
+    file.write(name + "_masks", hmasks.data(), n_active, true);
+}
+
+template <>
+void
+bunch_particles_t<double>::load_checkpoint_particles(Hdf5_file& file,
+                                                     std::string const& prefix,
+                                                     Commxx const& comm)
+{
+    auto name = prefix + "_" + label;
+
+    auto counts = file.read<karray1i_row>(name + "_counts");
+    int total = file.get_dims(name + "_" + coord_names[0])[0];
+
+    // keep the saved decomposition when possible
+    int num = (counts.extent(0) == comm.size())
+                  ? counts(comm.rank())
+                  : decompose_1d_local(comm, total);
+
+    realloc_local(num);
+
+    for (int i = 0; i < 7; ++i) {
+        file.read(name + "_" + coord_names[i],
+                  hparts.data() + i * hparts.stride(1),
+                  num);
+    }
+
+    file.read(name + "_masks", hmasks.data(), num);
+
+    // count the valid ones
+    auto hm = hmasks;
+    Kokkos::parallel_reduce(
+        Kokkos::RangePolicy<Kokkos::DefaultHostExecutionSpace>(0, num),
+        [hm](const int p, int& sum) { sum += hm(p) ? 1 : 0; },
+        n_valid);
+
+    update_total_num(comm);
+    checkin_particles();
+}
+
+template <>
+void
+bunch_particles_t<double>::skip_checkpoint_particles(Hdf5_file& file,
+                                                     std::string const& prefix,
+                                                     ParticleGroup pg,
+                                                     bool saving)
+{
+    auto name = prefix + "_" + group_label(pg);
+
+    // same collective calls as the ranks holding the bunch, with no data
+    if (saving) {
+        file.write(name + "_counts", (int const*)nullptr, 0, true);
+
+        for (int i = 0; i < 7; ++i)
+            file.write(
+                name + "_" + coord_names[i], (double const*)nullptr, 0, true);
+
+        file.write(name + "_masks", (uint8_t const*)nullptr, 0, true);
+    } else {
+        file.read<karray1i_row>(name + "_counts");
+        file.get_dims(name + "_" + coord_names[0]);
+
+        for (int i = 0; i < 7; ++i)
+            file.read(name + "_" + coord_names[i], (double*)nullptr, 0);
+
+        file.read(name + "_masks", (uint8_t*)nullptr, 0);
+    }
 }
 
 template <>
 void
-bunch_particles_t<double>::load_checkpoint_particles(Hdf5_file& file, int idx)
+bunch_particles_t<double>::load_checkpoint_particles_legacy(Hdf5_file& file,
+                                                            int idx)
 {
     std::stringstream ss;
     ss << "bunch_particles_" << label << "_parts_" << idx;
@@ -9,11 +9,37 @@
 #include "synergia/utils/gsvector.h"
 #include "synergia/utils/hdf5_file.h"
 
+#include <Kokkos_UnorderedMap.hpp>
+
 #include <cereal/cereal.hpp>
 #include <utility>
 
 enum class ParticleGroup { regular = 0, spectator = 1 };
 
+// how the particles are stored in a particle file
+struct ParticleFileFormat {
+    // by default the particles go to a single (n, 7) row major dataset,
+    // which is what the analysis tools read. With per_coordinate each
+    // coordinate has its own 1d dataset (e.g., particles_x, particles_xp,
+    // ...) written straight from the column major particle array
+    bool per_coordinate = false;
+
+    // store the coordinates as float
+    bool single_precision = false;
+
+    // deflate level (1-9) with byte shuffling, 0 for no compression
+    int compression = 0;
+
+    template <class AR>
+    void
+    serialize(AR& ar)
+    {
+        ar(CEREAL_NVP(per_coordinate));
+        ar(CEREAL_NVP(single_precision));
+        ar(CEREAL_NVP(compression));
+    }
+};
+
 using Particles = Kokkos::View<double* [7],
                                Kokkos::LayoutLeft,
                                Kokkos::DefaultExecutionSpace::memory_space>;
@@ -141,6 +167,10 @@ class bunch_particles_t {
 
     using exec_space = typename parts_t::execution_space;
 
+    // particle id -> slot in the local array
+    using id_index_t =
+        Kokkos::UnorderedMap<int, int, Kokkos::Device<exec_space, memspace>>;
+
   private:
     /*
      * Local Particle Array Memory Layout:
@@ -212,6 +242,17 @@ class bunch_particles_t {
     // multiple ranks
     int poffset;
 
+    // n_valid of every rank, from the last update_total_num() that
+    // gathered them. Empty otherwise
+    std::vector<int> valid_counts;
+
+    // optional id index for the particle searches, see enable_id_index().
+    // It is a cache and not part of the checkpoint. Rebuilt on the next
+    // search once stale
+    bool id_index_on;
+    mutable bool id_index_stale;
+    mutable id_index_t id_index;
+
   public:
     parts_t parts;
     masks_t masks;
@@ -272,12 +313,14 @@ class bunch_particles_t {
         return ceil(1.0 * n_active / gsv_t::size());
     }
 
-    // copy particles/masks between host and device memories
+    // copy particles/masks between host and device memories. The host
+    // arrays may carry new ids, so a checkin invalidates the id index
     void
     checkin_particles() const
     {
         Kokkos::deep_copy(parts, hparts);
         Kokkos::deep_copy(masks, hmasks);
+        invalidate_id_index();
     }
 
     void
@@ -309,8 +352,19 @@ class bunch_particles_t {
     // update the valid num from the masks and return the old valid num
     int update_valid_num();
 
-    // update total num across the ranks and returns the old total number
-    int update_total_num(Commxx const& comm);
+    // update total num across the ranks and returns the old total number.
+    // With gather_counts the valid numbers of all ranks are gathered in
+    // the same collective, for imbalance() and rebalance()
+    int update_total_num(Commxx const& comm, bool gather_counts = false);
+
+    // largest valid number of a rank over the average, from the last
+    // update_total_num() with gathered counts. 1.0 if not available
+    double imbalance() const;
+
+    // move valid particles (with their ids) between the ranks of comm so
+    // every rank ends up with its decompose_1d share of the total. The
+    // local arrays are compacted, the lost particles dropped. Collective
+    void rebalance(Commxx const& comm);
 
     // apply aperture operation
     template <typename AP>
@@ -319,6 +373,39 @@ class bunch_particles_t {
     // search/get particle(s)
     int search_particle(int pid, int last_idx) const;
 
+    // slots[i] is the local index of the particle ids[i], or
+    // particle_index_null if not on this rank. With the id index it is
+    // one device pass over the k ids. Without, every one of the n
+    // particles is compared against all the ids, O(n*k), which is only
+    // reasonable for a few ids
+    void search_particles(karray1i_row_dev const& ids,
+                          karray1i_row_dev const& slots) const;
+
+    // keep an id -> slot hash index so that search_particle() is O(1)
+    // instead of a scan of all the particles. It follows inject(),
+    // rebalance(), checkin_particles() and the (re)loading and id
+    // assignment of the particles. Ids modified on the device by other
+    // means need invalidate_id_index()
+    void
+    enable_id_index(bool on = true)
+    {
+        id_index_on = on;
+        id_index_stale = true;
+        if (!on) id_index = id_index_t();
+    }
+
+    bool
+    has_id_index() const
+    {
+        return id_index_on;
+    }
+
+    void
+    invalidate_id_index() const
+    {
+        id_index_stale = true;
+    }
+
     std::pair<karray1d_row, bool> get_particle(int idx) const;
 
     // hostview is allocated by the caller and filled by this routine
@@ -340,15 +427,45 @@ class bunch_particles_t {
     // as the one stored in the particle file
     void read_file_legacy(Hdf5_file const& file, Commxx const& comm);
 
+    // reads either of the layouts in ParticleFileFormat
     void read_file(Hdf5_file const& file, Commxx const& comm);
     void write_file(Hdf5_file const& file,
                     int num_part,
                     int offset,
-                    Commxx const& comm) const;
-
-    // checkpoint save/load
-    void save_checkpoint_particles(Hdf5_file& file, int idx) const;
-    void load_checkpoint_particles(Hdf5_file& file, int idx);
+                    Commxx const& comm,
+                    ParticleFileFormat const& format = {}) const;
+
+    // checkpoint save/load in a rank independent layout. The active
+    // particles of all ranks go one after another into the per coordinate
+    // datasets <prefix>_<label>_<coord>, and the local counts into
+    // <prefix>_<label>_counts. On load the saved decomposition is kept
+    // if the bunch has the same number of ranks, otherwise the particles
+    // are divided evenly. Collective over the communicator of the file,
+    // ranks not holding the bunch call skip_checkpoint_particles()
+    void save_checkpoint_particles(Hdf5_file& file,
+                                   std::string const& prefix) const;
+    void load_checkpoint_particles(Hdf5_file& file,
+                                   std::string const& prefix,
+                                   Commxx const& comm);
+
+    static void skip_checkpoint_particles(Hdf5_file& file,
+                                          std::string const& prefix,
+                                          ParticleGroup pg,
+                                          bool saving);
+
+    // checkpoints written before the rank independent layout have the
+    // whole particle array of each rank in bunch_particles_<label>_parts_<idx>,
+    // idx being the index of the bunch in the simulator on that rank.
+    // They can only be loaded on the same number of ranks, into particle
+    // arrays of the saved sizes
+    void load_checkpoint_particles_legacy(Hdf5_file& file, int idx);
+
+    // label of the particle group, also the name of its datasets in files
+    static std::string
+    group_label(ParticleGroup pg)
+    {
+        return pg == PG::regular ? "particles" : "spectators";
+    }
 
     // assign ids cooperatively
     void assign_ids(int train_idx, int bunch_idx);
@@ -371,6 +488,12 @@ class bunch_particles_t {
   private:
     void default_ids(int local_offset, Commxx const& comm);
 
+    // drop the local particles and make room for n of them
+    void realloc_local(int n);
+
+    // (re)build the id index if enabled and stale
+    void update_id_index() const;
+
     // serialization
     friend class cereal::access;
 
@@ -531,13 +654,17 @@ inline bunch_particles_t<PART>::bunch_particles_t(ParticleGroup pg,
                                                   int reserved,
                                                   Commxx const& comm)
     : group(pg)
-    , label(pg == PG::regular ? "particles" : "spectators")
+    , label(group_label(pg))
     , n_valid(0)
     , n_active(0)
     , n_reserved(0)
     , n_total(total)
     , n_last_discarded(0)
     , poffset(0)
+    , valid_counts()
+    , id_index_on(false)
+    , id_index_stale(true)
+    , id_index()
     , parts()
     , masks()
     , discards()
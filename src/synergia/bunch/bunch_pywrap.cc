@@ -9,8 +9,11 @@
 
 #include "synergia/bunch/diagnostics_bulk_track.h"
 #include "synergia/bunch/diagnostics_full2.h"
+#include "synergia/bunch/diagnostics_halo.h"
+#include "synergia/bunch/diagnostics_histograms.h"
 #include "synergia/bunch/diagnostics_loss.h"
 #include "synergia/bunch/diagnostics_particles.h"
+#include "synergia/bunch/diagnostics_tunes.h"
 #include "synergia/bunch/diagnostics_worker.h"
 
 #include "synergia/bunch/diagnostics_py.h"
@@ -24,6 +27,12 @@ PYBIND11_MODULE(bunch, m)
     .value("regular", ParticleGroup::regular)
     .value("spectator", ParticleGroup::spectator);
 
+  py::class_<ParticleFileFormat>(m, "ParticleFileFormat")
+    .def(py::init<>())
+    .def_readwrite("per_coordinate", &ParticleFileFormat::per_coordinate)
+    .def_readwrite("single_precision", &ParticleFileFormat::single_precision)
+    .def_readwrite("compression", &ParticleFileFormat::compression);
+
   py::enum_<LongitudinalBoundary>(m, "LongitudinalBoundary")
     .value("open", LongitudinalBoundary::open)
     .value("periodic", LongitudinalBoundary::periodic)
@@ -160,6 +169,35 @@ PYBIND11_MODULE(bunch, m)
          &Bunch::get_longitudinal_boundary,
          "Get the longitudinal boundary of the bunch")
 
+    .def("set_diag_async",
+         &Bunch::set_diag_async,
+         "Write the diagnostics added afterwards asynchronously, in "
+         "batches of queue_depth updates. 0 turns it off.",
+         "queue_depth"_a)
+
+    .def("set_rebalance_threshold",
+         &Bunch::set_rebalance_threshold,
+         "Rebalance the particles across the ranks when the largest local "
+         "count exceeds threshold times the average. 0 turns it off.",
+         "threshold"_a)
+
+    .def("get_rebalance_threshold", &Bunch::get_rebalance_threshold)
+
+    .def("rebalance",
+         &Bunch::rebalance,
+         "Move particles between the ranks for an even distribution.")
+
+    .def("enable_id_index",
+         &Bunch::enable_id_index,
+         "Keep a particle id hash index for O(1) particle searches.",
+         "on"_a = true)
+
+    .def("has_id_index", &Bunch::has_id_index)
+
+    .def("diag_drain",
+         &Bunch::diag_drain,
+         "Write out all queued async diagnostics")
+
     .def(
       "add_diagnostics",
       [](Bunch& self, std::shared_ptr<Diagnostics> const& diag) {
@@ -308,27 +346,99 @@ PYBIND11_MODULE(bunch, m)
          "Construct a Diagnostics_full2 object.",
          "filename"_a = "diag_full2.h5");
 
+  py::enum_<HistogramProjection>(m, "HistogramProjection")
+    .value("x", HistogramProjection::x)
+    .value("y", HistogramProjection::y)
+    .value("z", HistogramProjection::z)
+    .value("x_xp", HistogramProjection::x_xp)
+    .value("y_yp", HistogramProjection::y_yp)
+    .value("z_dpop", HistogramProjection::z_dpop)
+    .value("r", HistogramProjection::r);
+
+  py::class_<Diagnostics_histograms,
+             Diagnostics,
+             std::shared_ptr<Diagnostics_histograms>>(m,
+                                                      "Diagnostics_histograms")
+    .def(py::init<std::string const&,
+                  std::vector<HistogramProjection> const&,
+                  int,
+                  double>(),
+         "Construct a Diagnostics_histograms object.",
+         "filename"_a = "diag_histograms.h5",
+         "projections"_a =
+           std::vector<HistogramProjection>{HistogramProjection::x,
+                                            HistogramProjection::y,
+                                            HistogramProjection::z},
+         "bins"_a = 128,
+         "n_sigma"_a = 6.0);
+
+  py::class_<Diagnostics_halo, Diagnostics, std::shared_ptr<Diagnostics_halo>>(
+    m, "Diagnostics_halo")
+    .def(py::init<std::string const&, int, double, double, double, double>(),
+         "Construct a Diagnostics_halo object. beta and alpha are the "
+         "Twiss parameters of the lattice at its location.",
+         "filename"_a,
+         "num"_a,
+         "beta_x"_a,
+         "alpha_x"_a,
+         "beta_y"_a,
+         "alpha_y"_a);
+
   py::class_<Diagnostics_bulk_track,
              Diagnostics,
              std::shared_ptr<Diagnostics_bulk_track>>(m,
                                                       "Diagnostics_bulk_track")
-    .def(py::init<std::string const&, int, int, ParticleGroup>(),
+    .def(py::init<std::string const&, int, int, ParticleGroup, int>(),
          "Construct a Diagnostics_bulk_track object.",
          "filename"_a = "diag_bulk_track.h5",
          "num_tracks"_a = 0,
          "offset"_a = 0,
-         "particlegroup"_a = ParticleGroup::regular);
+         "particlegroup"_a = ParticleGroup::regular,
+         "buffer_turns"_a = 1);
+
+  py::class_<Diagnostics_tunes,
+             Diagnostics,
+             std::shared_ptr<Diagnostics_tunes>>(m, "Diagnostics_tunes")
+    .def(py::init<std::string const&,
+                  int,
+                  int,
+                  int,
+                  double,
+                  double,
+                  double,
+                  double>(),
+         "Construct a Diagnostics_tunes object, with the Twiss parameters "
+         "of the lattice at its location.",
+         "filename"_a = "diag_tunes.h5",
+         "num_tracks"_a = 0,
+         "offset"_a = 0,
+         "window"_a = 512,
+         "beta_x"_a = 1.0,
+         "alpha_x"_a = 0.0,
+         "beta_y"_a = 1.0,
+         "alpha_y"_a = 0.0)
+    .def_static("get_tune",
+                &Diagnostics_tunes::get_tune,
+                "Tune of a single normalized turn by turn signal.",
+                "re"_a,
+                "im"_a);
 
   py::class_<Diagnostics_particles,
              Diagnostics,
              std::shared_ptr<Diagnostics_particles>>(m, "Diagnostics_particles")
-    .def(py::init<std::string const&, int, int, int, int>(),
+    .def(py::init<std::string const&,
+                  int,
+                  int,
+                  int,
+                  int,
+                  ParticleFileFormat>(),
          "Construct a Diagnostics_particles object.",
          "filename"_a = "diag_particles.h5",
          "num_part"_a = -1,
          "offset"_a = 0,
          "num_spec_part"_a = 0,
-         "spec_offset"_a = 0);
+         "spec_offset"_a = 0,
+         "format"_a = ParticleFileFormat());
 
   // populate
   // m.def( "populate_6d", populate_6d );
@@ -184,6 +184,12 @@ Bunch_train::get_spacings()
     return spacings;
 }
 
+std::vector<double> const&
+Bunch_train::get_spacings() const
+{
+    return spacings;
+}
+
 std::vector<int>&
 Bunch_train::get_proc_counts_for_impedance()
 {
@@ -143,6 +143,7 @@ class Bunch_train {
     }
 
     std::vector<double>& get_spacings();
+    std::vector<double> const& get_spacings() const;
 
     // update the total particle number for all bunches in the bunch train
     // note that calling each bunch's update_total_num() wont do the actual
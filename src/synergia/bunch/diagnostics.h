@@ -1,6 +1,7 @@
 #ifndef DIAGNOSTICS_H_
 #define DIAGNOSTICS_H_
 
+#include <memory>
 #include <string>
 
 #include <cereal/archives/json.hpp>
@@ -32,6 +33,26 @@ class Diagnostics {
     virtual void do_write(io_device&, const size_t) = 0;
     virtual void do_first_write(io_device&) = 0;
 
+    // diagnostics that buffer several updates on their own write out
+    // whatever they hold when flushed
+    virtual bool
+    do_buffered() const
+    {
+        return false;
+    }
+
+    virtual void
+    do_flush(io_device&)
+    {}
+
+    // a copy of the reduced data which stays valid across the next
+    // update, for deferred writing. nullptr if not supported
+    virtual std::shared_ptr<Diagnostics>
+    do_snapshot() const
+    {
+        return nullptr;
+    }
+
   public:
     Diagnostics(std::string const& type = "Diagnostics",
                 std::string const& filename = "diag.h5",
@@ -74,6 +95,27 @@ class Diagnostics {
         do_write(io_device, iteration);
     }
 
+    bool
+    buffered() const
+    {
+        return do_buffered();
+    }
+
+    void
+    flush(io_device& io_device)
+    {
+        do_flush(io_device);
+    }
+
+    // the first write of the diagnostics goes with the first snapshot
+    std::shared_ptr<Diagnostics>
+    snapshot()
+    {
+        auto s = do_snapshot();
+        if (s) first_write = false;
+        return s;
+    }
+
     bool
     single_file() const
     {
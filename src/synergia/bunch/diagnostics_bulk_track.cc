@@ -5,24 +5,80 @@
 #include <iostream>
 #include <string>
 
+namespace {
+    // copies the tracked particles into one slot of the ring buffer
+    struct track_copier {
+        ConstParticles src;
+        karray3d_row_dev dst;
+
+        int slot;
+        int offset;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i) const
+        {
+            for (int j = 0; j < 7; ++j)
+                dst(slot, i, j) = src(offset + i, j);
+        }
+    };
+}
+
 Diagnostics_bulk_track::Diagnostics_bulk_track(std::string const& filename,
                                                int num_tracks,
                                                int offset,
-                                               ParticleGroup pg)
+                                               ParticleGroup pg,
+                                               int buffer_turns)
     : Diagnostics("diagnostis_bulk_track", filename, true)
     , total_num_tracks(num_tracks)
     , local_num_tracks(0)
     , offset(offset)
     , local_offset(0)
     , setup(false)
-    , track_coords("local_coords", 0, 0)
+    , buffer_turns(buffer_turns)
+    , filled(0)
+    , ref_charge(0.0)
+    , ref_mass(0.0)
+    , ref_pz(0.0)
+    , buf()
+    , hbuf()
+    , buf_pz()
+    , buf_s()
+    , buf_s_n()
+    , buf_repetition()
+    , buf_iterations()
+#ifdef SYNERGIA_HAVE_OPENPMD
+    , cached_local_num_tracks(-1)
+    , track_parts_offset_num(0)
+    , track_parts_total_num(0)
+#endif
     , pg(pg)
-{}
+{
+    if (buffer_turns < 1)
+        throw std::runtime_error(
+            "Diagnostics_bulk_track: buffer_turns must be at least 1");
+}
+
+void
+Diagnostics_bulk_track::allocate_buffers()
+{
+    buf = karray3d_row_dev(
+        "bulk_track_buffer", buffer_turns, local_num_tracks, 7);
+    hbuf = Kokkos::create_mirror_view(buf);
+
+    buf_pz = karray1d("track_pz", buffer_turns);
+    buf_s = karray1d("track_s", buffer_turns);
+    buf_s_n = karray1d("track_s_n", buffer_turns);
+    buf_repetition = host_iarray1d("track_repetition", buffer_turns);
+    buf_iterations.resize(buffer_turns);
+
+    filled = 0;
+}
 
 void
 Diagnostics_bulk_track::do_update(Bunch const& bunch)
 {
-    scoped_simple_timer("diag_bulk_track_update");
+    scoped_simple_timer timer("diag_bulk_track_update");
 
     auto const& ref = bunch.get_reference_particle();
 
@@ -42,36 +98,51 @@ Diagnostics_bulk_track::do_update(Bunch const& bunch)
         setup = true;
     }
 
-    pz = ref.get_momentum();
-    s = ref.get_s();
-    s_n = ref.get_s_n();
-    repetition = ref.get_repetition();
-
-    track_coords =
-        bunch.get_particles_in_range_row(local_offset, local_num_tracks, pg);
+    // buffers are not part of the checkpoint, (re)allocate when needed
+    if (buf.extent(0) != buffer_turns || buf.extent(1) != local_num_tracks)
+        allocate_buffers();
 
 #ifdef SYNERGIA_HAVE_OPENPMD
-    track_parts_local_num = track_coords.extent(0);
-
-    if (MPI_Allreduce(&track_parts_local_num,
-                      &track_parts_total_num,
-                      1,
-                      MPI_SIZE_T,
-                      MPI_SUM,
-                      bunch.get_comm()) != MPI_SUCCESS) {
-        std::runtime_error("Error in MPI_Allreduce in diagnostics-bulk-track!");
-    }
+    // the rank offsets of the tracks only change with the local count
+    if (cached_local_num_tracks != local_num_tracks) {
+        size_t local_num = local_num_tracks;
 
-    if (MPI_Scan(&track_parts_local_num,
-                 &track_parts_offset_num,
-                 1,
-                 MPI_SIZE_T,
-                 MPI_SUM,
-                 bunch.get_comm()) != MPI_SUCCESS) {
-        std::runtime_error("Error in MPI_Scan in diagnostics-bulk-track!");
-    }
+        if (MPI_Allreduce(&local_num,
+                          &track_parts_total_num,
+                          1,
+                          MPI_SIZE_T,
+                          MPI_SUM,
+                          bunch.get_comm()) != MPI_SUCCESS) {
+            throw std::runtime_error(
+                "Error in MPI_Allreduce in diagnostics-bulk-track!");
+        }
+
+        if (MPI_Exscan(&local_num,
+                       &track_parts_offset_num,
+                       1,
+                       MPI_SIZE_T,
+                       MPI_SUM,
+                       bunch.get_comm()) != MPI_SUCCESS) {
+            throw std::runtime_error(
+                "Error in MPI_Exscan in diagnostics-bulk-track!");
+        }
+
+        // result of MPI_Exscan is undefined on rank 0
+        if (bunch.get_comm().rank() == 0) track_parts_offset_num = 0;
 
+        cached_local_num_tracks = local_num_tracks;
+    }
 #endif
+
+    // an update without a write is overwritten by the next update
+    buf_pz(filled) = ref.get_momentum();
+    buf_s(filled) = ref.get_s();
+    buf_s_n(filled) = ref.get_s_n();
+    buf_repetition(filled) = ref.get_repetition();
+
+    track_copier tc{
+        bunch.get_local_particles(pg), buf, filled, local_offset};
+    Kokkos::parallel_for(local_num_tracks, tc);
 }
 
 void
@@ -91,67 +162,111 @@ Diagnostics_bulk_track::do_first_write(io_device& file)
 void
 Diagnostics_bulk_track::do_write(io_device& file, const size_t iteration)
 {
-    scoped_simple_timer("diag_bulk_track_write");
+    buf_iterations[filled] = iteration;
+    ++filled;
 
-#ifdef SYNERGIA_HAVE_OPENPMD
-    auto i = file.iterations[iteration];
-    i.setAttribute("track_pz", pz);
-    i.setAttribute("track_s", s);
-    i.setAttribute("track_s_n", s_n);
-    i.setAttribute("track_repitition", repetition);
+    if (filled == buffer_turns) write_buffer(file);
+}
+
+void
+Diagnostics_bulk_track::do_flush(io_device& file)
+{
+    if (filled) write_buffer(file);
+}
+
+void
+Diagnostics_bulk_track::write_buffer(io_device& file)
+{
+    scoped_simple_timer timer("diag_bulk_track_write");
+
+    auto const range = std::make_pair(0, filled);
 
-    openPMD::ParticleSpecies& protons =
-        file.iterations[iteration].particles["bunch_discards"];
+    // one device to host copy for all the buffered updates
+    auto coords = Kokkos::subview(hbuf, range, Kokkos::ALL, Kokkos::ALL);
+    Kokkos::deep_copy(coords,
+                      Kokkos::subview(buf, range, Kokkos::ALL, Kokkos::ALL));
 
+#ifdef SYNERGIA_HAVE_OPENPMD
     openPMD::Datatype datatype = openPMD::determineDatatype<double>();
     openPMD::Extent global_extent = {track_parts_total_num};
     openPMD::Dataset dataset = openPMD::Dataset(datatype, global_extent);
 
-    auto parts_x = Kokkos::subview(track_coords, Kokkos::ALL, Bunch::x);
-    auto parts_y = Kokkos::subview(track_coords, Kokkos::ALL, Bunch::y);
-    auto parts_z = Kokkos::subview(track_coords, Kokkos::ALL, Bunch::cdt);
+    openPMD::Offset chunk_offset = {track_parts_offset_num};
+    openPMD::Extent chunk_extent = {(size_t)local_num_tracks};
+
+    // openPMD records are per coordinate and contiguous
+    std::array<std::vector<double>, 6> comps;
+    for (auto& c : comps)
+        c.resize(local_num_tracks);
 
-    auto moments_x = Kokkos::subview(track_coords, Kokkos::ALL, Bunch::xp);
-    auto moments_y = Kokkos::subview(track_coords, Kokkos::ALL, Bunch::yp);
-    auto moments_dpop = Kokkos::subview(track_coords, Kokkos::ALL, Bunch::dpop);
+    for (int k = 0; k < filled; ++k) {
+        auto i = file.iterations[buf_iterations[k]];
+        i.setAttribute("track_pz", buf_pz(k));
+        i.setAttribute("track_s", buf_s(k));
+        i.setAttribute("track_s_n", buf_s_n(k));
+        i.setAttribute("track_repitition", buf_repetition(k));
 
-    protons["position"]["x"].resetDataset(dataset);
-    protons["position"]["y"].resetDataset(dataset);
-    protons["position"]["z"].resetDataset(dataset);
+        openPMD::ParticleSpecies& protons = i.particles["bunch_discards"];
 
-    protons["moments"]["x"].resetDataset(dataset);
-    protons["moments"]["y"].resetDataset(dataset);
-    protons["moments"]["z"].resetDataset(dataset);
+        for (int p = 0; p < local_num_tracks; ++p)
+            for (int j = 0; j < 6; ++j)
+                comps[j][p] = coords(k, p, j);
 
-    file.flush();
+        protons["position"]["x"].resetDataset(dataset);
+        protons["position"]["y"].resetDataset(dataset);
+        protons["position"]["z"].resetDataset(dataset);
 
-    openPMD::Offset chunk_offset = {track_parts_offset_num -
-                                    track_parts_local_num};
-    openPMD::Extent chunk_extent = {track_parts_local_num};
+        protons["moments"]["x"].resetDataset(dataset);
+        protons["moments"]["y"].resetDataset(dataset);
+        protons["moments"]["z"].resetDataset(dataset);
 
-    protons["position"]["x"].storeChunkRaw(
-        parts_x.data(), chunk_offset, chunk_extent);
-    protons["position"]["y"].storeChunkRaw(
-        parts_y.data(), chunk_offset, chunk_extent);
-    protons["position"]["z"].storeChunkRaw(
-        parts_z.data(), chunk_offset, chunk_extent);
-    protons["moments"]["x"].storeChunkRaw(
-        moments_x.data(), chunk_offset, chunk_extent);
-    protons["moments"]["y"].storeChunkRaw(
-        moments_y.data(), chunk_offset, chunk_extent);
-    protons["moments"]["z"].storeChunkRaw(
-        moments_dpop.data(), chunk_offset, chunk_extent);
+        protons["position"]["x"].storeChunkRaw(
+            comps[Bunch::x].data(), chunk_offset, chunk_extent);
+        protons["position"]["y"].storeChunkRaw(
+            comps[Bunch::y].data(), chunk_offset, chunk_extent);
+        protons["position"]["z"].storeChunkRaw(
+            comps[Bunch::cdt].data(), chunk_offset, chunk_extent);
+        protons["moments"]["x"].storeChunkRaw(
+            comps[Bunch::xp].data(), chunk_offset, chunk_extent);
+        protons["moments"]["y"].storeChunkRaw(
+            comps[Bunch::yp].data(), chunk_offset, chunk_extent);
+        protons["moments"]["z"].storeChunkRaw(
+            comps[Bunch::dpop].data(), chunk_offset, chunk_extent);
 
-    file.flush();
+        // comps are reused for the next update
+        file.flush();
+    }
 
 #else
     // write serial
-    file.append_single("track_pz", pz);
-    file.append_single("track_s", s);
-    file.append_single("track_s_n", s_n);
-    file.append_single("track_repetition", repetition);
+    file.append_slabs("track_pz", Kokkos::subview(buf_pz, range), false);
+    file.append_slabs("track_s", Kokkos::subview(buf_s, range), false);
+    file.append_slabs("track_s_n", Kokkos::subview(buf_s_n, range), false);
+    file.append_slabs(
+        "track_repetition", Kokkos::subview(buf_repetition, range), false);
 
     // write collective from all ranks
-    file.append_collective("track_coords", track_coords);
+    file.append_slabs("track_coords", coords, true);
 #endif
+
+    filled = 0;
+}
+
+std::shared_ptr<Diagnostics>
+Diagnostics_bulk_track::do_snapshot() const
+{
+    // a multi-update ring buffer batches its writes already
+    if (buffer_turns > 1) return nullptr;
+
+    // the snapshot owns a copy of the single buffered update
+    auto s = std::make_shared<Diagnostics_bulk_track>(*this);
+    s->allocate_buffers();
+
+    Kokkos::deep_copy(s->buf, buf);
+    Kokkos::deep_copy(s->buf_pz, buf_pz);
+    Kokkos::deep_copy(s->buf_s, buf_s);
+    Kokkos::deep_copy(s->buf_s_n, buf_s_n);
+    Kokkos::deep_copy(s->buf_repetition, buf_repetition);
+
+    return s;
 }
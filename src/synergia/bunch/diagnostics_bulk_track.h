@@ -9,27 +9,43 @@
 /// Particles will only be tracked if they stay on the same processor.
 /// Lost particles that are somehow restored or particles not available when
 /// the first update is called will also not be tracked.
+///
+/// The coordinates are gathered on the device into a ring buffer of
+/// buffer_turns updates, which is copied to the host and written to the
+/// file in one go when full, or when the diagnostics is flushed.
 class Diagnostics_bulk_track : public Diagnostics {
 
   private:
+    using host_iarray1d = Kokkos::View<int*, Kokkos::HostSpace>;
+
     int total_num_tracks, local_num_tracks;
     int offset, local_offset;
     bool setup;
 
-    // used between update and write
-    double s_n;
-    int repetition;
-    double s;
-    double pz;
+    // number of updates held in the ring buffer before a write
+    int buffer_turns;
+
+    // number of updates in the buffer
+    int filled;
 
     double ref_charge;
     double ref_mass;
     double ref_pz;
 
-    karray2d_row track_coords;
+    // ring buffer, (buffer_turns, local_num_tracks, 7)
+    karray3d_row_dev buf;
+    karray3d_row_hst hbuf;
+
+    // per update reference values and iteration numbers
+    karray1d buf_pz;
+    karray1d buf_s;
+    karray1d buf_s_n;
+    host_iarray1d buf_repetition;
+    std::vector<size_t> buf_iterations;
 
 #ifdef SYNERGIA_HAVE_OPENPMD
-    size_t track_parts_local_num;
+    // rank offsets, only recomputed when the local track count changes
+    int cached_local_num_tracks;
     size_t track_parts_offset_num;
     size_t track_parts_total_num;
 #endif
@@ -43,6 +59,18 @@ class Diagnostics_bulk_track : public Diagnostics {
     {}
     void do_first_write(io_device& file) override;
     void do_write(io_device& file, const size_t iteration) override;
+    std::shared_ptr<Diagnostics> do_snapshot() const override;
+
+    bool
+    do_buffered() const override
+    {
+        return filled > 0;
+    }
+
+    void do_flush(io_device& file) override;
+
+    void allocate_buffers();
+    void write_buffer(io_device& file);
 
     friend class cereal::access;
 
@@ -56,6 +84,10 @@ class Diagnostics_bulk_track : public Diagnostics {
         ar(offset);
         ar(local_offset);
         ar(setup);
+        ar(buffer_turns);
+        ar(ref_charge);
+        ar(ref_mass);
+        ar(ref_pz);
     }
 
   public:
@@ -64,10 +96,14 @@ class Diagnostics_bulk_track : public Diagnostics {
     ///        a numerical index inserted
     /// @param num_tracks the number of local particles to track
     /// @param offset id offset for first particle to track
+    /// @param pg particle group to track
+    /// @param buffer_turns number of updates buffered on the device
+    ///        between two writes
     Diagnostics_bulk_track(std::string const& filename = "diag_bulk_track.h5",
                            int num_tracks = 0,
                            int offset = 0,
-                           ParticleGroup pg = ParticleGroup::regular);
+                           ParticleGroup pg = ParticleGroup::regular,
+                           int buffer_turns = 1);
 };
 
 CEREAL_REGISTER_TYPE(Diagnostics_bulk_track)
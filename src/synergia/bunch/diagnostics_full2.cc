@@ -104,3 +104,19 @@ Diagnostics_full2::do_write(io_device& file, size_t iteration)
 #endif
     return;
 }
+
+std::shared_ptr<Diagnostics>
+Diagnostics_full2::do_snapshot() const
+{
+    auto s = std::make_shared<Diagnostics_full2>(*this);
+
+    // mean, min, max and mom2 are reallocated at every update, std and
+    // corr are filled in place so they need their own copies
+    s->std = karray1d("std", 6);
+    s->corr = karray2d_row("corr", 6, 6);
+
+    Kokkos::deep_copy(s->std, std);
+    Kokkos::deep_copy(s->corr, corr);
+
+    return s;
+}
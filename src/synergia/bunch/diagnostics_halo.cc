@@ -0,0 +1,387 @@
+#include "synergia/bunch/diagnostics_halo.h"
+#include "synergia/bunch/bunch.h"
+#include "synergia/bunch/core_diagnostics.h"
+#include "synergia/bunch/diagnostics_io.h"
+#include "synergia/bunch/particle_binning.h"
+#include "synergia/utils/simple_timer.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace halo_impl {
+    // bins of the action histograms
+    constexpr int nbins = 256;
+
+    // histogram rounds at the most
+    constexpr int max_rounds = 8;
+
+    // (Jx, Jy) of every particle, -1 for the invalid ones
+    struct alg_actions {
+        ConstParticles p;
+        ConstParticleMasks masks;
+        karray2d_row_dev act;
+
+        double bx, ax, gx;
+        double by, ay, gy;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i) const
+        {
+            if (!masks(i)) {
+                act(i, 0) = -1.0;
+                act(i, 1) = -1.0;
+                return;
+            }
+
+            double x = p(i, 0);
+            double xp = p(i, 1);
+            double y = p(i, 2);
+            double yp = p(i, 3);
+
+            act(i, 0) = 0.5 * (gx * x * x + 2.0 * ax * x * xp + bx * xp * xp);
+            act(i, 1) = 0.5 * (gy * y * y + 2.0 * ay * y * yp + by * yp * yp);
+        }
+    };
+
+    struct alg_max_action {
+        karray2d_row_dev act;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i, double& m) const
+        {
+            double a = act(i, 0) + act(i, 1);
+            if (a > m) m = a;
+        }
+    };
+
+    struct alg_count_above {
+        karray2d_row_dev act;
+        double t;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i, int& n) const
+        {
+            if (act(i, 0) + act(i, 1) >= t) ++n;
+        }
+    };
+
+    // rows of 7 coordinates and ids followed by (Jx, Jy)
+    struct alg_gather_above {
+        typedef int value_type;
+
+        ConstParticles p;
+        karray2d_row_dev act;
+        karray2d_row_dev out;
+        double t;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i, int& pos, const bool final) const
+        {
+            if (act(i, 0) + act(i, 1) < t) return;
+
+            if (final) {
+                for (int j = 0; j < 7; ++j)
+                    out(pos, j) = p(i, j);
+
+                out(pos, 7) = act(i, 0);
+                out(pos, 8) = act(i, 1);
+            }
+
+            ++pos;
+        }
+    };
+
+    // lowest action of the selection. Every round bins the actions in
+    // [lo, hi), and zooms into the bin holding the k-th largest, until
+    // the particles at or above the bin are few
+    double
+    get_threshold(Bunch const& bunch,
+                  Particle_binning::Projection pj,
+                  int k,
+                  double amax)
+    {
+        double lo = 0.0;
+        double hi = amax;
+
+        // count at or above hi, from the earlier rounds. The first round
+        // has every particle in the bins, amax goes into the last one
+        double above = 0.0;
+
+        karray1d_dev dh("halo_hist", nbins);
+        auto h = Kokkos::create_mirror_view(dh);
+
+        Particle_binning::Projection_views views;
+
+        pj.coord0 = Particle_binning::action;
+        pj.bins0 = nbins;
+
+        for (int round = 0; round < max_rounds && hi > lo; ++round) {
+            pj.left0 = lo;
+            pj.h0 = (hi - lo) / nbins;
+
+            Particle_binning::bin_projections(bunch, {pj}, dh, views);
+            Kokkos::deep_copy(h, dh);
+
+            MPI_Allreduce(MPI_IN_PLACE,
+                          h.data(),
+                          nbins,
+                          MPI_DOUBLE,
+                          MPI_SUM,
+                          bunch.get_comm());
+
+            // count at or above the bins, from the top
+            int b = nbins - 1;
+
+            for (; b >= 0; --b) {
+                if (above + h[b] >= k) break;
+                above += h[b];
+            }
+
+            // fewer than k in total
+            if (b < 0) return lo;
+
+            double w = (hi - lo) / nbins;
+            hi = lo + (b + 1) * w;
+            lo = lo + b * w;
+
+            if (above + h[b] <= 2.0 * k) break;
+        }
+
+        return lo;
+    }
+
+    // the (at most) k rows of 9 values with the largest Jx + Jy, in
+    // decreasing order
+    std::vector<double>
+    top_rows(double const* rows, int n, int k)
+    {
+        std::vector<int> order(n);
+        std::iota(order.begin(), order.end(), 0);
+
+        const int m = std::min(k, n);
+
+        std::partial_sort(
+            order.begin(), order.begin() + m, order.end(), [&](int a, int b) {
+                return rows[a * 9 + 7] + rows[a * 9 + 8] >
+                       rows[b * 9 + 7] + rows[b * 9 + 8];
+            });
+
+        std::vector<double> top(m * 9);
+
+        for (int r = 0; r < m; ++r)
+            std::copy_n(rows + order[r] * 9, 9, &top[r * 9]);
+
+        return top;
+    }
+}
+
+Diagnostics_halo::Diagnostics_halo(std::string const& filename,
+                                   int num,
+                                   double beta_x,
+                                   double alpha_x,
+                                   double beta_y,
+                                   double alpha_y)
+    : Diagnostics("diagnostics_halo", filename, true)
+    , num(num)
+    , beta_x(beta_x)
+    , alpha_x(alpha_x)
+    , beta_y(beta_y)
+    , alpha_y(alpha_y)
+    , ref()
+    , coords("coords", num, 7)
+    , actions("actions", num, 2)
+    , dev_actions()
+{
+    if (num < 1)
+        throw std::runtime_error("Diagnostics_halo: num must be >= 1");
+
+    if (beta_x <= 0.0 || beta_y <= 0.0)
+        throw std::runtime_error("Diagnostics_halo: beta must be > 0");
+}
+
+void
+Diagnostics_halo::do_update(Bunch const& bunch)
+{
+    using namespace halo_impl;
+
+    scoped_simple_timer timer("diag_halo_update");
+
+    ref = bunch.get_reference_particle();
+
+    MPI_Comm comm = bunch.get_comm();
+    const int npart = bunch.size();
+
+    if ((int)dev_actions.extent(0) != npart)
+        dev_actions = karray2d_row_dev("actions", npart, 2);
+
+    alg_actions alg{bunch.get_local_particles(),
+                    bunch.get_local_particle_masks(),
+                    dev_actions,
+                    beta_x,
+                    alpha_x,
+                    (1.0 + alpha_x * alpha_x) / beta_x,
+                    beta_y,
+                    alpha_y,
+                    (1.0 + alpha_y * alpha_y) / beta_y};
+    Kokkos::parallel_for(npart, alg);
+
+    double amax = -1.0;
+    Kokkos::parallel_reduce(
+        npart, alg_max_action{dev_actions}, Kokkos::Max<double>(amax));
+    Kokkos::fence();
+
+    MPI_Allreduce(MPI_IN_PLACE, &amax, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+    // an empty bunch
+    if (amax < 0.0) amax = 0.0;
+
+    Particle_binning::Projection pj;
+    pj.beta_x = beta_x;
+    pj.alpha_x = alpha_x;
+    pj.beta_y = beta_y;
+    pj.alpha_y = alpha_y;
+
+    double t = get_threshold(bunch, pj, num, amax);
+
+    // a margin for the rounding in the binning, the host sort below
+    // drops the extra particles
+    t -= 1e-12 * amax;
+
+    // gather the particles above the threshold on every rank
+    int local = 0;
+    Kokkos::parallel_reduce(npart, alg_count_above{dev_actions, t}, local);
+    Kokkos::fence();
+
+    // the binning and the actions here round differently, so a particle
+    // on a bin edge can be counted on the wrong side of it. Should the
+    // threshold leave fewer than num particles, take all of them
+    int found = local;
+    MPI_Allreduce(MPI_IN_PLACE, &found, 1, MPI_INT, MPI_SUM, comm);
+
+    if (found < std::min(num, bunch.get_total_num())) {
+        t = 0.0;
+
+        local = 0;
+        Kokkos::parallel_reduce(
+            npart, alg_count_above{dev_actions, t}, local);
+        Kokkos::fence();
+    }
+
+    karray2d_row_dev dcand("cand", local, 9);
+    alg_gather_above gather{
+        bunch.get_local_particles(), dev_actions, dcand, t};
+    Kokkos::parallel_scan(npart, gather);
+
+    auto hcand = Kokkos::create_mirror_view(dcand);
+    Kokkos::deep_copy(hcand, dcand);
+
+    // a rank sends its own top num at the most. There can be many more
+    // above the threshold, e.g., when all the actions are the same
+    auto local_top = top_rows(hcand.data(), local, num);
+
+    const int mpi_size = bunch.get_comm().size();
+
+    std::vector<int> counts(mpi_size);
+    std::vector<int> displs(mpi_size, 0);
+
+    int nval = local_top.size();
+    MPI_Allgather(&nval, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+
+    for (int r = 1; r < mpi_size; ++r)
+        displs[r] = displs[r - 1] + counts[r - 1];
+
+    const int total = (displs.back() + counts.back()) / 9;
+    std::vector<double> cand(total * 9);
+
+    MPI_Allgatherv(local_top.data(),
+                   nval,
+                   MPI_DOUBLE,
+                   cand.data(),
+                   counts.data(),
+                   displs.data(),
+                   MPI_DOUBLE,
+                   comm);
+
+    // largest Jx + Jy first
+    auto top = top_rows(cand.data(), total, num);
+    const int n = top.size() / 9;
+
+    // new arrays for every update, so that snapshots can share them
+    coords = karray2d_row("coords", num, 7);
+    actions = karray2d_row("actions", num, 2);
+
+    for (int r = 0; r < num; ++r) {
+        if (r < n) {
+            double const* row = &top[r * 9];
+
+            for (int j = 0; j < 7; ++j)
+                coords(r, j) = row[j];
+
+            actions(r, 0) = row[7];
+            actions(r, 1) = row[8];
+        } else {
+            coords(r, Bunch::id) = -1;
+        }
+    }
+}
+
+void
+Diagnostics_halo::do_first_write(io_device& file)
+{
+#ifdef SYNERGIA_HAVE_OPENPMD
+    file.setAttribute("charge", ref.get_charge());
+    file.setAttribute("mass", ref.get_four_momentum().get_mass());
+    file.setAttribute("beta_x", beta_x);
+    file.setAttribute("alpha_x", alpha_x);
+    file.setAttribute("beta_y", beta_y);
+    file.setAttribute("alpha_y", alpha_y);
+    file.flush();
+#else
+    file.write("charge", ref.get_charge());
+    file.write("mass", ref.get_four_momentum().get_mass());
+    file.write("beta_x", beta_x);
+    file.write("alpha_x", alpha_x);
+    file.write("beta_y", beta_y);
+    file.write("alpha_y", alpha_y);
+#endif
+    return;
+}
+
+void
+Diagnostics_halo::do_write(io_device& file, size_t iteration)
+{
+    scoped_simple_timer timer("diag_halo_write");
+#ifdef SYNERGIA_HAVE_OPENPMD
+    auto i = file.iterations[iteration];
+    i.setAttribute("s", ref.get_s());
+    i.setAttribute("s_n", ref.get_s_n());
+    i.setAttribute("repetition", ref.get_repetition());
+    i.setAttribute("pz", ref.get_momentum());
+    i.setAttribute("halo_coords",
+                   Core_diagnostics::kokkos_view_to_stl_vector(coords));
+    i.setAttribute("halo_actions",
+                   Core_diagnostics::kokkos_view_to_stl_vector(actions));
+    file.flush();
+#else
+    // write serial
+    file.append("s", ref.get_s());
+    file.append("s_n", ref.get_s_n());
+    file.append("repetition", ref.get_repetition());
+    file.append("pz", ref.get_momentum());
+    file.append("halo_coords", coords);
+    file.append("halo_actions", actions);
+#endif
+    return;
+}
+
+std::shared_ptr<Diagnostics>
+Diagnostics_halo::do_snapshot() const
+{
+    // coords and actions are reallocated at every update
+    return std::make_shared<Diagnostics_halo>(*this);
+}
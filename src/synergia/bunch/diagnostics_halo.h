@@ -0,0 +1,82 @@
+#ifndef DIAGNOSTICS_HALO_H_
+#define DIAGNOSTICS_HALO_H_
+
+#include "synergia/bunch/diagnostics.h"
+#include "synergia/foundation/reference_particle.h"
+#include "synergia/utils/kokkos_views.h"
+
+/// Diagnostics_halo records the k particles of the bunch with the largest
+/// transverse action Jx + Jy, with J = (gamma u^2 + 2 alpha u u' + beta
+/// u'^2)/2 from the Twiss parameters passed to the constructor. They have
+/// no defaults, and should be the ones of the lattice at the location of
+/// the diagnostics. The actions are about the reference orbit.
+///
+/// The selection runs on the device and across the ranks of the bunch.
+/// A few histograms of the actions (Particle_binning::action) narrow down
+/// a threshold with at least k particles above it, and only the particles
+/// above the threshold, at most k from each rank, are gathered and
+/// sorted. Each update writes the k rows of coordinates (with the
+/// particle ids in the last column) and their (Jx, Jy), in decreasing
+/// order of Jx + Jy. Rows past the number of particles in the bunch have
+/// the id -1.
+class Diagnostics_halo : public Diagnostics {
+  private:
+    int num;
+
+    double beta_x, alpha_x;
+    double beta_y, alpha_y;
+
+    Reference_particle ref;
+
+    // (num, 7) coordinates and ids, (num, 2) actions
+    karray2d_row coords;
+    karray2d_row actions;
+
+    // per particle actions, reused across updates
+    karray2d_row_dev dev_actions;
+
+  public:
+    Diagnostics_halo(std::string const& filename,
+                     int num,
+                     double beta_x,
+                     double alpha_x,
+                     double beta_y,
+                     double alpha_y);
+
+  private:
+    // default ctor for serialization only
+    Diagnostics_halo()
+        : Diagnostics("diagnostics_halo", "diag_halo.h5", true)
+        , num(1)
+        , beta_x(1.0)
+        , alpha_x(0.0)
+        , beta_y(1.0)
+        , alpha_y(0.0)
+    {}
+
+    void do_update(Bunch const& bunch) override;
+    void
+    do_reduce(Commxx const& comm, int root) override
+    {}
+    void do_first_write(io_device& file) override;
+    void do_write(io_device& file, size_t iteration) override;
+    std::shared_ptr<Diagnostics> do_snapshot() const override;
+
+    friend class cereal::access;
+
+    template <class AR>
+    void
+    serialize(AR& ar)
+    {
+        ar(cereal::base_class<Diagnostics>(this));
+        ar(num);
+        ar(beta_x);
+        ar(alpha_x);
+        ar(beta_y);
+        ar(alpha_y);
+    }
+};
+
+CEREAL_REGISTER_TYPE(Diagnostics_halo)
+
+#endif /* DIAGNOSTICS_HALO_H_ */
@@ -0,0 +1,249 @@
+#include "synergia/bunch/diagnostics_histograms.h"
+#include "synergia/bunch/bunch.h"
+#include "synergia/bunch/core_diagnostics.h"
+#include "synergia/bunch/diagnostics_io.h"
+#include "synergia/utils/simple_timer.h"
+
+#include <stdexcept>
+
+namespace {
+    using PJ = HistogramProjection;
+
+    // binned coordinates of the projection, the second is -1 for 1d
+    std::array<int, 2>
+    get_coords(PJ p)
+    {
+        switch (p) {
+        case PJ::x: return {Bunch::x, -1};
+        case PJ::y: return {Bunch::y, -1};
+        case PJ::z: return {Bunch::cdt, -1};
+        case PJ::x_xp: return {Bunch::x, Bunch::xp};
+        case PJ::y_yp: return {Bunch::y, Bunch::yp};
+        case PJ::z_dpop: return {Bunch::cdt, Bunch::dpop};
+        case PJ::r: return {Particle_binning::radius, -1};
+        }
+
+        throw std::runtime_error("Diagnostics_histograms: unknown projection");
+    }
+
+    using host_2d_unmanaged =
+        Kokkos::View<double**,
+                     Kokkos::LayoutRight,
+                     Kokkos::HostSpace,
+                     Kokkos::MemoryTraits<Kokkos::Unmanaged>>;
+}
+
+Diagnostics_histograms::Diagnostics_histograms(
+    std::string const& filename,
+    std::vector<HistogramProjection> const& projections,
+    int bins,
+    double n_sigma)
+    : Diagnostics("diagnostics_histograms", filename, true)
+    , projections(projections)
+    , bins(bins)
+    , n_sigma(n_sigma)
+    , ref()
+    , num_particles(0)
+    , real_num_particles(0.0)
+    , bprojs()
+    , bviews()
+    , hist()
+    , hhist()
+    , edges()
+{
+    if (bins < 1)
+        throw std::runtime_error("Diagnostics_histograms: bins must be >= 1");
+}
+
+std::string
+Diagnostics_histograms::get_name(HistogramProjection p)
+{
+    switch (p) {
+    case PJ::x: return "x";
+    case PJ::y: return "y";
+    case PJ::z: return "z";
+    case PJ::x_xp: return "x_xp";
+    case PJ::y_yp: return "y_yp";
+    case PJ::z_dpop: return "z_dpop";
+    case PJ::r: return "r";
+    }
+
+    throw std::runtime_error("Diagnostics_histograms: unknown projection");
+}
+
+void
+Diagnostics_histograms::do_update(Bunch const& bunch)
+{
+    scoped_simple_timer timer("diag_histograms_update");
+
+    ref = bunch.get_reference_particle();
+    num_particles = bunch.get_total_num();
+    real_num_particles = bunch.get_real_num();
+
+    auto mean = Core_diagnostics::calculate_mean(bunch);
+    auto std = Core_diagnostics::calculate_std(bunch, mean);
+
+    // bins of n_sigma std about the mean, a bunch with no spread in
+    // the coordinate gets unit bins instead
+    auto span = [&](int c, double& left, double& h) {
+        double half = n_sigma * std(c);
+        if (!(half > 0.0)) half = 0.5 * bins;
+
+        left = mean(c) - half;
+        h = 2.0 * half / bins;
+    };
+
+    const int nprojs = projections.size();
+    bprojs.resize(nprojs);
+
+    if ((int)edges.extent(0) != nprojs) edges = karray2d_row("edges", nprojs, 4);
+
+    int size = 0;
+
+    for (int j = 0; j < nprojs; ++j) {
+        auto& bp = bprojs[j];
+        auto coords = get_coords(projections[j]);
+
+        bp = Particle_binning::Projection();
+        bp.coord0 = coords[0];
+        bp.coord1 = coords[1];
+        bp.bins0 = bins;
+        bp.bins1 = bins;
+
+        if (bp.coord0 == Particle_binning::radius) {
+            double sr = std::sqrt(std(Bunch::x) * std(Bunch::x) +
+                                  std(Bunch::y) * std(Bunch::y));
+            double rmax = n_sigma * sr > 0.0 ? n_sigma * sr : bins;
+
+            bp.left0 = 0.0;
+            bp.h0 = rmax / bins;
+            bp.cx = mean(Bunch::x);
+            bp.cy = mean(Bunch::y);
+        } else {
+            span(bp.coord0, bp.left0, bp.h0);
+        }
+
+        if (bp.coord1 >= 0) span(bp.coord1, bp.left1, bp.h1);
+
+        edges(j, 0) = bp.left0;
+        edges(j, 1) = bp.h0;
+        edges(j, 2) = bp.coord1 >= 0 ? bp.left1 : 0.0;
+        edges(j, 3) = bp.coord1 >= 0 ? bp.h1 : 0.0;
+
+        size += bp.size();
+    }
+
+    if ((int)hist.extent(0) != size) {
+        hist = karray1d_dev("hist", size);
+        hhist = Kokkos::create_mirror_view(hist);
+    }
+
+    Particle_binning::bin_projections(bunch, bprojs, hist, bviews);
+    Kokkos::deep_copy(hhist, hist);
+}
+
+void
+Diagnostics_histograms::do_reduce(Commxx const& comm, int root)
+{
+    // every rank sets the same attributes in the openPMD backend, so
+    // all of them get the sums
+    if (comm.size() > 1) {
+        if (MPI_Allreduce(MPI_IN_PLACE,
+                          hhist.data(),
+                          hhist.extent(0),
+                          MPI_DOUBLE,
+                          MPI_SUM,
+                          comm) != MPI_SUCCESS) {
+            throw std::runtime_error(
+                "MPI error in Diagnostics_histograms reduce");
+        }
+    }
+}
+
+void
+Diagnostics_histograms::do_first_write(io_device& file)
+{
+#ifdef SYNERGIA_HAVE_OPENPMD
+    file.setAttribute("charge", ref.get_charge());
+    file.setAttribute("mass", ref.get_four_momentum().get_mass());
+    file.setAttribute("bins", bins);
+    file.setAttribute("n_sigma", n_sigma);
+    file.flush();
+#else
+    file.write("charge", ref.get_charge());
+    file.write("mass", ref.get_four_momentum().get_mass());
+    file.write("bins", bins);
+    file.write("n_sigma", n_sigma);
+#endif
+    return;
+}
+
+void
+Diagnostics_histograms::do_write(io_device& file, size_t iteration)
+{
+    scoped_simple_timer timer("diag_histograms_write");
+
+    int offset = 0;
+
+#ifdef SYNERGIA_HAVE_OPENPMD
+    auto i = file.iterations[iteration];
+    i.setAttribute("s", ref.get_s());
+    i.setAttribute("s_n", ref.get_s_n());
+    i.setAttribute("repetition", ref.get_repetition());
+    i.setAttribute("num_particles", num_particles);
+    i.setAttribute("real_num_particles", real_num_particles);
+    i.setAttribute("edges", Core_diagnostics::kokkos_view_to_stl_vector(edges));
+
+    for (size_t j = 0; j < bprojs.size(); ++j) {
+        const int n = bprojs[j].size();
+
+        std::vector<double> h(hhist.data() + offset,
+                              hhist.data() + offset + n);
+        i.setAttribute("hist_" + get_name(projections[j]), h);
+
+        offset += n;
+    }
+
+    file.flush();
+#else
+    // write serial
+    file.append("s", ref.get_s());
+    file.append("s_n", ref.get_s_n());
+    file.append("repetition", ref.get_repetition());
+    file.append("num_particles", num_particles);
+    file.append("real_num_particles", real_num_particles);
+    file.append("edges", edges);
+
+    for (size_t j = 0; j < bprojs.size(); ++j) {
+        auto const& bp = bprojs[j];
+        auto name = "hist_" + get_name(projections[j]);
+
+        if (bp.coord1 < 0) {
+            file.append(name,
+                        Kokkos::subview(
+                            hhist, std::make_pair(offset, offset + bp.bins0)));
+        } else {
+            file.append(
+                name,
+                host_2d_unmanaged(hhist.data() + offset, bp.bins0, bp.bins1));
+        }
+
+        offset += bp.size();
+    }
+#endif
+    return;
+}
+
+std::shared_ptr<Diagnostics>
+Diagnostics_histograms::do_snapshot() const
+{
+    // hhist and edges are filled in place, the snapshot needs its own
+    auto s = std::make_shared<Diagnostics_histograms>(*this);
+
+    s->hhist = karray1d_hst("hhist", hhist.extent(0));
+    s->edges = karray2d_row("edges", edges.extent(0), 4);
+    Kokkos::deep_copy(s->hhist, hhist);
+    Kokkos::deep_copy(s->edges, edges);
+
+    return s;
+}
@@ -0,0 +1,76 @@
+#ifndef DIAGNOSTICS_HISTOGRAMS_H_
+#define DIAGNOSTICS_HISTOGRAMS_H_
+
+#include <cereal/types/vector.hpp>
+
+#include "synergia/bunch/diagnostics.h"
+#include "synergia/bunch/particle_binning.h"
+#include "synergia/foundation/reference_particle.h"
+#include "synergia/utils/kokkos_views.h"
+
+/// projected distributions of Diagnostics_histograms, r is the
+/// transverse radius about the bunch centre
+enum class HistogramProjection { x, y, z, x_xp, y_yp, z_dpop, r };
+
+/// Diagnostics_histograms writes the beam profiles of a bunch, as
+/// histograms of the particles in 1d or 2d projections. All projections
+/// are binned on the device in one pass over the particles and summed
+/// over the ranks of the bunch. The bins of a coordinate span n_sigma
+/// standard deviations on either side of the bunch mean at every update,
+/// and [0, n_sigma * sqrt(std_x^2 + std_y^2)] for r. The lower edges and
+/// widths of the bins are written with the histograms.
+class Diagnostics_histograms : public Diagnostics {
+  private:
+    std::vector<HistogramProjection> projections;
+    int bins;
+    double n_sigma;
+
+    Reference_particle ref;
+    int num_particles;
+    double real_num_particles;
+
+    std::vector<Particle_binning::Projection> bprojs;
+    Particle_binning::Projection_views bviews;
+
+    // all histograms one after the other, allocated at the first update
+    karray1d_dev hist;
+    karray1d_hst hhist;
+
+    // left0, h0, left1, h1 of every projection
+    karray2d_row edges;
+
+  public:
+    Diagnostics_histograms(
+        std::string const& filename = "diag_histograms.h5",
+        std::vector<HistogramProjection> const& projections =
+            {HistogramProjection::x,
+             HistogramProjection::y,
+             HistogramProjection::z},
+        int bins = 128,
+        double n_sigma = 6.0);
+
+    static std::string get_name(HistogramProjection p);
+
+  private:
+    void do_update(Bunch const& bunch) override;
+    void do_reduce(Commxx const& comm, int root) override;
+    void do_first_write(io_device& file) override;
+    void do_write(io_device& file, size_t iteration) override;
+    std::shared_ptr<Diagnostics> do_snapshot() const override;
+
+    friend class cereal::access;
+
+    template <class AR>
+    void
+    serialize(AR& ar)
+    {
+        ar(cereal::base_class<Diagnostics>(this));
+        ar(projections);
+        ar(bins);
+        ar(n_sigma);
+    }
+};
+
+CEREAL_REGISTER_TYPE(Diagnostics_histograms)
+
+#endif /* DIAGNOSTICS_HISTOGRAMS_H_ */
@@ -101,9 +101,23 @@ Diagnostics_io::open_file()
 }
 
 void
-Diagnostics_io::flush_file()
+Diagnostics_io::set_comm(std::shared_ptr<Commxx> const& comm_input)
 {
-    if (file.has_value() && (iteration_count % flush_period == 0))
+    comm = comm_input;
+
+#ifndef SYNERGIA_HAVE_OPENPMD
+    if (file.has_value()) {
+        auto fname = file.value().get_filename();
+        file.reset();
+        file.emplace(fname, Hdf5_file::Flag::read_write, comm);
+    }
+#endif
+}
+
+void
+Diagnostics_io::flush_file(bool force)
+{
+    if (file.has_value() && (force || iteration_count % flush_period == 0))
         file.value().flush();
 }
 
@@ -123,11 +137,11 @@ Diagnostics_io::close_file()
 }
 
 void
-Diagnostics_io::finish_write()
+Diagnostics_io::finish_write(bool flush)
 {
-    if (single_file)
-        flush_file();
-    else
+    if (single_file) {
+        if (flush) flush_file();
+    } else
         close_file();
 
     increment_count();
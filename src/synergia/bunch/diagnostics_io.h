@@ -13,7 +13,7 @@ class Diagnostics_io {
   private:
     std::optional<io_device> file;
 
-    const std::shared_ptr<Commxx> comm;
+    std::shared_ptr<Commxx> comm;
 
     bool single_file;
     size_t iteration_count;
@@ -56,10 +56,12 @@ class Diagnostics_io {
         ++iteration_count;
     }
 
-    void finish_write();
+    // flush is the periodic flush of single files, deferred writers
+    // skip it and flush once per batch instead
+    void finish_write(bool flush = true);
 
     void open_file();
-    void flush_file();
+    void flush_file(bool force = false);
     void close_file();
 
   private:
@@ -68,6 +70,10 @@ class Diagnostics_io {
     void move_file_overwrite_if_exists(std::string const& src,
                                        std::string const& dst);
 
+    // the communicator is not checkpointed, the owner sets it after a
+    // restart. A file restored open is reopened on the new communicator
+    void set_comm(std::shared_ptr<Commxx> const& comm_input);
+
     friend class Diagnostics_worker;
     friend class cereal::access;
 
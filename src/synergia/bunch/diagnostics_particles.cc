@@ -8,7 +8,8 @@ Diagnostics_particles::Diagnostics_particles(std::string const& filename,
                                              int num_part,
                                              int offset,
                                              int num_spec_part,
-                                             int spec_offset)
+                                             int spec_offset,
+                                             ParticleFileFormat format)
 #ifdef SYNERGIA_HAVE_OPENPMD
     // use a single file and iterations with openPMD
     : Diagnostics("diagnostics_particles", filename, true)
@@ -21,6 +22,7 @@ Diagnostics_particles::Diagnostics_particles(std::string const& filename,
     , offset(offset)
     , num_spec_part(num_spec_part)
     , spec_offset(spec_offset)
+    , format(format)
 {}
 
 void
@@ -209,7 +211,7 @@ Diagnostics_particles::do_write(io_device& file, const size_t iteration)
     file.write("pz", ref_part.get_momentum());
 
     bunch_ref.value().get().write_file(
-        file, num_part, offset, num_spec_part, spec_offset);
+        file, num_part, offset, num_spec_part, spec_offset, format);
 #endif
     // reset bunch_ref
     bunch_ref = std::nullopt;
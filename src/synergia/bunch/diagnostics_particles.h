@@ -18,6 +18,9 @@ class Diagnostics_particles : public Diagnostics {
     size_t local_num, local_offset, file_offset;
     size_t spec_local_num, spec_local_offset, spec_file_offset;
 
+    // layout, precision and compression of the particle files
+    ParticleFileFormat format;
+
 #ifdef SYNERGIA_HAVE_OPENPMD
     bunch_particles_t<double>::host_parts_t parts_subset;
     bunch_particles_t<double>::host_masks_t masks_subset;
@@ -32,7 +35,8 @@ class Diagnostics_particles : public Diagnostics {
                           int num_part = -1,
                           int offset = 0,
                           int num_spec_part = 0,
-                          int spec_offset = 0);
+                          int spec_offset = 0,
+                          ParticleFileFormat format = {});
 
   private:
     void
@@ -57,6 +61,7 @@ class Diagnostics_particles : public Diagnostics {
         ar(offset);
         ar(num_spec_part);
         ar(spec_offset);
+        ar(format);
     }
 };
 
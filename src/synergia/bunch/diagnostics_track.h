@@ -7,6 +7,8 @@
 /// Particles will only be tracked if they stay on the same processor.
 /// Lost particles that are somehow restored or particles not available when
 /// the first update is called will also not be tracked.
+/// With many tracked particles, Bunch::enable_id_index() turns the
+/// search in every update from a scan of the bunch into a hash lookup.
 class Diagnostics_track : public Diagnostics {
   public:
     /// Multiple serial diagnostics can be written to a single file.
@@ -0,0 +1,529 @@
+#include "diagnostics_tunes.h"
+#include "synergia/foundation/math_constants.h"
+#include "synergia/utils/parallel_utils.h"
+#include "synergia/utils/simple_timer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace tunes_impl {
+    using team_policy = Kokkos::TeamPolicy<>;
+    using team_member = team_policy::member_type;
+
+    using scratch_t =
+        Kokkos::View<double*,
+                     Kokkos::DefaultExecutionSpace::scratch_memory_space,
+                     Kokkos::MemoryTraits<Kokkos::Unmanaged>>;
+
+    // golden section steps of the refinement, shrinks the bracket of
+    // 2/N to below 1e-8/N
+    constexpr int refine_steps = 40;
+
+    // normalized signals of the tracked particles at one turn
+    struct alg_record {
+        ConstParticles p;
+        ConstParticleMasks masks;
+        karray3d_row_dev sig;
+        karray1d_dev ids;
+
+        int offset;
+        int turn;
+        bool first;
+
+        double bx, ax;
+        double by, ay;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i) const
+        {
+            const int k = offset + i;
+
+            if (first) ids(i) = masks(k) ? p(k, 6) : -1.0;
+
+            // lost, or another particle in the slot
+            if (!masks(k) || p(k, 6) != ids(i)) ids(i) = -1.0;
+
+            double x = p(k, 0);
+            double y = p(k, 2);
+
+            sig(i * 2 + 0, turn, 0) = x;
+            sig(i * 2 + 0, turn, 1) = -(ax * x + bx * p(k, 1));
+            sig(i * 2 + 1, turn, 0) = y;
+            sig(i * 2 + 1, turn, 1) = -(ay * y + by * p(k, 3));
+        }
+    };
+
+    // one team per signal row and window. The Hann windowed signal goes
+    // to scratch, its FFT gives the peak bin k, and the peak is refined
+    // to the maximum of |sum w_n z_n exp(-2 pi i nu n)| in
+    // [(k-1)/N, (k+1)/N]
+    struct alg_tune {
+        karray3d_row_dev sig;
+        karray1d_dev nus;
+
+        int n;
+        int log2n;
+        int windows;
+        int level;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const team_member& member) const
+        {
+            const double pi = mconstants::pi;
+
+            const int row = member.league_rank() / windows;
+            const int w0 = (member.league_rank() % windows) * n;
+
+            scratch_t wr(member.team_scratch(level), n);
+            scratch_t wi(member.team_scratch(level), n);
+            scratch_t fr(member.team_scratch(level), n);
+            scratch_t fi(member.team_scratch(level), n);
+
+            // mean of the signal, the closed orbit
+            Kokkos::complex<double> mean(0.0, 0.0);
+            Kokkos::parallel_reduce(
+                Kokkos::TeamThreadRange(member, n),
+                [&](const int t, Kokkos::complex<double>& s) {
+                    s += Kokkos::complex<double>(sig(row, w0 + t, 0),
+                                                 sig(row, w0 + t, 1));
+                },
+                mean);
+
+            mean /= double(n);
+
+            // windowed signal, and its bit reversed copy for the fft
+            Kokkos::parallel_for(
+                Kokkos::TeamThreadRange(member, n), [&](const int t) {
+                    double s = sin(pi * t / n);
+                    double h = s * s;
+
+                    wr(t) = (sig(row, w0 + t, 0) - mean.real()) * h;
+                    wi(t) = (sig(row, w0 + t, 1) - mean.imag()) * h;
+
+                    int r = 0;
+                    for (int b = 0; b < log2n; ++b)
+                        r |= ((t >> b) & 1) << (log2n - 1 - b);
+
+                    fr(r) = wr(t);
+                    fi(r) = wi(t);
+                });
+            member.team_barrier();
+
+            // radix 2 fft, exp(-2 pi i k t / n)
+            for (int len = 2; len <= n; len *= 2) {
+                const int half = len / 2;
+
+                Kokkos::parallel_for(
+                    Kokkos::TeamThreadRange(member, n / 2), [&](const int j) {
+                        int k = j % half;
+                        int i0 = (j / half) * len + k;
+                        int i1 = i0 + half;
+
+                        double c = cos(2.0 * pi * k / len);
+                        double s = -sin(2.0 * pi * k / len);
+
+                        double tr = fr(i1) * c - fi(i1) * s;
+                        double ti = fr(i1) * s + fi(i1) * c;
+
+                        fr(i1) = fr(i0) - tr;
+                        fi(i1) = fi(i0) - ti;
+                        fr(i0) += tr;
+                        fi(i0) += ti;
+                    });
+                member.team_barrier();
+            }
+
+            // peak bin
+            Kokkos::MaxLoc<double, int>::value_type peak;
+            Kokkos::parallel_reduce(
+                Kokkos::TeamThreadRange(member, n),
+                [&](const int k, Kokkos::MaxLoc<double, int>::value_type& v) {
+                    double a = fr(k) * fr(k) + fi(k) * fi(k);
+                    if (a > v.val) {
+                        v.val = a;
+                        v.loc = k;
+                    }
+                },
+                Kokkos::MaxLoc<double, int>(peak));
+
+            // windowed amplitude at the frequency nu
+            auto amplitude = [&](double nu) {
+                Kokkos::complex<double> sum(0.0, 0.0);
+                Kokkos::parallel_reduce(
+                    Kokkos::TeamThreadRange(member, n),
+                    [&](const int t, Kokkos::complex<double>& s) {
+                        double c = cos(2.0 * pi * nu * t);
+                        double si = -sin(2.0 * pi * nu * t);
+                        s += Kokkos::complex<double>(wr(t) * c - wi(t) * si,
+                                                     wr(t) * si + wi(t) * c);
+                    },
+                    sum);
+                return Kokkos::abs(sum);
+            };
+
+            // golden section search
+            const double g = 0.5 * (sqrt(5.0) - 1.0);
+
+            double a = (peak.loc - 1.0) / n;
+            double b = (peak.loc + 1.0) / n;
+
+            double c = b - g * (b - a);
+            double d = a + g * (b - a);
+
+            double fc = amplitude(c);
+            double fd = amplitude(d);
+
+            for (int it = 0; it < refine_steps; ++it) {
+                if (fc > fd) {
+                    b = d;
+                    d = c;
+                    fd = fc;
+                    c = b - g * (b - a);
+                    fc = amplitude(c);
+                } else {
+                    a = c;
+                    c = d;
+                    fc = fd;
+                    d = a + g * (b - a);
+                    fd = amplitude(d);
+                }
+            }
+
+            double nu = 0.5 * (a + b);
+            nu -= floor(nu);
+
+            Kokkos::single(Kokkos::PerTeam(member),
+                           [&]() { nus(member.league_rank()) = nu; });
+        }
+    };
+
+    int
+    get_log2(int n)
+    {
+        int l = 0;
+        while ((1 << l) < n)
+            ++l;
+        return (1 << l) == n ? l : -1;
+    }
+
+    // tunes of every row and window of sig, into nus
+    void
+    run_tunes(karray3d_row_dev const& sig,
+              karray1d_dev const& nus,
+              int rows,
+              int n,
+              int windows)
+    {
+        if (rows == 0) return;
+
+        alg_tune alg{sig, nus, n, get_log2(n), windows, 0};
+
+        const size_t bytes = 4 * scratch_t::shmem_size(n);
+        alg.level = bytes <= 32 * 1024 ? 0 : 1;
+
+        auto policy = team_policy(rows * windows, Kokkos::AUTO)
+                          .set_scratch_size(alg.level, Kokkos::PerTeam(bytes));
+
+        Kokkos::parallel_for("diag_tunes", policy, alg);
+        Kokkos::fence();
+    }
+}
+
+Diagnostics_tunes::Diagnostics_tunes(std::string const& filename,
+                                     int num_tracks,
+                                     int offset,
+                                     int window,
+                                     double beta_x,
+                                     double alpha_x,
+                                     double beta_y,
+                                     double alpha_y)
+    : Diagnostics("diagnostics_tunes", filename, true)
+    , total_num_tracks(num_tracks)
+    , local_num_tracks(0)
+    , offset(offset)
+    , local_offset(0)
+    , setup(false)
+    , window(window)
+    , beta_x(beta_x)
+    , alpha_x(alpha_x)
+    , beta_y(beta_y)
+    , alpha_y(alpha_y)
+    , filled(0)
+    , ready(false)
+    , ref_charge(0.0)
+    , ref_mass(0.0)
+    , ref_pz(0.0)
+    , ref_s_n(0.0)
+    , ref_repetition(0)
+    , sig()
+    , ids()
+    , nus()
+    , hids()
+    , hnus()
+#ifdef SYNERGIA_HAVE_OPENPMD
+    , cached_local_num_tracks(-1)
+    , track_parts_offset_num(0)
+    , track_parts_total_num(0)
+#endif
+{
+    if (window < 8 || tunes_impl::get_log2(window) < 0)
+        throw std::runtime_error(
+            "Diagnostics_tunes: window must be a power of 2, at least 8");
+}
+
+void
+Diagnostics_tunes::allocate_buffers()
+{
+    sig = karray3d_row_dev("tunes_signal", local_num_tracks * 2, window * 2, 2);
+    ids = karray1d_dev("tunes_ids", local_num_tracks);
+    nus = karray1d_dev("tunes_nus", local_num_tracks * 4);
+
+    hids = Kokkos::create_mirror_view(ids);
+    hnus = Kokkos::create_mirror_view(nus);
+
+    filled = 0;
+    ready = false;
+}
+
+void
+Diagnostics_tunes::do_update(Bunch const& bunch)
+{
+    using namespace tunes_impl;
+
+    scoped_simple_timer timer("diag_tunes_update");
+
+    auto const& ref = bunch.get_reference_particle();
+
+    if (!setup) {
+        ref_charge = ref.get_charge();
+        ref_mass = ref.get_four_momentum().get_mass();
+        ref_pz = ref.get_four_momentum().get_momentum();
+
+        auto const& comm = bunch.get_comm();
+
+        local_num_tracks = decompose_1d_local(comm, total_num_tracks);
+        local_offset = decompose_1d_local(comm, offset);
+
+        if (local_num_tracks + local_offset > bunch.size())
+            local_num_tracks = std::max(0, bunch.size() - local_offset);
+
+        setup = true;
+    }
+
+    // buffers are not part of the checkpoint, (re)allocate when needed
+    if (sig.extent(0) != local_num_tracks * 2 || sig.extent(1) != window * 2)
+        allocate_buffers();
+
+#ifdef SYNERGIA_HAVE_OPENPMD
+    // the rank offsets of the tracks only change with the local count
+    if (cached_local_num_tracks != local_num_tracks) {
+        size_t local_num = local_num_tracks;
+
+        if (MPI_Allreduce(&local_num,
+                          &track_parts_total_num,
+                          1,
+                          MPI_SIZE_T,
+                          MPI_SUM,
+                          bunch.get_comm()) != MPI_SUCCESS) {
+            throw std::runtime_error(
+                "Error in MPI_Allreduce in diagnostics-tunes!");
+        }
+
+        if (MPI_Exscan(&local_num,
+                       &track_parts_offset_num,
+                       1,
+                       MPI_SIZE_T,
+                       MPI_SUM,
+                       bunch.get_comm()) != MPI_SUCCESS) {
+            throw std::runtime_error("Error in MPI_Exscan in diagnostics-tunes!");
+        }
+
+        // result of MPI_Exscan is undefined on rank 0
+        if (bunch.get_comm().rank() == 0) track_parts_offset_num = 0;
+
+        cached_local_num_tracks = local_num_tracks;
+    }
+#endif
+
+    alg_record rec{bunch.get_local_particles(),
+                   bunch.get_local_particle_masks(),
+                   sig,
+                   ids,
+                   local_offset,
+                   filled,
+                   filled == 0,
+                   beta_x,
+                   alpha_x,
+                   beta_y,
+                   alpha_y};
+    Kokkos::parallel_for(local_num_tracks, rec);
+
+    ++filled;
+
+    if (filled == window * 2) {
+        ref_s_n = ref.get_s_n();
+        ref_repetition = ref.get_repetition();
+
+        calculate_tunes();
+
+        filled = 0;
+        ready = true;
+    }
+}
+
+void
+Diagnostics_tunes::calculate_tunes()
+{
+    scoped_simple_timer timer("diag_tunes_calculate");
+
+    tunes_impl::run_tunes(sig, nus, local_num_tracks * 2, window, 2);
+
+    Kokkos::deep_copy(hids, ids);
+    Kokkos::deep_copy(hnus, nus);
+}
+
+void
+Diagnostics_tunes::do_first_write(io_device& file)
+{
+#ifdef SYNERGIA_HAVE_OPENPMD
+    file.setAttribute("charge", ref_charge);
+    file.setAttribute("mass", ref_mass);
+    file.setAttribute("pz", ref_pz);
+    file.setAttribute("window", window);
+#else
+    file.write("charge", ref_charge);
+    file.write("mass", ref_mass);
+    file.write("pz", ref_pz);
+    file.write("window", window);
+#endif
+}
+
+void
+Diagnostics_tunes::do_write(io_device& file, const size_t iteration)
+{
+    if (!ready) return;
+
+    scoped_simple_timer timer("diag_tunes_write");
+
+    // (nu_x, nu_y) of both windows, and the diffusion index
+    const int n = local_num_tracks;
+
+    karray2d_row tunes("tunes", n, 4);
+    karray1d diffusion("diffusion", n);
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double eps = std::numeric_limits<double>::epsilon();
+
+    for (int i = 0; i < n; ++i) {
+        // the signal of a lost particle is meaningless
+        if (hids(i) < 0) {
+            for (int j = 0; j < 4; ++j)
+                tunes(i, j) = nan;
+
+            diffusion(i) = nan;
+            continue;
+        }
+
+        for (int w = 0; w < 2; ++w) {
+            tunes(i, w * 2 + 0) = hnus((i * 2 + 0) * 2 + w);
+            tunes(i, w * 2 + 1) = hnus((i * 2 + 1) * 2 + w);
+        }
+
+        double dx = tunes(i, 2) - tunes(i, 0);
+        double dy = tunes(i, 3) - tunes(i, 1);
+        double dnu = std::sqrt(dx * dx + dy * dy);
+
+        diffusion(i) = std::log10(std::max(dnu, eps));
+    }
+
+#ifdef SYNERGIA_HAVE_OPENPMD
+    auto it = file.iterations[iteration];
+    it.setAttribute("tunes_s_n", ref_s_n);
+    it.setAttribute("tunes_repetition", ref_repetition);
+
+    openPMD::Datatype datatype = openPMD::determineDatatype<double>();
+    openPMD::Extent global_extent = {track_parts_total_num};
+    openPMD::Dataset dataset = openPMD::Dataset(datatype, global_extent);
+
+    openPMD::Offset chunk_offset = {track_parts_offset_num};
+    openPMD::Extent chunk_extent = {(size_t)n};
+
+    // openPMD records are per component and contiguous
+    std::array<std::vector<double>, 4> comps;
+    for (int j = 0; j < 4; ++j) {
+        comps[j].resize(n);
+        for (int i = 0; i < n; ++i)
+            comps[j][i] = tunes(i, j);
+    }
+
+    openPMD::ParticleSpecies& tracks = it.particles["tunes"];
+    auto const scalar = openPMD::RecordComponent::SCALAR;
+
+    tracks["id"][scalar].resetDataset(dataset);
+    tracks["diffusion"][scalar].resetDataset(dataset);
+    tracks["tune"]["x"].resetDataset(dataset);
+    tracks["tune"]["y"].resetDataset(dataset);
+    tracks["tune_late"]["x"].resetDataset(dataset);
+    tracks["tune_late"]["y"].resetDataset(dataset);
+
+    tracks["id"][scalar].storeChunkRaw(hids.data(), chunk_offset, chunk_extent);
+    tracks["diffusion"][scalar].storeChunkRaw(
+        diffusion.data(), chunk_offset, chunk_extent);
+    tracks["tune"]["x"].storeChunkRaw(
+        comps[0].data(), chunk_offset, chunk_extent);
+    tracks["tune"]["y"].storeChunkRaw(
+        comps[1].data(), chunk_offset, chunk_extent);
+    tracks["tune_late"]["x"].storeChunkRaw(
+        comps[2].data(), chunk_offset, chunk_extent);
+    tracks["tune_late"]["y"].storeChunkRaw(
+        comps[3].data(), chunk_offset, chunk_extent);
+
+    file.flush();
+#else
+    // write serial
+    file.append("tunes_s_n", ref_s_n);
+    file.append("tunes_repetition", ref_repetition);
+
+    // write collective from all ranks
+    file.append("tunes_ids", hids, true);
+    file.append("tunes", tunes, true);
+    file.append("diffusion", diffusion, true);
+#endif
+
+    ready = false;
+}
+
+double
+Diagnostics_tunes::get_tune(std::vector<double> const& re,
+                            std::vector<double> const& im)
+{
+    const int n = re.size();
+
+    if (n < 8 || tunes_impl::get_log2(n) < 0 || im.size() != re.size())
+        throw std::runtime_error(
+            "Diagnostics_tunes::get_tune: the length of the signal must be "
+            "a power of 2, at least 8");
+
+    karray3d_row_dev sig("sig", 1, n, 2);
+    karray1d_dev nus("nus", 1);
+
+    auto hsig = Kokkos::create_mirror_view(sig);
+    for (int t = 0; t < n; ++t) {
+        hsig(0, t, 0) = re[t];
+        hsig(0, t, 1) = im[t];
+    }
+
+    Kokkos::deep_copy(sig, hsig);
+
+    tunes_impl::run_tunes(sig, nus, 1, n, 1);
+
+    auto hnus = Kokkos::create_mirror_view(nus);
+    Kokkos::deep_copy(hnus, nus);
+
+    return hnus(0);
+}
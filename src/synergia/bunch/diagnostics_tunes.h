@@ -0,0 +1,128 @@
+#ifndef DIAGNOSTICS_TUNES_H_
+#define DIAGNOSTICS_TUNES_H_
+
+#include "synergia/bunch/bunch.h"
+#include "synergia/bunch/diagnostics.h"
+
+/// Diagnostics_tunes computes the betatron tunes of tracked particles in
+/// place, for tune footprints and frequency maps, without writing their
+/// turn by turn coordinates. It must be updated once per turn.
+///
+/// The normalized signals x - i (alpha_x x + beta_x x') and the same in y
+/// of every tracked particle are kept on the device for two consecutive
+/// windows of window turns. When both are full, the tunes of each window
+/// are found in one batched kernel: a Hann windowed FFT locates the
+/// peak, which is then refined to the maximum of the windowed Fourier
+/// amplitude, as in NAFF. The tunes of both windows and the diffusion
+/// index log10(sqrt(dnu_x^2 + dnu_y^2)) are written, and the recording
+/// restarts. Tune changes below the double precision epsilon count as
+/// the epsilon, so the index stays finite for identical tunes.
+///
+/// As with Diagnostics_bulk_track, a particle is only followed while it
+/// stays in its slot on the same rank. Particles lost or moved during the
+/// two windows are written with the id -1, and NaN tunes and index.
+class Diagnostics_tunes : public Diagnostics {
+
+  private:
+    int total_num_tracks, local_num_tracks;
+    int offset, local_offset;
+    bool setup;
+
+    // turns in a window, a power of 2
+    int window;
+
+    double beta_x, alpha_x;
+    double beta_y, alpha_y;
+
+    // turns recorded in the current pair of windows
+    int filled;
+
+    // tunes computed, and not written yet
+    bool ready;
+
+    double ref_charge;
+    double ref_mass;
+    double ref_pz;
+    double ref_s_n;
+    int ref_repetition;
+
+    // signals, (local_num_tracks * 2, 2 * window, 2), rows are x and y of
+    // every track, the last index is real and imaginary
+    karray3d_row_dev sig;
+
+    // ids at the start of the recording, -1 once lost
+    karray1d_dev ids;
+
+    // tune of every signal row and window, (local_num_tracks * 2, 2)
+    // flattened
+    karray1d_dev nus;
+
+    karray1d_hst hids;
+    karray1d_hst hnus;
+
+#ifdef SYNERGIA_HAVE_OPENPMD
+    // rank offsets, only recomputed when the local track count changes
+    int cached_local_num_tracks;
+    size_t track_parts_offset_num;
+    size_t track_parts_total_num;
+#endif
+
+  private:
+    void do_update(Bunch const& bunch) override;
+    void
+    do_reduce(Commxx const& comm, int root) override
+    {}
+    void do_first_write(io_device& file) override;
+    void do_write(io_device& file, const size_t iteration) override;
+
+    void allocate_buffers();
+    void calculate_tunes();
+
+    friend class cereal::access;
+
+    template <class AR>
+    void
+    serialize(AR& ar)
+    {
+        ar(cereal::base_class<Diagnostics>(this));
+        ar(total_num_tracks);
+        ar(local_num_tracks);
+        ar(offset);
+        ar(local_offset);
+        ar(setup);
+        ar(window);
+        ar(beta_x);
+        ar(alpha_x);
+        ar(beta_y);
+        ar(alpha_y);
+        ar(ref_charge);
+        ar(ref_mass);
+        ar(ref_pz);
+    }
+
+  public:
+    /// @param filename the file to write to
+    /// @param num_tracks the number of particles to analyse
+    /// @param offset index of the first particle to analyse
+    /// @param window turns in each of the two windows, a power of 2
+    /// @param beta_x, alpha_x, beta_y, alpha_y Twiss parameters of the
+    ///        lattice at the location of the diagnostics
+    Diagnostics_tunes(std::string const& filename = "diag_tunes.h5",
+                      int num_tracks = 0,
+                      int offset = 0,
+                      int window = 512,
+                      double beta_x = 1.0,
+                      double alpha_x = 0.0,
+                      double beta_y = 1.0,
+                      double alpha_y = 0.0);
+
+    /// tune of a single normalized signal z_n = re[n] + i im[n] of n
+    /// turns, in [0, 1). Launches the batched device kernel on the one
+    /// signal, for testing and small analyses
+    static double get_tune(std::vector<double> const& re,
+                           std::vector<double> const& im);
+};
+
+CEREAL_REGISTER_TYPE(Diagnostics_tunes)
+
+#endif /* DIAGNOSTICS_TUNES_H_ */
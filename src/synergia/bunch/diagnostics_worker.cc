@@ -2,6 +2,100 @@
 #include "synergia/bunch/diagnostics_worker.h"
 #include "synergia/bunch/bunch.h"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+    // a single writer thread per process. Batches are written in the
+    // order they were submitted, which is the same on every rank, so the
+    // MPI calls made by the writer match up across ranks
+    class writer_thread {
+      private:
+        static constexpr size_t max_jobs = 8;
+
+        std::mutex m;
+        std::condition_variable cv_job;
+        std::condition_variable cv_space;
+        std::deque<std::packaged_task<void()>> jobs;
+        std::thread th;
+        bool stop = false;
+
+        void
+        run()
+        {
+            for (;;) {
+                std::packaged_task<void()> job;
+
+                {
+                    std::unique_lock<std::mutex> lk(m);
+                    cv_job.wait(lk, [this] { return stop || !jobs.empty(); });
+                    if (jobs.empty()) return;
+
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+
+                cv_space.notify_one();
+                job();
+            }
+        }
+
+      public:
+        ~writer_thread()
+        {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                stop = true;
+            }
+
+            cv_job.notify_one();
+            if (th.joinable()) th.join();
+        }
+
+        // blocks when the queue is full
+        std::shared_future<void>
+        submit(std::function<void()> f)
+        {
+            std::packaged_task<void()> job(std::move(f));
+            auto fut = job.get_future().share();
+
+            {
+                std::unique_lock<std::mutex> lk(m);
+                if (!th.joinable()) th = std::thread([this] { run(); });
+
+                cv_space.wait(lk, [this] { return jobs.size() < max_jobs; });
+                jobs.push_back(std::move(job));
+            }
+
+            cv_job.notify_one();
+            return fut;
+        }
+    };
+
+    writer_thread&
+    writer()
+    {
+        static writer_thread w;
+        return w;
+    }
+}
+
+Diagnostics_worker::~Diagnostics_worker()
+{
+    try {
+        drain();
+    }
+    catch (std::exception const& e) {
+        std::cerr << "Diagnostics_worker: error writing queued diagnostics: "
+                  << e.what() << "\n";
+    }
+}
+
 std::string
 Diagnostics_worker::type() const
 {
@@ -12,6 +106,14 @@ void
 Diagnostics_worker::update(Bunch const& bunch)
 {
     diag->update(bunch);
+
+    // the file may be in use by the writer thread, the root rank
+    // has been cached when the worker was created
+    if (async_depth) {
+        diag->reduce(bunch.get_comm(), root_rank);
+        return;
+    }
+
     // need to open file for the HDF5 backend to have
     // a meaningful root rank, previously this was done
     // implicity via get_file
@@ -22,6 +124,129 @@ Diagnostics_worker::update(Bunch const& bunch)
 void
 Diagnostics_worker::write()
 {
+    if (async_depth) {
+        auto snapshot = diag->snapshot();
+
+        if (snapshot) {
+            queue.push_back(snapshot);
+            if (queue.size() >= async_depth) submit_batch();
+            return;
+        }
+
+        // diagnostics without snapshot support are written synchronously,
+        // after everything that has been queued before them. Data they
+        // buffer themselves is left alone, the update just taken sits in
+        // their buffer and is written by the call below
+        write_queue();
+        diag_io.open_file();
+    }
+
     diag->write(diag_io.get_io_device(), diag_io.get_count());
     diag_io.finish_write();
 }
+
+void
+Diagnostics_worker::write_queue()
+{
+    submit_batch();
+    wait_pending();
+}
+
+void
+Diagnostics_worker::drain()
+{
+    write_queue();
+
+    // data buffered inside the diagnostics itself
+    if (diag && diag->buffered()) {
+        diag_io.open_file();
+        diag->flush(diag_io.get_io_device());
+        diag_io.flush_file(true);
+    }
+}
+
+bool
+Diagnostics_worker::threaded_writer_supported()
+{
+#if defined SYNERGIA_HAVE_OPENPMD || defined USE_PARALLEL_HDF5
+    // collective I/O inside the HDF5 global lock can deadlock against
+    // the collectives of the main thread
+    return false;
+#else
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Query_thread(&provided);
+
+    hbool_t threadsafe = false;
+    H5is_library_threadsafe(&threadsafe);
+
+    return provided == MPI_THREAD_MULTIPLE && threadsafe;
+#endif
+}
+
+std::shared_ptr<Commxx>
+Diagnostics_worker::io_comm(std::shared_ptr<Commxx> const& comm) const
+{
+    // the writer thread gets its own communicator so its messages never
+    // mix with the collectives of the main thread
+    if (threaded) return std::make_shared<Commxx>(comm->dup());
+    return comm;
+}
+
+void
+Diagnostics_worker::submit_batch()
+{
+    if (queue.empty()) return;
+
+    // at most one batch in flight per worker
+    wait_pending();
+
+    auto batch = std::move(queue);
+    queue.clear();
+
+    if (threaded) {
+        pending = writer().submit(
+            [this, batch = std::move(batch)] { write_batch(batch); });
+    } else {
+        write_batch(batch);
+    }
+}
+
+void
+Diagnostics_worker::write_batch(
+    std::vector<std::shared_ptr<Diagnostics>> const& batch)
+{
+    for (auto const& snapshot : batch) {
+        diag_io.open_file();
+        snapshot->write(diag_io.get_io_device(), diag_io.get_count());
+        diag_io.finish_write(false);
+    }
+
+    // one flush per batch
+    diag_io.flush_file(true);
+}
+
+void
+Diagnostics_worker::wait_pending()
+{
+    if (!pending.valid()) return;
+
+    auto p = std::move(pending);
+    pending = std::shared_future<void>();
+
+    // rethrows the errors from the writer thread
+    p.get();
+}
+
+std::shared_future<void>
+Diagnostics_worker::settle() noexcept
+{
+    try {
+        wait_pending();
+    }
+    catch (std::exception const& e) {
+        std::cerr << "Diagnostics_worker: error writing queued diagnostics: "
+                  << e.what() << "\n";
+    }
+
+    return std::shared_future<void>();
+}
@@ -1,8 +1,10 @@
 #ifndef DIAGNOSTICS_WORKER_H
 #define DIAGNOSTICS_WORKER_H
 
+#include <future>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <cereal/types/memory.hpp>
 
@@ -12,28 +14,85 @@
 class Diagnostics_worker {
 
   private:
+    // the batch handed to the writer thread and not yet finished.
+    // Declared first so a move waits for it before touching anything else
+    std::shared_future<void> pending;
+
     std::shared_ptr<Diagnostics> diag;
+
+    // async writes: reduced snapshots of up to async_depth updates are
+    // queued and written as one batch, on the writer thread if the
+    // MPI and HDF5 libraries allow it, inline otherwise
+    size_t async_depth;
+    bool threaded;
+    std::vector<std::shared_ptr<Diagnostics>> queue;
+
+    // the communicator of the diagnostics, the file is written on a
+    // duplicate of it when threaded
+    std::shared_ptr<Commxx> comm;
+
     Diagnostics_io diag_io;
+    int root_rank;
 
   public:
     // default constructor for serialization only
-    Diagnostics_worker() : diag(), diag_io() {}
+    Diagnostics_worker()
+        : pending()
+        , diag()
+        , async_depth(0)
+        , threaded(false)
+        , queue()
+        , comm()
+        , diag_io()
+        , root_rank(0)
+    {}
 
     // construct a diag worker with given type of diag and filename
     // specialization is provided for s_p<Diagnostics> so the python
     // interface can register
     template <class DiagCal>
-    Diagnostics_worker(DiagCal const& diag, std::shared_ptr<Commxx> const& comm)
-        : diag(std::make_shared<DiagCal>(diag))
-        , diag_io(diag.filename(), diag.single_file(), comm)
+    Diagnostics_worker(DiagCal const& diag,
+                       std::shared_ptr<Commxx> const& comm,
+                       size_t async_depth = 0)
+        : pending()
+        , diag(std::make_shared<DiagCal>(diag))
+        , async_depth(async_depth)
+        , threaded(async_depth && threaded_writer_supported())
+        , queue()
+        , comm(comm)
+        , diag_io(diag.filename(), diag.single_file(), io_comm(comm))
+        , root_rank(diag_io.get_root_rank())
     {}
 
     // for registering from python only
     Diagnostics_worker(std::shared_ptr<Diagnostics> const& diag,
-                       std::shared_ptr<Commxx> const& comm)
-        : diag(diag), diag_io(diag->filename(), diag->single_file(), comm)
+                       std::shared_ptr<Commxx> const& comm,
+                       size_t async_depth = 0)
+        : pending()
+        , diag(diag)
+        , async_depth(async_depth)
+        , threaded(async_depth && threaded_writer_supported())
+        , queue()
+        , comm(comm)
+        , diag_io(diag->filename(), diag->single_file(), io_comm(comm))
+        , root_rank(diag_io.get_root_rank())
+    {}
+
+    // waits for the in-flight batch of the source, so the writer thread
+    // never works on a moved-from io object
+    Diagnostics_worker(Diagnostics_worker&& o) noexcept
+        : pending(o.settle())
+        , diag(std::move(o.diag))
+        , async_depth(o.async_depth)
+        , threaded(o.threaded)
+        , queue(std::move(o.queue))
+        , comm(std::move(o.comm))
+        , diag_io(std::move(o.diag_io))
+        , root_rank(o.root_rank)
     {}
 
+    ~Diagnostics_worker();
+
     std::string type() const;
 
     void update(Bunch const& bunch);
@@ -46,15 +105,57 @@ class Diagnostics_worker {
         write();
     }
 
+    // write out everything queued, and the data buffered inside the
+    // diagnostics, and wait for the writer to finish. For checkpoints and
+    // the end of a run, not for every write
+    void drain();
+
+    // whether the writer thread can be used in this process. It needs
+    // MPI_THREAD_MULTIPLE and a thread-safe, serial HDF5 library
+    static bool threaded_writer_supported();
+
   private:
+    std::shared_ptr<Commxx> io_comm(std::shared_ptr<Commxx> const& comm) const;
+
+    // writes the queued snapshots and waits for them
+    void write_queue();
+
+    void submit_batch();
+    void write_batch(std::vector<std::shared_ptr<Diagnostics>> const& batch);
+    void wait_pending();
+    std::shared_future<void> settle() noexcept;
+
     friend class cereal::access;
 
     template <class AR>
     void
-    serialize(AR& ar)
+    save(AR& ar) const
+    {
+        // queued snapshots must be in the file before it is checkpointed
+        const_cast<Diagnostics_worker*>(this)->drain();
+
+        ar(CEREAL_NVP(diag));
+        ar(CEREAL_NVP(diag_io));
+        ar(CEREAL_NVP(async_depth));
+        ar(CEREAL_NVP(comm));
+        ar(CEREAL_NVP(root_rank));
+    }
+
+    template <class AR>
+    void
+    load(AR& ar)
     {
         ar(CEREAL_NVP(diag));
         ar(CEREAL_NVP(diag_io));
+        ar(CEREAL_NVP(async_depth));
+        ar(CEREAL_NVP(comm));
+        ar(CEREAL_NVP(root_rank));
+
+        // the restarted process may run at another MPI thread level or
+        // with another HDF5 library, so the writer thread and its
+        // communicator are decided again
+        threaded = async_depth && threaded_writer_supported();
+        diag_io.set_comm(io_comm(comm));
     }
 };
 
@@ -93,6 +194,12 @@ class Diagnostics_handler {
     {
         if (worker) worker->update_and_write(*bunch);
     }
+
+    void
+    drain()
+    {
+        if (worker) worker->drain();
+    }
 };
 
 #endif
@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "particle_binning.h"
+
+namespace particle_binning_impl {
+    using team_policy = Kokkos::TeamPolicy<>;
+    using team_member = team_policy::member_type;
+
+    using scratch_t =
+        Kokkos::View<double*,
+                     Kokkos::DefaultExecutionSpace::scratch_memory_space,
+                     Kokkos::MemoryTraits<Kokkos::Unmanaged>>;
+
+    using Projection = Particle_binning::Projection;
+
+    // particles per team at the least
+    constexpr int min_block = 1024;
+
+    // bin of v, the upper edge goes to the last bin, -1 if outside
+    KOKKOS_INLINE_FUNCTION
+    int
+    get_bin(double v, double left, double h, double recip_h, int bins)
+    {
+        double d = v - left;
+        double fb = floor(d * recip_h);
+        if (fb >= 0.0 && fb < bins) return (int)fb;
+
+        // only the edge itself, not the rest of the bin above it
+        return (fb == bins && d <= bins * h) ? bins - 1 : -1;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    double
+    get_coord(ConstParticles const& p, int i, int coord, Projection const& pj)
+    {
+        if (coord == Particle_binning::radius) {
+            double x = p(i, 0) - pj.cx;
+            double y = p(i, 2) - pj.cy;
+            return sqrt(x * x + y * y);
+        }
+
+        if (coord == Particle_binning::action) {
+            double x = p(i, 0);
+            double xp = p(i, 1);
+            double y = p(i, 2);
+            double yp = p(i, 3);
+
+            double gx = (1.0 + pj.alpha_x * pj.alpha_x) / pj.beta_x;
+            double gy = (1.0 + pj.alpha_y * pj.alpha_y) / pj.beta_y;
+
+            return 0.5 * (gx * x * x + 2.0 * pj.alpha_x * x * xp +
+                          pj.beta_x * xp * xp) +
+                   0.5 * (gy * y * y + 2.0 * pj.alpha_y * y * yp +
+                          pj.beta_y * yp * yp);
+        }
+
+        return p(i, coord);
+    }
+
+    struct alg_team_binning {
+        ConstParticles p;
+        ConstParticleMasks masks;
+        karray1d_dev hist;
+
+        int npart;
+        int block;
+        int level;
+
+        int coord;
+        double left;
+        double h;
+        double recip_h;
+        int bins;
+
+        int nsums;
+        int s0;
+        int s1;
+        int s2;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const team_member& member) const
+        {
+            const int n = (nsums + 1) * bins;
+            scratch_t h(member.team_scratch(level), n);
+
+            Kokkos::parallel_for(Kokkos::TeamThreadRange(member, n),
+                                 [&](const int k) { h(k) = 0.0; });
+            member.team_barrier();
+
+            const int first = member.league_rank() * block;
+            const int last = first + block < npart ? first + block : npart;
+
+            Kokkos::parallel_for(
+                Kokkos::TeamThreadRange(member, first, last),
+                [&](const int i) {
+                    if (!masks(i)) return;
+
+                    int b = get_bin(p(i, coord), left, h, recip_h, bins);
+                    if (b < 0) return;
+
+                    Kokkos::atomic_add(&h(b), 1.0);
+                    if (nsums > 0) Kokkos::atomic_add(&h(bins + b), p(i, s0));
+                    if (nsums > 1)
+                        Kokkos::atomic_add(&h(bins * 2 + b), p(i, s1));
+                    if (nsums > 2)
+                        Kokkos::atomic_add(&h(bins * 3 + b), p(i, s2));
+                });
+            member.team_barrier();
+
+            // empty bins are common in the tails, skip them
+            Kokkos::parallel_for(Kokkos::TeamThreadRange(member, n),
+                                 [&](const int k) {
+                                     if (h(k) != 0.0)
+                                         Kokkos::atomic_add(&hist(k), h(k));
+                                 });
+        }
+    };
+
+    struct alg_team_projections {
+        ConstParticles p;
+        ConstParticleMasks masks;
+        karray1d_dev hist;
+
+        Kokkos::View<Projection*> projs;
+        Kokkos::View<int*> offsets;
+
+        int nprojs;
+        int size;
+
+        int npart;
+        int block;
+        int level;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const team_member& member) const
+        {
+            scratch_t h(member.team_scratch(level), size);
+
+            Kokkos::parallel_for(Kokkos::TeamThreadRange(member, size),
+                                 [&](const int k) { h(k) = 0.0; });
+            member.team_barrier();
+
+            const int first = member.league_rank() * block;
+            const int last = first + block < npart ? first + block : npart;
+
+            Kokkos::parallel_for(
+                Kokkos::TeamThreadRange(member, first, last),
+                [&](const int i) {
+                    if (!masks(i)) return;
+
+                    for (int j = 0; j < nprojs; ++j) {
+                        Projection const& pj = projs(j);
+
+                        int b = get_bin(get_coord(p, i, pj.coord0, pj),
+                                        pj.left0,
+                                        pj.h0,
+                                        1.0 / pj.h0,
+                                        pj.bins0);
+                        if (b < 0) continue;
+
+                        if (pj.coord1 >= 0) {
+                            int b1 = get_bin(get_coord(p, i, pj.coord1, pj),
+                                             pj.left1,
+                                             pj.h1,
+                                             1.0 / pj.h1,
+                                             pj.bins1);
+                            if (b1 < 0) continue;
+
+                            b = b * pj.bins1 + b1;
+                        }
+
+                        Kokkos::atomic_add(&h(offsets(j) + b), 1.0);
+                    }
+                });
+            member.team_barrier();
+
+            Kokkos::parallel_for(Kokkos::TeamThreadRange(member, size),
+                                 [&](const int k) {
+                                     if (h(k) != 0.0)
+                                         Kokkos::atomic_add(&hist(k), h(k));
+                                 });
+        }
+    };
+
+    // runs the binning alg on enough teams to fill the device, but no
+    // more than the particles can keep busy, since every team adds its
+    // histogram of n bins once
+    template <class ALG>
+    void
+    launch(ALG& alg, int npart, int n, const char* label)
+    {
+        // the histogram goes to the larger (level 1) scratch if it does
+        // not fit in the fast one
+        const size_t bytes = scratch_t::shmem_size(n);
+        alg.level = bytes <= 32 * 1024 ? 0 : 1;
+
+        auto probe = team_policy(1, Kokkos::AUTO)
+                         .set_scratch_size(alg.level, Kokkos::PerTeam(bytes));
+        const int team_size =
+            probe.team_size_recommended(alg, Kokkos::ParallelForTag());
+
+        const int max_teams = std::max(
+            1, Kokkos::DefaultExecutionSpace().concurrency() / team_size);
+        const int teams = std::max(
+            1, std::min(max_teams, (npart + min_block - 1) / min_block));
+
+        alg.block = (npart + teams - 1) / teams;
+
+        auto policy = team_policy(teams, team_size)
+                          .set_scratch_size(alg.level, Kokkos::PerTeam(bytes));
+
+        Kokkos::parallel_for(label, policy, alg);
+        Kokkos::fence();
+    }
+}
+
+void
+Particle_binning::bin_1d(Bunch const& bunch,
+                         int coord,
+                         double left,
+                         double h,
+                         int bins,
+                         std::vector<int> const& sums,
+                         karray1d_dev const& hist)
+{
+    using namespace particle_binning_impl;
+
+    const int nsums = sums.size();
+
+    if (nsums > max_sums)
+        throw std::runtime_error(
+            "Particle_binning::bin_1d: too many summed coordinates");
+
+    if (hist.extent(0) < (nsums + 1) * bins)
+        throw std::runtime_error("Particle_binning::bin_1d: hist too small");
+
+    Kokkos::deep_copy(hist, 0.0);
+
+    const int npart = bunch.size();
+    if (npart == 0) return;
+
+    alg_team_binning alg{bunch.get_local_particles(),
+                         bunch.get_local_particle_masks(),
+                         hist,
+                         npart,
+                         0,
+                         0,
+                         coord,
+                         left,
+                         h,
+                         1.0 / h,
+                         bins,
+                         nsums,
+                         nsums > 0 ? sums[0] : 0,
+                         nsums > 1 ? sums[1] : 0,
+                         nsums > 2 ? sums[2] : 0};
+
+    launch(alg, npart, (nsums + 1) * bins, "particle_binning_1d");
+}
+
+void
+Particle_binning::bin_projections(Bunch const& bunch,
+                                  std::vector<Projection> const& projs,
+                                  karray1d_dev const& hist,
+                                  Projection_views& views)
+{
+    using namespace particle_binning_impl;
+
+    const int nprojs = projs.size();
+
+    if ((int)views.projs.extent(0) != nprojs) {
+        views.projs = Kokkos::View<Projection*>("projs", nprojs);
+        views.offsets = Kokkos::View<int*>("offsets", nprojs);
+
+        views.hprojs = Kokkos::create_mirror_view(views.projs);
+        views.hoffsets = Kokkos::create_mirror_view(views.offsets);
+    }
+
+    auto const& d_projs = views.projs;
+    auto const& d_offsets = views.offsets;
+
+    auto const& h_projs = views.hprojs;
+    auto const& h_offsets = views.hoffsets;
+
+    int size = 0;
+
+    for (int j = 0; j < nprojs; ++j) {
+        h_projs(j) = projs[j];
+        h_offsets(j) = size;
+        size += projs[j].size();
+    }
+
+    if (hist.extent(0) < size)
+        throw std::runtime_error(
+            "Particle_binning::bin_projections: hist too small");
+
+    Kokkos::deep_copy(d_projs, h_projs);
+    Kokkos::deep_copy(d_offsets, h_offsets);
+    Kokkos::deep_copy(hist, 0.0);
+
+    const int npart = bunch.size();
+    if (npart == 0 || size == 0) return;
+
+    alg_team_projections alg{bunch.get_local_particles(),
+                             bunch.get_local_particle_masks(),
+                             hist,
+                             d_projs,
+                             d_offsets,
+                             nprojs,
+                             size,
+                             npart,
+                             0,
+                             0};
+
+    launch(alg, npart, size, "particle_binning_projections");
+}
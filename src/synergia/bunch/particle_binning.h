@@ -0,0 +1,88 @@
+#ifndef PARTICLE_BINNING_H_
+#define PARTICLE_BINNING_H_
+
+#include "synergia/bunch/bunch.h"
+
+/// Histograms of the local particles of a bunch in equal bins of one
+/// coordinate. Every team of threads bins a contiguous block of particles
+/// into its own histogram in team scratch memory, and then adds it into
+/// the result with one atomic per bin. The workspace is one histogram per
+/// team, not one per thread as with a reduction or a ScatterView.
+struct Particle_binning {
+    /// largest number of summed coordinates
+    static constexpr int max_sums = 3;
+
+    /// Bins the particles on coord, bin b covers
+    /// [left + b*h, left + (b+1)*h). Particles at the upper edge go into
+    /// the last bin, other particles outside of the bins are dropped.
+    /// hist must hold (1 + sums.size()) * bins values. It is overwritten
+    /// with the number of particles in each bin, followed by the sum of
+    /// each of the coordinates in sums over each bin. There is no
+    /// reduction over the ranks of the bunch.
+    static void bin_1d(Bunch const& bunch,
+                       int coord,
+                       double left,
+                       double h,
+                       int bins,
+                       std::vector<int> const& sums,
+                       karray1d_dev const& hist);
+
+    /// coordinate index of the radius sqrt((x-cx)^2 + (y-cy)^2)
+    static constexpr int radius = 6;
+
+    /// coordinate index of the transverse action Jx + Jy about the
+    /// reference orbit, with J = (gamma u^2 + 2 alpha u u' + beta u'^2)/2
+    /// from the Twiss parameters of the projection
+    static constexpr int action = 7;
+
+    /// a 1d (coord1 < 0) or 2d projection, the bins are as in bin_1d
+    struct Projection {
+        int coord0 = 0;
+        int coord1 = -1;
+        int bins0 = 1;
+        int bins1 = 1;
+        double left0 = 0.0;
+        double h0 = 1.0;
+        double left1 = 0.0;
+        double h1 = 1.0;
+
+        // centre of the radius
+        double cx = 0.0;
+        double cy = 0.0;
+
+        // Twiss parameters of the action
+        double beta_x = 1.0;
+        double alpha_x = 0.0;
+        double beta_y = 1.0;
+        double alpha_y = 0.0;
+
+        int
+        size() const
+        {
+            return coord1 < 0 ? bins0 : bins0 * bins1;
+        }
+    };
+
+    /// device copies of the projections and of the offsets of their
+    /// histograms, kept by the caller across calls of bin_projections
+    struct Projection_views {
+        Kokkos::View<Projection*> projs;
+        Kokkos::View<int*> offsets;
+
+        Kokkos::View<Projection*>::HostMirror hprojs;
+        Kokkos::View<int*>::HostMirror hoffsets;
+    };
+
+    /// Bins the particles on all of the projections in a single pass.
+    /// hist is overwritten with the histograms one after the other, a 2d
+    /// histogram is row major in (coord0, coord1). A particle outside of
+    /// any of the two ranges of a 2d projection is dropped from it. There
+    /// is no reduction over the ranks of the bunch. The views are only
+    /// reallocated when the number of projections changes.
+    static void bin_projections(Bunch const& bunch,
+                                std::vector<Projection> const& projs,
+                                karray1d_dev const& hist,
+                                Projection_views& views);
+};
+
+#endif /* PARTICLE_BINNING_H_ */
@@ -29,37 +29,82 @@ namespace {
     }
 }
 
+namespace {
+    // p = map * (p - bunch_mean) + means, for the 6 coordinates
+    struct moments_adjuster {
+        Particles parts;
+        karray1d_dev map;
+        karray1d_dev bunch_mean;
+        karray1d_dev means;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i) const
+        {
+            double p[6];
+            for (int j = 0; j < 6; ++j)
+                p[j] = parts(i, j) - bunch_mean(j);
+
+            for (int j = 0; j < 6; ++j) {
+                double v = means(j);
+                for (int k = 0; k < 6; ++k)
+                    v += map(j * 6 + k) * p[k];
+                parts(i, j) = v;
+            }
+        }
+    };
+
+    karray1d_dev
+    to_device(std::string const& label, double const* data, int n)
+    {
+        karray1d_dev dev(label, n);
+        auto hdev = Kokkos::create_mirror_view(dev);
+
+        for (int i = 0; i < n; ++i)
+            hdev(i) = data[i];
+
+        Kokkos::deep_copy(dev, hdev);
+        return dev;
+    }
+}
+
 void
-adjust_moments(Bunch& bunch,
-               const_karray1d means,
-               const_karray2d_row covariances)
+adjust_moments_device(Bunch& bunch,
+                      const_karray1d means,
+                      const_karray2d_row covariances)
 {
     if (!is_symmetric66(covariances))
         throw std::runtime_error(
             "adjust_moments: covariance matrix must be symmetric");
 
-    // calculate_mean and mom2 are performed on device memory, so we need to
-    // copy the particle data from host to device first. checkout is not
-    // necessary since the core diagnostics do not change the particle data
-    bunch.checkin_particles();
-
     karray1d bunch_mean = Core_diagnostics::calculate_mean(bunch);
     karray2d_row bunch_mom2 =
         Core_diagnostics::calculate_mom2(bunch, bunch_mean);
 
-    int num_particles = bunch.size();
-    int num_particles_slots = bunch.capacity();
+    // the 6x6 map is solved on the host, only the particles are
+    // transformed on the device
+    karray1d map("map", 36);
+    moments_map_host(covariances.data(), bunch_mom2.data(), map.data());
 
-    // auto strides = bunch.get_particle_strides();
-    // int num_particles_slots = strides[1];
+    moments_adjuster adj{bunch.get_local_particles(),
+                         to_device("map", map.data(), 36),
+                         to_device("bunch_mean", bunch_mean.data(), 6),
+                         to_device("means", means.data(), 6)};
 
-    adjust_moments_host(means.data(),
-                        covariances.data(),
-                        bunch_mean.data(),
-                        bunch_mom2.data(),
-                        num_particles,
-                        num_particles_slots,
-                        bunch.get_host_particles().data());
+    Kokkos::parallel_for(bunch.size(), adj);
+}
+
+void
+adjust_moments(Bunch& bunch,
+               const_karray1d means,
+               const_karray2d_row covariances)
+{
+    // calculate_mean and mom2 are performed on device memory, so we need to
+    // copy the particle data from host to device first, and the adjusted
+    // particles back
+    bunch.checkin_particles();
+    adjust_moments_device(bunch, means, covariances);
+    bunch.checkout_particles();
 }
 
 namespace {
@@ -115,8 +115,15 @@ populate_transverseKV_logitudinalGaussian(Distribution &dist, Bunch &bunch,   ka
 
 #endif
 
+// adjusts the means and covariances of the particles in host memory
 void adjust_moments(Bunch& bunch,
                     const_karray1d means,
                     const_karray2d_row covariances);
 
+// same as adjust_moments(), but on the particles in device memory. The
+// host particles are left untouched
+void adjust_moments_device(Bunch& bunch,
+                           const_karray1d means,
+                           const_karray2d_row covariances);
+
 #endif /* POPULATE_H_ */
@@ -6,90 +6,69 @@
 #include "synergia/foundation/math_constants.h"
 #include "synergia/utils/floating_point.h"
 
-#include "synergia/utils/pcg/pcg_random.hpp"
-#include <random>
+#include "synergia/utils/philox.h"
 
 using mconstants::pi;
 
 namespace {
-    void
-    fill_unit_6d(std::vector<pcg64>& rngs,
-                 HostParticles parts,
-                 HostParticleMasks masks,
-                 HostParticleMasks valid,
-                 const_karray2d_row covariances)
-    {
-        const int np = valid.extent(0);
-        std::uniform_real_distribution<double> dist(0.0, 1.0);
-
-        for (int j = 0; j < 6; ++j) {
-            const double scale = sqrt(covariances(j, j));
-
-            for (int p = 0; p < np; ++p) {
-                if (masks(p) && !valid(p)) parts(p, j) = dist(rngs[p]) * scale;
+    // gaussian coordinates for the particles that are not valid yet. The
+    // numbers only depend on the seed, the particle id and the round, so
+    // the bunch is the same on any number of ranks and any device
+    struct unit_filler {
+        Particles parts;
+        ConstParticleMasks masks;
+        ConstParticleMasks valid;
+
+        uint64_t seed;
+        uint32_t round;
+        double scale[6];
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int p) const
+        {
+            if (!masks(p) || valid(p)) return;
+
+            philox::rng rng(seed, (uint64_t)parts(p, 6), round);
+
+            for (int j = 0; j < 6; j += 2) {
+                double a, b;
+                rng.normal2(a, b);
+
+                parts(p, j) = a * scale[j];
+                parts(p, j + 1) = b * scale[j + 1];
             }
         }
-    }
-
-    void
-    fill_unit_6d(uint64_t seed,
-                 HostParticles parts,
-                 HostParticleMasks masks,
-                 int np,
-                 const_karray2d_row covariances)
-    {
-        std::uniform_real_distribution<double> dist(0.0, 1.0);
-
-        std::array<double, 6> scales;
-        for (int j = 0; j < 6; ++j)
-            scales[j] = sqrt(covariances(j, j));
-
-        for (int p = 0; p < np; ++p) {
-            if (!masks(p)) continue;
-
-            pcg64 rng(seed, (uint64_t)parts(p, 6));
-
-            for (int j = 0; j < 6; ++j)
-                parts(p, j) = dist(rng) * scales[j];
-        }
-    }
-
-    inline bool
-    good(ConstHostParticles parts, int index, const_karray1d limits)
-    {
-        bool retval = true;
-
-        for (int i = 0; i < 6; ++i) {
-            double val = parts(index, i);
-            double limit = limits[i];
-
-            if ((limit > 0) && ((val > limit) or (val < -limit)))
-                retval = false;
-        }
-
-        return retval;
-    }
-
-    int
-    strip_unit_6d(ConstHostParticles parts,
-                  HostParticleMasks masks,
-                  HostParticleMasks valid,
-                  const_karray1d limits)
-    {
-        const int np = valid.extent(0);
-        int failed_num = 0;
-
-        for (int p = 0; p < np; ++p) {
-            if (masks(p) && !valid(p)) {
-                if (good(parts, p, limits))
-                    valid(p) = 1;
-                else
-                    ++failed_num;
+    };
+
+    // marks the particles within the limits as valid, and counts the
+    // ones outside
+    struct unit_stripper {
+        ConstParticles parts;
+        ConstParticleMasks masks;
+        ParticleMasks valid;
+
+        double limits[6];
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int p, int& bad) const
+        {
+            if (!masks(p) || valid(p)) return;
+
+            for (int i = 0; i < 6; ++i) {
+                double val = parts(p, i);
+                double limit = limits[i];
+
+                if ((limit > 0) && ((val > limit) || (val < -limit))) {
+                    ++bad;
+                    return;
+                }
             }
-        }
 
-        return failed_num;
-    }
+            valid(p) = 1;
+        }
+    };
 }
 
 void
@@ -118,13 +97,11 @@ populate_global_6d_truncated(uint64_t seed,
     multi_array_assert_size(limits, 6, "populate_6d: limits");
 #endif
 
-    // deep copy from device to host
-    // not for particles, but for masks
-    bunch.checkout_particles();
-
+    // the particles are generated on the device, only the
+    // ids and masks are needed
     const int np = bunch.size();
-    auto parts = bunch.get_host_particles();
-    auto masks = bunch.get_host_particle_masks();
+    auto parts = bunch.get_local_particles();
+    auto masks = bunch.get_local_particle_masks();
 
     karray2d_row unit_covariances("unit_covariances", 6, 6);
     karray1d zero_means("zero_means", 6);
@@ -149,17 +126,18 @@ populate_global_6d_truncated(uint64_t seed,
         }
     }
 
-    if (truncated) {
-        // a mask indicating whether the generated particle is valid
-        // defaults to 0 for all particles
-        HostParticleMasks valid("valid", np);
+    // a mask indicating whether the generated particle is valid
+    // defaults to 0 for all particles
+    ParticleMasks valid("valid", np);
 
-        // random number generators, one for each particle
-        std::vector<pcg64> rngs;
-        rngs.reserve(np);
+    unit_filler filler{parts, masks, valid, seed, 0, {}};
+    for (int j = 0; j < 6; ++j)
+        filler.scale[j] = sqrt(unit_covariances(j, j));
 
-        for (int i = 0; i < np; ++i)
-            rngs[i] = pcg64(seed, (uint64_t)parts(i, 6));
+    if (truncated) {
+        unit_stripper stripper{parts, masks, valid, {}};
+        for (int j = 0; j < 6; ++j)
+            stripper.limits[j] = limits[j];
 
         // loop to generate all particles
         // total_bad is init to 1 because the MPI_Allreduce has to be
@@ -171,9 +149,14 @@ populate_global_6d_truncated(uint64_t seed,
         int total_bad = 1;
 
         while (total_bad && iter < max_iters) {
-            fill_unit_6d(rngs, parts, masks, valid, unit_covariances);
-            adjust_moments(bunch, zero_means, unit_covariances);
-            int bad = strip_unit_6d(parts, masks, valid, limits);
+            // every round draws new numbers for the rejected particles
+            filler.round = iter;
+            Kokkos::parallel_for(np, filler);
+
+            adjust_moments_device(bunch, zero_means, unit_covariances);
+
+            int bad = 0;
+            Kokkos::parallel_reduce(np, stripper, bad);
 
             MPI_Allreduce(
                 &bad, &total_bad, 1, MPI_INT, MPI_SUM, bunch.get_comm());
@@ -188,14 +171,14 @@ populate_global_6d_truncated(uint64_t seed,
                 "Algorithm known to fail ~< 2.5 sigma.");
         }
     } else {
-        fill_unit_6d(seed, parts, masks, np, unit_covariances);
+        Kokkos::parallel_for(np, filler);
     }
 
     // adjust
-    adjust_moments(bunch, means, covariances);
+    adjust_moments_device(bunch, means, covariances);
 
-    // copy to device
-    bunch.checkin_particles();
+    // the host arrays are stale until now
+    bunch.checkout_particles();
 
     // check
     bunch.check_pz2_positive();
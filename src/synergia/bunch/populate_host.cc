@@ -7,41 +7,17 @@
 using namespace Eigen;
 
 void
-adjust_moments_host(double const* means,
-                    double const* covariances,
-                    double const* bunch_mean,
-                    double const* bunch_mom2,
-                    int num_particles,
-                    int num_particles_slots,
-                    double* particles)
+moments_map_host(double const* covariances,
+                 double const* bunch_mom2,
+                 double* map)
 {
     Matrix<double, 6, 6, Eigen::RowMajor> C(covariances);
     Matrix<double, 6, 6, Eigen::RowMajor> G(C.llt().matrixL());
     Matrix<double, 6, 6, Eigen::RowMajor> X(bunch_mom2);
     Matrix<double, 6, 6, Eigen::RowMajor> H(X.llt().matrixL());
-    Matrix<double, 6, 6, Eigen::RowMajor> A(G * H.inverse());
 
-    // jfa: dummy exists only to work around a bad interaction betwen
-    //      Eigen3 and g++ 4.1.2
-    std::stringstream dummy;
-    dummy << C;
-
-    Eigen::Map<Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor>>
-        rho7(particles, num_particles_slots, 7);
-
-    Matrix<double, 1, 6> rhobar6(bunch_mean);
-
-    for (int part = 0; part < num_particles; ++part) {
-        rho7.block<1, 6>(part, 0) -= rhobar6;
-    }
-
-    rho7.block(0, 0, num_particles, 6) *= A.transpose();
-
-    Matrix<double, 1, 6> means6(means);
-
-    for (int part = 0; part < num_particles; ++part) {
-        rho7.block<1, 6>(part, 0) += means6;
-    }
+    Eigen::Map<Matrix<double, 6, 6, Eigen::RowMajor>> A(map);
+    A = G * H.inverse();
 }
 
 void
@@ -3,13 +3,12 @@
 
 #include <array>
 
-void adjust_moments_host(double const* means,
-                         double const* covariances,
-                         double const* bunch_mean,
-                         double const* bunch_mom2,
-                         int num_particles,
-                         int num_particles_slots,
-                         double* particles);
+// the 6x6 linear map (row major) that takes particles with the second
+// moments bunch_mom2 to ones with the covariances. Applied to the
+// particles by adjust_moments()
+void moments_map_host(double const* covariances,
+                      double const* bunch_mom2,
+                      double* map);
 
 void get_correlation_matrix_host(double* correlation_matrix,
                                  double const* one_turn_map,
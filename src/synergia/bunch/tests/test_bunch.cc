@@ -1,6 +1,8 @@
 #include "synergia/utils/catch.hpp"
 
 #include "synergia/bunch/bunch.h"
+#include "synergia/bunch/diagnostics_bulk_track.h"
+#include "synergia/bunch/diagnostics_full2.h"
 #include "synergia/foundation/physical_constants.h"
 
 const double mass = 100.0;
@@ -37,3 +39,82 @@ TEST_CASE("Bunch", "[Bunch]")
     CHECK(p2(1, 6) == 124);
     CHECK(p2(4, 6) == 127);
 }
+
+#ifndef SYNERGIA_HAVE_OPENPMD
+TEST_CASE("Bunch async diagnostics", "[Bunch]")
+{
+    Four_momentum fm(mass, total_energy);
+    Reference_particle ref(pconstants::proton_charge, fm);
+
+    {
+        Bunch bunch(ref, 1024, 1e13, Commxx());
+        bunch.set_diag_async(3);
+
+        auto diag = bunch.add_diagnostics(
+            Diagnostics_full2("test_bunch_async_full2.h5"));
+
+        // two full batches and a partial one left in the queue
+        for (int i = 0; i < 7; ++i)
+            diag.first.update_and_write();
+
+        bunch.diag_drain();
+    }
+
+    Hdf5_file file("test_bunch_async_full2.h5", Hdf5_file::Flag::read_only);
+    auto dims = file.get_dims("num_particles");
+
+    REQUIRE(dims.size() == 1);
+    CHECK(dims[0] == 7);
+    CHECK(file.read<double>("mass") == Approx(mass));
+}
+
+TEST_CASE("Bunch async diagnostics with buffered bulk track", "[Bunch]")
+{
+    Four_momentum fm(mass, total_energy);
+    Reference_particle ref(pconstants::proton_charge, fm);
+
+    const int turns = 7;
+    const int tracks = 4;
+
+    {
+        Bunch bunch(ref, 16, 1e13, Commxx());
+        bunch.set_diag_async(2);
+
+        // the bulk track has no snapshot and is written synchronously,
+        // three turns per write of its ring buffer
+        auto diag = bunch.add_diagnostics(
+            Diagnostics_bulk_track("test_bunch_async_bulk_track.h5",
+                                   tracks,
+                                   0,
+                                   ParticleGroup::regular,
+                                   3));
+
+        for (int turn = 0; turn < turns; ++turn) {
+            bunch.checkout_particles();
+            auto parts = bunch.get_host_particles();
+
+            for (int p = 0; p < tracks; ++p)
+                parts(p, Bunch::x) = turn + 0.1 * p;
+
+            bunch.checkin_particles();
+            diag.first.update_and_write();
+        }
+
+        bunch.diag_drain();
+    }
+
+    Hdf5_file file("test_bunch_async_bulk_track.h5",
+                   Hdf5_file::Flag::read_only);
+    auto coords = file.read<karray3d_row>("track_coords");
+
+    REQUIRE(coords.extent(0) == turns);
+    REQUIRE(coords.extent(1) == tracks);
+
+    for (int turn = 0; turn < turns; ++turn) {
+        for (int p = 0; p < tracks; ++p) {
+            CHECK(coords(turn, p, Bunch::x) == Approx(turn + 0.1 * p));
+            CHECK(coords(turn, p, Bunch::id) == p);
+        }
+    }
+}
+#endif
@@ -142,4 +142,55 @@ TEST_CASE("BunchParticles", "[BunchParticles]")
             check_particle_values(bp2);
         }
     }
+
+    SECTION("write/read per coordinate file")
+    {
+        ParticleFileFormat format;
+        format.per_coordinate = true;
+        format.compression = 4;
+
+        {
+            Hdf5_file file("bp_test_coords.h5", Hdf5_file::Flag::truncate, Commxx::World);
+            bp.write_file(file, -1, 0, Commxx::World, format);
+        }
+
+        BunchParticles bp2(ParticleGroup::regular, 
+                0, 0, Commxx::World);
+
+        Hdf5_file file("bp_test_coords.h5", Hdf5_file::Flag::read_only, Commxx::World);
+        REQUIRE(file.has_dataset("particles_x"));
+        REQUIRE(!file.has_dataset("particles"));
+
+        bp2.read_file(file, Commxx::World);
+
+        REQUIRE(bp2.size() == np);
+        REQUIRE(bp2.num_valid() == np - losts.size());
+
+        check_particle_values(bp2);
+    }
+
+    SECTION("write/read single precision file")
+    {
+        ParticleFileFormat format;
+        format.per_coordinate = true;
+        format.single_precision = true;
+
+        {
+            Hdf5_file file("bp_test_float.h5", Hdf5_file::Flag::truncate, Commxx::World);
+            bp.write_file(file, -1, 0, Commxx::World, format);
+        }
+
+        BunchParticles bp2(ParticleGroup::regular, 
+                0, 0, Commxx::World);
+
+        Hdf5_file file("bp_test_float.h5", Hdf5_file::Flag::read_only, Commxx::World);
+        bp2.read_file(file, Commxx::World);
+
+        REQUIRE(bp2.size() == np);
+
+        bp2.checkout_particles();
+        for(int i=0; i<np; ++i)
+            for(int j=0; j<6; ++j)
+                CHECK( bp2.hparts(i, j) == Approx(i+j*0.1).epsilon(1e-6) );
+    }
 }
@@ -0,0 +1,135 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/bunch/bunch_particles.h"
+#include "synergia/utils/parallel_utils.h"
+
+// number of particles
+const int np = 1000;
+
+double
+sum_ids(BunchParticles const& bp, Commxx const& comm)
+{
+    bp.checkout_particles();
+
+    double sum = 0.0;
+    for (int i = 0; i < bp.size(); ++i)
+        if (bp.hmasks(i)) sum += bp.hparts(i, 6);
+
+    MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_DOUBLE, MPI_SUM, comm);
+    return sum;
+}
+
+TEST_CASE("rebalance", "[BunchParticles]")
+{
+    Commxx comm;
+
+    BunchParticles bp(ParticleGroup::regular, np, -1, comm);
+
+    // rank 0 loses every other particle
+    if (comm.rank() == 0) {
+        bp.checkout_particles();
+
+        for (int i = 0; i < bp.size(); i += 2)
+            bp.hmasks(i) = 0;
+
+        bp.checkin_particles();
+        bp.update_valid_num();
+    }
+
+    bp.update_total_num(comm, true);
+
+    int total = bp.num_total();
+    double ids = sum_ids(bp, comm);
+
+    if (comm.size() == 1) CHECK(bp.imbalance() == Approx(1.0));
+    else CHECK(bp.imbalance() > 1.0);
+
+    bp.rebalance(comm);
+
+    CHECK(bp.num_total() == total);
+    CHECK(bp.num_valid() == bp.size());
+    CHECK(bp.size() == decompose_1d_local(comm, total));
+    CHECK(sum_ids(bp, comm) == ids);
+
+    bp.update_total_num(comm, true);
+    CHECK(bp.imbalance() <= Approx(1.0 + 1.0 * comm.size() / total));
+}
+
+// slots of all the local ids, from the host arrays
+std::vector<std::pair<int, int>>
+local_slots(BunchParticles const& bp)
+{
+    bp.checkout_particles();
+
+    std::vector<std::pair<int, int>> res;
+    for (int i = 0; i < bp.size(); ++i)
+        res.emplace_back((int)bp.hparts(i, 6), i);
+
+    return res;
+}
+
+void
+check_searches(BunchParticles const& bp)
+{
+    auto slots = local_slots(bp);
+
+    karray1i_row_dev ids("ids", slots.size());
+    karray1i_row_dev found("found", slots.size());
+
+    auto hids = Kokkos::create_mirror_view(ids);
+    for (int i = 0; i < slots.size(); ++i)
+        hids(i) = slots[i].first;
+    Kokkos::deep_copy(ids, hids);
+
+    bp.search_particles(ids, found);
+
+    auto hfound = Kokkos::create_mirror_view(found);
+    Kokkos::deep_copy(hfound, found);
+
+    for (int i = 0; i < slots.size(); ++i) {
+        CHECK(hfound(i) == slots[i].second);
+        CHECK(bp.search_particle(slots[i].first, -1) == slots[i].second);
+    }
+
+    // not on this rank
+    CHECK(bp.search_particle(-7, -1) == BunchParticles::particle_index_null);
+}
+
+TEST_CASE("id index", "[BunchParticles]")
+{
+    Commxx comm;
+
+    BunchParticles bp(ParticleGroup::regular, np, -1, comm);
+
+    // scan without the index
+    check_searches(bp);
+
+    bp.enable_id_index();
+    CHECK(bp.has_id_index());
+    check_searches(bp);
+
+    // the slots change with the compaction of the rebalance
+    if (comm.rank() == 0) {
+        bp.checkout_particles();
+
+        for (int i = 0; i < bp.size(); i += 3)
+            bp.hmasks(i) = 0;
+
+        bp.checkin_particles();
+        bp.update_valid_num();
+    }
+
+    bp.rebalance(comm);
+    check_searches(bp);
+
+    // ids edited on the host are picked up at the checkin
+    bp.checkout_particles();
+    for (int i = 0; i < bp.size(); ++i)
+        bp.hparts(i, 6) += 10 * np;
+    bp.checkin_particles();
+
+    check_searches(bp);
+
+    bp.enable_id_index(false);
+    check_searches(bp);
+}
@@ -0,0 +1,182 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/bunch/bunch.h"
+#include "synergia/bunch/diagnostics_halo.h"
+#include "synergia/foundation/physical_constants.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    const double mass = 100.0;
+    const double total_energy = 125.0;
+
+    const int total_num = 40;
+
+    const double beta_x = 4.0;
+    const double alpha_x = 0.5;
+    const double beta_y = 2.0;
+    const double alpha_y = -0.3;
+
+    using coords_fn = std::array<double, 4> (*)(int);
+
+    // x, xp, y, yp of a particle from its id, with distinct actions
+    std::array<double, 4>
+    spread_coords(int id)
+    {
+        return {1e-3 * (id + 1),
+                1e-4 * ((id % 7) - 3),
+                5e-4 * ((id * 13) % total_num),
+                2e-4 * ((id % 3) - 1)};
+    }
+
+    // every particle on the reference orbit
+    std::array<double, 4>
+    zero_coords(int)
+    {
+        return {0.0, 0.0, 0.0, 0.0};
+    }
+
+    std::array<double, 2>
+    get_actions(std::array<double, 4> const& c)
+    {
+        const double gx = (1.0 + alpha_x * alpha_x) / beta_x;
+        const double gy = (1.0 + alpha_y * alpha_y) / beta_y;
+
+        return {0.5 * (gx * c[0] * c[0] + 2.0 * alpha_x * c[0] * c[1] +
+                       beta_x * c[1] * c[1]),
+                0.5 * (gy * c[2] * c[2] + 2.0 * alpha_y * c[2] * c[3] +
+                       beta_y * c[3] * c[3])};
+    }
+
+    // the written halo_coords and halo_actions of one update
+    std::pair<karray3d_row, karray3d_row>
+    run_halo(std::string const& name, int num, coords_fn f)
+    {
+        Four_momentum fm(mass, total_energy);
+        Reference_particle ref(pconstants::proton_charge, fm);
+
+        Commxx comm;
+        const std::string fname = "test_diagnostics_halo_" + name + "_" +
+                                  std::to_string(comm.size()) + ".h5";
+
+        {
+            Bunch bunch(ref, total_num, 1e11, comm);
+
+            bunch.checkout_particles();
+            auto parts = bunch.get_host_particles();
+
+            for (int p = 0; p < bunch.get_local_num(); ++p) {
+                auto c = f(parts(p, Bunch::id));
+
+                parts(p, Bunch::x) = c[0];
+                parts(p, Bunch::xp) = c[1];
+                parts(p, Bunch::y) = c[2];
+                parts(p, Bunch::yp) = c[3];
+                parts(p, Bunch::cdt) = 0.0;
+                parts(p, Bunch::dpop) = 0.0;
+            }
+
+            bunch.checkin_particles();
+
+            auto diag = bunch.add_diagnostics(Diagnostics_halo(
+                fname, num, beta_x, alpha_x, beta_y, alpha_y));
+
+            diag.first.update_and_write();
+            bunch.diag_drain();
+        }
+
+        Hdf5_file file(fname, Hdf5_file::Flag::read_only);
+
+        return {file.read<karray3d_row>("halo_coords"),
+                file.read<karray3d_row>("halo_actions")};
+    }
+}
+
+#ifndef SYNERGIA_HAVE_OPENPMD
+TEST_CASE("top_k", "[Diagnostics_halo]")
+{
+    const int num = 5;
+    auto [coords, actions] = run_halo("top_k", num, spread_coords);
+
+    REQUIRE(coords.extent(0) == 1);
+    REQUIRE(coords.extent(1) == num);
+    REQUIRE(actions.extent(1) == num);
+
+    // ids in decreasing order of Jx + Jy
+    std::vector<int> ids(total_num);
+    std::iota(ids.begin(), ids.end(), 0);
+
+    auto sum = [](int id) {
+        auto j = get_actions(spread_coords(id));
+        return j[0] + j[1];
+    };
+
+    std::sort(
+        ids.begin(), ids.end(), [&](int a, int b) { return sum(a) > sum(b); });
+
+    for (int r = 0; r < num; ++r) {
+        const int id = ids[r];
+        auto c = spread_coords(id);
+        auto j = get_actions(c);
+
+        CHECK(coords(0, r, Bunch::id) == id);
+        CHECK(coords(0, r, Bunch::x) == Approx(c[0]));
+        CHECK(coords(0, r, Bunch::yp) == Approx(c[3]).margin(1e-15));
+
+        CHECK(actions(0, r, 0) == Approx(j[0]));
+        CHECK(actions(0, r, 1) == Approx(j[1]));
+    }
+}
+
+TEST_CASE("fewer_than_k", "[Diagnostics_halo]")
+{
+    const int num = total_num + 10;
+    auto [coords, actions] = run_halo("fewer", num, spread_coords);
+
+    REQUIRE(coords.extent(1) == num);
+
+    // every particle once, then the empty rows
+    std::vector<int> seen;
+
+    for (int r = 0; r < total_num; ++r) {
+        seen.push_back(coords(0, r, Bunch::id));
+
+        if (r > 0)
+            CHECK(actions(0, r, 0) + actions(0, r, 1) <=
+                  actions(0, r - 1, 0) + actions(0, r - 1, 1));
+    }
+
+    std::sort(seen.begin(), seen.end());
+    for (int id = 0; id < total_num; ++id)
+        CHECK(seen[id] == id);
+
+    for (int r = total_num; r < num; ++r)
+        CHECK(coords(0, r, Bunch::id) == -1);
+}
+
+TEST_CASE("equal_actions", "[Diagnostics_halo]")
+{
+    // every particle is above any threshold, the selection must still
+    // be num distinct particles
+    const int num = 5;
+    auto [coords, actions] = run_halo("equal", num, zero_coords);
+
+    REQUIRE(coords.extent(1) == num);
+
+    std::vector<int> ids;
+
+    for (int r = 0; r < num; ++r) {
+        ids.push_back(coords(0, r, Bunch::id));
+
+        CHECK(actions(0, r, 0) == 0.0);
+        CHECK(actions(0, r, 1) == 0.0);
+    }
+
+    std::sort(ids.begin(), ids.end());
+
+    CHECK(ids.front() >= 0);
+    CHECK(ids.back() < total_num);
+    CHECK(std::adjacent_find(ids.begin(), ids.end()) == ids.end());
+}
+#endif
@@ -0,0 +1,161 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/bunch/bunch.h"
+#include "synergia/bunch/diagnostics_histograms.h"
+#include "synergia/foundation/physical_constants.h"
+
+#include <cmath>
+
+namespace {
+    const double mass = 100.0;
+    const double total_energy = 125.0;
+
+    const int total_num = 30;
+    // an odd number of bins keeps the particles off the bin edges
+    const int bins = 7;
+    const double n_sigma = 3.0;
+
+    // the coordinates of a particle only depend on its id, so the
+    // histograms are the same for any number of ranks
+    double
+    x_of(int id)
+    {
+        return (id % 3) - 1.0;
+    }
+
+    double
+    xp_of(int id)
+    {
+        return 0.01 * (id % 5);
+    }
+
+    // lower edge and width of the bins of a coordinate, as in
+    // Diagnostics_histograms
+    std::array<double, 2>
+    span(double (*f)(int))
+    {
+        double mean = 0.0;
+        for (int id = 0; id < total_num; ++id)
+            mean += f(id);
+        mean /= total_num;
+
+        double var = 0.0;
+        for (int id = 0; id < total_num; ++id)
+            var += (f(id) - mean) * (f(id) - mean);
+
+        double half = n_sigma * std::sqrt(var / total_num);
+        return {mean - half, 2.0 * half / bins};
+    }
+
+    int
+    bin_of(double v, std::array<double, 2> const& s)
+    {
+        return std::min(bins - 1, int(std::floor((v - s[0]) / s[1])));
+    }
+}
+
+#ifndef SYNERGIA_HAVE_OPENPMD
+TEST_CASE("Diagnostics_histograms", "[Diagnostics_histograms]")
+{
+    Four_momentum fm(mass, total_energy);
+    Reference_particle ref(pconstants::proton_charge, fm);
+
+    Commxx comm;
+    const std::string fname =
+        "test_diagnostics_histograms_" + std::to_string(comm.size()) + ".h5";
+
+    {
+        Bunch bunch(ref, total_num, 1e11, comm);
+
+        bunch.checkout_particles();
+        auto parts = bunch.get_host_particles();
+
+        for (int p = 0; p < bunch.get_local_num(); ++p) {
+            int id = parts(p, Bunch::id);
+
+            parts(p, Bunch::x) = x_of(id);
+            parts(p, Bunch::xp) = xp_of(id);
+            parts(p, Bunch::y) = 0.25;
+            parts(p, Bunch::yp) = 0.0;
+            parts(p, Bunch::cdt) = 0.0;
+            parts(p, Bunch::dpop) = 0.0;
+        }
+
+        bunch.checkin_particles();
+
+        auto diag = bunch.add_diagnostics(Diagnostics_histograms(
+            fname,
+            {HistogramProjection::x,
+             HistogramProjection::y,
+             HistogramProjection::x_xp},
+            bins,
+            n_sigma));
+
+        diag.first.update_and_write();
+        bunch.diag_drain();
+    }
+
+    Hdf5_file file(fname, Hdf5_file::Flag::read_only);
+
+    CHECK(file.read<int>("bins") == bins);
+    CHECK(file.read<double>("n_sigma") == Approx(n_sigma));
+
+    auto sx = span(x_of);
+    auto sxp = span(xp_of);
+
+    // one write of left0, h0, left1, h1 per projection
+    auto edges = file.read<karray3d_row>("edges");
+
+    REQUIRE(edges.extent(0) == 1);
+    REQUIRE(edges.extent(1) == 3);
+    REQUIRE(edges.extent(2) == 4);
+
+    CHECK(edges(0, 0, 0) == Approx(sx[0]));
+    CHECK(edges(0, 0, 1) == Approx(sx[1]));
+    CHECK(edges(0, 0, 3) == 0.0);
+
+    // no spread in y, unit bins around the mean
+    CHECK(edges(0, 1, 0) == Approx(0.25 - 0.5 * bins));
+    CHECK(edges(0, 1, 1) == Approx(1.0));
+
+    CHECK(edges(0, 2, 0) == Approx(sx[0]));
+    CHECK(edges(0, 2, 1) == Approx(sx[1]));
+    CHECK(edges(0, 2, 2) == Approx(sxp[0]));
+    CHECK(edges(0, 2, 3) == Approx(sxp[1]));
+
+    // expected counts over the particles of all ranks
+    std::vector<double> hx(bins, 0.0);
+    std::vector<double> hxxp(bins * bins, 0.0);
+
+    for (int id = 0; id < total_num; ++id) {
+        int bx = bin_of(x_of(id), sx);
+        int bxp = bin_of(xp_of(id), sxp);
+
+        hx[bx] += 1.0;
+        hxxp[bx * bins + bxp] += 1.0;
+    }
+
+    auto hist_x = file.read<karray2d_row>("hist_x");
+    REQUIRE(hist_x.extent(0) == 1);
+    REQUIRE(hist_x.extent(1) == bins);
+
+    for (int b = 0; b < bins; ++b)
+        CHECK(hist_x(0, b) == hx[b]);
+
+    auto hist_y = file.read<karray2d_row>("hist_y");
+    REQUIRE(hist_y.extent(1) == bins);
+
+    for (int b = 0; b < bins; ++b)
+        CHECK(hist_y(0, b) == (b == bins / 2 ? total_num : 0.0));
+
+    // row major in (x, xp)
+    auto hist_x_xp = file.read<karray3d_row>("hist_x_xp");
+    REQUIRE(hist_x_xp.extent(0) == 1);
+    REQUIRE(hist_x_xp.extent(1) == bins);
+    REQUIRE(hist_x_xp.extent(2) == bins);
+
+    for (int i = 0; i < bins; ++i)
+        for (int j = 0; j < bins; ++j)
+            CHECK(hist_x_xp(0, i, j) == hxxp[i * bins + j]);
+}
+#endif
@@ -0,0 +1,176 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/bunch/diagnostics_tunes.h"
+#include "synergia/foundation/math_constants.h"
+#include "synergia/foundation/physical_constants.h"
+
+#include <cmath>
+
+namespace {
+    // normalized signal of a particle on a linear orbit around a closed
+    // orbit offset, at the location of (beta, alpha)
+    void
+    make_signal(double nu,
+                int n,
+                std::vector<double>& re,
+                std::vector<double>& im)
+    {
+        const double beta = 10.0;
+        const double alpha = 1.5;
+        const double amp = 2e-3;
+
+        re.resize(n);
+        im.resize(n);
+
+        for (int t = 0; t < n; ++t) {
+            double phi = 2.0 * mconstants::pi * nu * t + 0.3;
+            double x = amp * std::sqrt(beta) * std::cos(phi) + 1e-3;
+            double xp = -amp / std::sqrt(beta) *
+                        (std::sin(phi) + alpha * std::cos(phi));
+
+            re[t] = x;
+            im[t] = -(alpha * x + beta * xp);
+        }
+    }
+}
+
+TEST_CASE("get_tune", "[Diagnostics_tunes]")
+{
+    std::vector<double> re, im;
+
+    for (double nu : {0.0877, 0.31234567, 0.73}) {
+        make_signal(nu, 512, re, im);
+        CHECK(Diagnostics_tunes::get_tune(re, im) ==
+              Approx(nu).margin(1e-9));
+    }
+
+    // short windows are less accurate
+    make_signal(0.31234567, 64, re, im);
+    CHECK(Diagnostics_tunes::get_tune(re, im) ==
+          Approx(0.31234567).margin(1e-5));
+}
+
+TEST_CASE("get_tune_length", "[Diagnostics_tunes]")
+{
+    std::vector<double> re(100), im(100);
+    CHECK_THROWS(Diagnostics_tunes::get_tune(re, im));
+}
+
+#ifndef SYNERGIA_HAVE_OPENPMD
+namespace {
+    // (nu_x, nu_y) of the particle with the id, in the first and the
+    // second window of a recording. Only particle 1 changes its x tune
+    std::array<double, 4>
+    track_tunes(int id)
+    {
+        switch (id) {
+        case 0: return {0.31, 0.17, 0.31, 0.17};
+        case 1: return {0.23, 0.41, 0.231, 0.41};
+        case 3: return {0.12, 0.37, 0.12, 0.37};
+        default: return {0.27, 0.08, 0.27, 0.08};
+        }
+    }
+}
+
+TEST_CASE("do_update", "[Diagnostics_tunes]")
+{
+    const int num = 4;
+    const int window = 64;
+    const int moved_id = 1000;
+
+    Four_momentum fm(100.0, 125.0);
+    Reference_particle ref(pconstants::proton_charge, fm);
+
+    {
+        Bunch bunch(ref, num, 1e11, Commxx());
+
+        auto diag = bunch.add_diagnostics(Diagnostics_tunes(
+            "test_diagnostics_tunes.h5", num, 0, window));
+
+        // two recordings of two windows each
+        for (int turn = 0; turn < window * 4; ++turn) {
+            const int t = turn % (window * 2);
+            const int w = t < window ? 0 : 1;
+
+            bunch.checkout_particles();
+            auto parts = bunch.get_host_particles();
+
+            for (int p = 0; p < bunch.get_local_num(); ++p) {
+                // another particle takes the slot of particle 2 during
+                // the first recording
+                if (turn == 10 && parts(p, Bunch::id) == 2)
+                    parts(p, Bunch::id) = moved_id;
+
+                auto nus = track_tunes(parts(p, Bunch::id));
+                double px = 2.0 * mconstants::pi * nus[w * 2 + 0] * t;
+                double py = 2.0 * mconstants::pi * nus[w * 2 + 1] * t;
+
+                // beta = 1 and alpha = 0, the signal is A exp(i phase)
+                parts(p, Bunch::x) = 1e-3 * std::cos(px);
+                parts(p, Bunch::xp) = -1e-3 * std::sin(px);
+                parts(p, Bunch::y) = 2e-3 * std::cos(py);
+                parts(p, Bunch::yp) = -2e-3 * std::sin(py);
+            }
+
+            bunch.checkin_particles();
+            diag.first.update_and_write();
+        }
+
+        bunch.diag_drain();
+    }
+
+    Hdf5_file file("test_diagnostics_tunes.h5", Hdf5_file::Flag::read_only);
+
+    CHECK(file.read<int>("window") == window);
+
+    // one row per recording
+    auto ids = file.read<karray2d_row>("tunes_ids");
+    auto tunes = file.read<karray3d_row>("tunes");
+    auto diffusion = file.read<karray2d_row>("diffusion");
+
+    REQUIRE(ids.extent(0) == 2);
+    REQUIRE(ids.extent(1) == num);
+    REQUIRE(tunes.extent(0) == 2);
+    REQUIRE(tunes.extent(1) == num);
+    REQUIRE(tunes.extent(2) == 4);
+
+    for (int r = 0; r < 2; ++r) {
+        int lost = 0;
+
+        for (int i = 0; i < num; ++i) {
+            const int id = ids(r, i);
+
+            if (id < 0) {
+                // the slot of particle 2 in the first recording only
+                CHECK(r == 0);
+                CHECK(std::isnan(tunes(r, i, 0)));
+                CHECK(std::isnan(diffusion(r, i)));
+
+                ++lost;
+                continue;
+            }
+
+            // (nu_x, nu_y) of the first window, then of the second
+            auto nus = track_tunes(id);
+            for (int j = 0; j < 4; ++j)
+                CHECK(tunes(r, i, j) == Approx(nus[j]).margin(1e-5));
+
+            if (id == 1) {
+                CHECK(diffusion(r, i) == Approx(-3.0).margin(0.02));
+            } else {
+                CHECK(std::isfinite(diffusion(r, i)));
+                CHECK(diffusion(r, i) < -5.0);
+            }
+        }
+
+        CHECK(lost == (r == 0 ? 1 : 0));
+    }
+
+    // the recording restarts with the particle now in the slot
+    bool moved = false;
+    for (int i = 0; i < num; ++i)
+        moved = moved || ids(1, i) == moved_id;
+
+    CHECK(moved);
+}
+#endif
@@ -0,0 +1,156 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/bunch/particle_binning.h"
+#include "synergia/foundation/physical_constants.h"
+
+TEST_CASE("bin_1d", "[Particle_binning]")
+{
+    const int num = 10000;
+    const int bins = 10;
+
+    Four_momentum fm(100.0, 125.0);
+    Reference_particle ref(pconstants::proton_charge, fm);
+    Bunch bunch(ref, num, 1e13, Commxx());
+
+    // particle i at cdt = i/num, so 1000 per bin, and x = 1, y = i
+    auto parts = bunch.get_host_particles();
+
+    for (int i = 0; i < num; ++i) {
+        parts(i, Bunch::x) = 1.0;
+        parts(i, Bunch::y) = i;
+        parts(i, Bunch::cdt) = double(i) / num;
+    }
+
+    // one on the upper edge, one outside, one in the bin above the edge
+    parts(0, Bunch::cdt) = 1.0;
+    parts(1, Bunch::cdt) = -0.5;
+    parts(2, Bunch::cdt) = 1.05;
+
+    bunch.checkin_particles();
+
+    karray1d_dev hist("hist", bins * 3);
+    Particle_binning::bin_1d(
+        bunch, Bunch::cdt, 0.0, 0.1, bins, {Bunch::x, Bunch::y}, hist);
+
+    auto h = Kokkos::create_mirror_view(hist);
+    Kokkos::deep_copy(h, hist);
+
+    double total = 0;
+    for (int b = 0; b < bins; ++b)
+        total += h(b);
+
+    CHECK(total == num - 2);
+
+    CHECK(h(0) == 997);
+    CHECK(h(5) == 1000);
+    CHECK(h(9) == 1001);
+
+    // sum of x is the count, sum of y is the sum of the indices
+    CHECK(h(bins + 9) == 1001);
+    CHECK(h(bins * 2 + 0) == Approx(997 * 501.0));
+    CHECK(h(bins * 2 + 5) == Approx(1000 * 5499.5));
+    CHECK(h(bins * 2 + 9) == Approx(1000 * 9499.5));
+
+    // refilled, not accumulated
+    Particle_binning::bin_1d(bunch, Bunch::cdt, 0.0, 0.1, bins, {}, hist);
+    Kokkos::deep_copy(h, hist);
+    CHECK(h(5) == 1000);
+    CHECK(h(bins + 5) == 0.0);
+}
+
+TEST_CASE("bin_projections", "[Particle_binning]")
+{
+    const int num = 4000;
+
+    Four_momentum fm(100.0, 125.0);
+    Reference_particle ref(pconstants::proton_charge, fm);
+    Bunch bunch(ref, num, 1e13, Commxx());
+
+    // four groups of particles at (x, xp) = (+-1, +-1), at radius 1
+    // about the origin in (x, y)
+    auto parts = bunch.get_host_particles();
+
+    for (int i = 0; i < num; ++i) {
+        double sx = (i % 2) ? 1.0 : -1.0;
+        double sp = (i % 4 < 2) ? 1.0 : -1.0;
+
+        parts(i, Bunch::x) = sx;
+        parts(i, Bunch::xp) = sp;
+        parts(i, Bunch::y) = 0.0;
+        parts(i, Bunch::yp) = 0.0;
+    }
+
+    bunch.checkin_particles();
+
+    Particle_binning::Projection x;
+    x.coord0 = Bunch::x;
+    x.bins0 = 4;
+    x.left0 = -2.0;
+
+    Particle_binning::Projection x_xp = x;
+    x_xp.coord1 = Bunch::xp;
+    x_xp.bins1 = 2;
+    x_xp.left1 = -2.0;
+    x_xp.h1 = 2.0;
+
+    Particle_binning::Projection r;
+    r.coord0 = Particle_binning::radius;
+    r.bins0 = 4;
+    r.h0 = 1.0;
+
+    karray1d_dev hist("hist", 4 + 8 + 4);
+    Particle_binning::Projection_views views;
+    Particle_binning::bin_projections(bunch, {x, x_xp, r}, hist, views);
+
+    auto h = Kokkos::create_mirror_view(hist);
+    Kokkos::deep_copy(h, hist);
+
+    // x
+    CHECK(h(0) == 0);
+    CHECK(h(1) == num / 2);
+    CHECK(h(3) == num / 2);
+
+    // x_xp, row major in (x, xp)
+    CHECK(h(4 + 1 * 2 + 0) == num / 4);
+    CHECK(h(4 + 1 * 2 + 1) == num / 4);
+    CHECK(h(4 + 3 * 2 + 0) == num / 4);
+    CHECK(h(4 + 3 * 2 + 1) == num / 4);
+    CHECK(h(4 + 0 * 2 + 0) == 0);
+
+    // r, all at 1
+    CHECK(h(12 + 1) == num);
+
+    // the cached views get the new projections, and are reallocated
+    // for a different number of them
+    x.left0 = -1.5;
+    Particle_binning::bin_projections(bunch, {x, x_xp, r}, hist, views);
+    Kokkos::deep_copy(h, hist);
+
+    CHECK(h(0) == num / 2);
+    CHECK(h(1) == 0);
+    CHECK(h(2) == num / 2);
+    CHECK(h(4 + 1 * 2 + 0) == num / 4);
+    CHECK(h(12 + 1) == num);
+
+    Particle_binning::bin_projections(bunch, {r}, hist, views);
+    Kokkos::deep_copy(h, hist);
+
+    CHECK(views.projs.extent(0) == 1);
+    CHECK(h(1) == num);
+    CHECK(h(4) == 0);
+
+    // with beta_x = 2 and alpha_x = 1 the action is 2.5 when x and xp
+    // have the same sign, 0.5 otherwise
+    Particle_binning::Projection a;
+    a.coord0 = Particle_binning::action;
+    a.bins0 = 3;
+    a.beta_x = 2.0;
+    a.alpha_x = 1.0;
+
+    Particle_binning::bin_projections(bunch, {a}, hist, views);
+    Kokkos::deep_copy(h, hist);
+
+    CHECK(h(0) == num / 2);
+    CHECK(h(1) == 0);
+    CHECK(h(2) == num / 2);
+}
@@ -0,0 +1,146 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/bunch/bunch.h"
+#include "synergia/bunch/core_diagnostics.h"
+#include "synergia/bunch/populate_global.h"
+#include "synergia/foundation/physical_constants.h"
+
+#include <map>
+
+const double mass = 100.0;
+const double total_energy = 125.0;
+const int total_num = 10000;
+const double real_num = 2.0e12;
+const uint64_t seed = 13;
+
+karray2d_row
+covariances()
+{
+    karray2d_row c("covariances", 6, 6);
+
+    for (int i = 0; i < 6; ++i)
+        c(i, i) = 1.0e-6 * (i + 1);
+
+    c(0, 1) = c(1, 0) = 2.0e-7;
+    c(2, 3) = c(3, 2) = -3.0e-7;
+
+    return c;
+}
+
+TEST_CASE("populate_global_6d", "[populate]")
+{
+    Four_momentum fm(mass, total_energy);
+    Reference_particle ref(pconstants::proton_charge, fm);
+    Bunch bunch(ref, total_num, real_num, Commxx());
+
+    karray1d means("means", 6);
+    for (int i = 0; i < 6; ++i)
+        means(i) = 1.0e-3 * i;
+
+    auto cov = covariances();
+    populate_global_6d(seed, bunch, means, cov);
+
+    auto mean = Core_diagnostics::calculate_mean(bunch);
+    auto mom2 = Core_diagnostics::calculate_mom2(bunch, mean);
+
+    for (int i = 0; i < 6; ++i) {
+        CHECK(mean(i) == Approx(means(i)).margin(1.0e-12));
+
+        for (int j = 0; j < 6; ++j)
+            CHECK(mom2(i, j) == Approx(cov(i, j)).margin(1.0e-12));
+    }
+}
+
+TEST_CASE("populate_global_6d_truncated", "[populate]")
+{
+    Four_momentum fm(mass, total_energy);
+    Reference_particle ref(pconstants::proton_charge, fm);
+    Bunch bunch(ref, total_num, real_num, Commxx());
+
+    karray1d means("means", 6);
+    karray1d limits("limits", 6);
+    for (int i = 0; i < 6; ++i)
+        limits(i) = 3.0;
+
+    auto cov = covariances();
+    populate_global_6d_truncated(seed, bunch, means, cov, limits);
+
+    auto mean = Core_diagnostics::calculate_mean(bunch);
+    auto mom2 = Core_diagnostics::calculate_mom2(bunch, mean);
+
+    for (int i = 0; i < 6; ++i)
+        for (int j = 0; j < 6; ++j)
+            CHECK(mom2(i, j) == Approx(cov(i, j)).margin(1.0e-12));
+
+    // the same seed gives the same particles
+    Bunch bunch2(ref, total_num, real_num, Commxx());
+    populate_global_6d_truncated(seed, bunch2, means, cov, limits);
+
+    auto p1 = bunch.get_host_particles();
+    auto p2 = bunch2.get_host_particles();
+
+    REQUIRE(bunch.get_local_num() == bunch2.get_local_num());
+
+    for (int p = 0; p < bunch.get_local_num(); ++p)
+        for (int i = 0; i < 6; ++i)
+            CHECK(p1(p, i) == p2(p, i));
+}
+
+// coordinates of the particles of a bunch on a single rank, by id
+std::map<int, std::array<double, 6>>
+coords_by_id(Bunch const& bunch)
+{
+    std::map<int, std::array<double, 6>> coords;
+
+    auto parts = bunch.get_host_particles();
+    auto masks = bunch.get_host_particle_masks();
+
+    for (int p = 0; p < bunch.size(); ++p) {
+        if (!masks(p)) continue;
+
+        auto& c = coords[(int)parts(p, Bunch::id)];
+        for (int i = 0; i < 6; ++i)
+            c[i] = parts(p, i);
+    }
+
+    return coords;
+}
+
+TEST_CASE("populate_global_6d_truncated rank independent", "[populate]")
+{
+    Four_momentum fm(mass, total_energy);
+    Reference_particle ref(pconstants::proton_charge, fm);
+
+    // the whole bunch on every rank, and the bunch over all ranks
+    auto world = std::make_shared<Commxx>();
+    Bunch serial(ref, total_num, real_num, world->split(world->rank()));
+    Bunch distributed(ref, total_num, real_num, *world);
+
+    karray1d means("means", 6);
+    karray1d limits("limits", 6);
+    for (int i = 0; i < 6; ++i) {
+        means(i) = 1.0e-3 * i;
+        limits(i) = 3.0;
+    }
+
+    auto cov = covariances();
+    populate_global_6d_truncated(seed, serial, means, cov, limits);
+    populate_global_6d_truncated(seed, distributed, means, cov, limits);
+
+    auto all = coords_by_id(serial);
+    auto local = coords_by_id(distributed);
+
+    REQUIRE(all.size() == (size_t)total_num);
+    REQUIRE(local.size() == (size_t)distributed.get_local_num());
+
+    // the moments are reduced in a different order, the coordinates
+    // agree to rounding
+    for (auto const& [id, c] : local) {
+        auto it = all.find(id);
+        REQUIRE(it != all.end());
+
+        for (int i = 0; i < 6; ++i)
+            CHECK(c[i] ==
+                  Approx(it->second[i]).epsilon(1.0e-10).margin(1.0e-15));
+    }
+}
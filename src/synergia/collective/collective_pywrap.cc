@@ -4,6 +4,8 @@
 #include "synergia/simulation/collective_operator_options.h"
 #include "synergia/simulation/implemented_collective_options.h"
 
+#include "synergia/collective/frozen_fields.h"
+
 namespace py = pybind11;
 using namespace py::literals;
 
@@ -18,7 +20,56 @@ PYBIND11_MODULE(collective, m)
          "gridz"_a)
     .def_readwrite("comm_group_size",
                    &Space_charge_2d_open_hockney_options::comm_group_size,
-                   "Communication group size (must be 1 on GPUs).");
+                   "Communication group size (must be 1 on GPUs).")
+    .def_readwrite("single_precision",
+                   &Space_charge_2d_open_hockney_options::single_precision,
+                   "Reduce the fields over the ranks in single precision.")
+    .def_readwrite("frozen_turns",
+                   &Space_charge_2d_open_hockney_options::frozen_turns,
+                   "Reuse the fields for up to this many turns (0 is off).")
+    .def_readwrite("frozen_tolerance",
+                   &Space_charge_2d_open_hockney_options::frozen_tolerance,
+                   "Bunch moment drift, in sigma, that forces a new solve.");
+
+  py::class_<Space_charge_2d_sliced_options>(m,
+                                             "Space_charge_2d_sliced_options")
+    .def(py::init<int, int, int>(),
+         "Construct the 2.5d sliced space charge solver.",
+         "gridx"_a,
+         "gridy"_a,
+         "gridz"_a)
+    .def_readwrite("n_sigma",
+                   &Space_charge_2d_sliced_options::n_sigma,
+                   "Domain size in units of the bunch sigma (default 8).")
+    .def_readwrite("kick_scale",
+                   &Space_charge_2d_sliced_options::kick_scale,
+                   "Scale factor of the kicks (default 1).")
+    .def("set_fixed_domain",
+         &Space_charge_2d_sliced_options::set_fixed_domain,
+         "Use a fixed domain in place of the bunch sized domain.",
+         "offset"_a,
+         "size"_a);
+
+  py::enum_<LongitudinalDistribution>(m, "LongitudinalDistribution")
+    .value("uniform", LongitudinalDistribution::uniform)
+    .value("gaussian", LongitudinalDistribution::gaussian);
+
+  py::class_<Space_charge_2d_bassetti_erskine_options>(
+    m, "Space_charge_2d_bassetti_erskine_options")
+    .def(py::init<>(),
+         "Construct the grid free Gaussian (Bassetti-Erskine) space charge.")
+    .def_readwrite(
+      "longitudinal_distribution",
+      &Space_charge_2d_bassetti_erskine_options::longitudinal_distribution,
+      "Uniform or gaussian line charge density (default uniform).")
+    .def_readwrite("strictly_centered",
+                   &Space_charge_2d_bassetti_erskine_options::strictly_centered,
+                   "Center the field on the axis instead of the bunch mean.");
+
+  py::enum_<green_fn_t>(m, "green_fn_t")
+    .value("pointlike", green_fn_t::pointlike)
+    .value("linear", green_fn_t::linear)
+    .value("igf", green_fn_t::igf);
 
   py::class_<Space_charge_3d_open_hockney_options>(
     m, "Space_charge_3d_open_hockney_options")
@@ -29,9 +80,28 @@ PYBIND11_MODULE(collective, m)
          "gridz"_a)
     .def_readwrite("comm_group_size",
                    &Space_charge_3d_open_hockney_options::comm_group_size,
-                   "Communication group size (must be 1 on GPUs).");
+                   "Communication group size (must be 1 on GPUs).")
+    .def_readwrite("green_fn",
+                   &Space_charge_3d_open_hockney_options::green_fn,
+                   "Green function of the solver (pointlike, linear or igf).")
+    .def_readwrite("single_precision",
+                   &Space_charge_3d_open_hockney_options::single_precision,
+                   "Single precision fields and reductions over the ranks.")
+    .def_readwrite("frozen_turns",
+                   &Space_charge_3d_open_hockney_options::frozen_turns,
+                   "Reuse the fields for up to this many turns (0 is off).")
+    .def_readwrite("frozen_tolerance",
+                   &Space_charge_3d_open_hockney_options::frozen_tolerance,
+                   "Bunch moment drift, in sigma, that forces a new solve.");
+
+  py::enum_<fd_solver_t>(m, "fd_solver_t")
+    .value("petsc", fd_solver_t::petsc)
+    .value("multigrid", fd_solver_t::multigrid);
+
+  py::enum_<mg_cycle_t>(m, "mg_cycle_t")
+    .value("V", mg_cycle_t::V)
+    .value("F", mg_cycle_t::F);
 
-#ifdef BUILD_FD_SPACE_CHARGE_SOLVER
   py::class_<Space_charge_3d_fd_options>(m, "Space_charge_3d_fd_options")
     .def(py::init<int, int, int>(),
          "Construct the space charge 3d finite difference solver solver.",
@@ -40,8 +110,29 @@ PYBIND11_MODULE(collective, m)
          "gridz"_a)
     .def_readwrite("comm_group_size",
                    &Space_charge_3d_fd_options::comm_group_size,
-                   "Communication group size (must be 1 on GPUs).");
-#endif
+                   "Communication group size (must be 1 on GPUs).")
+    .def_readwrite("solver",
+                   &Space_charge_3d_fd_options::solver,
+                   "Linear solver (petsc or multigrid).")
+    .def_readwrite("mg_cycle",
+                   &Space_charge_3d_fd_options::mg_cycle,
+                   "Multigrid cycle (V or F).")
+    .def_readwrite("mg_smooth",
+                   &Space_charge_3d_fd_options::mg_smooth,
+                   "Multigrid smoothing sweeps per level (int, default 2).")
+    .def_readwrite("mg_rtol",
+                   &Space_charge_3d_fd_options::mg_rtol,
+                   "Multigrid relative residual tolerance (default 1e-8).")
+    .def_readwrite("mg_max_cycles",
+                   &Space_charge_3d_fd_options::mg_max_cycles,
+                   "Multigrid maximum cycles per solve (int, default 20).")
+    .def_readwrite("open_boundary",
+                   &Space_charge_3d_fd_options::open_boundary,
+                   "Free space potential on the grid boundary (default false).")
+    .def_readwrite(
+      "open_boundary_coarsening",
+      &Space_charge_3d_fd_options::open_boundary_coarsening,
+      "Grid cells per coarse cell (per dimension) of the boundary potential.");
 
   py::class_<Space_charge_rectangular_options>(
     m, "Space_charge_rectangular_options")
@@ -86,4 +177,22 @@ PYBIND11_MODULE(collective, m)
 
   py::class_<Dummy_CO_options>(m, "Dummy_CO_options")
     .def(py::init<>(), "Construct a dummy collective operator.");
+
+  // frozen fields of the space charge solvers
+  m.def("clear_frozen_fields",
+        &Frozen_fields::clear_all,
+        "Drop the field grids of the frozen space charge kicks of all the "
+        "bunches.");
+
+  m.def("set_frozen_fields_budget",
+        &Frozen_fields::set_memory_budget,
+        "Memory budget in bytes of the frozen space charge field grids of "
+        "every bunch, over all the kick locations.",
+        "bytes"_a);
+
+  m.def("set_frozen_fields_checkpointed",
+        &Frozen_fields::set_checkpointed,
+        "Whether the frozen space charge field grids are saved in the "
+        "checkpoints. A restart without them solves again.",
+        "checkpointed"_a);
 }
@@ -0,0 +1,185 @@
+#include "frozen_fields.h"
+
+#include "synergia/simulation/bunch_simulator.h"
+
+#include <cereal/archives/binary.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+size_t Frozen_fields::memory_budget = size_t(1) << 30;
+bool Frozen_fields::checkpointed = true;
+
+namespace {
+    // the caches of the bunches on this rank, by (train, bunch) index
+    struct frozen_registry_t {
+        std::string sim_id;
+        std::map<std::pair<int, int>, Frozen_fields> caches;
+    };
+
+    frozen_registry_t registry;
+}
+
+size_t
+Frozen_fields::entry::bytes() const
+{
+    size_t b = 0;
+
+    for (auto const& f : fields)
+        b += f.extent(0) * sizeof(double);
+
+    for (auto const& f : fields_f)
+        b += f.extent(0) * sizeof(float);
+
+    return b;
+}
+
+Frozen_fields::entry*
+Frozen_fields::find(std::string const& key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end()) return nullptr;
+
+    it->second.last_used = ++clock;
+    return &it->second.e;
+}
+
+bool
+Frozen_fields::insert(std::string const& key, entry const& e)
+{
+    // replaces the old entry of the location
+    entries.erase(key);
+
+    const size_t bytes = e.bytes();
+    if (bytes > memory_budget) return false;
+
+    // drop the least recently used locations until the entry fits
+    while (get_memory_used() + bytes > memory_budget) {
+        auto lru = entries.begin();
+
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+            if (it->second.last_used < lru->second.last_used) lru = it;
+
+        entries.erase(lru);
+    }
+
+    entries[key] = slot{e, ++clock};
+    return true;
+}
+
+size_t
+Frozen_fields::get_memory_used() const
+{
+    size_t b = 0;
+
+    for (auto const& [key, s] : entries)
+        b += s.e.bytes();
+
+    return b;
+}
+
+bool
+Frozen_fields::stale(entry const& e,
+                     std::array<double, 6> const& moments,
+                     int turn,
+                     int max_turns,
+                     double tolerance)
+{
+    if (turn - e.turn >= max_turns) return true;
+
+    for (int d = 0; d < 3; ++d) {
+        const double sigma = e.moments[d + 3];
+
+        if (std::abs(moments[d] - e.moments[d]) > tolerance * sigma)
+            return true;
+
+        if (std::abs(moments[d + 3] - sigma) > tolerance * sigma) return true;
+    }
+
+    return false;
+}
+
+Frozen_fields&
+Frozen_fields::of(std::string const& sim_id, Bunch const& bunch)
+{
+    if (registry.sim_id != sim_id) {
+        registry.caches.clear();
+        registry.sim_id = sim_id;
+    }
+
+    return registry
+        .caches[{bunch.get_train_index(), bunch.get_bunch_index()}];
+}
+
+void
+Frozen_fields::clear_all()
+{
+    registry.caches.clear();
+}
+
+void
+Frozen_fields::dump_checkpoint(std::string const& dir,
+                               Bunch_simulator const& sim)
+{
+    // caches of another simulator are not part of this checkpoint
+    const bool mine = registry.sim_id == sim.id();
+
+    // the caches are the same on all ranks of a bunch, so the root rank
+    // of the bunch writes it
+    for (size_t t = 0; t < 2; ++t) {
+        for (auto const& bunch : sim[t].get_bunches()) {
+            if (bunch.get_comm().rank() != 0) continue;
+
+            std::ofstream os(dir + "/" + file_name(bunch), std::ios::binary);
+            if (!os.good())
+                throw std::runtime_error(
+                    "Frozen_fields::dump_checkpoint(): error at creating " +
+                    file_name(bunch));
+
+            cereal::BinaryOutputArchive ar(os);
+
+            auto it = registry.caches.find(
+                {bunch.get_train_index(), bunch.get_bunch_index()});
+
+            Frozen_fields empty;
+            ar(sim.id());
+            ar((mine && it != registry.caches.end()) ? it->second : empty);
+        }
+    }
+}
+
+void
+Frozen_fields::load_checkpoint(std::string const& dir,
+                               Bunch_simulator const& sim)
+{
+    registry.caches.clear();
+    registry.sim_id = sim.id();
+
+    for (size_t t = 0; t < 2; ++t) {
+        for (auto const& bunch : sim[t].get_bunches()) {
+            // checkpoints without the frozen fields start with empty
+            // caches, and solve again at the first kicks
+            std::ifstream is(dir + "/" + file_name(bunch), std::ios::binary);
+            if (!is.good()) continue;
+
+            cereal::BinaryInputArchive ar(is);
+
+            std::string id;
+            ar(id);
+
+            // left over from another simulator
+            if (id != sim.id()) continue;
+
+            ar(registry.caches[{bunch.get_train_index(),
+                                bunch.get_bunch_index()}]);
+        }
+    }
+}
+
+std::string
+Frozen_fields::file_name(Bunch const& bunch)
+{
+    return "frozen_fields_" + std::to_string(bunch.get_train_index()) + "_" +
+           std::to_string(bunch.get_bunch_index()) + ".bin";
+}
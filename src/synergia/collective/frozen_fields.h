@@ -0,0 +1,273 @@
+#ifndef FROZEN_FIELDS_H_
+#define FROZEN_FIELDS_H_
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cereal/types/array.hpp>
+#include <cereal/types/map.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+
+#include "synergia/utils/kokkos_views.h"
+
+template <class PART>
+class bunch_t;
+
+using Bunch = bunch_t<double>;
+
+class Bunch_simulator;
+
+// Frozen_fields keeps the field grids of the space charge solvers of a
+// bunch, one entry per kick location, for the solvers to reuse them in
+// place of a new solve while the bunch does not change much.
+//
+// The entries of a bunch are kept under a memory budget, shared by all
+// the kick locations. When a new entry does not fit, the least recently
+// used entries are dropped.
+//
+// The caches of the bunches on this rank are kept here, keyed by the
+// bunch, see of(). They are saved with the checkpoints of the simulator,
+// unless turned off with set_checkpointed(false) to keep the checkpoints
+// small. A restart then solves again at the first kick of every location.
+class Frozen_fields {
+  public:
+    struct entry {
+        // the field grids, in double or in single precision
+        std::vector<karray1d_dev> fields;
+        std::vector<karray1f_dev> fields_f;
+
+        // precision of the solve, the fields are in fields_f when true
+        bool single_precision = false;
+
+        // whatever else the solver needs to apply the fields, e.g., the
+        // domain and the normalization
+        std::vector<double> params;
+
+        // spatial mean and standard deviation (x, y, z, sx, sy, sz) of
+        // the bunch at the solve
+        std::array<double, 6> moments;
+
+        // turn of the solve
+        int turn = 0;
+
+        size_t bytes() const;
+
+        template <class AR>
+        void save(AR& ar) const;
+
+        template <class AR>
+        void load(AR& ar);
+    };
+
+    // the entry at the kick location key, or nullptr
+    entry* find(std::string const& key);
+
+    // store the entry at key. Returns false when the entry alone is over
+    // the budget and has not been stored
+    bool insert(std::string const& key, entry const& e);
+
+    void
+    erase(std::string const& key)
+    {
+        entries.erase(key);
+    }
+
+    void
+    clear()
+    {
+        entries.clear();
+    }
+
+    size_t
+    size() const
+    {
+        return entries.size();
+    }
+
+    size_t get_memory_used() const;
+
+    // budget of every bunch, in bytes
+    static void
+    set_memory_budget(size_t bytes)
+    {
+        memory_budget = bytes;
+    }
+
+    static size_t
+    get_memory_budget()
+    {
+        return memory_budget;
+    }
+
+    // whether the caches are saved in the checkpoints of the simulators
+    static void
+    set_checkpointed(bool c)
+    {
+        checkpointed = c;
+    }
+
+    static bool
+    get_checkpointed()
+    {
+        return checkpointed;
+    }
+
+    // the cache of a bunch of the simulator sim_id, keyed by the train
+    // and bunch indices. Like the workspaces of the solvers, the caches
+    // are of one simulator at a time: a different sim_id drops those of
+    // the previous simulator
+    static Frozen_fields& of(std::string const& sim_id, Bunch const& bunch);
+
+    // drop the caches of all the bunches
+    static void clear_all();
+
+    // the caches of the bunches of sim, one file per bunch in dir. Saved
+    // and loaded by the checkpoints. The files do not depend on the
+    // number of ranks, and a bunch without a file starts with an empty
+    // cache
+    static void dump_checkpoint(std::string const& dir,
+                                Bunch_simulator const& sim);
+    static void load_checkpoint(std::string const& dir,
+                                Bunch_simulator const& sim);
+
+    // true if the bunch has moved away from the moments of the entry by
+    // more than tolerance, in units of the standard deviations of the
+    // entry, or the entry is max_turns or more turns old
+    static bool stale(entry const& e,
+                      std::array<double, 6> const& moments,
+                      int turn,
+                      int max_turns,
+                      double tolerance);
+
+  private:
+    struct slot {
+        entry e;
+        uint64_t last_used;
+    };
+
+    std::map<std::string, slot> entries;
+    uint64_t clock = 0;
+
+    static size_t memory_budget;
+    static bool checkpointed;
+
+    static std::string file_name(Bunch const& bunch);
+
+    friend class cereal::access;
+
+    template <class AR>
+    void
+    save(AR& ar) const
+    {
+        // an archive without entries, when not checkpointed, loads as
+        // an empty cache
+        ar(checkpointed ? entries.size() : size_t(0));
+
+        if (checkpointed) {
+            for (auto const& [key, s] : entries) {
+                ar(key, s.last_used);
+                s.e.save(ar);
+            }
+        }
+
+        ar(clock);
+    }
+
+    template <class AR>
+    void
+    load(AR& ar)
+    {
+        size_t num;
+        ar(num);
+
+        entries.clear();
+
+        for (size_t i = 0; i < num; ++i) {
+            std::string key;
+            slot s;
+
+            ar(key, s.last_used);
+            s.e.load(ar);
+
+            entries.emplace(key, s);
+        }
+
+        ar(clock);
+    }
+};
+
+namespace frozen_fields_impl {
+    template <class VIEW, class T>
+    std::vector<T>
+    to_host(VIEW const& v)
+    {
+        auto hv = Kokkos::create_mirror_view(v);
+        Kokkos::deep_copy(hv, v);
+
+        return std::vector<T>(hv.data(), hv.data() + hv.extent(0));
+    }
+
+    template <class VIEW, class T>
+    VIEW
+    to_device(std::vector<T> const& v)
+    {
+        VIEW dv("frozen_field", v.size());
+        auto hv = Kokkos::create_mirror_view(dv);
+
+        for (size_t i = 0; i < v.size(); ++i)
+            hv(i) = v[i];
+
+        Kokkos::deep_copy(dv, hv);
+        return dv;
+    }
+}
+
+template <class AR>
+void
+Frozen_fields::entry::save(AR& ar) const
+{
+    using namespace frozen_fields_impl;
+
+    ar(fields.size(), fields_f.size());
+
+    for (auto const& f : fields)
+        ar(to_host<karray1d_dev, double>(f));
+
+    for (auto const& f : fields_f)
+        ar(to_host<karray1f_dev, float>(f));
+
+    ar(single_precision, params, moments, turn);
+}
+
+template <class AR>
+void
+Frozen_fields::entry::load(AR& ar)
+{
+    using namespace frozen_fields_impl;
+
+    size_t nd, nf;
+    ar(nd, nf);
+
+    fields.clear();
+    fields_f.clear();
+
+    for (size_t i = 0; i < nd; ++i) {
+        std::vector<double> v;
+        ar(v);
+        fields.push_back(to_device<karray1d_dev>(v));
+    }
+
+    for (size_t i = 0; i < nf; ++i) {
+        std::vector<float> v;
+        ar(v);
+        fields_f.push_back(to_device<karray1f_dev>(v));
+    }
+
+    ar(single_precision, params, moments, turn);
+}
+
+#endif /* FROZEN_FIELDS_H_ */
@@ -1,6 +1,7 @@
 #include "impedance.h"
 
 #include "synergia/bunch/core_diagnostics.h"
+#include "synergia/bunch/particle_binning.h"
 #include "synergia/foundation/physical_constants.h"
 
 #include "synergia/bunch/period.h"
@@ -8,23 +9,11 @@
 
 #include "synergia/utils/simple_timer.h"
 
-#include <Kokkos_ScatterView.hpp>
-
 typedef Kokkos::TeamPolicy<> team_policy;
 typedef typename team_policy::member_type team_member;
 
-using scatter_t =
-  Kokkos::Experimental::ScatterView<double*, Kokkos::LayoutLeft>;
-
 namespace {
 
-  void
-  zero_karray(karray1d_dev const& arr)
-  {
-    ku::alg_zeroer alg{arr};
-    Kokkos::parallel_for(arr.extent(0), alg);
-  }
-
   struct alg_write_bps {
     Bunch_props bps;
     karray1d_dev vbi_buf;
@@ -43,77 +32,6 @@ namespace {
     }
   };
 
-  struct alg_z_binning {
-    typedef double value_type[];
-
-    const int value_count;
-    const int z_grid;
-
-    ConstParticles p;
-    ConstParticleMasks masks;
-
-    const double z_left;
-    const double recip_h;
-
-    alg_z_binning(ConstParticles const& p,
-                  ConstParticleMasks const& masks,
-                  int z_grid,
-                  double z_left,
-                  double h)
-      : value_count(z_grid * 3)
-      , z_grid(z_grid)
-      , p(p)
-      , masks(masks)
-      , z_left(z_left)
-      , recip_h(1.0 / h)
-    {}
-
-    KOKKOS_INLINE_FUNCTION
-    void
-    operator()(const int i, value_type sum) const
-    {
-      if (masks(i)) {
-        int bin = (p(i, 4) - z_left) * recip_h;
-
-        if (bin == z_grid) {
-          sum[z_grid * 0 + bin - 1] += 1;
-        } else {
-          sum[z_grid * 0 + bin] += 1;       // zdensity
-          sum[z_grid * 1 + bin] += p(i, 0); // xmom
-          sum[z_grid * 2 + bin] += p(i, 2); // ymom
-        }
-      }
-    }
-  };
-
-  struct alg_z_binning_sv {
-    ConstParticles p;
-    ConstParticleMasks masks;
-    scatter_t scatter;
-
-    const int z_grid;
-    const double z_left;
-    const double recip_h;
-
-    KOKKOS_INLINE_FUNCTION
-    void
-    operator()(const int i) const
-    {
-      if (masks(i)) {
-        auto access = scatter.access();
-
-        int bin = (p(i, 4) - z_left) * recip_h;
-        if (bin == z_grid) {
-          access(z_grid * 0 + bin - 1) += 1;
-        } else {
-          access(z_grid * 0 + bin) += 1;       // zdensity
-          access(z_grid * 1 + bin) += p(i, 0); // xmom
-          access(z_grid * 2 + bin) += p(i, 2); // ymom
-        }
-      }
-    }
-  };
-
   struct alg_z_normalize {
     karray1d_dev binning;
     const int z_grid;
@@ -690,26 +608,14 @@ Impedance::calculate_moments_and_partitions(Bunch const& bunch)
   // double h = z_length/(opts.z_grid-1.0); // AM why have I done that???
   double h = bp.cell_size_z;
 
-  // get binning results
-  auto parts = bunch.get_local_particles();
-  auto masks = bunch.get_local_particle_masks();
-
-#if 0
-    alg_z_binning alg(parts, masks, opts.z_grid, bp.z_left, h);
-    Kokkos::parallel_reduce(bunch.size(), alg, h_zbinning.data());
-    Kokkos::fence();
-#endif
-
-  // zero first
-  zero_karray(zbinning);
-
-  // z binning
-  scatter_t scatter(zbinning);
-  alg_z_binning_sv alg{parts, masks, scatter, opts.z_grid, bp.z_left, 1.0 / h};
-
-  Kokkos::parallel_for(bunch.size(), alg);
-  Kokkos::Experimental::contribute(zbinning, scatter);
-  Kokkos::fence();
+  // z binning: zdensity, xmom, ymom
+  Particle_binning::bin_1d(bunch,
+                           Bunch::cdt,
+                           bp.z_left,
+                           h,
+                           opts.z_grid,
+                           {Bunch::x, Bunch::y},
+                           zbinning);
 
   // MPI reduction to get global z-binning results
   if (bunch.get_comm().size() > 1) {
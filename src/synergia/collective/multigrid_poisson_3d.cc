@@ -0,0 +1,588 @@
+#include "multigrid_poisson_3d.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "synergia/utils/kokkos_utils.h"
+
+namespace {
+    // the operator of a level at node (i, j, k): returns the diagonal and
+    // the sum of the off-diagonal terms times phi
+    struct mg_stencil {
+        karray1d_dev phi;
+        int nx, ny;
+
+        karray1d_dev ilx, irx, wx;
+        karray1d_dev ily, iry, wy;
+        karray1d_dev ilz, irz, wz;
+
+        double sx, sy, sz;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(int i, int j, int k, double& diag, double& off) const
+        {
+            const int idx = (k * ny + j) * nx + i;
+
+            // finite volume: face areas times the inverse distances
+            const double cx = sx * wy(j) * wz(k);
+            const double cy = sy * wx(i) * wz(k);
+            const double cz = sz * wx(i) * wy(j);
+
+            diag = cx * (ilx(i) + irx(i)) + cy * (ily(j) + iry(j)) +
+                   cz * (ilz(k) + irz(k));
+
+            off = cx * (ilx(i) * phi(idx - 1) + irx(i) * phi(idx + 1)) +
+                  cy * (ily(j) * phi(idx - nx) + iry(j) * phi(idx + nx)) +
+                  cz * (ilz(k) * phi(idx - nx * ny) +
+                        irz(k) * phi(idx + nx * ny));
+        }
+    };
+
+    struct alg_mg_gs_color {
+        mg_stencil st;
+        karray1d_dev rhs;
+        int nz;
+        int color;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int idx) const
+        {
+            const int nx = st.nx;
+            const int ny = st.ny;
+
+            int k = idx / (nx * ny);
+            int j = (idx - k * nx * ny) / nx;
+            int i = idx - k * nx * ny - j * nx;
+
+            if ((i + j + k) % 2 != color) return;
+
+            // boundary values are fixed
+            if (i == 0 || i == nx - 1 || j == 0 || j == ny - 1 || k == 0 ||
+                k == nz - 1)
+                return;
+
+            double diag, off;
+            st(i, j, k, diag, off);
+
+            st.phi(idx) = (rhs(idx) + off) / diag;
+        }
+    };
+
+    struct alg_mg_residual {
+        mg_stencil st;
+        karray1d_dev rhs;
+        karray1d_dev res;
+        int nz;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int idx) const
+        {
+            const int nx = st.nx;
+            const int ny = st.ny;
+
+            int k = idx / (nx * ny);
+            int j = (idx - k * nx * ny) / nx;
+            int i = idx - k * nx * ny - j * nx;
+
+            if (i == 0 || i == nx - 1 || j == 0 || j == ny - 1 || k == 0 ||
+                k == nz - 1) {
+                res(idx) = 0.0;
+                return;
+            }
+
+            double diag, off;
+            st(i, j, k, diag, off);
+
+            res(idx) = rhs(idx) + off - diag * st.phi(idx);
+        }
+    };
+
+    // coarse rhs = P^T r, the fine nodes next to a coarse node contribute
+    // with their interpolation weight
+    struct alg_mg_restrict {
+        karray1d_dev res;
+        karray1d_dev rhs;
+
+        int fnx, fny;
+        int cnx, cny, cnz;
+
+        karray1i_row_dev fcx, fcy, fcz;
+        karray1d_dev rlx, rrx, rly, rry, rlz, rrz;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int idx) const
+        {
+            int k = idx / (cnx * cny);
+            int j = (idx - k * cnx * cny) / cnx;
+            int i = idx - k * cnx * cny - j * cnx;
+
+            if (i == 0 || i == cnx - 1 || j == 0 || j == cny - 1 || k == 0 ||
+                k == cnz - 1) {
+                rhs(idx) = 0.0;
+                return;
+            }
+
+            const double wx[3] = {rlx(i), 1.0, rrx(i)};
+            const double wy[3] = {rly(j), 1.0, rry(j)};
+            const double wz[3] = {rlz(k), 1.0, rrz(k)};
+
+            const int fi = fcx(i);
+            const int fj = fcy(j);
+            const int fk = fcz(k);
+
+            double sum = 0.0;
+
+            for (int dk = 0; dk < 3; ++dk) {
+                if (wz[dk] == 0.0) continue;
+
+                for (int dj = 0; dj < 3; ++dj) {
+                    if (wy[dj] == 0.0) continue;
+
+                    for (int di = 0; di < 3; ++di) {
+                        if (wx[di] == 0.0) continue;
+
+                        int f = ((fk + dk - 1) * fny + (fj + dj - 1)) * fnx +
+                                (fi + di - 1);
+
+                        sum += wx[di] * wy[dj] * wz[dk] * res(f);
+                    }
+                }
+            }
+
+            rhs(idx) = sum;
+        }
+    };
+
+    // fine phi += P e, trilinear interpolation of the coarse error
+    struct alg_mg_prolong {
+        karray1d_dev err;
+        karray1d_dev phi;
+
+        int fnx, fny, fnz;
+        int cnx, cny;
+
+        karray1i_row_dev plx, prx, ply, pry, plz, prz;
+        karray1d_dev pwx, pwy, pwz;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int idx) const
+        {
+            int k = idx / (fnx * fny);
+            int j = (idx - k * fnx * fny) / fnx;
+            int i = idx - k * fnx * fny - j * fnx;
+
+            if (i == 0 || i == fnx - 1 || j == 0 || j == fny - 1 || k == 0 ||
+                k == fnz - 1)
+                return;
+
+            const int ci[2] = {plx(i), prx(i)};
+            const int cj[2] = {ply(j), pry(j)};
+            const int ck[2] = {plz(k), prz(k)};
+
+            const double wx[2] = {pwx(i), 1.0 - pwx(i)};
+            const double wy[2] = {pwy(j), 1.0 - pwy(j)};
+            const double wz[2] = {pwz(k), 1.0 - pwz(k)};
+
+            double sum = 0.0;
+
+            for (int c = 0; c < 8; ++c) {
+                const int a = c & 1;
+                const int b = (c >> 1) & 1;
+                const int d = (c >> 2) & 1;
+
+                const double w = wx[a] * wy[b] * wz[d];
+                if (w == 0.0) continue;
+
+                sum += w * err((ck[d] * cny + cj[b]) * cnx + ci[a]);
+            }
+
+            phi(idx) += sum;
+        }
+    };
+
+    struct alg_mg_sqnorm {
+        karray1d_dev arr;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i, double& sum) const
+        {
+            sum += arr(i) * arr(i);
+        }
+    };
+
+    // interior rhs of the finest level, and the fixed boundary values
+    struct alg_mg_finest_rhs {
+        karray1d_dev rho;
+        karray1d_dev rhs;
+        karray1d_dev phi;
+
+        int nx, ny, nz;
+        double vol;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int idx) const
+        {
+            int k = idx / (nx * ny);
+            int j = (idx - k * nx * ny) / nx;
+            int i = idx - k * nx * ny - j * nx;
+
+            if (i == 0 || i == nx - 1 || j == 0 || j == ny - 1 || k == 0 ||
+                k == nz - 1) {
+                rhs(idx) = 0.0;
+                phi(idx) = vol * rho(idx);
+            } else {
+                rhs(idx) = vol * rho(idx);
+            }
+        }
+    };
+
+    template <class T, class V>
+    V
+    to_device(std::vector<T> const& v, std::string const& label)
+    {
+        V dv(label, v.size());
+        auto hv = Kokkos::create_mirror_view(dv);
+        for (int i = 0; i < (int)v.size(); ++i)
+            hv(i) = v[i];
+        Kokkos::deep_copy(dv, hv);
+        return dv;
+    }
+
+    karray1d_dev
+    to_dev(std::vector<double> const& v, std::string const& label)
+    {
+        return to_device<double, karray1d_dev>(v, label);
+    }
+
+    karray1i_row_dev
+    to_dev(std::vector<int> const& v, std::string const& label)
+    {
+        return to_device<int, karray1i_row_dev>(v, label);
+    }
+}
+
+void
+Multigrid_poisson_3d::construct(std::array<int, 3> const& shape,
+                                mg_cycle_t cycle,
+                                int smooth,
+                                double rtol,
+                                int max_cycles)
+{
+    if (shape[0] < 3 || shape[1] < 3 || shape[2] < 3) {
+        throw std::runtime_error(
+            "Multigrid_poisson_3d: the grid needs at least 3 nodes along "
+            "each dimension");
+    }
+
+    cycle_type = cycle;
+    num_smooth = smooth;
+    this->rtol = rtol;
+    this->max_cycles = max_cycles;
+
+    levels.clear();
+
+    // node coordinates of the current level, per dimension
+    std::array<std::vector<double>, 3> xs;
+    for (int d = 0; d < 3; ++d) {
+        xs[d].resize(shape[d]);
+        for (int i = 0; i < shape[d]; ++i)
+            xs[d][i] = i;
+    }
+
+    while (true) {
+        level_t lv;
+        for (int d = 0; d < 3; ++d)
+            lv.n[d] = xs[d].size();
+
+        const int size = lv.n[0] * lv.n[1] * lv.n[2];
+
+        // the finest level works on the solution array of the caller
+        if (!levels.empty()) lv.phi = karray1d_dev("mg_phi", size);
+        lv.rhs = karray1d_dev("mg_rhs", size);
+        lv.res = karray1d_dev("mg_res", size);
+
+        for (int d = 0; d < 3; ++d) {
+            auto const& x = xs[d];
+            const int n = x.size();
+
+            // boundary entries are never used
+            std::vector<double> il(n, 0.0), ir(n, 0.0), w(n, 0.0);
+            for (int i = 1; i < n - 1; ++i) {
+                il[i] = 1.0 / (x[i] - x[i - 1]);
+                ir[i] = 1.0 / (x[i + 1] - x[i]);
+                w[i] = 0.5 * (x[i + 1] - x[i - 1]);
+            }
+
+            lv.il[d] = to_dev(il, "mg_il");
+            lv.ir[d] = to_dev(ir, "mg_ir");
+            lv.w[d] = to_dev(w, "mg_w");
+        }
+
+        // coarsest level, at most one interior node per dimension
+        if (lv.n[0] <= 3 && lv.n[1] <= 3 && lv.n[2] <= 3) {
+            levels.push_back(lv);
+            break;
+        }
+
+        // the next coarser level keeps the even nodes and the last node.
+        // Dimensions with no more than 3 nodes are not coarsened
+        std::array<std::vector<double>, 3> cxs;
+
+        for (int d = 0; d < 3; ++d) {
+            auto const& x = xs[d];
+            const int n = x.size();
+
+            std::vector<int> fc;
+            if (n <= 3) {
+                for (int i = 0; i < n; ++i)
+                    fc.push_back(i);
+            } else {
+                for (int i = 0; i < n; i += 2)
+                    fc.push_back(i);
+                if (fc.back() != n - 1) fc.push_back(n - 1);
+            }
+
+            const int nc = fc.size();
+
+            std::vector<int> pl(n), pr(n);
+            std::vector<double> pw(n);
+            std::vector<double> rl(nc, 0.0), rr(nc, 0.0);
+
+            for (int c = 0; c < nc; ++c) {
+                cxs[d].push_back(x[fc[c]]);
+
+                pl[fc[c]] = c;
+                pr[fc[c]] = c;
+                pw[fc[c]] = 1.0;
+
+                // at most one fine node between two coarse nodes
+                if (c + 1 < nc && fc[c + 1] - fc[c] == 2) {
+                    const int f = fc[c] + 1;
+                    const double wl =
+                        (x[fc[c + 1]] - x[f]) / (x[fc[c + 1]] - x[fc[c]]);
+
+                    pl[f] = c;
+                    pr[f] = c + 1;
+                    pw[f] = wl;
+
+                    rr[c] = wl;
+                    rl[c + 1] = 1.0 - wl;
+                }
+            }
+
+            lv.pl[d] = to_dev(pl, "mg_pl");
+            lv.pr[d] = to_dev(pr, "mg_pr");
+            lv.pw[d] = to_dev(pw, "mg_pw");
+            lv.fc[d] = to_dev(fc, "mg_fc");
+            lv.rl[d] = to_dev(rl, "mg_rl");
+            lv.rr[d] = to_dev(rr, "mg_rr");
+        }
+
+        levels.push_back(lv);
+        xs = cxs;
+    }
+}
+
+void
+Multigrid_poisson_3d::smooth(level_t& lv, int sweeps)
+{
+    mg_stencil st{lv.phi,
+                  lv.n[0],
+                  lv.n[1],
+                  lv.il[0],
+                  lv.ir[0],
+                  lv.w[0],
+                  lv.il[1],
+                  lv.ir[1],
+                  lv.w[1],
+                  lv.il[2],
+                  lv.ir[2],
+                  lv.w[2],
+                  s[0],
+                  s[1],
+                  s[2]};
+
+    const int size = lv.n[0] * lv.n[1] * lv.n[2];
+
+    for (int sweep = 0; sweep < sweeps; ++sweep) {
+        for (int color = 0; color < 2; ++color) {
+            alg_mg_gs_color alg{st, lv.rhs, lv.n[2], color};
+            Kokkos::parallel_for(size, alg);
+        }
+    }
+}
+
+void
+Multigrid_poisson_3d::compute_residual(level_t& lv)
+{
+    mg_stencil st{lv.phi,
+                  lv.n[0],
+                  lv.n[1],
+                  lv.il[0],
+                  lv.ir[0],
+                  lv.w[0],
+                  lv.il[1],
+                  lv.ir[1],
+                  lv.w[1],
+                  lv.il[2],
+                  lv.ir[2],
+                  lv.w[2],
+                  s[0],
+                  s[1],
+                  s[2]};
+
+    const int size = lv.n[0] * lv.n[1] * lv.n[2];
+
+    alg_mg_residual alg{st, lv.rhs, lv.res, lv.n[2]};
+    Kokkos::parallel_for(size, alg);
+}
+
+double
+Multigrid_poisson_3d::residual_norm(level_t& lv)
+{
+    compute_residual(lv);
+
+    const int size = lv.n[0] * lv.n[1] * lv.n[2];
+
+    double sum = 0.0;
+    alg_mg_sqnorm norm{lv.res};
+    Kokkos::parallel_reduce(size, norm, sum);
+
+    return std::sqrt(sum);
+}
+
+void
+Multigrid_poisson_3d::restrict_residual(level_t& fine, level_t& coarse)
+{
+    alg_mg_restrict alg{fine.res,
+                        coarse.rhs,
+                        fine.n[0],
+                        fine.n[1],
+                        coarse.n[0],
+                        coarse.n[1],
+                        coarse.n[2],
+                        fine.fc[0],
+                        fine.fc[1],
+                        fine.fc[2],
+                        fine.rl[0],
+                        fine.rr[0],
+                        fine.rl[1],
+                        fine.rr[1],
+                        fine.rl[2],
+                        fine.rr[2]};
+
+    Kokkos::parallel_for(coarse.n[0] * coarse.n[1] * coarse.n[2], alg);
+}
+
+void
+Multigrid_poisson_3d::prolong_correct(level_t& coarse, level_t& fine)
+{
+    alg_mg_prolong alg{coarse.phi,
+                       fine.phi,
+                       fine.n[0],
+                       fine.n[1],
+                       fine.n[2],
+                       coarse.n[0],
+                       coarse.n[1],
+                       fine.pl[0],
+                       fine.pr[0],
+                       fine.pl[1],
+                       fine.pr[1],
+                       fine.pl[2],
+                       fine.pr[2],
+                       fine.pw[0],
+                       fine.pw[1],
+                       fine.pw[2]};
+
+    Kokkos::parallel_for(fine.n[0] * fine.n[1] * fine.n[2], alg);
+}
+
+void
+Multigrid_poisson_3d::cycle(int l, mg_cycle_t type)
+{
+    auto& lv = levels[l];
+
+    // one sweep solves the single interior node of the coarsest level
+    if (l == (int)levels.size() - 1) {
+        smooth(lv, 1);
+        return;
+    }
+
+    auto& coarse = levels[l + 1];
+
+    // only the residual, its norm would cost a reduction and a host
+    // sync on every level
+    smooth(lv, num_smooth);
+    compute_residual(lv);
+    restrict_residual(lv, coarse);
+
+    // coarse levels solve for the error, with zero boundaries
+    ku::zero_karray(coarse.phi);
+
+    cycle(l + 1, type);
+    if (type == mg_cycle_t::F) cycle(l + 1, mg_cycle_t::V);
+
+    prolong_correct(coarse, lv);
+    smooth(lv, num_smooth);
+}
+
+int
+Multigrid_poisson_3d::solve(karray1d_dev const& rho,
+                            karray1d_dev const& phi,
+                            std::array<double, 3> const& h)
+{
+    if (levels.empty()) {
+        throw std::runtime_error(
+            "Multigrid_poisson_3d::solve: called before construct");
+    }
+
+    auto& fine = levels[0];
+    const int size = fine.n[0] * fine.n[1] * fine.n[2];
+
+    if ((int)rho.extent(0) != size || (int)phi.extent(0) != size) {
+        throw std::runtime_error(
+            "Multigrid_poisson_3d::solve: inconsistent array sizes");
+    }
+
+    s = {h[1] * h[2] / h[0], h[0] * h[2] / h[1], h[0] * h[1] / h[2]};
+
+    // the finest level works in place on phi
+    fine.phi = phi;
+
+    alg_mg_finest_rhs alg{rho,
+                          fine.rhs,
+                          fine.phi,
+                          fine.n[0],
+                          fine.n[1],
+                          fine.n[2],
+                          h[0] * h[1] * h[2]};
+    Kokkos::parallel_for(size, alg);
+
+    double bnorm = 0.0;
+    alg_mg_sqnorm norm{fine.rhs};
+    Kokkos::parallel_reduce(size, norm, bnorm);
+
+    bnorm = std::sqrt(bnorm);
+    if (bnorm == 0.0) bnorm = 1.0;
+
+    residual = residual_norm(fine) / bnorm;
+
+    int num_cycles = 0;
+
+    while (residual > rtol && num_cycles < max_cycles) {
+        cycle(0, cycle_type);
+        residual = residual_norm(fine) / bnorm;
+        ++num_cycles;
+    }
+
+    Kokkos::fence();
+    return num_cycles;
+}
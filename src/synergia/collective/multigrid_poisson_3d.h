@@ -0,0 +1,102 @@
+#ifndef MULTIGRID_POISSON_3D_H_
+#define MULTIGRID_POISSON_3D_H_
+
+#include <array>
+#include <vector>
+
+#include "synergia/simulation/implemented_collective_options.h"
+#include "synergia/utils/kokkos_views.h"
+
+/// Matrix-free geometric multigrid solver for the 7-point discretization
+/// of -lap(phi) = rho on a regular grid, with Dirichlet boundaries. It
+/// solves the same system as the PETSc backend of Space_charge_3d_fd:
+/// the boundary nodes are fixed at hx*hy*hz*rho.
+///
+/// Arrays are in [z][y][x] order, the shape is in [x][y][z] order.
+///
+/// The levels keep every other node of the finer level plus the last
+/// one, so any grid size can be coarsened. The spacing of the coarse
+/// levels is then non-uniform near the upper boundaries, and the
+/// operator of each level is the finite volume discretization on its
+/// own nodes. Levels are smoothed with red-black Gauss-Seidel, and the
+/// residual is restricted with the transpose of the trilinear
+/// interpolation.
+///
+/// The solution array is used as the initial guess, so keeping it
+/// around between the solves warm starts the next one.
+class Multigrid_poisson_3d {
+  public:
+    Multigrid_poisson_3d() = default;
+
+    void construct(std::array<int, 3> const& shape,
+                   mg_cycle_t cycle = mg_cycle_t::V,
+                   int smooth = 2,
+                   double rtol = 1e-8,
+                   int max_cycles = 20);
+
+    /// solve for phi on a grid of cell size h. phi is the initial guess.
+    /// Returns the number of cycles taken
+    int solve(karray1d_dev const& rho,
+              karray1d_dev const& phi,
+              std::array<double, 3> const& h);
+
+    /// relative residual norm at the end of the last solve
+    double
+    get_residual() const
+    {
+        return residual;
+    }
+
+    int
+    get_num_levels() const
+    {
+        return levels.size();
+    }
+
+    std::array<int, 3> const&
+    get_level_shape(int l) const
+    {
+        return levels[l].n;
+    }
+
+  private:
+    struct level_t {
+        std::array<int, 3> n;
+
+        karray1d_dev phi;
+        karray1d_dev rhs;
+        karray1d_dev res;
+
+        // per dimension, in units of the cell size of the finest level:
+        // inverse distances to the left and right neighbours, and width
+        // of the dual cell
+        std::array<karray1d_dev, 3> il, ir, w;
+
+        // per dimension, transfers to the next coarser level.
+        //   pl, pr, pw: coarse neighbours of a node and the weight of pl
+        //   fc, rl, rr: node of a coarse node on this level, and the
+        //               weights of its left and right neighbours
+        std::array<karray1i_row_dev, 3> pl, pr, fc;
+        std::array<karray1d_dev, 3> pw, rl, rr;
+    };
+
+    void smooth(level_t& lv, int sweeps);
+    void compute_residual(level_t& lv);
+    double residual_norm(level_t& lv);
+    void restrict_residual(level_t& fine, level_t& coarse);
+    void prolong_correct(level_t& coarse, level_t& fine);
+    void cycle(int l, mg_cycle_t type);
+
+    std::vector<level_t> levels;
+
+    mg_cycle_t cycle_type = mg_cycle_t::V;
+    int num_smooth = 2;
+    double rtol = 1e-8;
+    int max_cycles = 20;
+
+    // operator scale factors of the current solve, h_y*h_z/h_x, ...
+    std::array<double, 3> s{1.0, 1.0, 1.0};
+    double residual = 0.0;
+};
+
+#endif /* MULTIGRID_POISSON_3D_H_ */
@@ -0,0 +1,246 @@
+#include "space_charge_2d_bassetti_erskine.h"
+
+#include "synergia/bunch/core_diagnostics.h"
+#include "synergia/foundation/math_constants.h"
+#include "synergia/foundation/physical_constants.h"
+
+#include "synergia/utils/simple_timer.h"
+
+namespace {
+  // returns the "normalized" electric field in the rest frame of the bunch,
+  // in inverse meters. To get the field [V/m], this must be multiplied
+  // by Q/(2 pi epsilon_o), where Q is the line density of charge [C/m]
+  // (in rest frame).
+  //
+  // from M. Bassetti and G. A. Erskine, Closed Expression for the
+  // Electrical Field of a Two-Dimensional Gaussian Charge, CERN-ISR-TH/80-06
+  //
+  // the branches are on the bunch sizes only, so all particles of a
+  // vector take the same path. T is double or a GSVector. Requires
+  // sigma_x >= sigma_y, see gaussian_unit_efield() for the other case
+  template <class T>
+  KOKKOS_INLINE_FUNCTION void
+  gaussian_unit_efield_flat(T const& x,
+                            T const& y,
+                            double sigma_x,
+                            double sigma_y,
+                            weideman_coeffs const& wc,
+                            T& ex,
+                            T& ey)
+  {
+    // round beam, where the elliptical expression loses precision
+    if (sigma_x - sigma_y < 1e-6 * sigma_x) {
+      double sigma2 = sigma_x * sigma_y;
+      double tiny2 = 1e-20 * sigma2;
+
+      T r2 = x * x + y * y + T(tiny2);
+      T e = (T(1.0) - exp(-r2 / T(2.0 * sigma2))) / r2;
+
+      ex = e * x;
+      ey = e * y;
+      return;
+    }
+
+    double s = std::sqrt(2.0 * (sigma_x * sigma_x - sigma_y * sigma_y));
+    double rxy = sigma_y / sigma_x;
+
+    // |y| without a branch, the field is odd in y
+    T ay = sqrt(y * y + T(1e-20 * sigma_y * sigma_y));
+    T sgn = y / ay;
+
+    T w1r(0.0), w1i(0.0);
+    T w2r(0.0), w2i(0.0);
+
+    wofz_weideman(T(x / T(s)), T(ay / T(s)), wc, w1r, w1i);
+    wofz_weideman(
+      T(x * T(rxy / s)), T(ay * T(1.0 / (rxy * s))), wc, w2r, w2i);
+
+    T g = exp(T(-x * x / T(2.0 * sigma_x * sigma_x)) -
+              T(y * y / T(2.0 * sigma_y * sigma_y)));
+
+    T norm(std::sqrt(mconstants::pi) / s);
+
+    ex = norm * (w1i - g * w2i);
+    ey = norm * (w1r - g * w2r) * sgn;
+  }
+
+  template <class T>
+  KOKKOS_INLINE_FUNCTION void
+  gaussian_unit_efield(T const& x,
+                       T const& y,
+                       double sigma_x,
+                       double sigma_y,
+                       weideman_coeffs const& wc,
+                       T& ex,
+                       T& ey)
+  {
+    // the expression needs sigma_x >= sigma_y, otherwise swap the planes
+    if (sigma_x >= sigma_y) {
+      gaussian_unit_efield_flat(x, y, sigma_x, sigma_y, wc, ex, ey);
+    } else {
+      gaussian_unit_efield_flat(y, x, sigma_y, sigma_x, wc, ey, ex);
+    }
+  }
+
+  // line charge density of the bunch at z
+  //   uniform: lambda = coeff
+  //   gaussian: lambda = exp(-z^2/(2 sigma_cdt^2)) * coeff
+  template <class T>
+  KOKKOS_INLINE_FUNCTION T
+  line_density(T const& z, bool gaussian, double sigma_cdt, double coeff)
+  {
+    if (!gaussian) return T(coeff);
+    return exp(-z * z / T(2.0 * sigma_cdt * sigma_cdt)) * T(coeff);
+  }
+
+  // kicks a vector of particles at a time, see ff_dipedge.h
+  struct sc_be {
+    using gsv_t = Bunch::gsv_t;
+
+    Particles p;
+    ConstParticleMasks masks;
+
+    weideman_coeffs wc;
+
+    double offx;
+    double offy;
+    double offz;
+
+    double sigma_x;
+    double sigma_y;
+    double sigma_cdt;
+
+    double factor;
+    double coeff;
+
+    bool gaussian;
+
+    KOKKOS_INLINE_FUNCTION
+    void
+    operator()(const int idx) const
+    {
+      int i = idx * gsv_t::size();
+
+      int m = 0;
+      for (int x = i; x < i + gsv_t::size(); ++x)
+        m |= masks(x);
+
+      if (m) {
+        gsv_t p0(&p(i, 0));
+        gsv_t p1(&p(i, 1));
+        gsv_t p2(&p(i, 2));
+        gsv_t p3(&p(i, 3));
+        gsv_t p4(&p(i, 4));
+
+        gsv_t x = p0 - gsv_t(offx);
+        gsv_t y = p2 - gsv_t(offy);
+        gsv_t z = p4 - gsv_t(offz);
+
+        gsv_t ex(0.0), ey(0.0);
+        gaussian_unit_efield(x, y, sigma_x, sigma_y, wc, ex, ey);
+
+        gsv_t lambda = line_density(z, gaussian, sigma_cdt, coeff);
+
+        p1 = p1 + ex * gsv_t(factor) * lambda;
+        p3 = p3 + ey * gsv_t(factor) * lambda;
+
+        p1.store(&p(i, 1));
+        p3.store(&p(i, 3));
+      }
+    }
+  };
+}
+
+Space_charge_2d_bassetti_erskine::Space_charge_2d_bassetti_erskine(
+  Space_charge_2d_bassetti_erskine_options const& opts)
+  : Collective_operator("sc_2d_bassetti_erskine", 1.0)
+  , opts(opts)
+  , wcoeffs(get_weideman_coeffs())
+{}
+
+void
+Space_charge_2d_bassetti_erskine::apply_impl(Bunch_simulator& sim,
+                                             double time_step,
+                                             Logger& logger)
+{
+  logger << "    Space charge 2d Bassetti-Erskine\n";
+
+  scoped_simple_timer timer("sc2d_be_total");
+
+  // apply to bunches
+  for (size_t t = 0; t < 2; ++t) {
+    for (size_t b = 0; b < sim[t].get_bunch_array_size(); ++b) {
+      apply_bunch(sim[t][b], time_step, logger);
+    }
+  }
+}
+
+void
+Space_charge_2d_bassetti_erskine::apply_bunch(Bunch& bunch,
+                                              double time_step,
+                                              Logger& logger)
+{
+  // mean x, y, cdt, then std x, y, cdt
+  auto ms = Core_diagnostics::calculate_spatial_mean_stddev(bunch);
+
+  // dp/p kick, see Space_charge_2d_kv
+  double beta = bunch.get_reference_particle().get_beta();
+  double gamma = bunch.get_reference_particle().get_gamma();
+
+  double factor =
+    pconstants::rp * pconstants::c * time_step / (gamma * gamma * gamma * beta);
+
+  double total_q = bunch.get_real_num() * bunch.get_particle_charge();
+
+  double offx = 0;
+  double offy = 0;
+  double offz = 0;
+
+  if (!opts.strictly_centered) {
+    offx = ms(0);
+    offy = ms(1);
+    offz = ms(2);
+  }
+
+  bool gaussian = opts.longitudinal_distribution ==
+                  Space_charge_2d_bassetti_erskine_options::LD::gaussian;
+
+  // the uniform bunch is sqrt(12)*sigma_z long, as in Space_charge_2d_kv
+  double coeff = gaussian ?
+                   total_q / (sqrt(2.0 * mconstants::pi) * ms(5) * beta) :
+                   total_q / (std::sqrt(12) * ms(5) * beta);
+
+  auto parts = bunch.get_local_particles();
+  auto masks = bunch.get_local_particle_masks();
+
+  sc_be alg{parts,
+            masks,
+            wcoeffs,
+            offx,
+            offy,
+            offz,
+            ms(3),
+            ms(4),
+            ms(5),
+            factor,
+            coeff,
+            gaussian};
+
+  Kokkos::parallel_for(bunch.size_in_gsv(), alg);
+
+  Kokkos::fence();
+}
+
+std::array<double, 2>
+Space_charge_2d_bassetti_erskine::get_unit_efield(double x,
+                                                  double y,
+                                                  double sigma_x,
+                                                  double sigma_y)
+{
+  static const weideman_coeffs wc = get_weideman_coeffs();
+
+  double ex = 0.0, ey = 0.0;
+  gaussian_unit_efield(x, y, sigma_x, sigma_y, wc, ex, ey);
+
+  return {ex, ey};
+}
@@ -0,0 +1,41 @@
+#ifndef SPACE_CHARGE_2D_BASSETTI_ERSKINE_H_
+#define SPACE_CHARGE_2D_BASSETTI_ERSKINE_H_
+
+#include "synergia/simulation/collective_operator.h"
+#include "synergia/simulation/implemented_collective_options.h"
+
+#include "synergia/utils/complex_error_function.h"
+
+/// Grid free transverse space charge of an elliptical Gaussian bunch.
+/// The field is the Bassetti-Erskine field of the rms sizes of the bunch,
+/// scaled by the line density at the particle, see
+/// Space_charge_2d_bassetti_erskine_options.
+class Space_charge_2d_bassetti_erskine : public Collective_operator {
+
+private:
+  const Space_charge_2d_bassetti_erskine_options opts;
+
+  // coefficients of the Faddeeva function
+  const weideman_coeffs wcoeffs;
+
+  void apply_impl(Bunch_simulator& simulator,
+                  double time_step,
+                  Logger& logger) override;
+
+  void apply_bunch(Bunch& bunch, double time_step, Logger& logger);
+
+public:
+  Space_charge_2d_bassetti_erskine(
+    Space_charge_2d_bassetti_erskine_options const& opts);
+
+  /// the field of a unit line charge with the Gaussian transverse profile
+  /// of rms sizes sigma_x and sigma_y, at (x, y) from its centre, in
+  /// inverse meters. Multiply by Q/(2 pi epsilon0), with Q the line
+  /// density of charge, for the field in V/m
+  static std::array<double, 2> get_unit_efield(double x,
+                                               double y,
+                                               double sigma_x,
+                                               double sigma_y);
+};
+
+#endif /* SPACE_CHARGE_2D_BASSETTI_ERSKINE_H_ */
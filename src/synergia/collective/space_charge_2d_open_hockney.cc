@@ -1,6 +1,9 @@
 
 #include "space_charge_2d_open_hockney.h"
 #include "deposit.h"
+#include "utils.h"
+
+#include "frozen_fields.h"
 
 #include "synergia/bunch/core_diagnostics.h"
 #include "synergia/foundation/math_constants.h"
@@ -199,6 +202,48 @@ namespace {
     }
   };
 
+  // particle bins of the kicker, as the deposit would have them
+  struct alg_binner {
+    ConstParticles p;
+    karray2d_dev bin;
+
+    double lx, ly, lz;
+    double ihx, ihy, ihz;
+
+    alg_binner(ConstParticles p,
+               karray2d_dev const& bin,
+               std::array<double, 3> const& l,
+               std::array<double, 3> const& h)
+      : p(p)
+      , bin(bin)
+      , lx(l[0])
+      , ly(l[1])
+      , lz(l[2])
+      , ihx(1.0 / h[0])
+      , ihy(1.0 / h[1])
+      , ihz(1.0 / h[2])
+    {}
+
+    KOKKOS_INLINE_FUNCTION
+    void
+    operator()(const int i) const
+    {
+      int ix, iy, iz;
+      double ox, oy, oz;
+
+      get_leftmost_indices_offset(p(i, 0), lx, ihx, ix, ox);
+      get_leftmost_indices_offset(p(i, 2), ly, ihy, iy, oy);
+      get_leftmost_indices_offset(p(i, 4), lz, ihz, iz, oz);
+
+      bin(i, 0) = ix;
+      bin(i, 1) = ox;
+      bin(i, 2) = iy;
+      bin(i, 3) = oy;
+      bin(i, 4) = iz;
+      bin(i, 5) = oz;
+    }
+  };
+
   struct alg_kicker {
     Particles p;
     ConstParticleMasks masks;
@@ -312,6 +357,16 @@ Space_charge_2d_open_hockney::apply_bunch(Bunch& bunch,
                                           double time_step,
                                           Logger& logger)
 {
+  std::array<double, 6> moments;
+
+  // reuse the fields of the last solve at this location
+  if (options.frozen_turns > 0) {
+    auto mean_std = Core_diagnostics::calculate_spatial_mean_stddev(bunch);
+    for (int i = 0; i < 6; ++i) moments[i] = mean_std(i);
+
+    if (apply_frozen(bunch, moments, time_step)) return;
+  }
+
   update_domain(bunch);
 
   get_local_charge_density(bunch); // [C/m^3]
@@ -324,7 +379,91 @@ Space_charge_2d_open_hockney::apply_bunch(Bunch& bunch,
 
   auto fn_norm = get_normalization_force(bunch, fft);
 
-  apply_kick(bunch, fn_norm, time_step);
+  apply_kick(bunch, phi2, rho2, fn_norm, time_step);
+
+  // keep the fields for the next turns
+  if (options.frozen_turns > 0) freeze(bunch, moments, fn_norm);
+}
+
+std::string
+Space_charge_2d_open_hockney::get_frozen_key(Bunch const& bunch) const
+{
+  // the kick location is the position of the reference particle in the
+  // turn, to a micron
+  auto s = bunch.get_reference_particle().get_s_n();
+  return get_name() + ":" + std::to_string(std::llround(s * 1e6));
+}
+
+bool
+Space_charge_2d_open_hockney::apply_frozen(Bunch& bunch,
+                                           std::array<double, 6> const& moments,
+                                           double time_step)
+{
+  auto e = Frozen_fields::of(bunch_sim_id, bunch).find(get_frozen_key(bunch));
+  if (!e) return false;
+
+  // the fields are always frozen in double precision
+  if (e->single_precision) return false;
+
+  int turn = bunch.get_reference_particle().get_repetition();
+
+  if (Frozen_fields::stale(
+        *e, moments, turn, options.frozen_turns, options.frozen_tolerance))
+    return false;
+
+  scoped_simple_timer timer("sc2d_frozen");
+
+  // params are the offset, size and normalization of the solve
+  auto const& p = e->params;
+
+  std::array<double, 3> offset{p[0], p[1], p[2]};
+  std::array<double, 3> size{p[3], p[4], p[5]};
+  std::array<double, 3> doubled_size{size[0] * 2.0, size[1] * 2.0, size[2]};
+
+  domain = Rectangular_grid_domain(options.shape, size, offset, false);
+  doubled_domain =
+    Rectangular_grid_domain(options.doubled_shape, doubled_size, offset, false);
+
+  // the kicker reads the particle bins of the deposit
+  if (bunch.size() > particle_bin.extent(0))
+    Kokkos::resize(particle_bin, bunch.size(), 6);
+
+  alg_binner binner(bunch.get_local_particles(),
+                    particle_bin,
+                    doubled_domain.get_left(),
+                    doubled_domain.get_cell_size());
+
+  Kokkos::parallel_for(bunch.size(), binner);
+
+  // force and line density of the entry
+  apply_kick(bunch, e->fields[0], e->fields[1], p[6], time_step);
+  return true;
+}
+
+void
+Space_charge_2d_open_hockney::freeze(Bunch& bunch,
+                                     std::array<double, 6> const& moments,
+                                     double fn_norm)
+{
+  Frozen_fields::entry e;
+
+  auto copy = [](karray1d_dev const& v) {
+    karray1d_dev c(v.label(), v.extent(0));
+    Kokkos::deep_copy(c, v);
+    return c;
+  };
+
+  e.fields = {copy(phi2), copy(rho2)};
+
+  auto const& offset = domain.get_physical_offset();
+  auto const& size = domain.get_physical_size();
+
+  e.params = {
+    offset[0], offset[1], offset[2], size[0], size[1], size[2], fn_norm};
+  e.moments = moments;
+  e.turn = bunch.get_reference_particle().get_repetition();
+
+  Frozen_fields::of(bunch_sim_id, bunch).insert(get_frozen_key(bunch), e);
 }
 
 void
@@ -341,6 +480,11 @@ Space_charge_2d_open_hockney::construct_workspaces(Bunch_simulator const& sim)
   h_rho2 = Kokkos::create_mirror_view(rho2);
   h_phi2 = Kokkos::create_mirror_view(phi2);
 
+  if (options.single_precision) {
+    buf_f = karray1f_dev("buf_f", rho2.extent(0));
+    h_buf_f = Kokkos::create_mirror_view(buf_f);
+  }
+
   for (size_t t = 0; t < 2; ++t) {
     int num_local_bunches = sim[t].get_bunch_array_size();
     ffts[t] = std::vector<Distributed_fft2d>(num_local_bunches);
@@ -415,6 +559,18 @@ Space_charge_2d_open_hockney::get_global_charge_density(Bunch const& bunch)
 
   auto dg = doubled_domain.get_grid_shape();
 
+  if (options.single_precision) {
+    int err =
+      ku::allreduce_sum_single(rho2, buf_f, h_buf_f, bunch.get_comm());
+
+    if (err != MPI_SUCCESS) {
+      throw std::runtime_error("MPI error in Space_charge_2d_open_hockney"
+                               "(MPI_Allreduce in get_global_charge_density)");
+    }
+
+    return;
+  }
+
   simple_timer_start("sc2d_global_rho_copy");
   Kokkos::deep_copy(h_rho2, rho2);
   simple_timer_stop("sc2d_global_rho_copy");
@@ -497,6 +653,18 @@ Space_charge_2d_open_hockney::get_global_force2(Commxx const& comm)
 
   auto dg = doubled_domain.get_grid_shape();
 
+  if (options.single_precision) {
+    int err = ku::allreduce_sum_single(phi2, buf_f, h_buf_f, comm);
+
+    if (err != MPI_SUCCESS) {
+      throw std::runtime_error(
+        "MPI error in Space_charge_2d_open_hockney"
+        "(MPI_Allreduce in get_global_electric_force2_allreduce)");
+    }
+
+    return;
+  }
+
   Kokkos::deep_copy(h_phi2, phi2);
 
   int err = MPI_Allreduce(MPI_IN_PLACE,
@@ -552,6 +720,8 @@ Space_charge_2d_open_hockney::get_normalization_force(
 
 void
 Space_charge_2d_open_hockney::apply_kick(Bunch& bunch,
+                                         karray1d_dev const& fn,
+                                         karray1d_dev const& rho,
                                          double fn_norm,
                                          double time_step)
 {
@@ -603,8 +773,8 @@ Space_charge_2d_open_hockney::apply_kick(Bunch& bunch,
 
   alg_kicker kicker(parts,
                     masks,
-                    phi2,
-                    rho2,
+                    fn,
+                    rho,
                     particle_bin,
                     doubled_domain.get_grid_shape(),
                     factor);
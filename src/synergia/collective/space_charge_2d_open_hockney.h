@@ -32,6 +32,10 @@ private:
   karray1d_hst h_rho2;
   karray1d_hst h_phi2;
 
+  // message buffer of the single_precision reductions
+  karray1f_dev buf_f;
+  karray1f_hst h_buf_f;
+
 private:
   void apply_impl(Bunch_simulator& simulator,
                   double time_step,
@@ -56,7 +60,24 @@ private:
 
   void get_global_force2(Commxx const& comm);
 
-  void apply_kick(Bunch& bunch, double fn_norm, double time_step);
+  // kick with the force fn and the line density rho, of the solve or
+  // frozen
+  void apply_kick(Bunch& bunch,
+                  karray1d_dev const& fn,
+                  karray1d_dev const& rho,
+                  double fn_norm,
+                  double time_step);
+
+  // frozen fields
+  std::string get_frozen_key(Bunch const& bunch) const;
+
+  bool apply_frozen(Bunch& bunch,
+                    std::array<double, 6> const& moments,
+                    double time_step);
+
+  void freeze(Bunch& bunch,
+              std::array<double, 6> const& moments,
+              double fn_norm);
 
   double get_normalization_force(Bunch const& bunch,
                                  Distributed_fft2d const& fft);
@@ -0,0 +1,633 @@
+
+#include "space_charge_2d_sliced.h"
+#include "utils.h"
+
+#include "synergia/bunch/core_diagnostics.h"
+#include "synergia/foundation/math_constants.h"
+#include "synergia/foundation/physical_constants.h"
+#include "synergia/utils/kokkos_utils.h"
+#include "synergia/utils/simple_timer.h"
+
+using mconstants::pi;
+
+namespace {
+  double
+  get_smallest_non_tiny(double val, double other1, double other2, double tiny)
+  {
+    double retval;
+    if (val > tiny) {
+      retval = val;
+    } else {
+      if ((other1 > tiny) && (other2 > tiny)) {
+        retval = std::min(other1, other2);
+      } else {
+        retval = std::max(other1, other2);
+      }
+    }
+
+    return retval;
+  }
+
+  // linear weights of the two slices around z. Particles between the
+  // domain boundary and the outermost slice centres go to the outermost
+  // slice in full, particles outside the domain return false
+  KOKKOS_INLINE_FUNCTION
+  bool
+  get_slice_offset(double z, double lz, double ihz, int nz, int& iz, double& oz)
+  {
+    double scaled = (z - lz) * ihz - 0.5;
+    if (scaled < -0.5 || scaled >= nz - 0.5) return false;
+
+    iz = static_cast<int>(Kokkos::floor(scaled));
+    oz = scaled - iz;
+
+    if (iz < 0) {
+      iz = 0;
+      oz = 0.0;
+    } else if (iz > nz - 2) {
+      iz = nz - 1;
+      oz = 0.0;
+    }
+
+    return true;
+  }
+
+  // cic deposit of all the local particles on all the slices
+  struct alg_slice_deposit {
+    ConstParticles p;
+    ConstParticleMasks masks;
+    karray1d_atomic_dev rho;
+
+    int dgx, dgy, nz;
+    double lx, ly, lz;
+    double ihx, ihy, ihz;
+    double w0;
+
+    alg_slice_deposit(ConstParticles p,
+                      ConstParticleMasks masks,
+                      karray1d_atomic_dev const& rho,
+                      std::array<int, 3> const& dg,
+                      std::array<double, 3> const& l,
+                      std::array<double, 3> const& h,
+                      double w0)
+      : p(p)
+      , masks(masks)
+      , rho(rho)
+      , dgx(dg[0])
+      , dgy(dg[1])
+      , nz(dg[2])
+      , lx(l[0])
+      , ly(l[1])
+      , lz(l[2])
+      , ihx(1.0 / h[0])
+      , ihy(1.0 / h[1])
+      , ihz(1.0 / h[2])
+      , w0(w0)
+    {}
+
+    KOKKOS_INLINE_FUNCTION
+    void
+    operator()(const int i) const
+    {
+      if (!masks(i)) return;
+
+      int ix, iy, iz;
+      double ox, oy, oz;
+
+      if (!get_slice_offset(p(i, 4), lz, ihz, nz, iz, oz)) return;
+
+      get_leftmost_indices_offset(p(i, 0), lx, ihx, ix, ox);
+      get_leftmost_indices_offset(p(i, 2), ly, ihy, iy, oy);
+
+      for (int dz = 0; dz < 2; ++dz) {
+        int k = iz + dz;
+        double wz = dz ? oz : 1.0 - oz;
+        if (k >= nz || wz == 0.0) continue;
+
+        for (int dx = 0; dx < 2; ++dx) {
+          int cx = ix + dx;
+          double wx = dx ? ox : 1.0 - ox;
+          if (cx < 0 || cx >= dgx) continue;
+
+          for (int dy = 0; dy < 2; ++dy) {
+            int cy = iy + dy;
+            double wy = dy ? oy : 1.0 - oy;
+            if (cy < 0 || cy >= dgy) continue;
+
+            rho(((k * dgx + cx) * dgy + cy) * 2) += w0 * wx * wy * wz;
+          }
+        }
+      }
+    }
+  };
+
+  struct alg_g2_pointlike {
+    const double epsilon = 0.01;
+
+    karray1d_dev g2;
+    int gx, gy;
+    int dgx, dgy;
+    double hx, hy;
+
+    alg_g2_pointlike(karray1d_dev const& g2,
+                     std::array<int, 3> const& g,
+                     std::array<int, 3> const& dg,
+                     std::array<double, 3> const& h)
+      : g2(g2), gx(g[0]), gy(g[1]), dgx(dg[0]), dgy(dg[1]), hx(h[0]), hy(h[1])
+    {}
+
+    KOKKOS_INLINE_FUNCTION
+    void
+    operator()(const int i) const
+    {
+      int ix = i / dgy;
+      int iy = i - ix * dgy;
+
+      double dx = (ix > gx) ? (ix - dgx) * hx : ix * hx;
+      double dy = (iy > gy) ? (iy - dgy) * hy : iy * hy;
+
+      double Gx, Gy;
+
+      if (ix == gx || iy == gy) {
+        Gx = 0.0;
+        Gy = 0.0;
+      } else {
+        double inv = 1.0 / (dx * dx + dy * dy + hx * hy * epsilon * epsilon);
+        Gx = dx * inv;
+        Gy = dy * inv;
+      }
+
+      g2(i * 2) = Gx;
+      g2(i * 2 + 1) = Gy;
+    }
+  };
+
+  // every slice of rho times the same green function
+  struct alg_slice_multiplier {
+    karray1d_dev prod;
+    karray1d_dev rho;
+    karray1d_dev g;
+    int n;
+
+    alg_slice_multiplier(karray1d_dev const& prod,
+                         karray1d_dev const& rho,
+                         karray1d_dev const& g,
+                         int n)
+      : prod(prod), rho(rho), g(g), n(n)
+    {}
+
+    KOKKOS_INLINE_FUNCTION
+    void
+    operator()(const int i) const
+    {
+      const int c = i % n;
+
+      const double rr = rho(i * 2);
+      const double ri = rho(i * 2 + 1);
+      const double gr = g(c * 2);
+      const double gi = g(c * 2 + 1);
+
+      prod(i * 2) = rr * gr - ri * gi;
+      prod(i * 2 + 1) = rr * gi + ri * gr;
+    }
+  };
+
+  struct alg_slice_kicker {
+    Particles p;
+    ConstParticleMasks masks;
+    karray1d_dev fn;
+
+    int dgx, dgy, nz;
+    double lx, ly, lz;
+    double ihx, ihy, ihz;
+    double factor;
+
+    alg_slice_kicker(Particles p,
+                     ConstParticleMasks masks,
+                     karray1d_dev const& fn,
+                     std::array<int, 3> const& dg,
+                     std::array<double, 3> const& l,
+                     std::array<double, 3> const& h,
+                     double factor)
+      : p(p)
+      , masks(masks)
+      , fn(fn)
+      , dgx(dg[0])
+      , dgy(dg[1])
+      , nz(dg[2])
+      , lx(l[0])
+      , ly(l[1])
+      , lz(l[2])
+      , ihx(1.0 / h[0])
+      , ihy(1.0 / h[1])
+      , ihz(1.0 / h[2])
+      , factor(factor)
+    {}
+
+    KOKKOS_INLINE_FUNCTION
+    void
+    operator()(const int i) const
+    {
+      if (!masks(i)) return;
+
+      int ix, iy, iz;
+      double ox, oy, oz;
+
+      if (!get_slice_offset(p(i, 4), lz, ihz, nz, iz, oz)) return;
+
+      get_leftmost_indices_offset(p(i, 0), lx, ihx, ix, ox);
+      get_leftmost_indices_offset(p(i, 2), ly, ihy, iy, oy);
+
+      if (ix < 0 || ix >= dgx - 1 || iy < 0 || iy >= dgy - 1) return;
+
+      double vx = 0.0;
+      double vy = 0.0;
+
+      for (int dz = 0; dz < 2; ++dz) {
+        int k = iz + dz;
+        double wz = dz ? oz : 1.0 - oz;
+        if (k >= nz || wz == 0.0) continue;
+
+        int base = (k * dgx + ix) * dgy + iy;
+
+        double w00 = wz * (1.0 - ox) * (1.0 - oy);
+        double w10 = wz * ox * (1.0 - oy);
+        double w01 = wz * (1.0 - ox) * oy;
+        double w11 = wz * ox * oy;
+
+        vx += w00 * fn(base * 2) + w10 * fn((base + dgy) * 2) +
+              w01 * fn((base + 1) * 2) + w11 * fn((base + dgy + 1) * 2);
+
+        vy += w00 * fn(base * 2 + 1) + w10 * fn((base + dgy) * 2 + 1) +
+              w01 * fn((base + 1) * 2 + 1) + w11 * fn((base + dgy + 1) * 2 + 1);
+      }
+
+      p(i, 1) += factor * vx;
+      p(i, 3) += factor * vy;
+    }
+  };
+}
+
+Space_charge_2d_sliced::Space_charge_2d_sliced(
+  Space_charge_2d_sliced_options const& ops)
+  : Collective_operator("sc_2d_sliced", 1.0)
+  , options(ops)
+  , bunch_sim_id()
+  , domain(ops.shape, {1.0, 1.0, 1.0})
+  , doubled_domain(ops.doubled_shape, {1.0, 1.0, 1.0})
+  , ffts()
+  , ffts_g()
+{
+  if (ops.shape[2] < 1) {
+    throw std::runtime_error(
+      "Space_charge_2d_sliced: number of slices must be >= 1");
+  }
+
+  if (ops.domain_fixed) {
+    std::array<double, 3> doubled_size{ops.size[0] * 2.0,
+                                       ops.size[1] * 2.0,
+                                       ops.size[2]};
+
+    domain =
+      Rectangular_grid_domain(options.shape, ops.size, ops.offset, false);
+    doubled_domain = Rectangular_grid_domain(
+      options.doubled_shape, doubled_size, ops.offset, false);
+  }
+}
+
+std::pair<int, int>
+Space_charge_2d_sliced::get_local_slices(int num_slices, int rank, int size)
+{
+  int per_rank = num_slices / size;
+  int extra = num_slices % size;
+
+  // the first extra ranks take one more slice
+  int first = rank * per_rank + std::min(rank, extra);
+  int count = per_rank + (rank < extra ? 1 : 0);
+
+  return {first, count};
+}
+
+void
+Space_charge_2d_sliced::apply_impl(Bunch_simulator& sim,
+                                   double time_step,
+                                   Logger& logger)
+{
+  logger << "    Space charge 2d sliced\n";
+
+  scoped_simple_timer timer("sc2d_sliced_total");
+
+  // construct the workspace for a new bunch simulator
+  if (bunch_sim_id != sim.id()) {
+    construct_workspaces(sim);
+    bunch_sim_id = sim.id();
+  }
+
+  // apply to bunches
+  for (size_t t = 0; t < 2; ++t) {
+    for (size_t b = 0; b < sim[t].get_bunch_array_size(); ++b) {
+      apply_bunch(sim[t][b], ffts[t][b], ffts_g[t][b], time_step, logger);
+    }
+  }
+}
+
+void
+Space_charge_2d_sliced::apply_bunch(Bunch& bunch,
+                                    Distributed_fft2d& fft,
+                                    Distributed_fft2d& fft_g,
+                                    double time_step,
+                                    Logger& logger)
+{
+  if (!options.domain_fixed) update_domain(bunch);
+
+  get_charge_density(bunch);
+
+  // solve the local slices, if any
+  auto const& comm = bunch.get_comm();
+  auto local = get_local_slices(options.shape[2], comm.rank(), comm.size());
+
+  if (local.second) {
+    get_green_fn2_pointlike(fft_g);
+    get_local_force2(fft);
+  }
+
+  get_global_force2(comm);
+
+  auto fn_norm = get_normalization_force(bunch);
+
+  apply_kick(bunch, fn_norm, time_step);
+}
+
+void
+Space_charge_2d_sliced::construct_workspaces(Bunch_simulator const& sim)
+{
+  scoped_simple_timer timer("sc2d_sliced_workspaces");
+
+  auto const& s = options.doubled_shape;
+
+  rho2 = karray1d_dev("rho2", s[0] * s[1] * s[2] * 2);
+  phi2 = karray1d_dev("phi2", s[0] * s[1] * s[2] * 2);
+  g2 = karray1d_dev("g2", s[0] * s[1] * 2);
+
+  h_rho2 = Kokkos::create_mirror_view(rho2);
+  h_phi2 = Kokkos::create_mirror_view(phi2);
+
+  // local slice arrays are sized by the bunch comm at the deposit
+  rho2_local = karray1d_dev();
+  phi2_local = karray1d_dev();
+
+  for (size_t t = 0; t < 2; ++t) {
+    int num_local_bunches = sim[t].get_bunch_array_size();
+    ffts[t] = std::vector<Distributed_fft2d>(num_local_bunches);
+    ffts_g[t] = std::vector<Distributed_fft2d>(num_local_bunches);
+
+    for (size_t b = 0; b < num_local_bunches; ++b) {
+      auto const& comm = sim[t][b].get_comm();
+
+      // the slice ffts are local to the rank
+      auto self = comm.split(comm.rank());
+      auto local = get_local_slices(s[2], comm.rank(), comm.size());
+
+      if (local.second == 0) continue;
+
+      ffts[t][b].construct({s[0], s[1]}, self, local.second);
+      ffts_g[t][b].construct({s[0], s[1]}, self);
+    }
+  }
+}
+
+void
+Space_charge_2d_sliced::update_domain(Bunch const& bunch)
+{
+  scoped_simple_timer timer("sc2d_sliced_domain");
+
+  auto mean = Core_diagnostics::calculate_mean(bunch);
+  auto std = Core_diagnostics::calculate_std(bunch, mean);
+
+  const double tiny = 1.0e-10;
+
+  if ((std[0] < tiny) && (std[2] < tiny) && (std[4] < tiny)) {
+    throw std::runtime_error(
+      "Space_charge_2d_sliced::update_domain: "
+      "all three spatial dimensions have neglible extent");
+  }
+
+  std::array<double, 3> offset{mean[0], mean[2], mean[4]};
+
+  std::array<double, 3> size{
+    options.n_sigma * get_smallest_non_tiny(std[0], std[2], std[4], tiny),
+    options.n_sigma * get_smallest_non_tiny(std[2], std[0], std[4], tiny),
+    options.n_sigma * get_smallest_non_tiny(std[4], std[0], std[2], tiny)};
+
+  std::array<double, 3> doubled_size{size[0] * 2.0, size[1] * 2.0, size[2]};
+
+  domain = Rectangular_grid_domain(options.shape, size, offset, false);
+
+  doubled_domain =
+    Rectangular_grid_domain(options.doubled_shape, doubled_size, offset, false);
+}
+
+void
+Space_charge_2d_sliced::get_charge_density(Bunch const& bunch)
+{
+  scoped_simple_timer timer("sc2d_sliced_rho");
+
+  auto dg = doubled_domain.get_grid_shape();
+  auto h = doubled_domain.get_cell_size();
+  auto l = doubled_domain.get_left();
+
+  // charge per unit area and unit length of every slice
+  double weight0 = (bunch.get_real_num() / bunch.get_total_num()) *
+                   bunch.get_particle_charge() * pconstants::e /
+                   (h[0] * h[1] * h[2]);
+
+  ku::zero_karray(rho2);
+
+  karray1d_atomic_dev rho_atomic = rho2;
+  alg_slice_deposit alg(bunch.get_local_particles(),
+                        bunch.get_local_particle_masks(),
+                        rho_atomic,
+                        dg,
+                        l,
+                        h,
+                        weight0);
+
+  Kokkos::parallel_for(bunch.size(), alg);
+  Kokkos::fence();
+
+  auto const& comm = bunch.get_comm();
+
+  // a single rank solves all the slices in place
+  if (comm.size() == 1) {
+    rho2_local = rho2;
+    phi2_local = phi2;
+    return;
+  }
+
+  // sum the slices over the ranks, every rank receives its own block
+  const int n = dg[0] * dg[1] * 2;
+  auto local = get_local_slices(dg[2], comm.rank(), comm.size());
+
+  if (rho2_local.extent(0) != local.second * n ||
+      rho2_local.data() == rho2.data()) {
+    rho2_local = karray1d_dev("rho2_local", local.second * n);
+    phi2_local = karray1d_dev("phi2_local", local.second * n);
+
+    h_rho2_local = Kokkos::create_mirror_view(rho2_local);
+    h_phi2_local = Kokkos::create_mirror_view(phi2_local);
+  }
+
+  std::vector<int> counts(comm.size());
+  for (int r = 0; r < comm.size(); ++r)
+    counts[r] = get_local_slices(dg[2], r, comm.size()).second * n;
+
+  Kokkos::deep_copy(h_rho2, rho2);
+
+  int err = MPI_Reduce_scatter((void*)h_rho2.data(),
+                               (void*)h_rho2_local.data(),
+                               counts.data(),
+                               MPI_DOUBLE,
+                               MPI_SUM,
+                               comm);
+
+  if (err != MPI_SUCCESS) {
+    throw std::runtime_error("MPI error in Space_charge_2d_sliced"
+                             "(MPI_Reduce_scatter in get_charge_density)");
+  }
+
+  Kokkos::deep_copy(rho2_local, h_rho2_local);
+}
+
+void
+Space_charge_2d_sliced::get_green_fn2_pointlike(Distributed_fft2d& fft_g)
+{
+  scoped_simple_timer timer("sc2d_sliced_green_fn2");
+
+  auto g = domain.get_grid_shape();
+  auto h = doubled_domain.get_cell_size();
+  auto dg = doubled_domain.get_grid_shape();
+
+  alg_g2_pointlike alg(g2, g, dg, h);
+
+  Kokkos::parallel_for(dg[0] * dg[1], alg);
+  Kokkos::fence();
+
+  fft_g.transform(g2, g2);
+  Kokkos::fence();
+}
+
+void
+Space_charge_2d_sliced::get_local_force2(Distributed_fft2d& fft)
+{
+  scoped_simple_timer timer("sc2d_sliced_local_f");
+
+  auto dg = doubled_domain.get_grid_shape();
+  const int n = dg[0] * dg[1];
+
+  // all the local slices in one batch
+  fft.transform(rho2_local, rho2_local);
+  Kokkos::fence();
+
+  alg_slice_multiplier alg(phi2_local, rho2_local, g2, n);
+  Kokkos::parallel_for(fft.get_batch() * n, alg);
+  Kokkos::fence();
+
+  fft.inv_transform(phi2_local, phi2_local);
+  Kokkos::fence();
+}
+
+void
+Space_charge_2d_sliced::get_global_force2(Commxx const& comm)
+{
+  // the single rank already has all the slices
+  if (comm.size() == 1) return;
+
+  scoped_simple_timer timer("sc2d_sliced_global_f");
+
+  auto dg = doubled_domain.get_grid_shape();
+  const int n = dg[0] * dg[1] * 2;
+
+  std::vector<int> counts(comm.size());
+  std::vector<int> displs(comm.size());
+
+  for (int r = 0; r < comm.size(); ++r) {
+    auto slices = get_local_slices(dg[2], r, comm.size());
+    counts[r] = slices.second * n;
+    displs[r] = slices.first * n;
+  }
+
+  Kokkos::deep_copy(h_phi2_local, phi2_local);
+
+  int err = MPI_Allgatherv((void*)h_phi2_local.data(),
+                           counts[comm.rank()],
+                           MPI_DOUBLE,
+                           (void*)h_phi2.data(),
+                           counts.data(),
+                           displs.data(),
+                           MPI_DOUBLE,
+                           comm);
+
+  if (err != MPI_SUCCESS) {
+    throw std::runtime_error("MPI error in Space_charge_2d_sliced"
+                             "(MPI_Allgatherv in get_global_force2)");
+  }
+
+  Kokkos::deep_copy(phi2, h_phi2);
+}
+
+double
+Space_charge_2d_sliced::get_normalization_force(Bunch const& bunch)
+{
+  auto h = doubled_domain.get_cell_size();
+
+  // area element of the convolution, and the 2d green function of a
+  // line charge, E = lambda / (2 pi epsilon0 r)
+  double normalization = h[0] * h[1];
+  normalization *= 1.0 / (2.0 * pi * pconstants::epsilon0);
+
+  // charge of the kicked particle
+  normalization *= bunch.get_particle_charge() * pconstants::e;
+
+  // from fft
+  normalization *= 1.0 / (doubled_domain.get_grid_shape()[0] *
+                          doubled_domain.get_grid_shape()[1]);
+
+  return normalization;
+}
+
+void
+Space_charge_2d_sliced::apply_kick(Bunch& bunch,
+                                   double fn_norm,
+                                   double time_step)
+{
+  scoped_simple_timer timer("sc2d_sliced_kick");
+
+  // transverse kicks in the lab frame, with the same approximations as
+  // Space_charge_2d_open_hockney::apply_kick
+  auto const& ref = bunch.get_reference_particle();
+
+  double delta_t_beam = time_step / ref.get_gamma();
+
+  // unit_conversion: [N] = [kg m/s^2] to [Gev/c]
+  double unit_conversion = pconstants::c / (1.0e9 * pconstants::e);
+
+  double gamma = ref.get_gamma();
+  double beta = ref.get_beta();
+  double p_scale = 1.0 / ref.get_momentum();
+
+  // the slice line density is per unit of c*dt, beta converts it to
+  // the lab frame
+  double factor = options.kick_scale * unit_conversion * delta_t_beam *
+                  fn_norm * p_scale / (gamma * beta);
+
+  alg_slice_kicker kicker(bunch.get_local_particles(),
+                          bunch.get_local_particle_masks(),
+                          phi2,
+                          doubled_domain.get_grid_shape(),
+                          doubled_domain.get_left(),
+                          doubled_domain.get_cell_size(),
+                          factor);
+
+  Kokkos::parallel_for(bunch.size(), kicker);
+  Kokkos::fence();
+}
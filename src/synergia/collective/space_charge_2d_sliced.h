@@ -0,0 +1,85 @@
+#ifndef SPACE_CHARGE_2D_SLICED_H_
+#define SPACE_CHARGE_2D_SLICED_H_
+
+#include "synergia/simulation/collective_operator.h"
+#include "synergia/simulation/implemented_collective_options.h"
+
+#include "synergia/utils/distributed_fft2d.h"
+
+#include "synergia/collective/rectangular_grid.h"
+#include "synergia/collective/rectangular_grid_domain.h"
+
+/// 2.5d space charge. The bunch is deposited on shape[2] longitudinal
+/// slices, and every slice is kicked with the 2d open boundary field
+/// of its own transverse charge density. The slices are shared out in
+/// contiguous blocks among the ranks of the bunch, each rank solves
+/// its block with one batched 2d FFT, and the fields of all slices are
+/// gathered back for the kick.
+class Space_charge_2d_sliced : public Collective_operator {
+
+private:
+  const Space_charge_2d_sliced_options options;
+
+  // cached bunch simulator id
+  // if the id is changed, the workspace needs to be reconstructed
+  std::string bunch_sim_id;
+
+  Rectangular_grid_domain domain;
+  Rectangular_grid_domain doubled_domain;
+
+  // batched fft of the local slices, and the fft of the green function
+  std::array<std::vector<Distributed_fft2d>, 2> ffts;
+  std::array<std::vector<Distributed_fft2d>, 2> ffts_g;
+
+  // all slices, double[z][x][y][2]
+  karray1d_dev rho2;
+  karray1d_dev phi2;
+  karray1d_dev g2;
+
+  karray1d_hst h_rho2;
+  karray1d_hst h_phi2;
+
+  // slices of this rank
+  karray1d_dev rho2_local;
+  karray1d_dev phi2_local;
+
+  karray1d_hst h_rho2_local;
+  karray1d_hst h_phi2_local;
+
+private:
+  void apply_impl(Bunch_simulator& simulator,
+                  double time_step,
+                  Logger& logger) override;
+
+  void apply_bunch(Bunch& bunch,
+                   Distributed_fft2d& fft,
+                   Distributed_fft2d& fft_g,
+                   double time_step,
+                   Logger& logger);
+
+  void construct_workspaces(Bunch_simulator const& sim);
+
+  void update_domain(Bunch const& bunch);
+
+  void get_charge_density(Bunch const& bunch);
+
+  void get_green_fn2_pointlike(Distributed_fft2d& fft_g);
+
+  void get_local_force2(Distributed_fft2d& fft);
+
+  void get_global_force2(Commxx const& comm);
+
+  double get_normalization_force(Bunch const& bunch);
+
+  void apply_kick(Bunch& bunch, double fn_norm, double time_step);
+
+public:
+  Space_charge_2d_sliced(Space_charge_2d_sliced_options const& ops);
+
+  /// first slice and number of slices of the rank in a comm of the size
+  static std::pair<int, int> get_local_slices(int num_slices,
+                                              int rank,
+                                              int size);
+};
+
+#endif /* SPACE_CHARGE_2D_SLICED_H_ */
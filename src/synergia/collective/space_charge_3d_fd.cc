@@ -5,6 +5,7 @@
 
 #include "deposit.h"
 #include "space_charge_3d_kernels.h"
+#include "space_charge_3d_open_boundary.h"
 
 #include "synergia/bunch/core_diagnostics.h"
 #include "synergia/foundation/physical_constants.h"
@@ -41,6 +42,17 @@ Space_charge_3d_fd::Space_charge_3d_fd(Space_charge_3d_fd_options const& ops)
     scale_y_threshold = ops.scale_thresholds[1];
     scale_z_threshold = ops.scale_thresholds[2];
 
+    if (ops.solver != fd_solver_t::petsc) {
+        throw std::runtime_error(
+            "Space_charge_3d_fd: solver must be petsc, the multigrid "
+            "solver is Space_charge_3d_mg");
+    }
+
+    if (ops.open_boundary && ops.open_boundary_coarsening < 1) {
+        throw std::runtime_error(
+            "Space_charge_3d_fd: open_boundary_coarsening must be at least 1");
+    }
+
     if (ops.domain_fixed) {
         set_fixed_domain(ops.offset, ops.size);
         use_fixed_domain = true;
@@ -80,6 +92,17 @@ Space_charge_3d_fd::get_local_charge_density(Bunch const& bunch)
         lctx.seqrho_view, domain, domain.get_grid_shape(), bunch);
 }
 
+void
+Space_charge_3d_fd::set_open_boundary()
+{
+    set_open_boundary_3d(lctx.seqrho_view,
+                         domain,
+                         options.open_boundary_coarsening,
+                         gctx.bunch_comm,
+                         coarse_charge,
+                         h_coarse_charge);
+}
+
 void
 Space_charge_3d_fd::apply_impl(Bunch_simulator& sim,
                                double time_step,
@@ -115,6 +138,11 @@ Space_charge_3d_fd::apply_impl(Bunch_simulator& sim,
         // number of MPI ranks, we require number of bunches to be divisible by
         // number of  MPI ranks and each bunch has a MPI communicator of size 1.
         // Update this bit when enabling bunch sim with two bunch trains!
+        if (allocated) {
+            destroy_sc3d_fd();
+            allocated = false;
+        }
+
         allocate_sc3d_fd(sim[0][0]);
         allocated = true;
 
@@ -163,6 +191,8 @@ Space_charge_3d_fd::apply_bunch(Bunch& bunch, double time_step, Logger& logger)
     // charge density
     get_local_charge_density(bunch); // [C/m^3]
 
+    if (options.open_boundary) set_open_boundary();
+
     // Debugging
     if (gctx.dumps) {
         PetscViewer hdf5_viewer;
@@ -183,6 +213,9 @@ Space_charge_3d_fd::apply_bunch(Bunch& bunch, double time_step, Logger& logger)
     {
         scoped_simple_timer timer("sc3d_fd_rho_local_to_subcomms");
 
+        /* the scatters add to the subcomm vector */
+        PetscCall(VecZeroEntries(sctx.rho_subcomm));
+
         /* Begin global (alias of local) to subcomm scatters! */
         for (PetscInt i = 0; i < gctx.nsubcomms; i++) {
             PetscCall(VecScatterBegin(gctx.scat_glocal_to_subcomms[i],
@@ -235,10 +268,10 @@ Space_charge_3d_fd::apply_bunch(Bunch& bunch, double time_step, Logger& logger)
         std::string filename = "mat_on_subcomm";
         filename.append(std::to_string(sctx.solversubcommid));
         filename.append(".ascii");
-        PetscCall(PetscObjectSetName((PetscObject)(sctx.A), "A_on_sctx"));
+        PetscCall(PetscObjectSetName((PetscObject)(sctx.P), "P_on_sctx"));
         PetscCall(PetscViewerASCIIOpen(
             sctx.solversubcomm, filename.c_str(), &ascii_viewer));
-        PetscCall(MatView(sctx.A, ascii_viewer));
+        PetscCall(MatView(sctx.P, ascii_viewer));
         PetscCall(PetscViewerDestroy(&ascii_viewer));
     }
 
@@ -491,7 +524,10 @@ Space_charge_3d_fd::allocate_sc3d_fd(const Bunch& bunch)
     /* Local rho and phi vectors on each MPI rank */
     PetscCall(init_local_vecs(lctx, gctx));
 
-    /* rho and phi vectors on each subcomm */
+    /* create DM and Matrix on subcomms */
+    PetscCall(init_subcomm_mat(lctx, sctx, gctx));
+
+    /* rho and phi vectors on each subcomm, with the layout of the DM */
     PetscCall(init_subcomm_vecs(sctx, gctx));
 
     /* create global aliases of local vectors */
@@ -503,9 +539,6 @@ Space_charge_3d_fd::allocate_sc3d_fd(const Bunch& bunch)
     /* create subcomm aliases of local vectors */
     PetscCall(init_subcomm_local_aliases(lctx, sctx, gctx));
 
-    /* create DM and Matrix on subcomms */
-    PetscCall(init_subcomm_mat(lctx, sctx, gctx));
-
     /* Initialize global (alias of local) to subcomm scatters */
     PetscCall(init_global_subcomm_scatters(sctx, gctx));
 
@@ -522,5 +555,8 @@ Space_charge_3d_fd::destroy_sc3d_fd()
 
     PetscCall(finalize(lctx, sctx, gctx));
 
+    /* duplicated in allocate_sc3d_fd */
+    PetscCall(PetscCommDestroy(&gctx.bunch_comm));
+
     PetscFunctionReturn(0);
 }
@@ -34,6 +34,10 @@ class Space_charge_3d_fd : public Collective_operator {
     SubcommCtx sctx;
     LocalCtx lctx;
 
+    /* coarse charges for the open boundary potential */
+    karray1d_dev coarse_charge;
+    karray1d_hst h_coarse_charge;
+
   private:
     void set_fixed_domain(std::array<double, 3> offset,
                           std::array<double, 3> size);
@@ -44,6 +48,8 @@ class Space_charge_3d_fd : public Collective_operator {
 
     void get_local_charge_density(const Bunch& bunch);
 
+    void set_open_boundary();
+
     PetscErrorCode apply_bunch(Bunch& bunch, double time_step, Logger& logger);
 
     void get_force();
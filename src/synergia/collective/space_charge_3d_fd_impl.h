@@ -2,6 +2,7 @@
 #define SPACE_CHARGE_3D_FD_IMPL_H_
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -29,6 +30,16 @@ struct LocalCtx {
     karray1d_dev coo_v; /*! kokkos view for matrix entries in coo format */
 };
 
+/*! Context of the matrix-free operator. It lives on the heap, so the
+    shell matrix keeps a valid pointer when the SubcommCtx is moved */
+struct StencilCtx {
+
+    DM da;                   /* DMDA of the subcomm, not owned */
+    PetscScalar hxhydhz = 0; /* stencil coefficients, along z */
+    PetscScalar hxdhyhz = 0; /* stencil coefficients, along y */
+    PetscScalar dhxhyhz = 0; /* stencil coefficients, along x */
+};
+
 /*! Subcomm context */
 struct SubcommCtx {
 
@@ -40,11 +51,14 @@ struct SubcommCtx {
     Vec rho_subcomm;       /*! vector on the subcomm */
 
     DM da;                         /* DMDA to manage grid and vecs */
-    Mat A;                         /* discretization matrix */
+    Mat A;                         /* discretization operator, matrix-free */
+    Mat P;                         /* assembled matrix, preconditioner */
     KSP ksp;                       /* krylov solver */
     PC pc;                         /* preconditioner */
     PetscBool reuse = PETSC_FALSE; /* state of ksp/pc re-use */
 
+    std::shared_ptr<StencilCtx> stencil; /* context of A */
+
     VecScatter scat_subcomm_to_local; /*! VecScatter from subcomm vector to
                                         constituent local vectors */
     IS ix_scat_subcomms_to_local; /*! IndexSet for scatter from subcomm vector
@@ -109,8 +123,6 @@ struct GlobalCtx {
                                    local vectors to all subcomm vectors */
     IS ix_scat_glocal_to_subcomms; /*! IndexSet for scatters from global alias
                                      of local vectors to all subcomm vectors */
-    IS iy_scat_glocal_to_subcomms; /*! IndexSet for scatters from global alias
-                                     of local vectors to all subcomm vectors */
     std::vector<PetscMPIInt>
         sids; /*! holds the solversubcommmid's from each solver */
 
@@ -1,6 +1,8 @@
 #include "space_charge_3d_fd_utils.h"
 #include "Kokkos_Core.hpp"
 
+#include <numeric>
+
 /* --------------------------------------------------------------------- */
 /*!
   Initialize sequential vectors on each MPI rank
@@ -101,7 +103,9 @@ init_solver_subcomms(SubcommCtx& sctx, GlobalCtx& gctx)
 
 /* --------------------------------------------------------------------- */
 /*!
-  Initialize vectors on each solver-subcommunicator
+  Initialize vectors on each solver-subcommunicator. The vectors are
+  global vectors of the DMDA, so that they have the same layout as the
+  rows of the matrices. Must be called after init_subcomm_mat
   \param   sctx - subcomm context
   \param   gctx - global context
   \return  ierr - PetscErrorCode
@@ -112,17 +116,11 @@ init_subcomm_vecs(SubcommCtx& sctx, GlobalCtx& gctx)
     PetscInt size;
 
     PetscFunctionBeginUser;
-    PetscCall(VecCreate(sctx.solversubcomm, &sctx.phi_subcomm));
-    PetscCall(VecSetType(sctx.phi_subcomm, gctx.vectype));
-    PetscCall(VecSetSizes(sctx.phi_subcomm, PETSC_DECIDE, gctx.nsize));
-    PetscCall(VecSetFromOptions(sctx.phi_subcomm));
+    PetscCall(DMCreateGlobalVector(sctx.da, &sctx.phi_subcomm));
     PetscCall(PetscObjectSetName((PetscObject)(sctx.phi_subcomm),
                                  "phi_subcomm_on_sctx"));
 
-    PetscCall(VecCreate(sctx.solversubcomm, &sctx.rho_subcomm));
-    PetscCall(VecSetType(sctx.rho_subcomm, gctx.vectype));
-    PetscCall(VecSetSizes(sctx.rho_subcomm, PETSC_DECIDE, gctx.nsize));
-    PetscCall(VecSetFromOptions(sctx.rho_subcomm));
+    PetscCall(DMCreateGlobalVector(sctx.da, &sctx.rho_subcomm));
     PetscCall(PetscObjectSetName((PetscObject)(sctx.rho_subcomm),
                                  "rho_subcomm_on_sctx"));
 
@@ -140,6 +138,33 @@ init_subcomm_vecs(SubcommCtx& sctx, GlobalCtx& gctx)
     PetscFunctionReturn(0);
 }
 
+/* --------------------------------------------------------------------- */
+/*!
+  Indices in the subcomm vectors (DMDA ordering) of the grid points in the
+  natural ordering of the local vectors
+  \param   sctx - subcomm context
+  \param   gctx - global context
+  \param   idx - output, idx[n] is the DMDA index of the natural index n
+  \return  ierr - PetscErrorCode
+  */
+PetscErrorCode
+subcomm_petsc_indices(SubcommCtx& sctx,
+                      GlobalCtx& gctx,
+                      std::vector<PetscInt>& idx)
+{
+    AO ao;
+
+    PetscFunctionBeginUser;
+
+    idx.resize(gctx.nsize);
+    std::iota(idx.begin(), idx.end(), 0);
+
+    PetscCall(DMDAGetAO(sctx.da, &ao));
+    PetscCall(AOApplicationToPetsc(ao, gctx.nsize, idx.data()));
+
+    PetscFunctionReturn(0);
+}
+
 /* --------------------------------------------------------------------- */
 /*!
   Initialize DMDA and Matrix to solve Poisson Eq on each solver-subcommunicator
@@ -177,16 +202,35 @@ init_subcomm_mat(LocalCtx& lctx, SubcommCtx& sctx, GlobalCtx& gctx)
     PetscCall(DMSetFromOptions(sctx.da));
     PetscCall(DMSetUp(sctx.da));
 
-    /* create discretization matrix */
-    PetscCall(MatCreate(PetscObjectComm((PetscObject)sctx.da), &(sctx.A)));
-    PetscCall(MatSetSizes(
-        sctx.A, PETSC_DECIDE, PETSC_DECIDE, gctx.nsize, gctx.nsize));
-    PetscCall(MatSetType(sctx.A, gctx.mattype));
-    PetscCall(MatSetFromOptions(sctx.A));
-
     /* Gather DMDA local info for preallocation of matrix */
     PetscCall(DMDAGetLocalInfo(sctx.da, &info));
 
+    /* both matrices have the row layout of the DMDA vectors */
+    PetscInt nlocal = info.xm * info.ym * info.zm;
+
+    /* create discretization matrix */
+    PetscCall(MatCreate(PetscObjectComm((PetscObject)sctx.da), &(sctx.P)));
+    PetscCall(MatSetSizes(sctx.P, nlocal, nlocal, gctx.nsize, gctx.nsize));
+    PetscCall(MatSetType(sctx.P, gctx.mattype));
+    PetscCall(MatSetFromOptions(sctx.P));
+
+    /* The operator is applied matrix-free, so that a change of the cell
+       sizes only updates three scalars. The assembled matrix is only
+       needed to build the preconditioner */
+    sctx.stencil = std::make_shared<StencilCtx>();
+    sctx.stencil->da = sctx.da;
+
+    PetscCall(MatCreateShell(PetscObjectComm((PetscObject)sctx.da),
+                             nlocal,
+                             nlocal,
+                             gctx.nsize,
+                             gctx.nsize,
+                             sctx.stencil.get(),
+                             &(sctx.A)));
+    PetscCall(MatShellSetOperation(
+        sctx.A, MATOP_MULT, (void (*)(void))(stencil_mult)));
+    PetscCall(MatShellSetVecType(sctx.A, gctx.vectype));
+
     PetscInt i, j, k;
     PetscCount ncoo = ((PetscCount)info.xm) * ((PetscCount)info.ym) *
                       ((PetscCount)info.zm) * 7;
@@ -262,7 +306,7 @@ init_subcomm_mat(LocalCtx& lctx, SubcommCtx& sctx, GlobalCtx& gctx)
 
     /* Preallocate matrix, this is symbolic and sets the locations
        where we will add numeric values later, repeatedly */
-    PetscCall(MatSetPreallocationCOO(sctx.A, ncoo, coo_i, coo_j));
+    PetscCall(MatSetPreallocationCOO(sctx.P, ncoo, coo_i, coo_j));
 
     /* Free memory, perhaps this should use C++ arrays instead */
     PetscCall(PetscFree2(coo_i, coo_j));
@@ -276,7 +320,7 @@ init_subcomm_mat(LocalCtx& lctx, SubcommCtx& sctx, GlobalCtx& gctx)
     PetscCall(
         KSPGMRESSetCGSRefinementType(sctx.ksp, KSP_GMRES_CGS_REFINE_IFNEEDED));
 
-    PetscCall(KSPSetOperators(sctx.ksp, sctx.A, sctx.A));
+    PetscCall(KSPSetOperators(sctx.ksp, sctx.A, sctx.P));
     PetscCall(KSPSetFromOptions(sctx.ksp));
 
     /* set preconditioner */
@@ -312,8 +356,11 @@ init_subcomm_mat(LocalCtx& lctx, SubcommCtx& sctx, GlobalCtx& gctx)
 
 /* --------------------------------------------------------------------- */
 /*!
-  Compute the RHS matrix to solve the (scaled) Poisson's Eq, setup the
-  krylov solver associated with the RHS matrix
+  Update the stencil coefficients of the (scaled) Poisson's Eq operator for
+  the current cell sizes. The matrix for the preconditioner is only
+  assembled, and the preconditioner rebuilt, when sctx.reuse has been
+  reset, i.e., on the first call and when the domain has changed by more
+  than the scale thresholds
   \param   lctx - local context
   \param   sctx - subcomm context
   \param   gctx - global context
@@ -324,67 +371,168 @@ compute_mat(LocalCtx& lctx, SubcommCtx& sctx, GlobalCtx& gctx)
 {
 
     PetscFunctionBeginUser;
-    scoped_simple_timer("sc3d_fd_compute_mat");
+    scoped_simple_timer timer("sc3d_fd_compute_mat");
 
     DMDALocalInfo info; /* For storing DMDA info */
     PetscScalar hx, hy, hz;
-    PetscScalar hxhydhz, hxdhyhz, dhxhyhz;
 
-    PetscFunctionBeginUser;
     PetscCall(DMDAGetLocalInfo(sctx.da, &info));
 
     hx = (gctx.Lx) / (PetscReal)(info.mx);
     hy = (gctx.Ly) / (PetscReal)(info.my);
     hz = (gctx.Lz) / (PetscReal)(info.mz);
 
-    hxhydhz = (hx * hy) / hz;
-    hxdhyhz = (hx * hz) / hy;
-    dhxhyhz = (hy * hz) / hx;
+    /* the matrix-free operator always has the current cell sizes */
+    sctx.stencil->hxhydhz = (hx * hy) / hz;
+    sctx.stencil->hxdhyhz = (hx * hz) / hy;
+    sctx.stencil->dhxhyhz = (hy * hz) / hx;
+
+    /* the shell has no values to change, bump its state so the KSP
+       knows the operator is not the one of the last solve */
+    PetscCall(PetscObjectStateIncrease((PetscObject)sctx.A));
+
+    if (sctx.reuse == PETSC_TRUE) {
+        PetscCall(KSPSetReusePreconditioner(sctx.ksp, PETSC_TRUE));
+        PetscCall(PCSetReusePreconditioner(sctx.pc, PETSC_TRUE));
+        PetscCall(KSPSetInitialGuessNonzero(sctx.ksp, PETSC_TRUE));
+        PetscCall(PCGAMGSetReuseInterpolation(sctx.pc, PETSC_TRUE));
+
+        PetscFunctionReturn(0);
+    }
+
+    {
+        scoped_simple_timer timer("sc3d_fd_assemble_mat");
+
+        const PetscScalar hxhydhz = sctx.stencil->hxhydhz;
+        const PetscScalar hxdhyhz = sctx.stencil->hxdhyhz;
+        const PetscScalar dhxhyhz = sctx.stencil->dhxhyhz;
+
+        PetscCallCXX(Kokkos::parallel_for(
+            "ComputeMat",
+            Kokkos::MDRangePolicy<Kokkos::Rank<3,
+                                               Kokkos::Iterate::Right,
+                                               Kokkos::Iterate::Right>>(
+                {info.zs, info.ys, info.xs},
+                {info.zs + info.zm, info.ys + info.ym, info.xs + info.xm}),
+            KOKKOS_LAMBDA(PetscCount k, PetscCount j, PetscCount i) {
+                PetscInt p = ((k - info.zs) * info.ym * info.xm +
+                              (j - info.ys) * info.xm + (i - info.xs)) *
+                             7;
+                if (i == 0 || j == 0 || k == 0 || i == info.mx - 1 ||
+                    j == info.my - 1 || k == info.mz - 1) {
+                    lctx.coo_v(p + 3) = 1.0; // on boundary: trivial equation
+                } else {
+                    lctx.coo_v(p + 0) = -hxhydhz;
+                    lctx.coo_v(p + 1) = -hxdhyhz;
+                    lctx.coo_v(p + 2) = -dhxhyhz;
+                    lctx.coo_v(p + 3) = 2 * (hxhydhz + hxdhyhz + dhxhyhz);
+                    lctx.coo_v(p + 4) = -dhxhyhz;
+                    lctx.coo_v(p + 5) = -hxdhyhz;
+                    lctx.coo_v(p + 6) = -hxhydhz;
+                }
+            }));
+        Kokkos::fence();
+        PetscCall(MatSetValuesCOO(sctx.P, lctx.coo_v.data(), INSERT_VALUES));
+    }
+
+    PetscCall(KSPSetReusePreconditioner(sctx.ksp, PETSC_FALSE));
+    PetscCall(PCSetReusePreconditioner(sctx.pc, PETSC_FALSE));
+    PetscCall(KSPSetInitialGuessNonzero(sctx.ksp, PETSC_FALSE));
+    PetscCall(PCGAMGSetReuseInterpolation(sctx.pc, PETSC_FALSE));
+    sctx.reuse = PETSC_TRUE; /* will reset reuse at next solve  */
+
+    PetscCall(KSPSetUp(sctx.ksp));
+    PetscCall(PCSetUp(sctx.pc));
+
+    PetscFunctionReturn(0);
+}
+
+/* --------------------------------------------------------------------- */
+/*!
+  Matrix-free product with the 7-point stencil of the (scaled) Poisson's
+  Eq, with the coefficients of the current cell sizes. Boundary rows are
+  the identity, as in the assembled matrix
+  \param   A - shell matrix, the context is a StencilCtx
+  \param   x - input vector
+  \param   y - output vector, y = A x
+  \return  ierr - PetscErrorCode
+  */
+PetscErrorCode
+stencil_mult(Mat A, Vec x, Vec y)
+{
+    StencilCtx* st;
+    DMDALocalInfo info;
+    Vec xlocal;
+
+    const PetscScalar* xa;
+    PetscScalar* ya;
+    PetscMemType xmtype, ymtype;
+
+    PetscFunctionBeginUser;
+    PetscCall(MatShellGetContext(A, &st));
+    PetscCall(DMDAGetLocalInfo(st->da, &info));
+
+    /* ghost values from the neighbouring ranks of the subcomm */
+    PetscCall(DMGetLocalVector(st->da, &xlocal));
+    PetscCall(DMGlobalToLocalBegin(st->da, x, INSERT_VALUES, xlocal));
+    PetscCall(DMGlobalToLocalEnd(st->da, x, INSERT_VALUES, xlocal));
+
+    /* arrays are in the memory space of the vector type, which is the
+       one of the default execution space */
+    PetscCall(VecGetArrayReadAndMemType(xlocal, &xa, &xmtype));
+    PetscCall(VecGetArrayWriteAndMemType(y, &ya, &ymtype));
+
+    using unmanaged_view =
+        Kokkos::View<PetscScalar*,
+                     Kokkos::DefaultExecutionSpace::memory_space,
+                     Kokkos::MemoryTraits<Kokkos::Unmanaged>>;
+    using const_unmanaged_view =
+        Kokkos::View<const PetscScalar*,
+                     Kokkos::DefaultExecutionSpace::memory_space,
+                     Kokkos::MemoryTraits<Kokkos::Unmanaged>>;
+
+    const_unmanaged_view xv(xa, info.gxm * info.gym * info.gzm);
+    unmanaged_view yv(ya, info.xm * info.ym * info.zm);
+
+    const PetscScalar hxhydhz = st->hxhydhz;
+    const PetscScalar hxdhyhz = st->hxdhyhz;
+    const PetscScalar dhxhyhz = st->dhxhyhz;
+    const PetscScalar diag = 2 * (hxhydhz + hxdhyhz + dhxhyhz);
 
     PetscCallCXX(Kokkos::parallel_for(
-        "ComputeMat",
+        "StencilMult",
         Kokkos::MDRangePolicy<
             Kokkos::Rank<3, Kokkos::Iterate::Right, Kokkos::Iterate::Right>>(
             {info.zs, info.ys, info.xs},
             {info.zs + info.zm, info.ys + info.ym, info.xs + info.xm}),
         KOKKOS_LAMBDA(PetscCount k, PetscCount j, PetscCount i) {
-            PetscInt p = ((k - info.zs) * info.ym * info.xm +
-                          (j - info.ys) * info.xm + (i - info.xs)) *
-                         7;
+            PetscInt p = (k - info.zs) * info.ym * info.xm +
+                         (j - info.ys) * info.xm + (i - info.xs);
+            PetscInt g = ((k - info.gzs) * info.gym + (j - info.gys)) *
+                             info.gxm +
+                         (i - info.gxs);
+
             if (i == 0 || j == 0 || k == 0 || i == info.mx - 1 ||
                 j == info.my - 1 || k == info.mz - 1) {
-                lctx.coo_v(p + 3) = 1.0; // on boundary: trivial equation
+                yv(p) = xv(g); // on boundary: trivial equation
             } else {
-                lctx.coo_v(p + 0) = -hxhydhz;
-                lctx.coo_v(p + 1) = -hxdhyhz;
-                lctx.coo_v(p + 2) = -dhxhyhz;
-                lctx.coo_v(p + 3) = 2 * (hxhydhz + hxdhyhz + dhxhyhz);
-                lctx.coo_v(p + 4) = -dhxhyhz;
-                lctx.coo_v(p + 5) = -hxdhyhz;
-                lctx.coo_v(p + 6) = -hxhydhz;
+                const PetscInt sy = info.gxm;
+                const PetscInt sz = info.gxm * info.gym;
+
+                yv(p) = diag * xv(g) - hxhydhz * (xv(g - sz) + xv(g + sz)) -
+                        hxdhyhz * (xv(g - sy) + xv(g + sy)) -
+                        dhxhyhz * (xv(g - 1) + xv(g + 1));
             }
         }));
     Kokkos::fence();
-    PetscCall(MatSetValuesCOO(sctx.A, lctx.coo_v.data(), INSERT_VALUES));
-
-    if (sctx.reuse == PETSC_FALSE) {
-        PetscCall(KSPSetReusePreconditioner(sctx.ksp, PETSC_FALSE));
-        PetscCall(PCSetReusePreconditioner(sctx.pc, PETSC_FALSE));
-        PetscCall(KSPSetInitialGuessNonzero(sctx.ksp, PETSC_FALSE));
-        PetscCall(PCGAMGSetReuseInterpolation(sctx.pc, PETSC_FALSE));
-        sctx.reuse = PETSC_TRUE; /* will reset reuse at next solve  */
-    } else {
-        PetscCall(KSPSetReusePreconditioner(sctx.ksp, PETSC_TRUE));
-        PetscCall(PCSetReusePreconditioner(sctx.pc, PETSC_TRUE));
-        PetscCall(KSPSetInitialGuessNonzero(sctx.ksp, PETSC_TRUE));
-        PetscCall(PCGAMGSetReuseInterpolation(sctx.pc, PETSC_TRUE));
-    }
 
-    PetscCall(KSPSetUp(sctx.ksp));
-    PetscCall(PCSetUp(sctx.pc));
+    PetscCall(VecRestoreArrayWriteAndMemType(y, &ya));
+    PetscCall(VecRestoreArrayReadAndMemType(xlocal, &xa));
+    PetscCall(DMRestoreLocalVector(st->da, &xlocal));
 
     PetscFunctionReturn(0);
 }
+
 /* --------------------------------------------------------------------- */
 /*!
   Solve the scaled Poisson Eq!
@@ -440,24 +588,40 @@ init_global_subcomm_scatters(SubcommCtx& sctx, GlobalCtx& gctx)
                              start,
                              1,
                              &gctx.ix_scat_glocal_to_subcomms));
-    PetscCall(ISCreateStride(
-        PETSC_COMM_SELF, localsize, 0, 1, &gctx.iy_scat_glocal_to_subcomms));
 
     PetscCall(PetscObjectSetName((PetscObject)(gctx.ix_scat_glocal_to_subcomms),
                                  "ix_scat_glocal_to_subcomms"));
-    PetscCall(PetscObjectSetName((PetscObject)(gctx.iy_scat_glocal_to_subcomms),
-                                 "iy_scat_glocal_to_subcomms"));
+
+    /* The subcomm vectors are in DMDA ordering, which depends on the
+       decomposition of the grid over the ranks of each subcomm. Subcomms
+       may differ in size, so the ordering of each one is broadcast from
+       its rank sids[i] */
+    std::vector<PetscInt> own, idx;
+    PetscCall(subcomm_petsc_indices(sctx, gctx, own));
 
     /* resize to ensure we only create as many scatters
        as the number of subcomms ! */
     gctx.scat_glocal_to_subcomms.resize(gctx.nsubcomms);
 
     for (PetscInt i = 0; i < gctx.nsubcomms; i++) {
+        IS iy;
+
+        idx = own;
+        PetscCallMPI(MPI_Bcast(idx.data(),
+                               gctx.nsize,
+                               MPIU_INT,
+                               gctx.sids[i],
+                               gctx.bunch_comm));
+
+        PetscCall(ISCreateGeneral(
+            PETSC_COMM_SELF, localsize, idx.data(), PETSC_COPY_VALUES, &iy));
+
         PetscCall(VecScatterCreate(gctx.rho_global_local,
                                    gctx.ix_scat_glocal_to_subcomms,
                                    gctx.rho_global_subcomm[i],
-                                   gctx.iy_scat_glocal_to_subcomms,
+                                   iy,
                                    &(gctx.scat_glocal_to_subcomms[i])));
+        PetscCall(ISDestroy(&iy));
     }
 
     if (gctx.debug) {
@@ -494,10 +658,18 @@ init_subcomm_local_scatters(LocalCtx& lctx, SubcommCtx& sctx, GlobalCtx& gctx)
     PetscCall(VecGetLocalSize(sctx.phi_subcomm_local, &localsize));
     PetscCall(VecGetOwnershipRange(sctx.phi_subcomm_local, &start, NULL));
 
+    /* the local vectors are in natural ordering, the subcomm vector
+       in DMDA ordering */
+    std::vector<PetscInt> idx;
+    PetscCall(subcomm_petsc_indices(sctx, gctx, idx));
+
     PetscCall(ISCreateStride(
         PETSC_COMM_SELF, localsize, start, 1, &sctx.ix_scat_subcomms_to_local));
-    PetscCall(ISCreateStride(
-        PETSC_COMM_SELF, localsize, 0, 1, &sctx.iy_scat_subcomms_to_local));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,
+                              localsize,
+                              idx.data(),
+                              PETSC_COPY_VALUES,
+                              &sctx.iy_scat_subcomms_to_local));
 
     /* This scatter will always be run as a SCATTER_REVERSE,
        perhaps the naming terminilogy may be updated to prevent
@@ -553,7 +725,6 @@ finalize(LocalCtx& lctx, SubcommCtx& sctx, GlobalCtx& gctx)
         PetscCall(VecScatterDestroy(&(gctx.scat_glocal_to_subcomms[i])));
     }
     PetscCall(ISDestroy(&gctx.ix_scat_glocal_to_subcomms));
-    PetscCall(ISDestroy(&gctx.iy_scat_glocal_to_subcomms));
 
     /* Destroy subcomm aliases of local vectors */
     PetscCall(VecDestroy(&sctx.phi_subcomm_local));
@@ -561,6 +732,8 @@ finalize(LocalCtx& lctx, SubcommCtx& sctx, GlobalCtx& gctx)
 
     /* Destroy DMDA and matrix on subcomm */
     PetscCall(MatDestroy(&sctx.A));
+    PetscCall(MatDestroy(&sctx.P));
+    sctx.stencil.reset();
     PetscCall(DMDestroy(&sctx.da));
     PetscCall(KSPDestroy(&sctx.ksp));
 
@@ -15,8 +15,14 @@ PetscErrorCode init_subcomm_mat(LocalCtx& lctx,
 
 PetscErrorCode compute_mat(LocalCtx& lctx, SubcommCtx& sctx, GlobalCtx& gctx);
 
+PetscErrorCode stencil_mult(Mat A, Vec x, Vec y);
+
 PetscErrorCode solve(SubcommCtx& sctx, GlobalCtx& gctx);
 
+PetscErrorCode subcomm_petsc_indices(SubcommCtx& sctx,
+                                     GlobalCtx& gctx,
+                                     std::vector<PetscInt>& idx);
+
 PetscErrorCode init_global_subcomm_scatters(SubcommCtx& sctx, GlobalCtx& gctx);
 PetscErrorCode init_subcomm_local_scatters(LocalCtx& lctx,
                                            SubcommCtx& sctx,
@@ -88,13 +88,15 @@ namespace sc3d_kernels {
             }
         };
 
+        // FV is the view type of the fields, karray1d_dev or karray1f_dev
+        template <class FV>
         struct alg_kicker {
             Particles parts;
             ConstParticleMasks masks;
 
-            karray1d_dev enx;
-            karray1d_dev eny;
-            karray1d_dev enz;
+            FV enx;
+            FV eny;
+            FV enz;
 
             int gx, gy, gz;
             double ihx, ihy, ihz;
@@ -103,9 +105,9 @@ namespace sc3d_kernels {
 
             alg_kicker(Particles parts,
                        ConstParticleMasks masks,
-                       karray1d_dev const& enx,
-                       karray1d_dev const& eny,
-                       karray1d_dev const& enz,
+                       FV const& enx,
+                       FV const& eny,
+                       FV const& enz,
                        std::array<int, 3> const& g,
                        std::array<double, 3> const& h,
                        std::array<double, 3> const& l,
@@ -214,11 +216,13 @@ namespace sc3d_kernels {
             }
         };
 
+        // FV is the view type of the fields, karray1d_dev or karray1f_dev
+        template <class FV>
         struct alg_force_extractor_doubled_domain {
             karray1d_dev phi2;
-            karray1d_dev enx;
-            karray1d_dev eny;
-            karray1d_dev enz;
+            FV enx;
+            FV eny;
+            FV enz;
 
             int gx, gy, gz;
             int dgx, dgy;
@@ -227,9 +231,9 @@ namespace sc3d_kernels {
             double igx;
 
             alg_force_extractor_doubled_domain(karray1d_dev const& phi2,
-                                               karray1d_dev const& enx,
-                                               karray1d_dev const& eny,
-                                               karray1d_dev const& enz,
+                                               FV const& enx,
+                                               FV const& eny,
+                                               FV const& enz,
                                                std::array<int, 3> const& g,
                                                std::array<int, 3> const& dg,
                                                std::array<double, 3> const& h)
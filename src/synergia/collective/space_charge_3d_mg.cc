@@ -0,0 +1,250 @@
+#include "space_charge_3d_mg.h"
+
+#include "deposit.h"
+#include "space_charge_3d_kernels.h"
+#include "space_charge_3d_open_boundary.h"
+
+#include "synergia/bunch/core_diagnostics.h"
+#include "synergia/foundation/physical_constants.h"
+#include "synergia/utils/simple_timer.h"
+
+namespace {
+    double
+    get_smallest_non_tiny(double val, double other1, double other2, double tiny)
+    {
+        double retval;
+        if (val > tiny) {
+            retval = val;
+        } else {
+            if ((other1 > tiny) && (other2 > tiny)) {
+                retval = std::min(other1, other2);
+            } else {
+                retval = std::max(other1, other2);
+            }
+        }
+        return retval;
+    }
+} // namespace
+
+Space_charge_3d_mg::Space_charge_3d_mg(Space_charge_3d_fd_options const& ops)
+    : Collective_operator("sc_3d_mg", 1.0)
+    , options(ops)
+    , domain(ops.shape, {1.0, 1.0, 1.0})
+    , use_fixed_domain(false)
+    , allocated(false)
+{
+    if (ops.solver != fd_solver_t::multigrid) {
+        throw std::runtime_error(
+            "Space_charge_3d_mg: solver must be multigrid");
+    }
+
+    if (ops.open_boundary && ops.open_boundary_coarsening < 1) {
+        throw std::runtime_error(
+            "Space_charge_3d_mg: open_boundary_coarsening must be at least 1");
+    }
+
+    if (ops.domain_fixed) {
+        domain =
+            Rectangular_grid_domain(ops.shape, ops.size, ops.offset, false);
+        use_fixed_domain = true;
+    }
+}
+
+void
+Space_charge_3d_mg::apply_impl(Bunch_simulator& sim,
+                               double time_step,
+                               Logger& logger)
+{
+    logger << "    Space charge 3d finite difference, multigrid\n";
+    scoped_simple_timer timer("sc3d_mg_total");
+
+    // the workspace only depends on the grid shape, so it is shared by
+    // all the bunches and simulators
+    if (!allocated) {
+        allocate();
+        allocated = true;
+    }
+
+    // apply to bunches
+    for (size_t t = 0; t < 2; ++t) {
+        for (size_t b = 0; b < sim[t].get_bunch_array_size(); ++b) {
+            apply_bunch(sim[t][b], time_step, logger);
+        }
+    }
+}
+
+void
+Space_charge_3d_mg::apply_bunch(Bunch& bunch, double time_step, Logger& logger)
+{
+    // update domain only when not using fixed
+    if (!use_fixed_domain) update_domain(bunch);
+
+    // charge density
+    get_local_charge_density(bunch); // [C/m^3]
+
+    if (options.open_boundary) {
+        set_open_boundary_3d(rho,
+                             domain,
+                             options.open_boundary_coarsening,
+                             bunch.get_comm(),
+                             coarse_charge,
+                             h_coarse_charge);
+    }
+
+    get_global_charge_density(bunch);
+
+    {
+        scoped_simple_timer timer("sc3d_mg_solver");
+
+        // phi holds the potential of the last kick, and is the
+        // initial guess of this one
+        int cycles = mg.solve(rho, phi, domain.get_cell_size());
+
+        logger(LoggerV::DEBUG) << "      multigrid cycles = " << cycles
+                               << ", residual = " << mg.get_residual() << "\n";
+    }
+
+    get_force();
+    apply_kick(bunch, time_step);
+}
+
+void
+Space_charge_3d_mg::allocate()
+{
+    scoped_simple_timer timer("sc3d_mg_allocations");
+
+    const int nsize = options.shape[0] * options.shape[1] * options.shape[2];
+
+    rho = karray1d_dev("rho", nsize);
+    phi = karray1d_dev("phi", nsize);
+    h_rho = Kokkos::create_mirror_view(rho);
+
+    enx = karray1d_dev("enx", nsize);
+    eny = karray1d_dev("eny", nsize);
+    enz = karray1d_dev("enz", nsize);
+
+    mg.construct(options.shape,
+                 options.mg_cycle,
+                 options.mg_smooth,
+                 options.mg_rtol,
+                 options.mg_max_cycles);
+}
+
+void
+Space_charge_3d_mg::update_domain(Bunch const& bunch)
+{
+    scoped_simple_timer timer("sc3d_mg_domain");
+
+    auto spatial_mean_stddev =
+        Core_diagnostics::calculate_spatial_mean_stddev(bunch);
+
+    auto mean_x = spatial_mean_stddev(0);
+    auto mean_y = spatial_mean_stddev(1);
+    auto mean_z = spatial_mean_stddev(2);
+    auto stddev_x = spatial_mean_stddev(3);
+    auto stddev_y = spatial_mean_stddev(4);
+    auto stddev_z = spatial_mean_stddev(5);
+
+    const double tiny = 1.0e-10;
+
+    if ((stddev_x < tiny) && (stddev_y < tiny) && (stddev_z < tiny)) {
+        throw std::runtime_error(
+            "Space_charge_3d_mg::update_domain: "
+            "all three spatial dimensions have neglible extent");
+    }
+
+    std::array<double, 3> offset{mean_x, mean_y, mean_z};
+
+    std::array<double, 3> size{
+        options.n_sigma *
+            get_smallest_non_tiny(stddev_x, stddev_y, stddev_z, tiny),
+        options.n_sigma *
+            get_smallest_non_tiny(stddev_y, stddev_x, stddev_z, tiny),
+        options.n_sigma *
+            get_smallest_non_tiny(stddev_z, stddev_x, stddev_y, tiny)};
+
+    domain = Rectangular_grid_domain(options.shape, size, offset, false);
+}
+
+void
+Space_charge_3d_mg::get_local_charge_density(Bunch const& bunch)
+{
+    scoped_simple_timer timer("sc3d_mg_local_rho");
+
+    deposit_charge_rectangular_3d_kokkos_scatter_view(
+        rho, domain, domain.get_grid_shape(), bunch);
+}
+
+void
+Space_charge_3d_mg::get_global_charge_density(Bunch const& bunch)
+{
+    scoped_simple_timer timer("sc3d_mg_global_rho");
+
+    // every rank then solves the whole grid. Solving on one rank and
+    // broadcasting phi would trade this allreduce for a reduce and a
+    // broadcast of the same size, with the other ranks idle in the solve
+    Kokkos::deep_copy(h_rho, rho);
+
+    int err = MPI_Allreduce(MPI_IN_PLACE,
+                            (void*)h_rho.data(),
+                            h_rho.extent(0),
+                            MPI_DOUBLE,
+                            MPI_SUM,
+                            bunch.get_comm());
+
+    if (err != MPI_SUCCESS) {
+        throw std::runtime_error(
+            "MPI error in Space_charge_3d_mg: MPI_Allreduce in "
+            "get_global_charge_density: rho");
+    }
+
+    Kokkos::deep_copy(rho, h_rho);
+}
+
+void
+Space_charge_3d_mg::get_force()
+{
+    scoped_simple_timer timer("sc3d_mg_force");
+
+    auto const& g = domain.get_grid_shape();
+
+    sc3d_kernels::zyx::alg_force_extractor alg(
+        phi, enx, eny, enz, g, domain.get_cell_size());
+
+    Kokkos::parallel_for(g[0] * g[1] * g[2], alg);
+    Kokkos::fence();
+}
+
+void
+Space_charge_3d_mg::apply_kick(Bunch& bunch, double time_step)
+{
+    scoped_simple_timer timer("sc3d_mg_kick");
+
+    auto ref = bunch.get_reference_particle();
+
+    double q = bunch.get_particle_charge() * pconstants::e;
+    double m = bunch.get_mass();
+
+    double gamma = ref.get_gamma();
+    double beta = ref.get_beta();
+    double pref = ref.get_momentum();
+
+    auto g = domain.get_grid_shape();
+    auto h = domain.get_cell_size();
+    auto l = domain.get_left();
+
+    double fn_norm = (1.0 / (pconstants::epsilon0));
+
+    double unit_conversion = pconstants::c / (1e9 * pconstants::e);
+    double factor = options.kick_scale * unit_conversion * q * time_step *
+                    fn_norm / (pref * gamma * gamma * beta);
+
+    auto parts = bunch.get_local_particles();
+    auto masks = bunch.get_local_particle_masks();
+
+    sc3d_kernels::zyx::alg_kicker kicker(
+        parts, masks, enx, eny, enz, g, h, l, factor, pref, m);
+
+    Kokkos::parallel_for(bunch.size(), kicker);
+    Kokkos::fence();
+}
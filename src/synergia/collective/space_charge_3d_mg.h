@@ -0,0 +1,66 @@
+#ifndef SPACE_CHARGE_3D_MG_H_
+#define SPACE_CHARGE_3D_MG_H_
+
+#include "synergia/simulation/collective_operator.h"
+#include "synergia/simulation/implemented_collective_options.h"
+
+#include "rectangular_grid_domain.h"
+
+#include "multigrid_poisson_3d.h"
+
+/// The 3d finite difference space charge with the native multigrid
+/// solver (Space_charge_3d_fd_options with solver fd_solver_t::multigrid).
+/// It needs no PETSc, so it is built without the PETSc backend too.
+///
+/// The charge density is summed over the ranks of the bunch and every
+/// rank solves the whole grid, the same way as the open hockney solver
+/// with a comm_group_size of 1.
+///
+/// Note: internal grid is stored in [z][y][x] order, but
+/// grid shape expects [x][y][z] order.
+class Space_charge_3d_mg : public Collective_operator {
+  private:
+    const Space_charge_3d_fd_options options;
+
+    Rectangular_grid_domain domain;
+    bool use_fixed_domain;
+    bool allocated;
+
+    Multigrid_poisson_3d mg;
+
+    karray1d_dev rho;
+    karray1d_dev phi;
+    karray1d_hst h_rho;
+
+    karray1d_dev enx;
+    karray1d_dev eny;
+    karray1d_dev enz;
+
+    /* coarse charges for the open boundary potential */
+    karray1d_dev coarse_charge;
+    karray1d_hst h_coarse_charge;
+
+  private:
+    void apply_impl(Bunch_simulator& simulator,
+                    double time_step,
+                    Logger& logger);
+
+    void apply_bunch(Bunch& bunch, double time_step, Logger& logger);
+
+    void allocate();
+
+    void update_domain(Bunch const& bunch);
+
+    void get_local_charge_density(Bunch const& bunch);
+
+    void get_global_charge_density(Bunch const& bunch);
+
+    void get_force();
+
+    void apply_kick(Bunch& bunch, double time_step);
+
+  public:
+    Space_charge_3d_mg(Space_charge_3d_fd_options const& ops);
+};
+
+#endif /* SPACE_CHARGE_3D_MG_H_ */
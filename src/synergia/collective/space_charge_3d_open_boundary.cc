@@ -0,0 +1,191 @@
+#include "space_charge_3d_open_boundary.h"
+
+#include "synergia/foundation/math_constants.h"
+#include "synergia/utils/simple_timer.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+    // charge and charge weighted positions (relative to the domain
+    // offset) of the coarse cells, from the charge density on the grid
+    struct alg_coarse_charge {
+        karray1d_dev rho;
+        karray1d_dev coarse;
+
+        int gx, gy, gz;
+        int cgx, cgy;
+        double hx, hy, hz;
+        double lx, ly, lz;
+        int f;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int c) const
+        {
+            int cz = c / (cgx * cgy);
+            int cy = (c - cz * cgx * cgy) / cgx;
+            int cx = c - cz * cgx * cgy - cy * cgx;
+
+            const double vol = hx * hy * hz;
+
+            double q = 0, qx = 0, qy = 0, qz = 0;
+
+            for (int k = cz * f; k < (cz + 1) * f && k < gz; ++k) {
+                for (int j = cy * f; j < (cy + 1) * f && j < gy; ++j) {
+                    for (int i = cx * f; i < (cx + 1) * f && i < gx; ++i) {
+                        double dq = rho((k * gy + j) * gx + i) * vol;
+
+                        q += dq;
+                        qx += dq * (lx + (i + 0.5) * hx);
+                        qy += dq * (ly + (j + 0.5) * hy);
+                        qz += dq * (lz + (k + 0.5) * hz);
+                    }
+                }
+            }
+
+            coarse(c * 4 + 0) = q;
+            coarse(c * 4 + 1) = qx;
+            coarse(c * 4 + 2) = qy;
+            coarse(c * 4 + 3) = qz;
+        }
+    };
+
+    // free space potential of the coarse charges at the boundary nodes,
+    // stored as the boundary value of rho. The solvers fix the boundary
+    // of phi to hx*hy*hz*rho. Only one rank writes it, since rho is
+    // summed over the ranks
+    struct alg_open_boundary {
+        karray1d_dev rho;
+        karray1d_dev coarse;
+
+        int gx, gy, gz;
+        double hx, hy, hz;
+        double lx, ly, lz;
+        int ncoarse;
+        bool writer;
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int idx) const
+        {
+            int k = idx / (gx * gy);
+            int j = (idx - k * gx * gy) / gx;
+            int i = idx - k * gx * gy - j * gx;
+
+            if (i != 0 && i != gx - 1 && j != 0 && j != gy - 1 && k != 0 &&
+                k != gz - 1)
+                return;
+
+            if (!writer) {
+                rho(idx) = 0.0;
+                return;
+            }
+
+            // relative to the domain offset, like the coarse charges
+            const double x = lx + (i + 0.5) * hx;
+            const double y = ly + (j + 0.5) * hy;
+            const double z = lz + (k + 0.5) * hz;
+
+            // softened by a grid cell, for the charges next to the node
+            const double eps2 = 0.25 * (hx * hx + hy * hy + hz * hz);
+
+            double phi = 0.0;
+
+            for (int c = 0; c < ncoarse; ++c) {
+                double q = coarse(c * 4);
+                if (q == 0.0) continue;
+
+                double dx = x - coarse(c * 4 + 1) / q;
+                double dy = y - coarse(c * 4 + 2) / q;
+                double dz = z - coarse(c * 4 + 3) / q;
+
+                phi += q / std::sqrt(dx * dx + dy * dy + dz * dz + eps2);
+            }
+
+            phi *= 1.0 / (4.0 * mconstants::pi);
+
+            rho(idx) = phi / (hx * hy * hz);
+        }
+    };
+} // namespace
+
+void
+set_open_boundary_3d(karray1d_dev const& rho,
+                     Rectangular_grid_domain const& domain,
+                     int f,
+                     MPI_Comm comm,
+                     karray1d_dev& coarse,
+                     karray1d_hst& h_coarse)
+{
+    scoped_simple_timer timer("sc3d_fd_open_boundary");
+
+    auto const& g = domain.get_grid_shape();
+    auto const& h = domain.get_cell_size();
+    auto const& off = domain.get_physical_offset();
+
+    std::array<int, 3> gc{
+        (g[0] + f - 1) / f, (g[1] + f - 1) / f, (g[2] + f - 1) / f};
+    const int ncoarse = gc[0] * gc[1] * gc[2];
+
+    if ((int)coarse.extent(0) != ncoarse * 4) {
+        coarse = karray1d_dev("coarse_charge", ncoarse * 4);
+        h_coarse = Kokkos::create_mirror_view(coarse);
+    }
+
+    // positions relative to the offset of the domain
+    std::array<double, 3> l{domain.get_left()[0] - off[0],
+                            domain.get_left()[1] - off[1],
+                            domain.get_left()[2] - off[2]};
+
+    alg_coarse_charge alg_cc{rho,
+                             coarse,
+                             g[0],
+                             g[1],
+                             g[2],
+                             gc[0],
+                             gc[1],
+                             h[0],
+                             h[1],
+                             h[2],
+                             l[0],
+                             l[1],
+                             l[2],
+                             f};
+    Kokkos::parallel_for(ncoarse, alg_cc);
+
+    Kokkos::deep_copy(h_coarse, coarse);
+
+    int err = MPI_Allreduce(MPI_IN_PLACE,
+                            (void*)h_coarse.data(),
+                            ncoarse * 4,
+                            MPI_DOUBLE,
+                            MPI_SUM,
+                            comm);
+
+    if (err != MPI_SUCCESS) {
+        throw std::runtime_error(
+            "MPI error in set_open_boundary_3d: MPI_Allreduce coarse charge");
+    }
+
+    Kokkos::deep_copy(coarse, h_coarse);
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    alg_open_boundary alg_ob{rho,
+                             coarse,
+                             g[0],
+                             g[1],
+                             g[2],
+                             h[0],
+                             h[1],
+                             h[2],
+                             l[0],
+                             l[1],
+                             l[2],
+                             ncoarse,
+                             rank == 0};
+    Kokkos::parallel_for(g[0] * g[1] * g[2], alg_ob);
+    Kokkos::fence();
+}
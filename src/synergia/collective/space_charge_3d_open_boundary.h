@@ -0,0 +1,26 @@
+#ifndef SPACE_CHARGE_3D_OPEN_BOUNDARY_H_
+#define SPACE_CHARGE_3D_OPEN_BOUNDARY_H_
+
+#include <mpi.h>
+
+#include "rectangular_grid_domain.h"
+
+#include "synergia/utils/kokkos_views.h"
+
+/// Open boundaries of the 3d finite difference solvers: sets the
+/// boundary nodes of the local charge density rho ([z][y][x] order, to
+/// be summed over comm) to the free space potential of the charge,
+/// summed over coarse cells of f^3 grid cells. The solvers fix the
+/// boundary of phi to hx*hy*hz*rho, so only rank 0 of comm writes it and
+/// the other ranks zero their boundary nodes.
+///
+/// coarse and h_coarse are the workspace of the coarse charges, they
+/// are (re)allocated when the size does not match.
+void set_open_boundary_3d(karray1d_dev const& rho,
+                          Rectangular_grid_domain const& domain,
+                          int f,
+                          MPI_Comm comm,
+                          karray1d_dev& coarse,
+                          karray1d_hst& h_coarse);
+
+#endif /* SPACE_CHARGE_3D_OPEN_BOUNDARY_H_ */
@@ -1,6 +1,7 @@
 
 #include "space_charge_3d_open_hockney.h"
 #include "deposit.h"
+#include "frozen_fields.h"
 #include "space_charge_3d_kernels.h"
 
 #include "synergia/bunch/core_diagnostics.h"
@@ -348,6 +349,135 @@ namespace {
         }
     };
 
+    // Antiderivative of 1/r, d^3 F / dx dy dz = 1/sqrt(x^2 + y^2 + z^2).
+    // The asinh form leaves out terms that cancel in the sum over the
+    // corners of a cell and is well behaved for negative coordinates.
+    // Never evaluated at a point with a zero coordinate, the corners
+    // of the cells are half a cell off the grid points.
+    KOKKOS_INLINE_FUNCTION
+    double
+    igf_antiderivative(double x, double y, double z)
+    {
+        double xx = x * x;
+        double yy = y * y;
+        double zz = z * z;
+        double r = sqrt(xx + yy + zz);
+
+        return y * z * asinh(x / sqrt(yy + zz)) +
+               x * z * asinh(y / sqrt(xx + zz)) +
+               x * y * asinh(z / sqrt(xx + yy)) -
+               0.5 * xx * atan(y * z / (x * r)) -
+               0.5 * yy * atan(x * z / (y * r)) -
+               0.5 * zz * atan(x * y / (z * r));
+    }
+
+    // Integrated Green function: 1/r averaged over the cell centered at
+    // the grid point. Unlike the point value it stays accurate when the
+    // cells are long and thin, e.g., hz >> hx for a long bunch. The
+    // normalization is the same as for the pointlike kernel.
+    struct alg_g2_igf {
+        // beyond far cells the cell average is taken from the
+        // expansion of 1/r to the second order in the cell size
+        const double far = 10.0;
+
+        karray1d_dev g2;
+        int gx, gy;
+        int dgx, dgy, dgz;
+        int padded_dgx;
+        double hx, hy, hz;
+
+        double igxgy;
+        double igx;
+
+        double ivol;
+        double far2;
+
+        alg_g2_igf(karray1d_dev const& g2,
+                   std::array<int, 3> const& g,
+                   std::array<int, 3> const& dg,
+                   std::array<double, 3> const& h)
+            : g2(g2)
+            , gx(g[0] + 1)
+            , gy(g[1] + 1)
+            , dgx(dg[0])
+            , dgy(dg[1])
+            , dgz(dg[2])
+            , padded_dgx(Distributed_fft3d::get_padded_shape_real(dgx))
+            , hx(h[0])
+            , hy(h[1])
+            , hz(h[2])
+            , igxgy(1.0 / (gx * gy))
+            , igx(1.0 / gx)
+            , ivol(1.0 / (h[0] * h[1] * h[2]))
+            , far2(0.0)
+        {
+            double hmax = std::max(hx, std::max(hy, hz));
+            far2 = far * far * hmax * hmax;
+        }
+
+        KOKKOS_INLINE_FUNCTION
+        void
+        operator()(const int i) const
+        {
+            int iz = i * igxgy;
+            int iy = (i - iz * gx * gy) * igx;
+            int ix = i - iz * gx * gy - iy * gx;
+
+            double x = ix * hx;
+            double y = iy * hy;
+            double z = iz * hz;
+
+            double rr = x * x + y * y + z * z;
+            double G;
+
+            if (rr > far2) {
+                double ir = 1.0 / sqrt(rr);
+                double ir5 = ir * ir * ir * ir * ir;
+
+                G = ir + (hx * hx * (3.0 * x * x - rr) +
+                          hy * hy * (3.0 * y * y - rr) +
+                          hz * hz * (3.0 * z * z - rr)) *
+                             ir5 / 24.0;
+            } else {
+                double x0 = x - 0.5 * hx, x1 = x + 0.5 * hx;
+                double y0 = y - 0.5 * hy, y1 = y + 0.5 * hy;
+                double z0 = z - 0.5 * hz, z1 = z + 0.5 * hz;
+
+                G = igf_antiderivative(x1, y1, z1) -
+                    igf_antiderivative(x0, y1, z1) -
+                    igf_antiderivative(x1, y0, z1) -
+                    igf_antiderivative(x1, y1, z0) +
+                    igf_antiderivative(x0, y0, z1) +
+                    igf_antiderivative(x0, y1, z0) +
+                    igf_antiderivative(x1, y0, z0) -
+                    igf_antiderivative(x0, y0, z0);
+
+                G *= ivol;
+            }
+
+            int mix, miy, miz;
+
+            mix = dgx - ix;
+            if (mix == dgx) mix = 0;
+
+            miy = dgy - iy;
+            if (miy == dgy) miy = 0;
+
+            miz = dgz - iz;
+            if (miz == dgz) miz = 0;
+
+            g2(iz * padded_dgx * dgy + iy * padded_dgx + ix) = G;
+            g2(iz * padded_dgx * dgy + miy * padded_dgx + ix) = G;
+            g2(iz * padded_dgx * dgy + iy * padded_dgx + mix) = G;
+            g2(iz * padded_dgx * dgy + miy * padded_dgx + mix) = G;
+
+            g2(miz * padded_dgx * dgy + iy * padded_dgx + ix) = G;
+            g2(miz * padded_dgx * dgy + miy * padded_dgx + ix) = G;
+            g2(miz * padded_dgx * dgy + iy * padded_dgx + mix) = G;
+            g2(miz * padded_dgx * dgy + miy * padded_dgx + mix) = G;
+        }
+    };
+
     struct alg_cplx_multiplier {
         karray1d_dev prod;
         karray1d_dev m1, m2;
@@ -426,6 +556,17 @@ Space_charge_3d_open_hockney::apply_bunch(Bunch& bunch,
                                           double time_step,
                                           Logger& logger)
 {
+    std::array<double, 6> moments;
+
+    // reuse the fields of the last solve at this location
+    if (options.frozen_turns > 0) {
+        auto mean_std = Core_diagnostics::calculate_spatial_mean_stddev(bunch);
+        for (int i = 0; i < 6; ++i)
+            moments[i] = mean_std(i);
+
+        if (apply_frozen(bunch, moments, time_step)) return;
+    }
+
     // update domain only when not using fixed
     if (!use_fixed_domain) update_domain(bunch);
 
@@ -436,6 +577,8 @@ Space_charge_3d_open_hockney::apply_bunch(Bunch& bunch,
     // green function
     if (options.green_fn == green_fn_t::pointlike) {
         get_green_fn2_pointlike();
+    } else if (options.green_fn == green_fn_t::igf) {
+        get_green_fn2_igf();
     } else {
         get_green_fn2_linear();
     }
@@ -451,6 +594,96 @@ Space_charge_3d_open_hockney::apply_bunch(Bunch& bunch,
 
     // kick
     apply_kick(bunch, fn_norm, time_step);
+
+    // keep the fields for the next turns
+    if (options.frozen_turns > 0) freeze(bunch, moments, fn_norm);
+}
+
+std::string
+Space_charge_3d_open_hockney::get_frozen_key(Bunch const& bunch) const
+{
+    // the kick location is the position of the reference particle in
+    // the turn, to a micron
+    auto s = bunch.get_reference_particle().get_s_n();
+    return get_name() + ":" + std::to_string(std::llround(s * 1e6));
+}
+
+bool
+Space_charge_3d_open_hockney::apply_frozen(Bunch& bunch,
+                                           std::array<double, 6> const& moments,
+                                           double time_step)
+{
+    auto e =
+        Frozen_fields::of(bunch_sim_id, bunch).find(get_frozen_key(bunch));
+    if (!e) return false;
+
+    // fields of a solve in the other precision
+    if (e->single_precision != options.single_precision) return false;
+
+    int turn = bunch.get_reference_particle().get_repetition();
+
+    if (Frozen_fields::stale(*e,
+                             moments,
+                             turn,
+                             options.frozen_turns,
+                             options.frozen_tolerance))
+        return false;
+
+    scoped_simple_timer timer("sc3d_frozen");
+
+    // params are the offset, size and normalization of the solve
+    auto const& p = e->params;
+
+    std::array<double, 3> offset{p[0], p[1], p[2]};
+    std::array<double, 3> size{p[3], p[4], p[5]};
+    std::array<double, 3> doubled_size{size[0] * 2, size[1] * 2, size[2] * 2};
+
+    domain = Rectangular_grid_domain(options.shape, size, offset, false);
+    doubled_domain = Rectangular_grid_domain(
+        options.doubled_shape, doubled_size, offset, false);
+
+    // kicks with the fields of the entry
+    if (options.single_precision) {
+        auto const& f = e->fields_f;
+        apply_kick(bunch, f[0], f[1], f[2], p[6], time_step);
+    } else {
+        auto const& f = e->fields;
+        apply_kick(bunch, f[0], f[1], f[2], p[6], time_step);
+    }
+
+    return true;
+}
+
+void
+Space_charge_3d_open_hockney::freeze(Bunch& bunch,
+                                     std::array<double, 6> const& moments,
+                                     double fn_norm)
+{
+    Frozen_fields::entry e;
+
+    auto copy = [](auto const& v) {
+        std::decay_t<decltype(v)> c(v.label(), v.extent(0));
+        Kokkos::deep_copy(c, v);
+        return c;
+    };
+
+    e.single_precision = options.single_precision;
+
+    if (options.single_precision) {
+        e.fields_f = {copy(enxf), copy(enyf), copy(enzf)};
+    } else {
+        e.fields = {copy(enx), copy(eny), copy(enz)};
+    }
+
+    auto const& offset = domain.get_physical_offset();
+    auto const& size = domain.get_physical_size();
+
+    e.params = {
+        offset[0], offset[1], offset[2], size[0], size[1], size[2], fn_norm};
+    e.moments = moments;
+    e.turn = bunch.get_reference_particle().get_repetition();
+
+    Frozen_fields::of(bunch_sim_id, bunch).insert(get_frozen_key(bunch), e);
 }
 
 void
@@ -486,9 +719,18 @@ Space_charge_3d_open_hockney::construct_workspaces(Bunch_simulator const& sim)
     h_phi2 = Kokkos::create_mirror_view(phi2);
 
     // En is in the original domain
-    enx = karray1d_dev("enx", s[0] * s[1] * s[2] / 8);
-    eny = karray1d_dev("eny", s[0] * s[1] * s[2] / 8);
-    enz = karray1d_dev("enz", s[0] * s[1] * s[2] / 8);
+    if (options.single_precision) {
+        enxf = karray1f_dev("enxf", s[0] * s[1] * s[2] / 8);
+        enyf = karray1f_dev("enyf", s[0] * s[1] * s[2] / 8);
+        enzf = karray1f_dev("enzf", s[0] * s[1] * s[2] / 8);
+
+        buf_f = karray1f_dev("buf_f", nx_real * s[1] * s[2]);
+        h_buf_f = Kokkos::create_mirror_view(buf_f);
+    } else {
+        enx = karray1d_dev("enx", s[0] * s[1] * s[2] / 8);
+        eny = karray1d_dev("eny", s[0] * s[1] * s[2] / 8);
+        enz = karray1d_dev("enz", s[0] * s[1] * s[2] / 8);
+    }
 }
 
 void
@@ -565,6 +807,19 @@ Space_charge_3d_open_hockney::get_global_charge_density(Bunch const& bunch)
 
     auto dg = doubled_domain.get_grid_shape();
 
+    if (options.single_precision) {
+        int err = ku::allreduce_sum_single(
+            rho2, buf_f, h_buf_f, bunch.get_comm());
+
+        if (err != MPI_SUCCESS) {
+            throw std::runtime_error(
+                "MPI error in Space_charge_3d_open_hockney"
+                "(MPI_Allreduce in get_global_charge_density)");
+        }
+
+        return;
+    }
+
     simple_timer_start("sc3d_global_rho_copy");
     Kokkos::deep_copy(h_rho2, rho2);
     simple_timer_stop("sc3d_global_rho_copy");
@@ -639,6 +894,31 @@ Space_charge_3d_open_hockney::get_green_fn2_linear()
     Kokkos::fence();
 }
 
+void
+Space_charge_3d_open_hockney::get_green_fn2_igf()
+{
+    if (options.periodic_z) {
+        throw std::runtime_error(
+            "Space_charge_3d_open_hockney::get_green_fn2_igf: "
+            "periodic_z not yet implemented");
+    }
+
+    scoped_simple_timer timer("sc3d_green_fn2_igf");
+
+    auto g = domain.get_grid_shape();
+    auto h = doubled_domain.get_cell_size();
+    auto dg = doubled_domain.get_grid_shape();
+
+    ku::alg_zeroer az{g2};
+    Kokkos::parallel_for(g2.extent(0), az);
+
+    // calculation is performed on grid (gx+1, gy+1, gz+1)
+    // rest of the doubled domain will be filled with mirrors
+    alg_g2_igf alg(g2, g, dg, h);
+    Kokkos::parallel_for((g[0] + 1) * (g[1] + 1) * (g[2] + 1), alg);
+    Kokkos::fence();
+}
+
 void
 Space_charge_3d_open_hockney::get_local_phi2(Distributed_fft3d& fft)
 {
@@ -684,6 +964,19 @@ Space_charge_3d_open_hockney::get_global_phi2(Distributed_fft3d const& fft)
 
     scoped_simple_timer timer("sc3d_global_f");
 
+    if (options.single_precision) {
+        int err =
+            ku::allreduce_sum_single(phi2, buf_f, h_buf_f, fft.get_comm());
+
+        if (err != MPI_SUCCESS) {
+            throw std::runtime_error(
+                "MPI error in Space_charge_3d_open_hockney"
+                "(MPI_Allreduce in get_global_electric_force2_allreduce)");
+        }
+
+        return;
+    }
+
     Kokkos::deep_copy(h_phi2, phi2);
 
     auto dg = doubled_domain.get_grid_shape();
@@ -724,7 +1017,7 @@ Space_charge_3d_open_hockney::get_normalization_force(
     // from charege density
     normalization *= 1.0;
 
-    // 1.0 from point-like greens function.
+    // 1.0 from point-like and integrated greens functions.
     // 1.0/(hz*hz) for linear greens function
     if (options.green_fn == green_fn_t::linear)
         normalization *= 1.0 / (hz * hz);
@@ -744,9 +1037,16 @@ Space_charge_3d_open_hockney::get_force()
 
     // phi2 is in (padded_real_dgx, dgy, dgz)
     // en{x|y|z} is in (gx, gy, gz)
-    sc3d_kernels::zyx::alg_force_extractor_doubled_domain alg(
-        phi2, enx, eny, enz, g, dg, h);
-    Kokkos::parallel_for(g[0] * g[1] * g[2], alg);
+    if (options.single_precision) {
+        sc3d_kernels::zyx::alg_force_extractor_doubled_domain alg(
+            phi2, enxf, enyf, enzf, g, dg, h);
+        Kokkos::parallel_for(g[0] * g[1] * g[2], alg);
+    } else {
+        sc3d_kernels::zyx::alg_force_extractor_doubled_domain alg(
+            phi2, enx, eny, enz, g, dg, h);
+        Kokkos::parallel_for(g[0] * g[1] * g[2], alg);
+    }
+
     Kokkos::fence();
 }
 
@@ -754,6 +1054,22 @@ void
 Space_charge_3d_open_hockney::apply_kick(Bunch& bunch,
                                          double fn_norm,
                                          double time_step)
+{
+    if (options.single_precision) {
+        apply_kick(bunch, enxf, enyf, enzf, fn_norm, time_step);
+    } else {
+        apply_kick(bunch, enx, eny, enz, fn_norm, time_step);
+    }
+}
+
+template <class VIEW>
+void
+Space_charge_3d_open_hockney::apply_kick(Bunch& bunch,
+                                         VIEW const& ex,
+                                         VIEW const& ey,
+                                         VIEW const& ez,
+                                         double fn_norm,
+                                         double time_step)
 {
     scoped_simple_timer timer("sc3d_kick");
 
@@ -778,8 +1094,8 @@ Space_charge_3d_open_hockney::apply_kick(Bunch& bunch,
     auto l = domain.get_left();
 
     sc3d_kernels::zyx::alg_kicker kicker(
-        parts, masks, enx, eny, enz, g, h, l, factor, pref, m);
-
+        parts, masks, ex, ey, ez, g, h, l, factor, pref, m);
     Kokkos::parallel_for(bunch.size(), kicker);
+
     Kokkos::fence();
 }
@@ -36,6 +36,15 @@ class Space_charge_3d_open_hockney : public Collective_operator {
     karray1d_dev eny;
     karray1d_dev enz;
 
+    // single_precision workspaces, the fields and the message buffer
+    // of the reductions
+    karray1f_dev enxf;
+    karray1f_dev enyf;
+    karray1f_dev enzf;
+
+    karray1f_dev buf_f;
+    karray1f_hst h_buf_f;
+
   private:
     void apply_impl(Bunch_simulator& simulator,
                     double time_step,
@@ -56,8 +65,27 @@ class Space_charge_3d_open_hockney : public Collective_operator {
 
     void apply_kick(Bunch& bunch, double fn_norm, double time_step);
 
+    // kick with the field grids ex, ey and ez, of the solve or frozen
+    template <class VIEW>
+    void apply_kick(Bunch& bunch,
+                    VIEW const& ex,
+                    VIEW const& ey,
+                    VIEW const& ez,
+                    double fn_norm,
+                    double time_step);
+
+    // frozen fields
+    bool apply_frozen(Bunch& bunch,
+                      std::array<double, 6> const& moments,
+                      double time_step);
+
+    void freeze(Bunch& bunch,
+                std::array<double, 6> const& moments,
+                double fn_norm);
+
     void get_green_fn2_pointlike();
     void get_green_fn2_linear();
+    void get_green_fn2_igf();
 
     void get_local_phi2(Distributed_fft3d& fft);
 
@@ -70,6 +98,9 @@ class Space_charge_3d_open_hockney : public Collective_operator {
   public:
     Space_charge_3d_open_hockney(
         Space_charge_3d_open_hockney_options const& ops);
+
+    // key of the frozen fields of the current kick location of the bunch
+    std::string get_frozen_key(Bunch const& bunch) const;
 };
 
 #endif /* SPACE_CHARGE_3D_OPEN_HOCKNEY_H_ */
@@ -0,0 +1,163 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/collective/frozen_fields.h"
+#include "synergia/simulation/bunch_simulator.h"
+
+#include <cereal/archives/binary.hpp>
+#include <filesystem>
+#include <sstream>
+
+namespace {
+    Frozen_fields::entry
+    make_entry(int n, int turn)
+    {
+        Frozen_fields::entry e;
+
+        e.fields = {karray1d_dev("f", n)};
+        e.moments = {0.0, 0.0, 0.0, 1.0e-3, 1.0e-3, 1.0e-2};
+        e.turn = turn;
+
+        return e;
+    }
+}
+
+TEST_CASE("stale", "[Frozen_fields]")
+{
+    auto e = make_entry(8, 10);
+    auto m = e.moments;
+
+    CHECK(!Frozen_fields::stale(e, m, 12, 4, 0.05));
+
+    // too old
+    CHECK(Frozen_fields::stale(e, m, 14, 4, 0.05));
+
+    // centroid moved by 0.1 sigma
+    m[0] = 1.0e-4;
+    CHECK(Frozen_fields::stale(e, m, 12, 4, 0.05));
+
+    // size grew by 1%
+    m = e.moments;
+    m[5] = 1.01e-2;
+    CHECK(!Frozen_fields::stale(e, m, 12, 4, 0.05));
+    CHECK(Frozen_fields::stale(e, m, 12, 4, 0.005));
+}
+
+TEST_CASE("memory_budget", "[Frozen_fields]")
+{
+    auto budget = Frozen_fields::get_memory_budget();
+    Frozen_fields::set_memory_budget(3 * 100 * sizeof(double));
+
+    Frozen_fields ff;
+
+    CHECK(ff.insert("a", make_entry(100, 0)));
+    CHECK(ff.insert("b", make_entry(100, 0)));
+    CHECK(ff.insert("c", make_entry(100, 0)));
+    CHECK(ff.size() == 3);
+
+    // "a" is the most recently used, "b" is dropped
+    CHECK(ff.find("a") != nullptr);
+    CHECK(ff.insert("d", make_entry(100, 0)));
+
+    CHECK(ff.size() == 3);
+    CHECK(ff.find("b") == nullptr);
+    CHECK(ff.find("a") != nullptr);
+    CHECK(ff.get_memory_used() == 3 * 100 * sizeof(double));
+
+    // over the budget on its own
+    CHECK(!ff.insert("e", make_entry(400, 0)));
+    CHECK(ff.find("e") == nullptr);
+
+    Frozen_fields::set_memory_budget(budget);
+}
+
+TEST_CASE("checkpoint", "[Frozen_fields]")
+{
+    Frozen_fields ff;
+
+    auto e = make_entry(5, 7);
+    e.single_precision = true;
+    e.fields_f = {karray1f_dev("ff", 3)};
+    e.params = {0.5, 2.0};
+
+    auto hf = Kokkos::create_mirror_view(e.fields[0]);
+    for (int i = 0; i < 5; ++i)
+        hf(i) = 0.25 * i;
+    Kokkos::deep_copy(e.fields[0], hf);
+
+    ff.insert("a", e);
+
+    auto save_load = [&ff]() {
+        std::stringstream ss;
+        {
+            cereal::BinaryOutputArchive ar(ss);
+            ar(ff);
+        }
+
+        Frozen_fields loaded;
+        {
+            cereal::BinaryInputArchive ar(ss);
+            ar(loaded);
+        }
+
+        return loaded;
+    };
+
+    auto loaded = save_load();
+    auto le = loaded.find("a");
+
+    REQUIRE(le != nullptr);
+    CHECK(le->turn == 7);
+    CHECK(le->single_precision);
+    CHECK(le->params == e.params);
+    CHECK(le->moments == e.moments);
+    CHECK(le->fields_f[0].extent(0) == 3);
+
+    REQUIRE(le->fields.size() == 1);
+    auto hl = Kokkos::create_mirror_view(le->fields[0]);
+    Kokkos::deep_copy(hl, le->fields[0]);
+
+    for (int i = 0; i < 5; ++i)
+        CHECK(hl(i) == 0.25 * i);
+
+    // turned off, the checkpoint restores an empty cache
+    Frozen_fields::set_checkpointed(false);
+    CHECK(save_load().size() == 0);
+    Frozen_fields::set_checkpointed(true);
+}
+
+TEST_CASE("simulator_checkpoint", "[Frozen_fields]")
+{
+    const Reference_particle ref(1, 100.0, 125.0);
+
+    auto sim = Bunch_simulator::create_single_bunch_simulator(
+        ref, 16, 1e10, Commxx());
+    auto& bunch = sim.get_bunch();
+
+    Frozen_fields::of(sim.id(), bunch).insert("a", make_entry(5, 3));
+
+    const std::string dir = "test_frozen_fields_cp";
+    std::filesystem::create_directories(dir);
+
+    Frozen_fields::dump_checkpoint(dir, sim);
+    Frozen_fields::clear_all();
+    CHECK(Frozen_fields::of(sim.id(), bunch).size() == 0);
+
+    Frozen_fields::load_checkpoint(dir, sim);
+
+    auto e = Frozen_fields::of(sim.id(), bunch).find("a");
+    REQUIRE(e != nullptr);
+    CHECK(e->turn == 3);
+    CHECK(e->fields[0].extent(0) == 5);
+
+    // files of another simulator are not loaded
+    auto other = Bunch_simulator::create_single_bunch_simulator(
+        ref, 16, 1e10, Commxx());
+
+    Frozen_fields::load_checkpoint(dir, other);
+    CHECK(Frozen_fields::of(other.id(), other.get_bunch()).size() == 0);
+
+    // a different simulator drops the caches of the previous one
+    CHECK(Frozen_fields::of(sim.id(), bunch).size() == 0);
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,162 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/collective/multigrid_poisson_3d.h"
+
+#include <cmath>
+
+namespace {
+  // rho such that the discrete system has the solution phi, on a grid of
+  // shape g and cell size h
+  karray1d_hst
+  manufactured_rho(karray1d_hst const& phi,
+                   std::array<int, 3> const& g,
+                   std::array<double, 3> const& h)
+  {
+    const double vol = h[0] * h[1] * h[2];
+    const double sx = h[1] * h[2] / h[0];
+    const double sy = h[0] * h[2] / h[1];
+    const double sz = h[0] * h[1] / h[2];
+
+    karray1d_hst rho("rho", phi.extent(0));
+
+    for (int k = 0; k < g[2]; ++k) {
+      for (int j = 0; j < g[1]; ++j) {
+        for (int i = 0; i < g[0]; ++i) {
+          int idx = (k * g[1] + j) * g[0] + i;
+
+          if (i == 0 || i == g[0] - 1 || j == 0 || j == g[1] - 1 || k == 0 ||
+              k == g[2] - 1) {
+            rho(idx) = phi(idx) / vol;
+            continue;
+          }
+
+          double lap =
+            sx * (2 * phi(idx) - phi(idx - 1) - phi(idx + 1)) +
+            sy * (2 * phi(idx) - phi(idx - g[0]) - phi(idx + g[0])) +
+            sz * (2 * phi(idx) - phi(idx - g[0] * g[1]) -
+                  phi(idx + g[0] * g[1]));
+
+          rho(idx) = lap / vol;
+        }
+      }
+    }
+
+    return rho;
+  }
+
+  karray1d_hst
+  smooth_phi(std::array<int, 3> const& g)
+  {
+    karray1d_hst phi("phi", g[0] * g[1] * g[2]);
+
+    for (int k = 0; k < g[2]; ++k) {
+      for (int j = 0; j < g[1]; ++j) {
+        for (int i = 0; i < g[0]; ++i) {
+          double x = (double)i / (g[0] - 1);
+          double y = (double)j / (g[1] - 1);
+          double z = (double)k / (g[2] - 1);
+
+          phi((k * g[1] + j) * g[0] + i) =
+            std::sin(3.0 * x) * std::cos(2.0 * y) * std::exp(z) + 0.1 * x * y;
+        }
+      }
+    }
+
+    return phi;
+  }
+
+  double
+  solve_and_compare(std::array<int, 3> const& g,
+                    std::array<double, 3> const& h,
+                    mg_cycle_t cycle,
+                    int& cycles)
+  {
+    auto hphi = smooth_phi(g);
+    auto hrho = manufactured_rho(hphi, g, h);
+
+    karray1d_dev rho("rho", hrho.extent(0));
+    karray1d_dev phi("phi", hrho.extent(0));
+    Kokkos::deep_copy(rho, hrho);
+
+    Multigrid_poisson_3d mg;
+    mg.construct(g, cycle, 2, 1e-10, 50);
+    cycles = mg.solve(rho, phi, h);
+
+    karray1d_hst res = Kokkos::create_mirror_view(phi);
+    Kokkos::deep_copy(res, phi);
+
+    double err = 0.0;
+    double norm = 0.0;
+
+    for (int i = 0; i < (int)res.extent(0); ++i) {
+      err = std::max(err, std::abs(res(i) - hphi(i)));
+      norm = std::max(norm, std::abs(hphi(i)));
+    }
+
+    return err / norm;
+  }
+}
+
+TEST_CASE("levels")
+{
+  Multigrid_poisson_3d mg;
+
+  mg.construct({17, 12, 9});
+  REQUIRE(mg.get_num_levels() == 4);
+
+  CHECK(mg.get_level_shape(1) == std::array<int, 3>{9, 7, 5});
+  CHECK(mg.get_level_shape(2) == std::array<int, 3>{5, 4, 3});
+  CHECK(mg.get_level_shape(3) == std::array<int, 3>{3, 3, 3});
+
+  // dimensions of 3 nodes are not coarsened
+  mg.construct({3, 16, 3});
+  REQUIRE(mg.get_num_levels() == 4);
+  CHECK(mg.get_level_shape(3) == std::array<int, 3>{3, 3, 3});
+
+  CHECK_THROWS(mg.construct({2, 16, 16}));
+}
+
+TEST_CASE("solve_v_cycle")
+{
+  int cycles = 0;
+  double err = solve_and_compare(
+    {17, 12, 9}, {1e-3, 1e-3, 1e-3}, mg_cycle_t::V, cycles);
+
+  CHECK(err < 1e-6);
+  CHECK(cycles < 15);
+}
+
+TEST_CASE("solve_f_cycle")
+{
+  int cycles = 0;
+  double err = solve_and_compare(
+    {16, 11, 20}, {1e-3, 1.5e-3, 2e-3}, mg_cycle_t::F, cycles);
+
+  // anisotropic cells converge slower with point smoothing
+  CHECK(err < 1e-6);
+  CHECK(cycles < 25);
+}
+
+TEST_CASE("warm_start")
+{
+  std::array<int, 3> g{16, 16, 16};
+  std::array<double, 3> h{1e-3, 1e-3, 1e-3};
+
+  auto hphi = smooth_phi(g);
+  auto hrho = manufactured_rho(hphi, g, h);
+
+  karray1d_dev rho("rho", hrho.extent(0));
+  karray1d_dev phi("phi", hrho.extent(0));
+  Kokkos::deep_copy(rho, hrho);
+
+  Multigrid_poisson_3d mg;
+  mg.construct(g, mg_cycle_t::V, 2, 1e-8, 50);
+
+  int cold = mg.solve(rho, phi, h);
+  CHECK(mg.get_residual() < 1e-8);
+
+  // the same rho again starts from its own solution
+  int warm = mg.solve(rho, phi, h);
+  CHECK(warm < cold);
+  CHECK(warm <= 1);
+}
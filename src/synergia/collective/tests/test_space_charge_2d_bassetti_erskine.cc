@@ -0,0 +1,200 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/collective/space_charge_2d_bassetti_erskine.h"
+#include "synergia/collective/space_charge_2d_open_hockney.h"
+#include "synergia/foundation/physical_constants.h"
+
+#include <random>
+
+using be = Space_charge_2d_bassetti_erskine;
+
+namespace {
+    // the same Gaussian bunch on every call
+    Bunch_simulator
+    gaussian_bunch(int num)
+    {
+        Four_momentum fm(pconstants::mp, pconstants::mp * 61.0 / 60.0);
+        Reference_particle ref(pconstants::proton_charge, fm);
+
+        auto bsim = Bunch_simulator::create_single_bunch_simulator(
+            ref, num, 5.0e10, Commxx());
+
+        auto& bunch = bsim.get_bunch();
+        bunch.checkout_particles();
+        auto parts = bunch.get_host_particles();
+
+        std::mt19937 gen(12345);
+        std::normal_distribution<double> gauss;
+
+        for (int p = 0; p < bunch.get_local_num(); ++p) {
+            parts(p, Bunch::x) = 2e-3 * gauss(gen);
+            parts(p, Bunch::xp) = 0.0;
+            parts(p, Bunch::y) = 1e-3 * gauss(gen);
+            parts(p, Bunch::yp) = 0.0;
+            parts(p, Bunch::cdt) = 0.05 * gauss(gen);
+            parts(p, Bunch::dpop) = 0.0;
+        }
+
+        bunch.checkin_particles();
+        return bsim;
+    }
+
+    // transverse kicks of the bunch after one step of the operator
+    std::vector<std::array<double, 2>>
+    transverse_kicks(Bunch_simulator& bsim, Collective_operator& op)
+    {
+        auto logger = Logger(0, LoggerV::INFO_STEP);
+
+        auto& bunch = bsim.get_bunch();
+        double beta = bunch.get_reference_particle().get_beta();
+        op.apply(bsim, 0.1 / (beta * pconstants::c), logger);
+
+        bunch.checkout_particles();
+        auto parts = bunch.get_host_particles();
+
+        std::vector<std::array<double, 2>> k(bunch.get_local_num());
+        for (int p = 0; p < bunch.get_local_num(); ++p)
+            k[p] = {parts(p, Bunch::xp), parts(p, Bunch::yp)};
+
+        return k;
+    }
+}
+
+TEST_CASE("linear_core", "[Space_charge_2d_bassetti_erskine]")
+{
+    // close to the centre the field of the Gaussian is linear,
+    // E = (x/(sx(sx+sy)), y/(sy(sx+sy)))
+    const double sx = 2e-3;
+    const double sy = 1e-3;
+
+    const double x = 1e-6;
+    const double y = 2e-6;
+
+    auto e = be::get_unit_efield(x, y, sx, sy);
+    CHECK(e[0] == Approx(x / (sx * (sx + sy))).epsilon(1e-5));
+    CHECK(e[1] == Approx(y / (sy * (sx + sy))).epsilon(1e-5));
+
+    // swapped planes
+    auto f = be::get_unit_efield(y, x, sy, sx);
+    CHECK(f[0] == Approx(e[1]).epsilon(1e-12));
+    CHECK(f[1] == Approx(e[0]).epsilon(1e-12));
+
+    // no field at the centre
+    auto z = be::get_unit_efield(0.0, 0.0, sx, sy);
+    CHECK(std::abs(z[0]) < 1e-9);
+    CHECK(std::abs(z[1]) < 1e-9);
+}
+
+TEST_CASE("far_field", "[Space_charge_2d_bassetti_erskine]")
+{
+    // far away the bunch is a line charge, E = r/r^2
+    const double sx = 2e-3;
+    const double sy = 1e-3;
+
+    const double x = -0.5;
+    const double y = 0.3;
+    const double r2 = x * x + y * y;
+
+    auto e = be::get_unit_efield(x, y, sx, sy);
+    CHECK(e[0] == Approx(x / r2).epsilon(1e-4));
+    CHECK(e[1] == Approx(y / r2).epsilon(1e-4));
+}
+
+TEST_CASE("round_limit", "[Space_charge_2d_bassetti_erskine]")
+{
+    // E = (1 - exp(-r^2/(2 s^2))) / r^2 * (x, y)
+    const double s = 1e-3;
+
+    const double x = 1e-3;
+    const double y = -2e-3;
+    const double r2 = x * x + y * y;
+    const double e_r = (1.0 - std::exp(-r2 / (2.0 * s * s))) / r2;
+
+    // exactly round
+    auto e = be::get_unit_efield(x, y, s, s);
+    CHECK(e[0] == Approx(e_r * x).epsilon(1e-12));
+    CHECK(e[1] == Approx(e_r * y).epsilon(1e-12));
+
+    // nearly round, on the elliptical expression
+    auto f = be::get_unit_efield(x, y, s * (1 + 1e-4), s);
+    CHECK(f[0] == Approx(e_r * x).epsilon(1e-3));
+    CHECK(f[1] == Approx(e_r * y).epsilon(1e-3));
+}
+
+TEST_CASE("matches_open_hockney", "[Space_charge_2d_bassetti_erskine]")
+{
+    // the analytic field must have the normalization of a grid solve of
+    // the same Gaussian bunch
+    const int num = 100000;
+
+    auto be_ops = Space_charge_2d_bassetti_erskine_options();
+    be_ops.longitudinal_distribution =
+        Space_charge_2d_bassetti_erskine_options::LD::gaussian;
+
+    auto b_be = gaussian_bunch(num);
+    auto sc_be = be(be_ops);
+    auto k_be = transverse_kicks(b_be, sc_be);
+
+    auto oh_ops = Space_charge_2d_open_hockney_options(64, 64, 32);
+    oh_ops.comm_group_size = 1;
+
+    auto b_oh = gaussian_bunch(num);
+    auto sc_oh = Space_charge_2d_open_hockney(oh_ops);
+    auto k_oh = transverse_kicks(b_oh, sc_oh);
+
+    REQUIRE(k_be.size() == k_oh.size());
+
+    // least squares scale of the grid kicks on the analytic ones, and
+    // the remaining spread, over the core of the bunch
+    b_be.get_bunch().checkout_particles();
+    auto parts = b_be.get_bunch().get_host_particles();
+
+    double sbb = 0.0, sbo = 0.0, soo = 0.0;
+
+    for (size_t p = 0; p < k_be.size(); ++p) {
+        if (std::abs(parts(p, Bunch::x)) > 6e-3) continue;
+        if (std::abs(parts(p, Bunch::y)) > 3e-3) continue;
+        if (std::abs(parts(p, Bunch::cdt)) > 0.1) continue;
+
+        for (int i = 0; i < 2; ++i) {
+            sbb += k_be[p][i] * k_be[p][i];
+            sbo += k_be[p][i] * k_oh[p][i];
+            soo += k_oh[p][i] * k_oh[p][i];
+        }
+    }
+
+    REQUIRE(sbb > 0.0);
+
+    double scale = sbo / sbb;
+    double spread = std::sqrt((soo - 2 * scale * sbo + scale * scale * sbb) /
+                              (scale * scale * sbb));
+
+    CHECK(scale == Approx(1.0).epsilon(0.05));
+    CHECK(spread < 0.15);
+}
+
+TEST_CASE("wofz_weideman", "[Space_charge_2d_bassetti_erskine]")
+{
+    const auto wc = get_weideman_coeffs();
+
+    double worst = 0.0;
+
+    for (int i = -40; i <= 40; ++i) {
+        for (int j = -30; j <= 20; ++j) {
+            double ax = std::pow(10.0, std::abs(i) / 10.0 - 2);
+            double x = i < 0 ? -ax : ax;
+            double y = std::pow(10.0, j / 10.0);
+
+            double wr = 0.0, wi = 0.0;
+            wofz_weideman(x, y, wc, wr, wi);
+
+            auto w = wofz({x, y});
+            double e = std::abs(std::complex<double>(wr, wi) - w);
+
+            worst = std::max(worst, e / std::abs(w));
+        }
+    }
+
+    // see complex_error_function.h
+    CHECK(worst < 1e-12);
+}
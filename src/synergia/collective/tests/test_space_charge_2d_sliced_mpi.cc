@@ -0,0 +1,191 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/collective/space_charge_2d_sliced.h"
+#include "synergia/collective/tests/rod_bunch.h"
+#include "synergia/foundation/math_constants.h"
+
+TEST_CASE("local_slices", "[Space_charge_2d_sliced]")
+{
+    // every slice goes to exactly one rank, in contiguous blocks
+    for (int size = 1; size < 9; ++size) {
+        int next = 0;
+
+        for (int r = 0; r < size; ++r) {
+            auto s = Space_charge_2d_sliced::get_local_slices(13, r, size);
+            CHECK(s.first == next);
+            CHECK(s.second >= 13 / size);
+            CHECK(s.second <= 13 / size + 1);
+            next += s.second;
+        }
+
+        CHECK(next == 13);
+    }
+
+    // more ranks than slices
+    auto s = Space_charge_2d_sliced::get_local_slices(2, 3, 4);
+    CHECK(s.second == 0);
+}
+
+TEST_CASE("rod_kick", "[Space_charge_2d_sliced]")
+{
+    const int gridx = 64;
+    const int gridy = 64;
+    const int gridz = 16;
+
+    const double step_length = 0.1;
+
+    auto bsim = Bunch_simulator::create_single_bunch_simulator(
+        Reference_particle(charge, Four_momentum(mass, mass * rod_lowgamma)),
+        240000,
+        rod_real_num);
+
+    auto& bunch = bsim.get_bunch();
+    auto const& ref = bunch.get_reference_particle();
+
+    const double beta = ref.get_beta();
+    const double gamma = ref.get_gamma();
+    const double betagamma = beta * gamma;
+    const double time_step = step_length / (beta * pconstants::c);
+
+    // every rank holds a uniform rod of rings of 8 particles, with
+    // the probe in front
+    auto parts = bunch.get_host_particles();
+    const int num = bunch.get_local_num();
+    const int num_rings = (num - 1 + 7) / 8;
+
+    for (int j = 1; j < num; ++j) {
+        int ring = (j - 1) / 8;
+        double phi = 2.0 * mconstants::pi * ((j - 1) % 8) / 8.0;
+        double z = -rod_length / 2.0 + rod_length * (ring + 0.5) / num_rings;
+
+        parts(j, Bunch::x) = rod_radius * std::cos(phi);
+        parts(j, Bunch::xp) = 0.0;
+        parts(j, Bunch::y) = rod_radius * std::sin(phi);
+        parts(j, Bunch::yp) = 0.0;
+        parts(j, Bunch::cdt) = z / beta;
+        parts(j, Bunch::dpop) = 0.0;
+    }
+
+    const double probe = 80 * rod_radius;
+
+    parts(0, Bunch::x) = probe;
+    parts(0, Bunch::xp) = 0.0;
+    parts(0, Bunch::y) = 0.0;
+    parts(0, Bunch::yp) = 0.0;
+    parts(0, Bunch::cdt) = 0.0;
+    parts(0, Bunch::dpop) = 0.0;
+
+    bunch.checkin_particles();
+
+    auto sc_ops = Space_charge_2d_sliced_options(gridx, gridy, gridz);
+    sc_ops.set_fixed_domain({0.0, 0.0, 0.0},
+                            {probe * 4, probe * 4, rod_length / beta});
+
+    auto sc = Space_charge_2d_sliced(sc_ops);
+
+    auto logger = Logger(0, LoggerV::INFO_STEP);
+    sc.apply(bsim, time_step, logger);
+
+    bunch.checkout_particles();
+
+    // see test_space_charge_3d_open_hockney_mpi.cc for the rod kick
+    double N = bunch.get_real_num();
+    double computed_dpop =
+        ((2.0 * N * pconstants::rp) /
+         (rod_length * betagamma * betagamma * gamma)) *
+        (step_length / probe);
+
+    CHECK(parts(0, Bunch::xp) == Approx(computed_dpop).epsilon(0.02));
+    CHECK(std::abs(parts(0, Bunch::yp)) < 1e-3 * computed_dpop);
+}
+
+TEST_CASE("rod_kick_two_radii", "[Space_charge_2d_sliced]")
+{
+    const int gridx = 64;
+    const int gridy = 64;
+    const int gridz = 16;
+
+    const double step_length = 0.1;
+
+    auto bsim = Bunch_simulator::create_single_bunch_simulator(
+        Reference_particle(charge, Four_momentum(mass, mass * rod_lowgamma)),
+        240000,
+        rod_real_num);
+
+    auto& bunch = bsim.get_bunch();
+    auto const& ref = bunch.get_reference_particle();
+
+    const double beta = ref.get_beta();
+    const double gamma = ref.get_gamma();
+    const double betagamma = beta * gamma;
+    const double time_step = step_length / (beta * pconstants::c);
+
+    // every rank holds a rod of uniform discs with the same line density
+    // on both halves, thin at the front and wide at the back. The two
+    // probes are between the two radii
+    const double r_front = rod_radius;
+    const double r_back = 16 * rod_radius;
+    const double probe = 8 * rod_radius;
+
+    auto parts = bunch.get_host_particles();
+    const int num = bunch.get_local_num();
+
+    const int num_half = (num - 2) / 2;
+    const int num_layers = 64;
+    const int num_disc = num_half / num_layers;
+    const double golden = mconstants::pi * (3.0 - std::sqrt(5.0));
+
+    for (int j = 2; j < num; ++j) {
+        int half = (j - 2) % 2;
+        int i = (j - 2) / 2;
+        int layer = (i / num_disc) % num_layers;
+        int k = i % num_disc;
+
+        double r = (half ? r_back : r_front) * std::sqrt((k + 0.5) / num_disc);
+        double phi = golden * k;
+        double z = rod_length / 2.0 * (layer + 0.5) / num_layers;
+
+        parts(j, Bunch::x) = r * std::cos(phi);
+        parts(j, Bunch::xp) = 0.0;
+        parts(j, Bunch::y) = r * std::sin(phi);
+        parts(j, Bunch::yp) = 0.0;
+        parts(j, Bunch::cdt) = (half ? -z : z) / beta;
+        parts(j, Bunch::dpop) = 0.0;
+    }
+
+    for (int j = 0; j < 2; ++j) {
+        parts(j, Bunch::x) = probe;
+        parts(j, Bunch::xp) = 0.0;
+        parts(j, Bunch::y) = 0.0;
+        parts(j, Bunch::yp) = 0.0;
+        parts(j, Bunch::cdt) = (j ? -rod_length : rod_length) / 4.0 / beta;
+        parts(j, Bunch::dpop) = 0.0;
+    }
+
+    bunch.checkin_particles();
+
+    auto sc_ops = Space_charge_2d_sliced_options(gridx, gridy, gridz);
+    sc_ops.set_fixed_domain({0.0, 0.0, 0.0},
+                            {r_back * 4, r_back * 4, rod_length / beta});
+
+    auto sc = Space_charge_2d_sliced(sc_ops);
+
+    auto logger = Logger(0, LoggerV::INFO_STEP);
+    sc.apply(bsim, time_step, logger);
+
+    bunch.checkout_particles();
+
+    // line charge outside of the thin discs
+    double N = bunch.get_real_num();
+    double computed_dpop =
+        ((2.0 * N * pconstants::rp) /
+         (rod_length * betagamma * betagamma * gamma)) *
+        (step_length / probe);
+
+    CHECK(parts(0, Bunch::xp) == Approx(computed_dpop).epsilon(0.02));
+
+    // inside of the wide discs only the charge within the probe radius
+    // pulls, (probe / r_back)^2 of it
+    double inside = (probe / r_back) * (probe / r_back);
+    CHECK(parts(1, Bunch::xp) == Approx(inside * computed_dpop).epsilon(0.05));
+}
@@ -1,8 +1,96 @@
 #include "synergia/collective/space_charge_3d_fd.h"
+#include "synergia/collective/space_charge_3d_fd_utils.h"
+#include "synergia/collective/space_charge_3d_mg.h"
 #include "synergia/foundation/physical_constants.h"
 
 #include "synergia/utils/catch.hpp"
 
+#include <cmath>
+
+namespace {
+    using kicks_t = std::vector<std::array<double, 3>>;
+
+    // a uniform box of charge of n^3 particles with sides w centred at c,
+    // one particle in the middle of each of its n^3 cells
+    Bunch_simulator
+    box_bunch(int n, double w, std::array<double, 3> const& c)
+    {
+        Four_momentum fm(100.0, 125.0);
+        Reference_particle ref(pconstants::proton_charge, fm);
+
+        auto bsim = Bunch_simulator::create_single_bunch_simulator(
+            ref, n * n * n, 1.0e11, Commxx());
+
+        auto& bunch = bsim.get_bunch();
+        bunch.checkout_particles();
+        auto parts = bunch.get_host_particles();
+
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                for (int k = 0; k < n; ++k) {
+                    int p = (i * n + j) * n + k;
+
+                    parts(p, Bunch::x) = c[0] + w * ((i + 0.5) / n - 0.5);
+                    parts(p, Bunch::y) = c[1] + w * ((j + 0.5) / n - 0.5);
+                    parts(p, Bunch::cdt) = c[2] + w * ((k + 0.5) / n - 0.5);
+
+                    parts(p, Bunch::xp) = 0.0;
+                    parts(p, Bunch::yp) = 0.0;
+                    parts(p, Bunch::dpop) = 0.0;
+                }
+            }
+        }
+
+        bunch.checkin_particles();
+        return bsim;
+    }
+
+    // xp, yp and dpop of the particles after one kick of a
+    // Space_charge_3d_fd or Space_charge_3d_mg
+    template <class SC>
+    kicks_t
+    apply_kicks(Bunch_simulator& bsim, Space_charge_3d_fd_options const& ops)
+    {
+        auto simlogger = Logger(0, LoggerV::INFO_STEP);
+
+        auto sc = SC(ops);
+        sc.apply(bsim, 1e-6, simlogger);
+
+        auto& bunch = bsim.get_bunch();
+        bunch.checkout_particles();
+        auto parts = bunch.get_host_particles();
+
+        kicks_t kicks(bunch.get_local_num());
+        for (int p = 0; p < bunch.get_local_num(); ++p)
+            kicks[p] = {parts(p, Bunch::xp),
+                        parts(p, Bunch::yp),
+                        parts(p, Bunch::dpop)};
+
+        return kicks;
+    }
+
+    // largest difference of the kicks relative to the largest reference
+    // kick
+    double
+    max_rel_diff(kicks_t const& kicks, kicks_t const& ref)
+    {
+        REQUIRE(kicks.size() == ref.size());
+
+        double dmax = 0.0;
+        double kmax = 0.0;
+
+        for (size_t p = 0; p < ref.size(); ++p) {
+            for (int i = 0; i < 3; ++i) {
+                dmax = std::max(dmax, std::abs(kicks[p][i] - ref[p][i]));
+                kmax = std::max(kmax, std::abs(ref[p][i]));
+            }
+        }
+
+        REQUIRE(kmax > 0.0);
+        return dmax / kmax;
+    }
+}
+
 TEST_CASE("PointCharge", "[PointCharge]")
 {
     PetscErrorCode ierr;
@@ -78,3 +166,81 @@ TEST_CASE("PointCharge", "[PointCharge]")
         }
     }
 }
+
+TEST_CASE("MultigridMatchesPetsc", "[Space_charge_3d_fd]")
+{
+    /* scope to prevent deallocate after finalize errors for Kokkos views! */
+    {
+        // both backends solve the same discrete system
+        auto ops = Space_charge_3d_fd_options(33, 33, 33);
+        ops.comm_group_size = 1;
+        ops.set_fixed_domain({0, 0, 0}, {4, 4, 4});
+
+        auto b_petsc = box_bunch(8, 1.0, {0.3, -0.2, 0.1});
+        auto k_petsc = apply_kicks<Space_charge_3d_fd>(b_petsc, ops);
+
+        ops.solver = fd_solver_t::multigrid;
+
+        auto b_mg = box_bunch(8, 1.0, {0.3, -0.2, 0.1});
+        auto k_mg = apply_kicks<Space_charge_3d_mg>(b_mg, ops);
+
+        CHECK(max_rel_diff(k_mg, k_petsc) < 1e-3);
+    }
+}
+
+TEST_CASE("StencilMatchesAssembled", "[Space_charge_3d_fd]")
+{
+    /* scope to prevent deallocate after finalize errors for Kokkos views! */
+    {
+        LocalCtx lctx;
+        SubcommCtx sctx;
+        GlobalCtx gctx;
+
+        sctx.solversubcomm = PETSC_COMM_WORLD;
+
+        gctx.nsize_x = 9;
+        gctx.nsize_y = 8;
+        gctx.nsize_z = 11;
+        gctx.nsize = gctx.nsize_x * gctx.nsize_y * gctx.nsize_z;
+
+        // cells of different sizes along the three axes
+        gctx.Lx = 4.0;
+        gctx.Ly = 3.0;
+        gctx.Lz = 5.0;
+
+        REQUIRE(init_subcomm_mat(lctx, sctx, gctx) == 0);
+        REQUIRE(compute_mat(lctx, sctx, gctx) == 0);
+
+        PetscInt m, n, mp, np;
+        REQUIRE(MatGetLocalSize(sctx.A, &m, &n) == 0);
+        REQUIRE(MatGetLocalSize(sctx.P, &mp, &np) == 0);
+        CHECK(mp == m);
+        CHECK(np == n);
+
+        Vec x, ya, yp;
+        REQUIRE(DMCreateGlobalVector(sctx.da, &x) == 0);
+        REQUIRE(VecDuplicate(x, &ya) == 0);
+        REQUIRE(VecDuplicate(x, &yp) == 0);
+        REQUIRE(VecSetRandom(x, NULL) == 0);
+
+        REQUIRE(MatMult(sctx.A, x, ya) == 0);
+        REQUIRE(MatMult(sctx.P, x, yp) == 0);
+
+        PetscReal norm, diff;
+        REQUIRE(VecNorm(yp, NORM_INFINITY, &norm) == 0);
+        REQUIRE(VecAXPY(ya, -1.0, yp) == 0);
+        REQUIRE(VecNorm(ya, NORM_INFINITY, &diff) == 0);
+
+        CHECK(norm > 0.0);
+        CHECK(diff <= 1e-12 * norm);
+
+        REQUIRE(VecDestroy(&x) == 0);
+        REQUIRE(VecDestroy(&ya) == 0);
+        REQUIRE(VecDestroy(&yp) == 0);
+
+        REQUIRE(MatDestroy(&sctx.A) == 0);
+        REQUIRE(MatDestroy(&sctx.P) == 0);
+        REQUIRE(KSPDestroy(&sctx.ksp) == 0);
+        REQUIRE(DMDestroy(&sctx.da) == 0);
+    }
+}
@@ -0,0 +1,114 @@
+#include "synergia/collective/space_charge_3d_fd.h"
+#include "synergia/foundation/physical_constants.h"
+
+#include "synergia/utils/catch.hpp"
+
+#include <cmath>
+
+namespace {
+    using kicks_t = std::vector<std::array<double, 3>>;
+
+    // a uniform box of charge of n^3 particles with sides w centred at c,
+    // one particle in the middle of each of its n^3 cells
+    Bunch_simulator
+    box_bunch(int n, double w, std::array<double, 3> const& c)
+    {
+        Four_momentum fm(100.0, 125.0);
+        Reference_particle ref(pconstants::proton_charge, fm);
+
+        auto bsim = Bunch_simulator::create_single_bunch_simulator(
+            ref, n * n * n, 1.0e11, Commxx());
+
+        auto& bunch = bsim.get_bunch();
+        bunch.checkout_particles();
+        auto parts = bunch.get_host_particles();
+
+        for (int p = 0; p < bunch.get_local_num(); ++p) {
+            int id = parts(p, Bunch::id);
+
+            int i = id / (n * n);
+            int j = (id / n) % n;
+            int k = id % n;
+
+            parts(p, Bunch::x) = c[0] + w * ((i + 0.5) / n - 0.5);
+            parts(p, Bunch::y) = c[1] + w * ((j + 0.5) / n - 0.5);
+            parts(p, Bunch::cdt) = c[2] + w * ((k + 0.5) / n - 0.5);
+
+            parts(p, Bunch::xp) = 0.0;
+            parts(p, Bunch::yp) = 0.0;
+            parts(p, Bunch::dpop) = 0.0;
+        }
+
+        bunch.checkin_particles();
+        return bsim;
+    }
+
+    // xp, yp and dpop of the local particles after one kick
+    kicks_t
+    apply_kicks(Space_charge_3d_fd_options const& ops)
+    {
+        auto simlogger = Logger(0, LoggerV::INFO_STEP);
+
+        // off the centre of the grid, so that a wrong ordering of the
+        // grid points shows in the kicks
+        auto bsim = box_bunch(8, 1.0, {0.3, -0.2, 0.1});
+
+        auto sc = Space_charge_3d_fd(ops);
+        sc.apply(bsim, 1e-6, simlogger);
+
+        auto& bunch = bsim.get_bunch();
+        bunch.checkout_particles();
+        auto parts = bunch.get_host_particles();
+
+        kicks_t kicks(bunch.get_local_num());
+        for (int p = 0; p < bunch.get_local_num(); ++p)
+            kicks[p] = {parts(p, Bunch::xp),
+                        parts(p, Bunch::yp),
+                        parts(p, Bunch::dpop)};
+
+        return kicks;
+    }
+
+    // largest difference of the kicks over all ranks, relative to the
+    // largest reference kick
+    double
+    max_rel_diff(kicks_t const& kicks, kicks_t const& ref)
+    {
+        REQUIRE(kicks.size() == ref.size());
+
+        double d[2] = {0.0, 0.0};
+
+        for (size_t p = 0; p < ref.size(); ++p) {
+            for (int i = 0; i < 3; ++i) {
+                d[0] = std::max(d[0], std::abs(kicks[p][i] - ref[p][i]));
+                d[1] = std::max(d[1], std::abs(ref[p][i]));
+            }
+        }
+
+        MPI_Allreduce(MPI_IN_PLACE, d, 2, MPI_DOUBLE, MPI_MAX, Commxx());
+
+        REQUIRE(d[1] > 0.0);
+        return d[0] / d[1];
+    }
+}
+
+TEST_CASE("SubcommsMatchSingleRank", "[Space_charge_3d_fd]")
+{
+    /* scope to prevent deallocate after finalize errors for Kokkos views! */
+    {
+        const int size = Commxx().size();
+
+        auto ops = Space_charge_3d_fd_options(33, 33, 33);
+        ops.set_fixed_domain({0, 0, 0}, {4, 4, 4});
+
+        // every rank solves the whole grid on its own
+        ops.comm_group_size = 1;
+        auto k_ref = apply_kicks(ops);
+
+        // the grid is decomposed over the ranks of each subcomm
+        for (int group : {2, size}) {
+            ops.comm_group_size = group;
+            CHECK(max_rel_diff(apply_kicks(ops), k_ref) < 1e-3);
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include "synergia/utils/catch.hpp"
 
+#include "synergia/collective/frozen_fields.h"
 #include "synergia/collective/space_charge_3d_open_hockney.h"
 #include "synergia/collective/tests/rod_bunch.h"
 
@@ -232,3 +233,181 @@ TEST_CASE("real_apply_full_highgamma", "[Rod_bunch]")
         }
     }
 }
+
+namespace {
+    // kick of the probe particle of the low gamma rod
+    double
+    rod_probe_kick(int gridx,
+                   int gridy,
+                   int gridz,
+                   green_fn_t green_fn,
+                   bool single_precision = false)
+    {
+        auto simlogger = Logger(0, LoggerV::INFO_STEP);
+
+        const double step_length = 0.1;
+        const double bunchlen = 0.1;
+
+        Rod_bunch_fixture_lowgamma fixture;
+
+        auto& bunch = fixture.bsim.get_bunch();
+        auto parts = bunch.get_host_particles();
+        const double beta = bunch.get_reference_particle().get_beta();
+
+        auto sc_ops = Space_charge_3d_open_hockney_options(gridx, gridy, gridz);
+        sc_ops.comm_group_size = 1;
+        sc_ops.green_fn = green_fn;
+        sc_ops.single_precision = single_precision;
+
+        std::array<double, 3> offset = {0, 0, 0};
+        std::array<double, 3> size = {
+            parts(0, 0) * 4, parts(0, 0) * 4, bunchlen / beta};
+        sc_ops.set_fixed_domain(offset, size);
+
+        auto sc = Space_charge_3d_open_hockney(sc_ops);
+        sc.apply(fixture.bsim, step_length / (beta * pconstants::c), simlogger);
+
+        bunch.checkout_particles();
+        return parts(0, Bunch::xp);
+    }
+}
+
+TEST_CASE("real_apply_igf_coarse_grid", "[Rod_bunch]")
+{
+    auto logger = Logger(0, LoggerV::DEBUG);
+
+    // the cells of the coarse grid are ~1000 times longer than wide
+    double kick_linear = rod_probe_kick(256, 256, 64, green_fn_t::linear);
+    double kick_igf = rod_probe_kick(32, 32, 64, green_fn_t::igf);
+
+    Rod_bunch_fixture_lowgamma fixture;
+
+    auto const& ref = fixture.bsim.get_bunch().get_reference_particle();
+    auto parts = fixture.bsim.get_bunch().get_host_particles();
+
+    const double L = 0.1;
+    const double N = fixture.bsim.get_bunch().get_real_num();
+    const double betagamma = ref.get_beta() * ref.get_gamma();
+
+    double computed_dpop =
+        ((2.0 * N * pconstants::rp) /
+         (L * betagamma * betagamma * ref.get_gamma())) *
+        (0.1 / parts(0, Bunch::x));
+
+    logger << "computed dpop: " << computed_dpop << '\n';
+    logger << "linear 256x256x64 dpop: " << kick_linear << '\n';
+    logger << "igf 32x32x64 dpop: " << kick_igf << '\n';
+
+    CHECK(kick_igf == Approx(computed_dpop).margin(.01));
+    CHECK(kick_igf == Approx(kick_linear).epsilon(0.02));
+}
+
+TEST_CASE("real_apply_single_precision", "[Rod_bunch]")
+{
+    auto logger = Logger(0, LoggerV::DEBUG);
+
+    double kick_double = rod_probe_kick(64, 64, 64, green_fn_t::linear);
+    double kick_single = rod_probe_kick(64, 64, 64, green_fn_t::linear, true);
+
+    // accuracy of the single precision fields against double
+    double rel = std::abs(kick_single - kick_double) / std::abs(kick_double);
+
+    logger << "double dpop: " << kick_double << '\n';
+    logger << "single dpop: " << kick_single << '\n';
+    logger << "relative difference: " << rel << '\n';
+
+    CHECK(rel < 1.0e-5);
+}
+
+namespace {
+    std::vector<double>
+    take_momenta(Bunch& bunch)
+    {
+        bunch.checkout_particles();
+        auto parts = bunch.get_host_particles();
+
+        std::vector<double> m;
+        for (int p = 0; p < bunch.get_local_num(); ++p) {
+            m.push_back(parts(p, Bunch::xp));
+            m.push_back(parts(p, Bunch::yp));
+            m.push_back(parts(p, Bunch::dpop));
+
+            parts(p, Bunch::xp) = 0.0;
+            parts(p, Bunch::yp) = 0.0;
+            parts(p, Bunch::dpop) = 0.0;
+        }
+
+        bunch.checkin_particles();
+        return m;
+    }
+}
+
+TEST_CASE("real_apply_frozen", "[Rod_bunch]")
+{
+    auto simlogger = Logger(0, LoggerV::INFO_STEP);
+
+    const double step_length = 0.1;
+    const double bunchlen = 0.1;
+
+    Rod_bunch_fixture_lowgamma fixture;
+
+    auto& bunch = fixture.bsim.get_bunch();
+    auto parts = bunch.get_host_particles();
+    const double beta = bunch.get_reference_particle().get_beta();
+    const double time_step = step_length / (beta * pconstants::c);
+
+    auto sc_ops = Space_charge_3d_open_hockney_options(64, 64, 64);
+    sc_ops.comm_group_size = 1;
+    sc_ops.frozen_turns = 4;
+    sc_ops.frozen_tolerance = 0.05;
+
+    std::array<double, 3> offset = {0, 0, 0};
+    std::array<double, 3> size = {
+        parts(0, 0) * 4, parts(0, 0) * 4, bunchlen / beta};
+    sc_ops.set_fixed_domain(offset, size);
+
+    // fresh solve, keeps the fields of the bunch
+    Space_charge_3d_open_hockney(sc_ops).apply(
+        fixture.bsim, time_step, simlogger);
+    auto fresh = take_momenta(bunch);
+
+    auto& ff = Frozen_fields::of(fixture.bsim.id(), bunch);
+    REQUIRE(ff.size() == 1);
+
+    // a new operator, as on every step, kicks with the frozen fields
+    Space_charge_3d_open_hockney(sc_ops).apply(
+        fixture.bsim, time_step, simlogger);
+    auto frozen = take_momenta(bunch);
+
+    REQUIRE(frozen.size() == fresh.size());
+    for (size_t i = 0; i < fresh.size(); ++i)
+        CHECK(frozen[i] == Approx(fresh[i]).epsilon(1e-12).margin(1e-30));
+
+    // the kick really comes from the frozen entry, not a copy of it
+    auto key = Space_charge_3d_open_hockney(sc_ops).get_frozen_key(bunch);
+    auto e = ff.find(key);
+    REQUIRE(e);
+    REQUIRE(!e->single_precision);
+
+    for (auto& f : e->fields)
+        Kokkos::deep_copy(f, 0.0);
+
+    Space_charge_3d_open_hockney(sc_ops).apply(
+        fixture.bsim, time_step, simlogger);
+    for (auto m : take_momenta(bunch))
+        CHECK(m == 0.0);
+
+    // double precision fields are not used by a single precision solver
+    sc_ops.single_precision = true;
+
+    Space_charge_3d_open_hockney(sc_ops).apply(
+        fixture.bsim, time_step, simlogger);
+    auto single = take_momenta(bunch);
+
+    e = ff.find(key);
+    REQUIRE(e);
+    CHECK(e->single_precision);
+
+    for (size_t i = 0; i < fresh.size(); ++i)
+        CHECK(single[i] == Approx(fresh[i]).epsilon(1e-5).margin(1e-30));
+}
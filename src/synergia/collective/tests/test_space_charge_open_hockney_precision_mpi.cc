@@ -0,0 +1,140 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/collective/space_charge_2d_open_hockney.h"
+#include "synergia/collective/space_charge_3d_open_hockney.h"
+#include "synergia/foundation/physical_constants.h"
+
+#include <random>
+
+namespace {
+    const int total_num = 20000;
+
+    using kicks_t = std::vector<std::array<double, 3>>;
+
+    // a Gaussian bunch. The coordinates of a particle only depend on its
+    // id, so the bunch is the same for any number of ranks
+    Bunch_simulator
+    gaussian_bunch()
+    {
+        Four_momentum fm(pconstants::mp, pconstants::mp * 61.0 / 60.0);
+        Reference_particle ref(pconstants::proton_charge, fm);
+
+        auto bsim = Bunch_simulator::create_single_bunch_simulator(
+            ref, total_num, 5.0e10, Commxx());
+
+        std::mt19937 gen(12345);
+        std::normal_distribution<double> gauss;
+
+        std::vector<std::array<double, 3>> coords(total_num);
+        for (auto& c : coords)
+            c = {2e-3 * gauss(gen), 1e-3 * gauss(gen), 0.05 * gauss(gen)};
+
+        auto& bunch = bsim.get_bunch();
+        bunch.checkout_particles();
+        auto parts = bunch.get_host_particles();
+
+        for (int p = 0; p < bunch.get_local_num(); ++p) {
+            auto const& c = coords[parts(p, Bunch::id)];
+
+            parts(p, Bunch::x) = c[0];
+            parts(p, Bunch::xp) = 0.0;
+            parts(p, Bunch::y) = c[1];
+            parts(p, Bunch::yp) = 0.0;
+            parts(p, Bunch::cdt) = c[2];
+            parts(p, Bunch::dpop) = 0.0;
+        }
+
+        bunch.checkin_particles();
+        return bsim;
+    }
+
+    // xp, yp and dpop of the local particles after one step of op
+    kicks_t
+    apply_kicks(Collective_operator& op)
+    {
+        auto logger = Logger(0, LoggerV::INFO_STEP);
+
+        auto bsim = gaussian_bunch();
+        auto& bunch = bsim.get_bunch();
+
+        double beta = bunch.get_reference_particle().get_beta();
+        op.apply(bsim, 0.1 / (beta * pconstants::c), logger);
+
+        bunch.checkout_particles();
+        auto parts = bunch.get_host_particles();
+
+        kicks_t k(bunch.get_local_num());
+        for (int p = 0; p < bunch.get_local_num(); ++p)
+            k[p] = {parts(p, Bunch::xp),
+                    parts(p, Bunch::yp),
+                    parts(p, Bunch::dpop)};
+
+        return k;
+    }
+
+    // largest difference of the kicks over all ranks, relative to the
+    // largest double precision kick
+    double
+    max_rel_diff(kicks_t const& single, kicks_t const& dbl, int ncoords)
+    {
+        REQUIRE(single.size() == dbl.size());
+
+        double d[2] = {0.0, 0.0};
+
+        for (size_t p = 0; p < dbl.size(); ++p) {
+            for (int i = 0; i < ncoords; ++i) {
+                d[0] = std::max(d[0], std::abs(single[p][i] - dbl[p][i]));
+                d[1] = std::max(d[1], std::abs(dbl[p][i]));
+            }
+        }
+
+        MPI_Allreduce(MPI_IN_PLACE, d, 2, MPI_DOUBLE, MPI_MAX, Commxx());
+
+        REQUIRE(d[1] > 0.0);
+        return d[0] / d[1];
+    }
+}
+
+TEST_CASE("single_precision_3d", "[Space_charge_3d_open_hockney]")
+{
+    const int size = Commxx().size();
+
+    // one solver per rank, and one solver over all the ranks, so that
+    // the single precision reductions of the charge density and of the
+    // fields both go over several ranks
+    for (int group : {1, size}) {
+        auto ops = Space_charge_3d_open_hockney_options(32, 32, 32);
+        ops.comm_group_size = group;
+
+        auto sc_d = Space_charge_3d_open_hockney(ops);
+        auto k_d = apply_kicks(sc_d);
+
+        ops.single_precision = true;
+
+        auto sc_s = Space_charge_3d_open_hockney(ops);
+        auto k_s = apply_kicks(sc_s);
+
+        CHECK(max_rel_diff(k_s, k_d, 3) < 1e-5);
+    }
+}
+
+TEST_CASE("single_precision_2d", "[Space_charge_2d_open_hockney]")
+{
+    const int size = Commxx().size();
+
+    for (int group : {1, size}) {
+        auto ops = Space_charge_2d_open_hockney_options(64, 64, 32);
+        ops.comm_group_size = group;
+
+        auto sc_d = Space_charge_2d_open_hockney(ops);
+        auto k_d = apply_kicks(sc_d);
+
+        ops.single_precision = true;
+
+        auto sc_s = Space_charge_2d_open_hockney(ops);
+        auto k_s = apply_kicks(sc_s);
+
+        // transverse kicks only
+        CHECK(max_rel_diff(k_s, k_d, 2) < 1e-5);
+    }
+}
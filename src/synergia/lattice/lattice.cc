@@ -47,6 +47,7 @@ Lattice::Lattice(Lattice const& o)
     , elements(o.elements)
     , updated(o.updated)
     , tree(o.tree)
+    , index(o.index)
 {
     for (auto& e : elements)
         e.set_lattice(*this);
@@ -58,6 +59,7 @@ Lattice::Lattice(Lattice&& o) noexcept
     , elements(std::move(o.elements))
     , updated(std::move(o.updated))
     , tree(std::move(o.tree))
+    , index(std::move(o.index))
 {
     for (auto& e : elements)
         e.set_lattice(*this);
@@ -71,6 +73,7 @@ Lattice::operator=(Lattice const& o)
     elements = o.elements;
     updated = o.updated;
     tree = o.tree;
+    index = o.index;
 
     for (auto& e : elements)
         e.set_lattice(*this);
@@ -148,6 +151,51 @@ Lattice::append(Lattice_element const& element)
     elements.push_back(Lattice_element_processor::process(element));
     elements.back().set_lattice(*this);
     updated.structure = true;
+
+    if (index.valid) {
+        auto const& e = elements.back();
+        int idx = elements.size() - 1;
+
+        index.names[e.get_name()].push_back(idx);
+        index.types[e.get_type()].push_back(idx);
+    }
+}
+
+void
+Lattice::build_index() const
+{
+    if (index.valid) return;
+
+    index = element_index_t();
+
+    int idx = 0;
+    for (auto const& e : elements) {
+        index.names[e.get_name()].push_back(idx);
+        index.types[e.get_type()].push_back(idx);
+        ++idx;
+    }
+
+    index.valid = true;
+}
+
+std::vector<int> const&
+Lattice::get_element_indices(std::string const& name) const
+{
+    static const std::vector<int> none;
+
+    build_index();
+    auto it = index.names.find(name);
+    return it == index.names.end() ? none : it->second;
+}
+
+std::vector<int> const&
+Lattice::get_element_indices(element_type type) const
+{
+    static const std::vector<int> none;
+
+    build_index();
+    auto it = index.types.find(type);
+    return it == index.types.end() ? none : it->second;
 }
 
 void
@@ -172,15 +220,58 @@ Lattice::set_all_string_attribute(std::string const& name,
     updated.element = true;
 }
 
-std::list<Lattice_element> const&
+void
+Lattice::set_all_double_attribute(element_type type,
+                                  std::string const& name,
+                                  double value,
+                                  bool increment_revision)
+{
+    for (int idx : get_element_indices(type))
+        elements[idx].set_double_attribute(name, value, increment_revision);
+
+    updated.element = true;
+}
+
+int
+Lattice::set_element_double_attribute(std::string const& element_name,
+                                      std::string const& name,
+                                      double value,
+                                      bool increment_revision)
+{
+    auto const& indices = get_element_indices(element_name);
+
+    for (int idx : indices)
+        elements[idx].set_double_attribute(name, value, increment_revision);
+
+    if (indices.size()) updated.element = true;
+    return indices.size();
+}
+
+int
+Lattice::set_element_string_attribute(std::string const& element_name,
+                                      std::string const& name,
+                                      std::string const& value,
+                                      bool increment_revision)
+{
+    auto const& indices = get_element_indices(element_name);
+
+    for (int idx : indices)
+        elements[idx].set_string_attribute(name, value, increment_revision);
+
+    if (indices.size()) updated.element = true;
+    return indices.size();
+}
+
+Lattice_elements const&
 Lattice::get_elements() const
 {
     return elements;
 }
 
-std::list<Lattice_element>&
+Lattice_elements&
 Lattice::get_elements()
 {
+    index.valid = false;
     return elements;
 }
 
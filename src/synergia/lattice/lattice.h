@@ -1,10 +1,12 @@
 #ifndef LATTICE_H_
 #define LATTICE_H_
 
-#include <list>
-#include <string>
+#include <deque>
 #include <optional>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "synergia/foundation/reference_particle.h"
 #include "synergia/lattice/lattice_element.h"
@@ -12,7 +14,11 @@
 
 #include "synergia/utils/logger.h"
 
-#include <cereal/types/list.hpp>
+#include <cereal/types/deque.hpp>
+
+/// Element storage of a Lattice. Indexed in constant time, and the
+/// references to the elements stay valid when appending to the lattice
+using Lattice_elements = std::deque<Lattice_element>;
 
 /// The Lattice class contains an abstract representation of an ordered
 /// set of objects of type Lattice_element.
@@ -36,7 +42,20 @@ private:
   std::string name;
 
   std::optional<Reference_particle> reference_particle;
-  std::list<Lattice_element> elements;
+  Lattice_elements elements;
+
+  // indices of the elements by name and by type, for the lookups and
+  // updates of named elements. Built on first use, extended by append()
+  // and dropped when the elements are handed out for modification
+  struct element_index_t {
+    bool valid = false;
+    std::unordered_map<std::string, std::vector<int>> names;
+    std::unordered_map<element_type, std::vector<int>> types;
+  };
+
+  mutable element_index_t index;
+
+  void build_index() const;
 
   update_flags_t updated;
 
@@ -148,10 +167,59 @@ public:
                                 std::string const& value,
                                 bool increment_revision = true);
 
-  /// Get the list of elements in the Lattice
-  std::list<Lattice_element> const& get_elements() const;
+  /// Set the value of the named double attribute on all elements of
+  /// the given type
+  void set_all_double_attribute(element_type type,
+                                std::string const& name,
+                                double value,
+                                bool increment_revision = true);
+
+  /// Set the value of the named double attribute on the elements with
+  /// the given element name. Returns the number of elements changed
+  int set_element_double_attribute(std::string const& element_name,
+                                   std::string const& name,
+                                   double value,
+                                   bool increment_revision = true);
+
+  /// Set the value of the named string attribute on the elements with
+  /// the given element name. Returns the number of elements changed
+  int set_element_string_attribute(std::string const& element_name,
+                                   std::string const& name,
+                                   std::string const& value,
+                                   bool increment_revision = true);
+
+  /// Get the elements in the Lattice
+  Lattice_elements const& get_elements() const;
+
+  /// Modifiable elements. Drops the element index, since the caller may
+  /// add or remove elements
+  Lattice_elements& get_elements();
+
+  /// Number of elements in the Lattice
+  int
+  get_num_elements() const
+  {
+    return elements.size();
+  }
+
+  /// Get the element at the index, in the order of the Lattice
+  Lattice_element const&
+  get_element(int idx) const
+  {
+    return elements.at(idx);
+  }
 
-  std::list<Lattice_element>& get_elements();
+  Lattice_element&
+  get_element(int idx)
+  {
+    return elements.at(idx);
+  }
+
+  /// Indices of the elements with the given name
+  std::vector<int> const& get_element_indices(std::string const& name) const;
+
+  /// Indices of the elements of the given type
+  std::vector<int> const& get_element_indices(element_type type) const;
 
   /// Clear the h/v tunes and chromaticity markers for all lattice elements
   void reset_all_markers();
@@ -259,6 +327,8 @@ private:
         reference_particle = reference_particle_value;
         for(auto & e : elements) 
             e.set_lattice(*this);
+
+        index = element_index_t();
     }
 
 };
@@ -0,0 +1,274 @@
+#include "synergia/lattice/lattice_cache.h"
+#include "synergia/lattice/madx_reader.h"
+#include "synergia/lattice/mx_parse.h"
+
+#include "synergia/utils/cereal.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char magic[8] = {'S', 'Y', 'N', 'L', 'A', 'T', 'C', '\0'};
+
+    // FNV-1a, good enough to tell the sources apart
+    struct fnv1a {
+        uint64_t h = 0xcbf29ce484222325ULL;
+
+        void
+        add(void const* data, size_t len)
+        {
+            auto p = static_cast<unsigned char const*>(data);
+            for (size_t i = 0; i < len; ++i) {
+                h ^= p[i];
+                h *= 0x100000001b3ULL;
+            }
+        }
+
+        void
+        add(std::string const& s)
+        {
+            uint64_t len = s.size();
+            add(&len, sizeof(len));
+            add(s.data(), s.size());
+        }
+    };
+
+    // hash of the file contents. Throws if the file cannot be read
+    uint64_t
+    hash_file(std::string const& fname)
+    {
+        std::ifstream file(fname, std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Lattice_cache: failed to open " + fname);
+
+        std::ostringstream ss;
+        ss << file.rdbuf();
+
+        fnv1a h;
+        h.add(ss.str());
+        return h.h;
+    }
+
+    template <class T>
+    void
+    write_pod(std::ostream& os, T const& v)
+    {
+        os.write(reinterpret_cast<char const*>(&v), sizeof(T));
+    }
+
+    template <class T>
+    bool
+    read_pod(std::istream& is, T& v)
+    {
+        return bool(is.read(reinterpret_cast<char*>(&v), sizeof(T)));
+    }
+
+    void
+    write_str(std::ostream& os, std::string const& s)
+    {
+        write_pod(os, (uint64_t)s.size());
+        os.write(s.data(), s.size());
+    }
+
+    bool
+    read_str(std::istream& is, std::string& s)
+    {
+        uint64_t len;
+        if (!read_pod(is, len)) return false;
+
+        s.resize(len);
+        return bool(is.read(&s[0], len));
+    }
+
+    // payload of the cache file if it is there and up to date
+    bool
+    read_cache(std::string const& path, uint64_t key, std::string& payload)
+    {
+        std::ifstream is(path, std::ios::binary);
+        if (!is.is_open()) return false;
+
+        char m[sizeof(magic)];
+        int32_t version;
+        uint64_t k;
+
+        if (!is.read(m, sizeof(m)) || !std::equal(m, m + sizeof(m), magic))
+            return false;
+        if (!read_pod(is, version) ||
+            version != Lattice_cache::format_version)
+            return false;
+        if (!read_pod(is, k) || k != key) return false;
+
+        // the called files may have changed since
+        uint32_t nsources;
+        if (!read_pod(is, nsources)) return false;
+
+        for (uint32_t i = 0; i < nsources; ++i) {
+            std::string fname;
+            uint64_t h;
+
+            if (!read_str(is, fname) || !read_pod(is, h)) return false;
+
+            try {
+                if (hash_file(fname) != h) return false;
+            }
+            catch (std::exception const&) {
+                return false;
+            }
+        }
+
+        return read_str(is, payload);
+    }
+
+    // written to a temporary first, so a reader never sees half a file
+    void
+    write_cache(std::string const& path,
+                uint64_t key,
+                std::vector<std::string> const& sources,
+                std::string const& payload)
+    {
+        fs::create_directories(fs::path(path).parent_path());
+
+        auto tmp = path + ".tmp";
+
+        {
+            std::ofstream os(tmp, std::ios::binary);
+            if (!os.is_open())
+                throw std::runtime_error("failed to create " + tmp);
+
+            os.write(magic, sizeof(magic));
+            write_pod(os, (int32_t)Lattice_cache::format_version);
+            write_pod(os, key);
+
+            write_pod(os, (uint32_t)sources.size());
+            for (auto const& src : sources) {
+                write_str(os, src);
+                write_pod(os, hash_file(src));
+            }
+
+            write_str(os, payload);
+
+            os.close();
+            if (!os) throw std::runtime_error("failed to write " + tmp);
+        }
+
+        fs::rename(tmp, path);
+    }
+}
+
+Lattice_cache::Lattice_cache(std::string const& dir) : dir(dir) {}
+
+Lattice
+Lattice_cache::get_lattice(std::string const& line_name,
+                           std::string const& filename,
+                           Commxx const& comm) const
+{
+    return load(line_name, filename, false, comm);
+}
+
+Lattice
+Lattice_cache::get_dynamic_lattice(std::string const& line_name,
+                                   std::string const& filename,
+                                   Commxx const& comm) const
+{
+    return load(line_name, filename, true, comm);
+}
+
+std::string
+Lattice_cache::compile(std::string const& line_name,
+                       std::string const& filename,
+                       bool dynamic) const
+{
+    fnv1a h;
+    h.add(&format_version, sizeof(format_version));
+    h.add(&dynamic, sizeof(dynamic));
+    h.add(line_name);
+    h.add(filename);
+
+    uint64_t key = h.h ^ hash_file(filename);
+
+    std::stringstream name;
+    name << line_name << (dynamic ? "_dyn_" : "_") << std::hex << key
+         << ".bin";
+
+    auto path = (fs::path(dir) / name.str()).string();
+
+    std::string payload;
+    if (read_cache(path, key, payload)) return payload;
+
+    // parse and resolve the sources
+    synergia::MadX mx;
+    synergia::parse_madx_file(filename, mx);
+
+    Lattice lattice = dynamic ? MadX_reader::get_dynamic_lattice(line_name, mx)
+                              : MadX_reader::get_lattice(line_name, mx);
+
+    std::ostringstream os;
+    {
+        cereal::BinaryOutputArchive ar(os);
+        ar(lattice);
+    }
+
+    payload = os.str();
+
+    // a cache that cannot be written only costs the next run a parse
+    try {
+        write_cache(path, key, mx.sources(), payload);
+    }
+    catch (std::exception const& e) {
+        Logger l(Commxx::world_rank(), LoggerV::WARNING);
+        l(LoggerV::WARNING) << "Lattice_cache: not caching " << line_name
+                            << ", " << e.what() << "\n";
+    }
+
+    return payload;
+}
+
+Lattice
+Lattice_cache::load(std::string const& line_name,
+                    std::string const& filename,
+                    bool dynamic,
+                    Commxx const& comm) const
+{
+    const int root = 0;
+
+    std::string payload;
+    std::string err;
+    int64_t len = -1;
+
+    if (comm.rank() == root) {
+        try {
+            payload = compile(line_name, filename, dynamic);
+            len = payload.size();
+        }
+        catch (std::exception const& e) {
+            err = e.what();
+        }
+    }
+
+    // the other ranks must not wait for a payload that never comes
+    MPI_Bcast(&len, 1, MPI_INT64_T, root, comm);
+
+    if (len < 0) {
+        throw std::runtime_error(
+            comm.rank() == root
+                ? err
+                : "Lattice_cache: failed to read " + line_name + " from " +
+                      filename + " on the root rank");
+    }
+
+    payload.resize(len);
+    MPI_Bcast(&payload[0], len, MPI_BYTE, root, comm);
+
+    std::istringstream is(payload);
+    cereal::BinaryInputArchive ar(is);
+
+    Lattice lattice;
+    ar(lattice);
+
+    return lattice;
+}
@@ -0,0 +1,60 @@
+#ifndef LATTICE_CACHE_H_
+#define LATTICE_CACHE_H_
+
+#include <string>
+
+#include "synergia/lattice/lattice.h"
+#include "synergia/utils/commxx.h"
+
+/// Lattice_cache keeps the lattices read from MAD-X files in a compiled,
+/// binary form. The cache file of a lattice is keyed with a hash of the
+/// main source file, the line name and the cache format version, and it
+/// also records the hashes of the files pulled in with 'call'. A cache
+/// file is only used when none of its sources has changed.
+///
+/// Only the root rank of the communicator parses the MAD-X sources or
+/// reads the cache file. The compiled lattice is broadcast to the other
+/// ranks, so a job no longer parses the same files on every rank.
+class Lattice_cache {
+public:
+  /// version of the cache file layout, bumped when the layout or the
+  /// serialized form of the Lattice changes
+  static constexpr int format_version = 1;
+
+  /// @param dir directory of the cache files, created when needed
+  explicit Lattice_cache(std::string const& dir = "lattice_cache");
+
+  /// Read the line or sequence from the MAD-X file, through the cache.
+  /// Collective over comm
+  Lattice get_lattice(std::string const& line_name,
+                      std::string const& filename,
+                      Commxx const& comm = Commxx()) const;
+
+  /// Same as get_lattice(), for a dynamic lattice. The variable tree of
+  /// a dynamic lattice is stored as MAD-X text and parsed again on load
+  Lattice get_dynamic_lattice(std::string const& line_name,
+                              std::string const& filename,
+                              Commxx const& comm = Commxx()) const;
+
+  /// Directory of the cache files
+  std::string const&
+  get_dir() const
+  {
+    return dir;
+  }
+
+private:
+  Lattice load(std::string const& line_name,
+               std::string const& filename,
+               bool dynamic,
+               Commxx const& comm) const;
+
+  // the serialized lattice, from the cache file or freshly parsed
+  std::string compile(std::string const& line_name,
+                      std::string const& filename,
+                      bool dynamic) const;
+
+  std::string dir;
+};
+
+#endif /* LATTICE_CACHE_H_ */
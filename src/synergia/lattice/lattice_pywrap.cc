@@ -8,16 +8,17 @@
 #include "synergia/lattice/lattice_element_slice.h"
 #include "synergia/lattice/lattice_element.h"
 #include "synergia/lattice/lattice.h"
+#include "synergia/lattice/lattice_cache.h"
 #include "synergia/lattice/madx_reader.h"
 #include "synergia/lattice/dynamic_lattice.h"
 
 namespace py = pybind11;
 using namespace py::literals;
 
-// convert the std::list<Lattice_element> to a python tuple object
+// convert the Lattice_elements to a python tuple object
 template <> 
-struct pybind11::detail::type_caster<std::list<Lattice_element>> 
-    : pybind11::detail::py_tuple_caster<std::list<Lattice_element>, Lattice_element> { };
+struct pybind11::detail::type_caster<Lattice_elements> 
+    : pybind11::detail::py_tuple_caster<Lattice_elements, Lattice_element> { };
 
 
 // lattice python module
@@ -354,7 +355,7 @@ PYBIND11_MODULE(lattice, m)
                 &Lattice::set_reference_particle )
 
         .def( "get_elements",
-                (std::list<Lattice_element>& (Lattice::*)())
+                (Lattice_elements& (Lattice::*)())
                 &Lattice::get_elements,
                 //py::overload_cast<>(&Lattice::get_elements),
                 py::return_value_policy::reference_internal,
@@ -398,16 +399,60 @@ PYBIND11_MODULE(lattice, m)
                 "Get the total angle in radians subtended by all elements in the lattice" )
 
         .def( "get_elements_const",
-                (std::list<Lattice_element> const& (Lattice::*)() const)&Lattice::get_elements,
+                (Lattice_elements const& (Lattice::*)() const)&Lattice::get_elements,
                 //py::overload_cast<>(&Lattice::get_elements, py::const_),
                 py::return_value_policy::reference_internal,
                 "Get the list of all lattice elements" )
 
+        .def( "get_num_elements",
+                &Lattice::get_num_elements,
+                "Get the number of elements in the lattice" )
+
+        .def( "get_element",
+                (Lattice_element& (Lattice::*)(int))&Lattice::get_element,
+                py::return_value_policy::reference_internal,
+                "Get the element at the index",
+                "idx"_a )
+
+        .def( "get_element_indices",
+                (std::vector<int> const& (Lattice::*)(std::string const&) const)
+                &Lattice::get_element_indices,
+                "Get the indices of the elements with the given name",
+                "name"_a )
+
+        .def( "get_element_indices",
+                (std::vector<int> const& (Lattice::*)(element_type) const)
+                &Lattice::get_element_indices,
+                "Get the indices of the elements of the given type",
+                "type"_a )
+
         .def( "set_all_double_attribute",
+                (void (Lattice::*)(std::string const&, double, bool))
                 &Lattice::set_all_double_attribute,
                 "Set the value of the named double attribute on all elements",
                 "name"_a, "value"_a, "increment_revision"_a = true )
 
+        .def( "set_all_double_attribute",
+                (void (Lattice::*)(element_type, std::string const&, double, bool))
+                &Lattice::set_all_double_attribute,
+                "Set the value of the named double attribute on all elements "
+                "of the given type",
+                "type"_a, "name"_a, "value"_a, "increment_revision"_a = true )
+
+        .def( "set_element_double_attribute",
+                &Lattice::set_element_double_attribute,
+                "Set the value of the named double attribute on the elements "
+                "with the given name",
+                "element_name"_a, "name"_a, "value"_a,
+                "increment_revision"_a = true )
+
+        .def( "set_element_string_attribute",
+                &Lattice::set_element_string_attribute,
+                "Set the value of the named string attribute on the elements "
+                "with the given name",
+                "element_name"_a, "name"_a, "value"_a,
+                "increment_revision"_a = true )
+
         .def( "set_all_string_attribute",
                 &Lattice::set_all_string_attribute,
                 "Set the value of the named string attribute on all elements",
@@ -478,6 +523,31 @@ PYBIND11_MODULE(lattice, m)
                 "Parse a lattice file",
                 "filename"_a )
         ;
+
+    // Lattice_cache
+    py::class_<Lattice_cache>(m, "Lattice_cache")
+        .def( py::init<std::string const&>(),
+                "Construct a compiled lattice cache in the directory",
+                "dir"_a = "lattice_cache" )
+
+        .def( "get_lattice",
+                &Lattice_cache::get_lattice,
+                "Parse and get the named lattice, through the cache",
+                "line_name"_a,
+                "filename"_a,
+                "comm"_a = Commxx() )
+
+        .def( "get_dynamic_lattice",
+                &Lattice_cache::get_dynamic_lattice,
+                "Parse and get the named dynamic lattice, through the cache",
+                "line_name"_a,
+                "filename"_a,
+                "comm"_a = Commxx() )
+
+        .def( "get_dir",
+                &Lattice_cache::get_dir,
+                "Directory of the cache files" )
+        ;
  
 }
 
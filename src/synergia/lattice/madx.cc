@@ -641,6 +641,7 @@ MadX::MadX()
   , seqs_()
   , cur_seq_(*this)
   , building_seq_(false)
+  , sources_()
 { }
 
 // lines and sequences are not copied for the moment
@@ -660,6 +661,7 @@ MadX::MadX(MadX const& o)
     , seqs_()
     , cur_seq_(*this)
     , building_seq_(false)
+    , sources_(o.sources_)
 {
     for(auto& cmd : cmd_seq_) cmd.set_parent(*this);
     for(auto& cmd : cmd_map_) cmd.second.set_parent(*this);
@@ -677,6 +679,7 @@ MadX::operator=(MadX const& o)
 
     cur_seq_.reset();
     building_seq_ = false;
+    sources_ = o.sources_;
 
     for(auto& cmd : cmd_seq_) cmd.set_parent(*this);
     for(auto& cmd : cmd_map_) cmd.second.set_parent(*this);
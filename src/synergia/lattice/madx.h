@@ -280,6 +280,11 @@ public:
   void insert_attribute(string_t const & name, mx_exprs const & value)
     { insert_variable(name, value); }
 
+  // files read into this object, the main file and the ones pulled in
+  // with 'call'. For the lattice cache to tell when the sources change
+  void insert_source(string_t const & fname) { sources_.push_back(fname); }
+  std::vector<string_t> const & sources() const { return sources_; }
+
   // export
   std::string to_madx() const;
 
@@ -301,6 +306,7 @@ private:
   sequences_m_t seqs_;
   MadX_sequence cur_seq_;       // sequence thats being built currently
   bool          building_seq_;  // currently building sequence?
+  std::vector<string_t> sources_; // files parsed
 };
 
 
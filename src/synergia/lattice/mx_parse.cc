@@ -747,5 +747,6 @@ synergia::parse_madx_file(string const& fname, MadX& mx)
 {
   string str;
   read_from_file(fname, str);
+  mx.insert_source(fname);
   return parse_madx(str, mx, fname);
 }
@@ -402,6 +402,7 @@ mx_command::execute(MadX& mx)
         string fname = std::any_cast<string>(it->value());
         mx_tree subroutine;
         parse_int_madx_file(fname, subroutine);
+        mx.insert_source(fname);
         subroutine.interpret(mx);
         return;
       }
@@ -80,6 +80,46 @@ TEST_CASE("append_fodo")
     CHECK(it->get_double_attribute("l") == Approx(drift_length).margin(tolerance));
 }
 
+TEST_CASE("element_index")
+{
+    Lattice_element f("quadrupole", "f");
+    f.set_double_attribute("l", quad_length);
+    Lattice_element o("drift", "o");
+    o.set_double_attribute("l", drift_length);
+    Lattice_element d("quadrupole", "d");
+    d.set_double_attribute("l", quad_length);
+
+    Lattice lattice(name);
+    lattice.append(f);
+    lattice.append(o);
+    lattice.append(d);
+
+    CHECK(lattice.get_num_elements() == 3);
+    CHECK(lattice.get_element(2).get_name() == "d");
+    CHECK(lattice.get_element_indices("f") == std::vector<int>{0});
+    CHECK(lattice.get_element_indices("x").empty());
+
+    // appended after the index was built
+    lattice.append(o);
+
+    CHECK(lattice.get_element_indices("o") == std::vector<int>{1, 3});
+    CHECK(lattice.get_element_indices(element_type::quadrupole) ==
+          std::vector<int>{0, 2});
+
+    CHECK(lattice.set_element_double_attribute("o", "l", 1.5) == 2);
+    CHECK(lattice.get_length() == Approx(2 * quad_length + 3.0));
+
+    lattice.set_all_double_attribute(element_type::quadrupole, "k1", 0.25);
+    CHECK(lattice.get_element(0).get_double_attribute("k1") == 0.25);
+    CHECK(lattice.get_element(1).get_double_attribute("k1", 0.0) == 0.0);
+
+    // the copy has its own elements
+    Lattice copied(lattice);
+    copied.set_element_double_attribute("f", "k1", 1.0);
+    CHECK(lattice.get_element(0).get_double_attribute("k1") == 0.25);
+    CHECK(copied.get_element(0).get_double_attribute("k1") == 1.0);
+}
+
 #if 0
 TEST_CASE(derive_internal_attributes)
 {
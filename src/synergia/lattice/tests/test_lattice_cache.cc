@@ -0,0 +1,82 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/lattice/lattice_cache.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+const std::string cache_dir = "test_lattice_cache.d";
+
+// written by the first rank only
+void
+write_file(std::string const& fname, std::string const& str, Commxx const& comm)
+{
+    if (comm.rank() == 0) {
+        std::ofstream f(fname);
+        f << str;
+    }
+
+    MPI_Barrier(comm);
+}
+
+int
+num_cache_files(Commxx const& comm)
+{
+    int n = 0;
+
+    if (comm.rank() == 0 && fs::exists(cache_dir))
+        for (auto const& e : fs::directory_iterator(cache_dir))
+            if (e.path().extension() == ".bin") ++n;
+
+    MPI_Bcast(&n, 1, MPI_INT, 0, comm);
+    return n;
+}
+
+TEST_CASE("lattice_cache")
+{
+    Commxx comm;
+
+    if (comm.rank() == 0) fs::remove_all(cache_dir);
+
+    write_file("test_lattice_cache_quads.madx",
+               "f: quadrupole, l=0.2, k1=0.5;\n"
+               "d: quadrupole, l=0.2, k1=-0.5;\n",
+               comm);
+
+    write_file("test_lattice_cache.madx",
+               "call, file=\"test_lattice_cache_quads.madx\";\n"
+               "beam, particle=proton, energy=2.0;\n"
+               "o: drift, l=1.0;\n"
+               "fodo: line=(f, o, d, o);\n",
+               comm);
+
+    Lattice_cache cache(cache_dir);
+
+    // first read compiles and writes the cache
+    auto l1 = cache.get_lattice("fodo", "test_lattice_cache.madx", comm);
+    CHECK(l1.get_num_elements() == 4);
+    CHECK(l1.get_length() == Approx(2.4));
+    CHECK(num_cache_files(comm) == 1);
+
+    // second read comes from the cache
+    auto l2 = cache.get_lattice("fodo", "test_lattice_cache.madx", comm);
+    CHECK(l2.get_num_elements() == 4);
+    CHECK(l2.get_element(0).get_double_attribute("k1") == Approx(0.5));
+    CHECK(l2.get_reference_particle().get_total_energy() ==
+          Approx(l1.get_reference_particle().get_total_energy()));
+    CHECK(num_cache_files(comm) == 1);
+
+    // a change in the called file invalidates the cache
+    write_file("test_lattice_cache_quads.madx",
+               "f: quadrupole, l=0.3, k1=0.5;\n"
+               "d: quadrupole, l=0.3, k1=-0.5;\n",
+               comm);
+
+    auto l3 = cache.get_lattice("fodo", "test_lattice_cache.madx", comm);
+    CHECK(l3.get_length() == Approx(2.6));
+
+    // unknown lines fail on all ranks
+    CHECK_THROWS(cache.get_lattice("nope", "test_lattice_cache.madx", comm));
+}
@@ -1,3 +1,4 @@
+#include <fstream>
 #include <numeric>
 #include <random>
 #include <sstream>
@@ -333,6 +334,7 @@ Bunch_simulator::Bunch_simulator(Bunch_train&& pt,
     , prop_actions()
     , prop_actions_step_end()
     , prop_actions_turn_end()
+    , ramps()
 {}
 
 int
@@ -405,6 +407,14 @@ Bunch_simulator::diag_action_element(Lattice_element const& element)
     }
 }
 
+void
+Bunch_simulator::diag_drain()
+{
+    for (auto& train : trains)
+        for (auto& bunch : train.get_bunches())
+            bunch.diag_drain();
+}
+
 void
 Bunch_simulator::diag_action_operator(Operator const& opr)
 {}
@@ -441,15 +451,31 @@ Bunch_simulator::reg_prop_action_turn_end(action_data_turn_t fun, void* data)
     prop_actions_turn_end.push_back(fun2);
 }
 
+Reference_particle const&
+Bunch_simulator::ramp_reference(Lattice const& lattice) const
+{
+    // the ramps follow the first local bunch
+    for (auto const& train : trains)
+        if (!train.get_bunches().empty())
+            return train.get_bunches()[0].get_reference_particle();
+
+    return lattice.get_reference_particle();
+}
+
 void
 Bunch_simulator::prop_action_first(Lattice& lattice)
 {
+    ramps.turn_start(lattice, curr_turn);
+
     if (prop_actions) prop_actions->first(*this, lattice);
 }
 
 void
 Bunch_simulator::prop_action_step_end(Lattice& lattice, int turn, int step)
 {
+    if (!ramps.empty())
+        ramps.step_end(lattice, turn, ramp_reference(lattice));
+
     if (prop_actions) prop_actions->step_end(*this, lattice, turn, step);
 
     for (auto const& action : prop_actions_step_end)
@@ -459,6 +485,8 @@ Bunch_simulator::prop_action_step_end(Lattice& lattice, int turn, int step)
 void
 Bunch_simulator::prop_action_turn_end(Lattice& lattice, int turn)
 {
+    ramps.turn_end(lattice, turn, ramp_reference(lattice));
+
     if (prop_actions) prop_actions->turn_end(*this, lattice, turn);
 
     for (auto const& action : prop_actions_turn_end)
@@ -476,18 +504,6 @@ Bunch_simulator::set_lattice_reference_particle(Reference_particle const& ref)
 }
 
 namespace {
-    std::vector<Bunch const*>
-    get_bunch_ptrs(std::array<Bunch_train, 2> const& trains)
-    {
-        std::vector<Bunch const*> bunches;
-
-        for (auto const& t : trains)
-            for (auto const& b : t.get_bunches())
-                bunches.push_back(&b);
-
-        return bunches;
-    }
-
     std::vector<Bunch*>
     get_bunch_ptrs(std::array<Bunch_train, 2>& trains)
     {
@@ -501,24 +517,162 @@ namespace {
     }
 }
 
+std::string Bunch_simulator::checkpoint_dir = ".";
+
+namespace {
+    // the datasets and files of a bunch in the checkpoint are named by
+    // the train and bunch index, not by rank
+    std::string
+    checkpoint_bunch_name(int train, int bunch)
+    {
+        return "train_" + std::to_string(train) + "_bunch_" +
+               std::to_string(bunch);
+    }
+}
+
 void
 Bunch_simulator::save_checkpoint_particles(std::string const& fname) const
 {
     Hdf5_file file(fname, Hdf5_file::Flag::truncate, *comm);
-    auto bunches = get_bunch_ptrs(trains);
 
-    for (int i = 0; i < bunches.size(); ++i)
-        bunches[i]->save_checkpoint_particles(file, i);
+    for (int t = 0; t < trains.size(); ++t) {
+        for (int b = 0; b < trains[t].get_num_bunches(); ++b) {
+            auto prefix = checkpoint_bunch_name(t, b);
+            int idx = get_bunch_array_idx(t, b);
+
+            if (idx == -1)
+                Bunch::skip_checkpoint_particles(file, prefix, true);
+            else
+                trains[t][idx].save_checkpoint_particles(file, prefix);
+        }
+    }
 }
 
 void
 Bunch_simulator::load_checkpoint_particles(std::string const& fname)
 {
     Hdf5_file file(fname, Hdf5_file::Flag::read_only, *comm);
-    auto bunches = get_bunch_ptrs(trains);
 
-    for (int i = 0; i < bunches.size(); ++i)
-        bunches[i]->load_checkpoint_particles(file, i);
+    // a checkpoint in the layout of before the rank independent one, on
+    // the same number of ranks
+    if (file.has_dataset("bunch_particles_particles_parts_0")) {
+        auto bunches = get_bunch_ptrs(trains);
+
+        for (int i = 0; i < bunches.size(); ++i)
+            bunches[i]->load_checkpoint_particles_legacy(file, i);
+
+        return;
+    }
+
+    for (int t = 0; t < trains.size(); ++t) {
+        for (int b = 0; b < trains[t].get_num_bunches(); ++b) {
+            auto prefix = checkpoint_bunch_name(t, b);
+            int idx = get_bunch_array_idx(t, b);
+
+            if (idx == -1)
+                Bunch::skip_checkpoint_particles(file, prefix, false);
+            else
+                trains[t][idx].load_checkpoint_particles(file, prefix);
+        }
+    }
+}
+
+void
+Bunch_simulator::dump_global_state(std::string const& dir) const
+{
+    // simulator wide part from the root rank
+    if (comm->rank() == 0) {
+        std::ofstream os(dir + "/simulator.bin", std::ios::binary);
+        cereal::BinaryOutputArchive ar(os);
+
+        ar(uuid, curr_turn, num_turns);
+
+        for (auto const& train : trains)
+            ar(train.get_num_bunches(), train.get_spacings());
+
+        ar(prop_actions, ramps);
+    }
+
+    // the bunches from their root ranks
+    for (auto const& train : trains) {
+        for (auto const& bunch : train.get_bunches()) {
+            if (bunch.get_comm().rank() != 0) continue;
+
+            auto fname = dir + "/" +
+                         checkpoint_bunch_name(train.get_index(),
+                                               bunch.get_bunch_index()) +
+                         ".bin";
+
+            std::ofstream os(fname, std::ios::binary);
+            cereal::BinaryOutputArchive ar(os);
+
+            bunch.save_shared_state(ar);
+        }
+    }
+}
+
+Bunch_simulator
+Bunch_simulator::load_global_state(std::string const& dir,
+                                   Commxx const& comm)
+{
+    std::ifstream is(dir + "/simulator.bin", std::ios::binary);
+    if (!is.good())
+        throw std::runtime_error(
+            "Bunch_simulator::load_global_state(): no simulator.bin in " +
+            dir);
+
+    cereal::BinaryInputArchive ar(is);
+
+    std::string uuid;
+    int curr_turn, num_turns;
+    ar(uuid, curr_turn, num_turns);
+
+    std::array<int, 2> num_bunches;
+    std::array<std::vector<double>, 2> spacings;
+
+    for (int t = 0; t < 2; ++t)
+        ar(num_bunches[t], spacings[t]);
+
+    // bunches are laid out on the new ranks as a newly created simulator,
+    // and start empty. The particles are filled in from the file
+    auto sim = construct(Reference_particle(),
+                         Reference_particle(),
+                         0,
+                         0,
+                         1.0,
+                         num_bunches[0],
+                         num_bunches[1],
+                         1.0,
+                         1.0,
+                         comm);
+
+    sim.uuid = uuid;
+    sim.curr_turn = curr_turn;
+    sim.num_turns = num_turns;
+
+    ar(sim.prop_actions, sim.ramps);
+
+    for (int t = 0; t < 2; ++t) {
+        sim.trains[t].get_spacings() = spacings[t];
+
+        for (auto& bunch : sim.trains[t].get_bunches()) {
+            auto fname =
+                dir + "/" + checkpoint_bunch_name(t, bunch.get_bunch_index()) +
+                ".bin";
+
+            std::ifstream bis(fname, std::ios::binary);
+            if (!bis.good())
+                throw std::runtime_error(
+                    "Bunch_simulator::load_global_state(): missing " + fname);
+
+            cereal::BinaryInputArchive bar(bis);
+            bunch.load_shared_state(bar);
+        }
+    }
+
+    // written by serialize() next to the states
+    sim.load_checkpoint_particles(dir + "/bunch_simulator.h5");
+    return sim;
 }
 
 void
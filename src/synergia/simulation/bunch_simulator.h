@@ -4,6 +4,7 @@
 #include "synergia/bunch/bunch_train.h"
 #include "synergia/lattice/lattice.h"
 #include "synergia/simulation/propagate_actions.h"
+#include "synergia/simulation/ramp.h"
 
 #include <cereal/types/utility.hpp> // std::pair
 #include <cereal/types/vector.hpp>
@@ -146,6 +147,9 @@ class Bunch_simulator {
 
     int get_bunch_array_idx(int train, int bunch) const;
 
+    // reference particle of the clock of the ramps
+    Reference_particle const& ramp_reference(Lattice const& lattice) const;
+
   public:
     Bunch_simulator(Bunch_simulator const&) = delete;
     Bunch_simulator(Bunch_simulator&&) = default;
@@ -303,6 +307,19 @@ class Bunch_simulator {
         get_bunch(train, bunch).set_diag_loss_zcut(filename);
     }
 
+    // async diagnostics writer for all local bunches, see
+    // Bunch::set_diag_async(). Call it before registering the diagnostics
+    void
+    set_diag_async(size_t queue_depth)
+    {
+        for (auto& train : trains)
+            for (auto& bunch : train.get_bunches())
+                bunch.set_diag_async(queue_depth);
+    }
+
+    // write out everything queued in the async diagnostics
+    void diag_drain();
+
 #if 0
     // diag per operator
     void reg_diag_at_operator(
@@ -332,6 +349,25 @@ class Bunch_simulator {
     void reg_prop_action_step_end(action_data_step_t fun, void* data = nullptr);
     void reg_prop_action_turn_end(action_data_turn_t fun, void* data = nullptr);
 
+    // ramp an attribute of the named elements with a table, see Ramps.
+    // The ramps are applied before the propagate actions, and are saved
+    // in the checkpoints
+    void
+    reg_ramp(std::string const& element_name,
+             std::string const& attribute,
+             Ramp_table const& table,
+             Ramps::Clock clock = Ramps::Clock::turn,
+             bool every_step = false)
+    {
+        ramps.add(element_name, attribute, table, clock, every_step);
+    }
+
+    Ramps const&
+    get_ramps() const
+    {
+        return ramps;
+    }
+
     // diag actions
     void diag_action_step_and_turn(int turn_num, int step_num);
     void diag_action_element(Lattice_element const& element);
@@ -456,7 +492,53 @@ class Bunch_simulator {
         return bs;
     }
 
+    // binary archive of the local state, for per rank checkpoints
+    void
+    dump_binary(std::ostream& os) const
+    {
+        cereal::BinaryOutputArchive ar(os);
+        ar(*this);
+    }
+
+    static Bunch_simulator
+    load_binary(std::istream& is)
+    {
+        cereal::BinaryInputArchive ar(is);
+
+        auto bs = create_empty_bunch_simulator();
+        ar(bs);
+
+        return bs;
+    }
+
+    // state of the simulator that does not depend on the number of ranks.
+    // The bunch states go to <dir>/train_<t>_bunch_<b>.bin, and the rest
+    // to <dir>/simulator.bin. load_global_state() lays the bunches out on
+    // the ranks of comm as a newly created simulator, and fills them in
+    // with the particles of the checkpoint in <dir>/bunch_simulator.h5.
+    // Diagnostics are not part of it and must be registered again
+    void dump_global_state(std::string const& dir) const;
+
+    static Bunch_simulator load_global_state(std::string const& dir,
+                                             Commxx const& comm = Commxx());
+
+    // directory of the checkpoint being saved or loaded. The particle
+    // file is placed in there next to the states
+    static void
+    set_checkpoint_dir(std::string const& dir)
+    {
+        checkpoint_dir = dir;
+    }
+
+    static std::string const&
+    get_checkpoint_dir()
+    {
+        return checkpoint_dir;
+    }
+
   private:
+    static std::string checkpoint_dir;
+
     std::string uuid;
 
     int curr_turn = 0;  // current progress in turns
@@ -478,6 +560,9 @@ class Bunch_simulator {
     std::vector<action_step_t> prop_actions_step_end;
     std::vector<action_turn_t> prop_actions_turn_end;
 
+    // element attribute ramps, persistent
+    Ramps ramps;
+
   private:
     friend class cereal::access;
 
@@ -498,6 +583,7 @@ class Bunch_simulator {
         ar(CEREAL_NVP(diags_element));
 
         ar(CEREAL_NVP(prop_actions));
+        ar(CEREAL_NVP(ramps));
 
         // save/load particles with parallel hdf5
         if (AR::is_saving::value) {
@@ -508,13 +594,13 @@ class Bunch_simulator {
             std::string particle_fname = ss.str();
             ar(CEREAL_NVP(particle_fname));
 
-            save_checkpoint_particles(particle_fname);
+            save_checkpoint_particles(checkpoint_dir + "/" + particle_fname);
         } else {
             // load particle
             std::string particle_fname;
             ar(CEREAL_NVP(particle_fname));
 
-            load_checkpoint_particles(particle_fname);
+            load_checkpoint_particles(checkpoint_dir + "/" + particle_fname);
         }
     }
 };
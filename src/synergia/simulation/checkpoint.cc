@@ -3,6 +3,14 @@
 #include "synergia/simulation/bunch_simulator.h"
 #include "synergia/simulation/propagator.h"
 
+#include "synergia/collective/frozen_fields.h"
+
+#include <filesystem>
+#include <fstream>
+#include <future>
+
+namespace fs = std::filesystem;
+
 namespace syn {
     void checkpoint_save_as_json(std::string const& prop_str,
                                  std::string const& sims_str,
@@ -12,98 +20,388 @@ namespace syn {
     std::pair<std::string, std::string> checkpoint_load_json(
         std::vector<char> const& buf,
         int rank);
+
+    void checkpoint_write_manifest(std::string const& dir,
+                                   int num_ranks,
+                                   int turn);
+
+    int checkpoint_read_manifest(std::string const& dir);
+}
+
+namespace {
+    // binary checkpoints are written to cp_dir_tmp, and renamed to
+    // cp_dir once complete. So there is always a valid checkpoint on
+    // disk, even if the job dies in the middle of a save
+    const std::string cp_dir = "cp_state";
+    const std::string cp_dir_tmp = "cp_state.tmp";
+    const std::string cp_dir_old = "cp_state.old";
+
+    std::string
+    state_file_name(int rank)
+    {
+        return "simulator_" + std::to_string(rank) + ".bin";
+    }
+
+    // staged checkpoint waiting for the background copies
+    struct staged_checkpoint_t {
+        std::future<void> copy;
+        std::shared_ptr<Commxx> comm;
+        int turn = 0;
+    };
+
+    staged_checkpoint_t staged;
+
+    // the particle file goes next to the states
+    struct checkpoint_dir_guard {
+        std::string prev;
+
+        explicit checkpoint_dir_guard(std::string const& dir)
+            : prev(Bunch_simulator::get_checkpoint_dir())
+        {
+            Bunch_simulator::set_checkpoint_dir(dir);
+        }
+
+        ~checkpoint_dir_guard() { Bunch_simulator::set_checkpoint_dir(prev); }
+    };
+
+    template <class F>
+    void
+    write_binary(std::string const& fname, F&& f)
+    {
+        std::ofstream os(fname, std::ios::binary);
+        if (!os.good())
+            throw std::runtime_error("Error at creating checkpoint file " +
+                                     fname);
+
+        f(os);
+
+        os.close();
+        if (!os)
+            throw std::runtime_error("Error at writing checkpoint file " +
+                                     fname);
+    }
+
+    std::ifstream
+    open_binary(std::string const& fname)
+    {
+        std::ifstream is(fname, std::ios::binary);
+        if (!is.good())
+            throw std::runtime_error("Error at openning checkpoint file " +
+                                     fname);
+
+        return is;
+    }
+
+    // runs f on every rank and agrees on the outcome. An error on any
+    // rank is thrown on all of them, instead of leaving the others
+    // waiting in the next collective. Also serves as a barrier
+    template <class F>
+    void
+    run_agreed(Commxx const& comm, std::string const& what, F&& f)
+    {
+        int err = 0;
+        std::string msg;
+
+        try {
+            f();
+        }
+        catch (std::exception const& e) {
+            err = 1;
+            msg = e.what();
+        }
+
+        int any_err = 0;
+        MPI_Allreduce(&err, &any_err, 1, MPI_INT, MPI_MAX, comm);
+
+        if (any_err) {
+            throw std::runtime_error(
+                what + " failed" +
+                (err ? ": " + msg : std::string(" on another rank")));
+        }
+    }
+
+    // all ranks have their state in cp_dir_tmp. Move it in place
+    void
+    commit_binary(Commxx const& comm, int turn)
+    {
+        run_agreed(comm, "checkpoint_save: commit of the checkpoint", [&] {
+            if (comm.rank() != 0) return;
+
+            syn::checkpoint_write_manifest(cp_dir_tmp, comm.size(), turn);
+
+            fs::remove_all(cp_dir_old);
+            if (fs::exists(cp_dir)) fs::rename(cp_dir, cp_dir_old);
+
+            fs::rename(cp_dir_tmp, cp_dir);
+            fs::remove_all(cp_dir_old);
+        });
+    }
+
+    void
+    checkpoint_save_json(Propagator const& prop, Bunch_simulator const& sim)
+    {
+        std::string prop_str = prop.dump();
+        std::string sim_str = sim.dump();
+
+        // collect sim_str to the root rank
+        auto const& comm = sim.get_comm();
+
+        const int root = 0;
+        const int mpi_size = comm.size();
+        const int mpi_rank = comm.rank();
+
+        int len = sim_str.size();
+        std::vector<int> lens(mpi_size, 0);
+
+        // gather string size
+        MPI_Gather(&len, 1, MPI_INT, lens.data(), 1, MPI_INT, root, comm);
+
+        // accumulate sizes
+        std::vector<int> displs(mpi_size, 0);
+        for (int i = 1; i < mpi_size; ++i)
+            displs[i] = displs[i - 1] + lens[i - 1];
+
+        // recv string buffer
+        int total_len = displs[mpi_size - 1] + lens[mpi_size - 1];
+        std::string sims_str(total_len, ' ');
+
+        // gather strings
+        MPI_Gatherv(sim_str.data(),
+                    sim_str.size(),
+                    MPI_CHAR,
+                    (void*)sims_str.data(),
+                    lens.data(),
+                    displs.data(),
+                    MPI_CHAR,
+                    root,
+                    comm);
+
+        // extract each string and parse into a JSON object
+        if (mpi_rank == root)
+            syn::checkpoint_save_as_json(prop_str, sims_str, displs, lens);
+
+        // the frozen space charge fields go next to the particles
+        Frozen_fields::dump_checkpoint(Bunch_simulator::get_checkpoint_dir(),
+                                       sim);
+    }
+
+    void
+    checkpoint_save_binary(Propagator const& prop,
+                           Bunch_simulator const& sim,
+                           syn::checkpoint_options const& opts)
+    {
+        // the previous staged checkpoint must be committed first
+        syn::checkpoint_wait();
+
+        auto const& comm = sim.get_comm();
+        const int mpi_rank = comm.rank();
+
+        run_agreed(comm, "checkpoint_save: creating " + cp_dir_tmp, [&] {
+            if (mpi_rank != 0) return;
+
+            fs::remove_all(cp_dir_tmp);
+            fs::create_directories(cp_dir_tmp);
+        });
+
+        auto const state = state_file_name(mpi_rank);
+        checkpoint_dir_guard guard(cp_dir_tmp);
+
+        // the state of a rank goes to the stage directory, if any, and is
+        // copied in the background
+        auto const local = opts.stage_dir.empty() ?
+                               cp_dir_tmp + "/" + state :
+                               opts.stage_dir + "/" + state;
+
+        // one agreed step per collective part, so that a failure on
+        // some of the ranks never leaves the others in a collective
+
+        // the propagator is the same on every rank
+        run_agreed(comm, "checkpoint_save: writing the propagator", [&] {
+            if (mpi_rank != 0) return;
+
+            write_binary(cp_dir_tmp + "/propagator.bin",
+                         [&prop](std::ostream& os) { prop.dump_binary(os); });
+        });
+
+        // rank independent state for restarting on a different number
+        // of ranks. It is small, and not staged
+        run_agreed(comm, "checkpoint_save: writing the global state", [&] {
+            sim.dump_global_state(cp_dir_tmp);
+        });
+
+        // the frozen space charge fields, one file per bunch. Rank
+        // independent too, and not staged
+        run_agreed(comm, "checkpoint_save: writing the frozen fields", [&] {
+            Frozen_fields::dump_checkpoint(cp_dir_tmp, sim);
+        });
+
+        if (!opts.stage_dir.empty()) {
+            run_agreed(
+                comm, "checkpoint_save: creating " + opts.stage_dir, [&] {
+                    fs::create_directories(opts.stage_dir);
+                });
+        }
+
+        run_agreed(comm, "checkpoint_save: writing the checkpoint", [&] {
+            write_binary(local,
+                         [&sim](std::ostream& os) { sim.dump_binary(os); });
+        });
+
+        if (opts.stage_dir.empty()) {
+            commit_binary(comm, sim.current_turn());
+            return;
+        }
+
+        staged.comm = std::make_shared<Commxx>(comm);
+        staged.turn = sim.current_turn();
+        staged.copy = std::async(
+            std::launch::async, [local, dest = cp_dir_tmp + "/" + state] {
+                fs::copy_file(
+                    local, dest, fs::copy_options::overwrite_existing);
+                fs::remove(local);
+            });
+    }
+
+    std::pair<Propagator, Bunch_simulator>
+    checkpoint_load_json()
+    {
+        const int root = 0;
+        const int mpi_rank = Commxx::world_rank();
+
+        size_t len;
+        std::vector<char> buf;
+
+        if (mpi_rank == root) {
+            // read states from file
+            std::ifstream file("cp_state.json");
+            if (!file.good())
+                throw std::runtime_error(
+                    "Error at openning checkpointing file");
+
+            file.seekg(0, std::ios::end);
+            len = file.tellg();
+
+            // broadcast the buffer length
+            MPI_Bcast(&len, 1, MPI_UINT64_T, root, Commxx::World);
+
+            // read the buffer
+            buf.resize(len);
+            file.seekg(0);
+            file.read(&buf[0], len);
+
+            // broadcast the buffer
+            MPI_Bcast(&buf[0], len, MPI_BYTE, root, Commxx::World);
+        } else {
+            // receive the buffer length
+            MPI_Bcast(&len, 1, MPI_UINT64_T, root, Commxx::World);
+
+            // prepare buffer
+            buf.resize(len);
+
+            // receive the buffer
+            MPI_Bcast(&buf[0], len, MPI_BYTE, root, Commxx::World);
+        }
+
+        // parse the json object
+        auto cp = syn::checkpoint_load_json(buf, mpi_rank);
+
+        // recreate the objects
+        auto prop = Propagator::load_from_string(cp.first);
+        auto sim = Bunch_simulator::load_from_string(cp.second);
+
+        Frozen_fields::load_checkpoint(Bunch_simulator::get_checkpoint_dir(),
+                                       sim);
+
+        return std::make_pair(std::move(prop), std::move(sim));
+    }
+
+    std::pair<Propagator, Bunch_simulator>
+    checkpoint_load_binary()
+    {
+        const int mpi_rank = Commxx::world_rank();
+        const int mpi_size = Commxx::world_size();
+
+        int num_ranks = syn::checkpoint_read_manifest(cp_dir);
+
+        auto is_prop = open_binary(cp_dir + "/propagator.bin");
+        auto prop = Propagator::load_binary(is_prop);
+
+        // the per rank states only fit the same number of ranks. Otherwise
+        // the bunches are laid out anew and the particles redistributed
+        if (num_ranks != mpi_size) {
+            Logger l(0, LoggerV::INFO);
+            l(LoggerV::INFO)
+                << "checkpoint_load: the checkpoint was written by "
+                << num_ranks << " ranks, redistributing over " << mpi_size
+                << " ranks. Diagnostics need to be registered again\n";
+
+            auto sim = Bunch_simulator::load_global_state(cp_dir);
+            Frozen_fields::load_checkpoint(cp_dir, sim);
+
+            return std::make_pair(std::move(prop), std::move(sim));
+        }
+
+        checkpoint_dir_guard guard(cp_dir);
+
+        auto is_sim = open_binary(cp_dir + "/" + state_file_name(mpi_rank));
+        auto sim = Bunch_simulator::load_binary(is_sim);
+
+        Frozen_fields::load_checkpoint(cp_dir, sim);
+
+        return std::make_pair(std::move(prop), std::move(sim));
+    }
 }
 
 void
 syn::checkpoint_save(Propagator const& prop, Bunch_simulator const& sim)
 {
-    std::string prop_str = prop.dump();
-    std::string sim_str = sim.dump();
-
-    // collect sim_str to the root rank
-    auto const& comm = sim.get_comm();
-
-    const int root = 0;
-    const int mpi_size = comm.size();
-    const int mpi_rank = comm.rank();
-
-    int len = sim_str.size();
-    std::vector<int> lens(mpi_size, 0);
-
-    // gather string size
-    MPI_Gather(&len, 1, MPI_INT, lens.data(), 1, MPI_INT, root, comm);
-
-    // accumulate sizes
-    std::vector<int> displs(mpi_size, 0);
-    for (int i = 1; i < mpi_size; ++i)
-        displs[i] = displs[i - 1] + lens[i - 1];
-
-    // recv string buffer
-    int total_len = displs[mpi_size - 1] + lens[mpi_size - 1];
-    std::string sims_str(total_len, ' ');
-
-    // gather strings
-    MPI_Gatherv(sim_str.data(),
-                sim_str.size(),
-                MPI_CHAR,
-                (void*)sims_str.data(),
-                lens.data(),
-                displs.data(),
-                MPI_CHAR,
-                root,
-                comm);
-
-    // extract each string and parse into a JSON object
-    if (mpi_rank == root)
-        checkpoint_save_as_json(prop_str, sims_str, displs, lens);
+    auto const& opts = prop.get_checkpoint_options();
+
+    if (opts.format == checkpoint_format::binary)
+        checkpoint_save_binary(prop, sim, opts);
+    else
+        checkpoint_save_json(prop, sim);
 }
 
-std::pair<Propagator, Bunch_simulator>
-syn::checkpoint_load()
+void
+syn::checkpoint_wait()
 {
-    const int root = 0;
-    const int mpi_size = Commxx::world_size();
-    const int mpi_rank = Commxx::world_rank();
+    if (!staged.copy.valid()) return;
 
-    size_t len;
-    std::vector<char> buf;
+    auto copy = std::move(staged.copy);
+    auto comm = std::move(staged.comm);
+    int turn = staged.turn;
+    staged = staged_checkpoint_t();
 
-    if (mpi_rank == root) {
-        // read states from file
-        std::ifstream file("cp_state.json");
-        if (!file.good())
-            throw std::runtime_error("Error at openning checkpointing file");
+    // the checkpoint is only committed if all ranks made it
+    run_agreed(*comm, "checkpoint_wait: copy of the staged checkpoint", [&] {
+        copy.get();
+    });
 
-        file.seekg(0, std::ios::end);
-        len = file.tellg();
-
-        // broadcast the buffer length
-        MPI_Bcast(&len, 1, MPI_UINT64_T, root, Commxx::World);
+    commit_binary(*comm, turn);
+}
 
-        // read the buffer
-        buf.resize(len);
-        file.seekg(0);
-        file.read(&buf[0], len);
+std::pair<Propagator, Bunch_simulator>
+syn::checkpoint_load()
+{
+    checkpoint_wait();
 
-        // broadcast the buffer
-        MPI_Bcast(&buf[0], len, MPI_BYTE, root, Commxx::World);
-    } else {
-        // receive the buffer length
-        MPI_Bcast(&len, 1, MPI_UINT64_T, root, Commxx::World);
+    // the most recent one if there are checkpoints in both formats
+    int binary = 0;
 
-        // prepare buffer
-        buf.resize(len);
+    if (Commxx::world_rank() == 0) {
+        auto manifest = cp_dir + "/manifest.json";
+        auto json = std::string("cp_state.json");
 
-        // receive the buffer
-        MPI_Bcast(&buf[0], len, MPI_BYTE, root, Commxx::World);
+        binary = fs::exists(manifest) &&
+                 (!fs::exists(json) ||
+                  fs::last_write_time(manifest) > fs::last_write_time(json));
     }
 
-    // parse the json object
-    auto cp = syn::checkpoint_load_json(buf, mpi_rank);
+    MPI_Bcast(&binary, 1, MPI_INT, 0, Commxx::World);
 
-    // recreate the objects
-    return std::make_pair(Propagator::load_from_string(cp.first),
-                          Bunch_simulator::load_from_string(cp.second));
+    if (binary) return checkpoint_load_binary();
+    return checkpoint_load_json();
 }
 
 void
@@ -1,18 +1,59 @@
 #ifndef SYNERGIA_SIMULATION_CHECKPOINT_H
 #define SYNERGIA_SIMULATION_CHECKPOINT_H
 
+#include <string>
 #include <utility>
 
+#include <cereal/cereal.hpp>
+
 class Propagator;
 class Bunch_simulator;
 
 namespace syn {
-    // save the current state in the checkpoint
+    // json:   states of all ranks are gathered to rank 0 and written to
+    //         a single cp_state.json file
+    //
+    // binary: every rank writes its own state in a cereal binary archive
+    //         to the cp_state/ directory, no gather or broadcast of the
+    //         states. The particles go to cp_state/bunch_simulator.h5
+    //         in a rank independent layout, and the frozen space charge
+    //         fields to a file per bunch. A binary checkpoint can be
+    //         loaded on a different number of ranks, see
+    //         Bunch_simulator::load_global_state()
+    enum class checkpoint_format { json, binary };
+
+    struct checkpoint_options {
+        checkpoint_format format = checkpoint_format::json;
+
+        // binary format only. When set, the per rank states are written
+        // to this (node-local) directory first and copied to cp_state/ in
+        // the background. The checkpoint is committed when all the copies
+        // are done, at the next checkpoint_wait()
+        std::string stage_dir = "";
+
+        template <class AR>
+        void
+        serialize(AR& ar)
+        {
+            ar(CEREAL_NVP(format));
+            ar(CEREAL_NVP(stage_dir));
+        }
+    };
+
+    // save the current state in the checkpoint, in the format set
+    // in the propagator
     void checkpoint_save(Propagator const& prop, Bunch_simulator const& sim);
 
-    // load from the most recent checkpoint
+    // load from the most recent checkpoint. The format is detected.
+    // When a binary checkpoint was written by a different number of
+    // ranks, the particles are redistributed over the current ranks, and
+    // the diagnostics of the bunches are not restored
     std::pair<Propagator, Bunch_simulator> checkpoint_load();
 
+    // wait for the background copies of a staged checkpoint and commit
+    // it. Collective, no-op if there is nothing pending
+    void checkpoint_wait();
+
     // load and resume simulation from most recent checkpoint
     void resume();
 }
@@ -29,6 +29,37 @@ namespace syn {
         file << cp;
     }
 
+    void
+    checkpoint_write_manifest(std::string const& dir, int num_ranks, int turn)
+    {
+        syn::json m = syn::json::object();
+
+        m["format"] = "binary";
+        m["ranks"] = num_ranks;
+        m["turn"] = turn;
+
+        std::ofstream file(dir + "/manifest.json");
+        if (!file.good())
+            throw std::runtime_error("Error at creating checkpoint manifest");
+
+        file << m;
+    }
+
+    int
+    checkpoint_read_manifest(std::string const& dir)
+    {
+        std::ifstream file(dir + "/manifest.json");
+        if (!file.good())
+            throw std::runtime_error("Error at openning checkpoint manifest");
+
+        auto m = syn::json::parse(file);
+
+        if (m["format"] != "binary")
+            throw std::runtime_error("unknown checkpoint format in manifest");
+
+        return m["ranks"].get<int>();
+    }
+
     std::pair<std::string, std::string>
     checkpoint_load_json(std::vector<char> const& buf, int rank)
     {
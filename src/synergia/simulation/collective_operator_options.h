@@ -11,6 +11,8 @@
 
 #include <variant>
 
+// the variant index is in the checkpoints, so without PETSc the fd
+// options (for the multigrid solver) go last to keep the other indices
 #ifdef BUILD_FD_SPACE_CHARGE_SOLVER
 using CO_options = std::variant<Dummy_CO_options,
                                 Space_charge_3d_open_hockney_options,
@@ -18,7 +20,9 @@ using CO_options = std::variant<Dummy_CO_options,
                                 Space_charge_2d_open_hockney_options,
                                 Space_charge_2d_kv_options,
                                 Space_charge_rectangular_options,
-                                Impedance_options>;
+                                Impedance_options,
+                                Space_charge_2d_sliced_options,
+                                Space_charge_2d_bassetti_erskine_options>;
 
 #else
 using CO_options = std::variant<Dummy_CO_options,
@@ -26,7 +30,10 @@ using CO_options = std::variant<Dummy_CO_options,
                                 Space_charge_2d_open_hockney_options,
                                 Space_charge_2d_kv_options,
                                 Space_charge_rectangular_options,
-                                Impedance_options>;
+                                Impedance_options,
+                                Space_charge_2d_sliced_options,
+                                Space_charge_2d_bassetti_erskine_options,
+                                Space_charge_3d_fd_options>;
 #endif
 
 struct create_collective_operator {
@@ -44,14 +51,23 @@ struct create_collective_operator {
       static_cast<const Space_charge_3d_open_hockney_options&>(ops));
   }
 
-#ifdef BUILD_FD_SPACE_CHARGE_SOLVER
   std::shared_ptr<Operator>
   operator()(const Space_charge_3d_fd_options& ops)
   {
+    if (ops.solver == fd_solver_t::multigrid) {
+      return std::make_shared<Space_charge_3d_mg>(
+        static_cast<const Space_charge_3d_fd_options&>(ops));
+    }
+
+#ifdef BUILD_FD_SPACE_CHARGE_SOLVER
     return std::make_shared<Space_charge_3d_fd>(
       static_cast<const Space_charge_3d_fd_options&>(ops));
-  }
+#else
+    throw std::runtime_error(
+      "Space_charge_3d_fd_options: built without PETSc, only the multigrid "
+      "solver is available");
 #endif
+  }
 
   std::shared_ptr<Operator>
   operator()(const Space_charge_2d_open_hockney_options& ops)
@@ -60,6 +76,13 @@ struct create_collective_operator {
       static_cast<const Space_charge_2d_open_hockney_options&>(ops));
   }
 
+  std::shared_ptr<Operator>
+  operator()(const Space_charge_2d_sliced_options& ops)
+  {
+    return std::make_shared<Space_charge_2d_sliced>(
+      static_cast<const Space_charge_2d_sliced_options&>(ops));
+  }
+
   std::shared_ptr<Operator>
   operator()(const Space_charge_2d_kv_options& ops)
   {
@@ -67,6 +90,13 @@ struct create_collective_operator {
       static_cast<const Space_charge_2d_kv_options&>(ops));
   }
 
+  std::shared_ptr<Operator>
+  operator()(const Space_charge_2d_bassetti_erskine_options& ops)
+  {
+    return std::make_shared<Space_charge_2d_bassetti_erskine>(
+      static_cast<const Space_charge_2d_bassetti_erskine_options&>(ops));
+  }
+
   std::shared_ptr<Operator>
   operator()(const Space_charge_rectangular_options& ops)
   {
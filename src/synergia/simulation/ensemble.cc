@@ -0,0 +1,180 @@
+#include "synergia/simulation/ensemble.h"
+
+#include "synergia/utils/hdf5_file.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    // a member index counter on rank 0 of the comm, taken with an atomic
+    // fetch-and-add by the group roots
+    struct member_counter {
+        MPI_Win win;
+        int* base;
+
+        explicit member_counter(Commxx const& comm)
+        {
+            MPI_Aint size = comm.rank() == 0 ? sizeof(int) : 0;
+            MPI_Win_allocate(
+                size, sizeof(int), MPI_INFO_NULL, comm, &base, &win);
+
+            if (comm.rank() == 0) *base = 0;
+            MPI_Barrier(comm);
+        }
+
+        ~member_counter() { MPI_Win_free(&win); }
+
+        member_counter(member_counter const&) = delete;
+
+        int
+        next()
+        {
+            int one = 1;
+            int idx = 0;
+
+            MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, win);
+            MPI_Fetch_and_op(&one, &idx, MPI_INT, 0, 0, MPI_SUM, win);
+            MPI_Win_unlock(0, win);
+
+            return idx;
+        }
+    };
+
+    // gathers the variable length local arrays to all ranks
+    template <class T>
+    std::vector<T>
+    allgather(std::vector<T> const& local, MPI_Datatype type, Commxx const& comm)
+    {
+        const int mpi_size = comm.size();
+
+        int count = local.size();
+        std::vector<int> counts(mpi_size), displs(mpi_size, 0);
+
+        MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+
+        for (int r = 1; r < mpi_size; ++r)
+            displs[r] = displs[r - 1] + counts[r - 1];
+
+        std::vector<T> all(displs[mpi_size - 1] + counts[mpi_size - 1]);
+
+        MPI_Allgatherv(local.data(),
+                       count,
+                       type,
+                       all.data(),
+                       counts.data(),
+                       displs.data(),
+                       type,
+                       comm);
+
+        return all;
+    }
+}
+
+Ensemble::Ensemble(Lattice const& lattice,
+                   int num_members,
+                   int group_size,
+                   Commxx const& comm)
+    : lattice(lattice)
+    , num_members(num_members)
+    , num_groups(0)
+    , group(0)
+    , comm(std::make_shared<Commxx>(comm))
+    , group_comm()
+    , results()
+    , member_group()
+    , member_time()
+{
+    if (group_size < 1 || comm.size() % group_size) {
+        throw std::runtime_error(
+            "Ensemble: the number of ranks must be a multiple of group_size");
+    }
+
+    num_groups = comm.size() / group_size;
+    group = comm.rank() / group_size;
+
+    group_comm = std::make_shared<Commxx>(this->comm->split(group));
+}
+
+void
+Ensemble::run(member_fn const& fn)
+{
+    member_counter counter(*comm);
+
+    const bool root = group_comm->rank() == 0;
+
+    // members run by this group, only kept on the group root
+    std::vector<int> idxs;
+    std::vector<double> times;
+    std::vector<double> values;
+
+    int num_results = -1;
+    int err = 0;
+
+    while (true) {
+        int idx = root ? counter.next() : 0;
+        MPI_Bcast(&idx, 1, MPI_INT, 0, *group_comm);
+
+        if (idx >= num_members) break;
+
+        double t0 = MPI_Wtime();
+        auto res = fn(idx, lattice, *group_comm);
+        double t1 = MPI_Wtime();
+
+        if (!root) continue;
+
+        if (num_results < 0) num_results = res.size();
+        if (num_results != (int)res.size()) err = 1;
+
+        idxs.push_back(idx);
+        times.push_back(t1 - t0);
+        values.insert(values.end(), res.begin(), res.end());
+    }
+
+    // same number of results from every member
+    int width = num_results;
+    MPI_Allreduce(MPI_IN_PLACE, &width, 1, MPI_INT, MPI_MAX, *comm);
+
+    if (num_results >= 0 && num_results != width) err = 1;
+    MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_INT, MPI_MAX, *comm);
+
+    if (err) {
+        throw std::runtime_error(
+            "Ensemble::run: the members returned different numbers of "
+            "results");
+    }
+
+    width = std::max(width, 0);
+
+    auto all_idxs = allgather(idxs, MPI_INT, *comm);
+    auto all_times = allgather(times, MPI_DOUBLE, *comm);
+    auto all_values = allgather(values, MPI_DOUBLE, *comm);
+
+    std::vector<int> groups(idxs.size(), group);
+    auto all_groups = allgather(groups, MPI_INT, *comm);
+
+    // in the order of the members
+    results = karray2d_row("results", num_members, width);
+    member_group = karray1i_row("group", num_members);
+    member_time = karray1d("time", num_members);
+
+    for (int k = 0; k < (int)all_idxs.size(); ++k) {
+        int m = all_idxs[k];
+
+        member_group(m) = all_groups[k];
+        member_time(m) = all_times[k];
+
+        for (int j = 0; j < width; ++j)
+            results(m, j) = all_values[k * width + j];
+    }
+}
+
+void
+Ensemble::write(std::string const& filename) const
+{
+    Hdf5_file file(filename, Hdf5_file::Flag::truncate, *comm);
+
+    file.write_single("results", results);
+    file.write_single("group", member_group);
+    file.write_single("time", member_time);
+    file.write_single("num_groups", num_groups);
+}
@@ -0,0 +1,104 @@
+#ifndef ENSEMBLE_H_
+#define ENSEMBLE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "synergia/lattice/lattice.h"
+#include "synergia/utils/commxx.h"
+#include "synergia/utils/kokkos_views.h"
+
+// Ensemble runs many small, independent simulations (the members, e.g.,
+// the points of a tune scan or the seeds of an error study) in one MPI
+// job, so the startup is paid once for all of them.
+//
+// The ranks are divided into groups of group_size ranks. Each group
+// takes the next member from a counter shared by all the groups as soon
+// as it is done with the previous one, so groups with fast members are
+// not held up by the slow ones. Every member gets the same lattice,
+// parsed once per rank.
+//
+// A member returns a vector of results of the same length for all the
+// members. The results of all the members are gathered on all ranks and
+// written to a single file for the ensemble. Per member diagnostics need
+// a member dependent file name to not overwrite each other.
+class Ensemble {
+  public:
+    // runs member idx on the ranks of group_comm, and returns its results.
+    // Called on all the ranks of the group
+    using member_fn = std::function<std::vector<double>(
+        int idx, Lattice const& lattice, Commxx const& group_comm)>;
+
+    // comm is split into groups of group_size ranks, its size must be a
+    // multiple of group_size
+    Ensemble(Lattice const& lattice,
+             int num_members,
+             int group_size = 1,
+             Commxx const& comm = Commxx());
+
+    // run all the members. Collective over the communicator
+    void run(member_fn const& fn);
+
+    // write the results of the last run to an hdf5 file, with datasets
+    //   results (num_members, num_results)
+    //   group   (num_members), the group that ran the member
+    //   time    (num_members), wall time of the member in seconds
+    // Collective over the communicator
+    void write(std::string const& filename) const;
+
+    int
+    get_num_members() const
+    {
+        return num_members;
+    }
+
+    int
+    get_num_groups() const
+    {
+        return num_groups;
+    }
+
+    // group of this rank
+    int
+    get_group() const
+    {
+        return group;
+    }
+
+    Commxx const&
+    get_group_comm() const
+    {
+        return *group_comm;
+    }
+
+    Lattice const&
+    get_lattice() const
+    {
+        return lattice;
+    }
+
+    // results of the last run, in the order of the members
+    karray2d_row
+    get_results() const
+    {
+        return results;
+    }
+
+  private:
+    Lattice lattice;
+
+    int num_members;
+    int num_groups;
+    int group;
+
+    std::shared_ptr<Commxx> comm;
+    std::shared_ptr<Commxx> group_comm;
+
+    karray2d_row results;
+    karray1i_row member_group;
+    karray1d member_time;
+};
+
+#endif /* ENSEMBLE_H_ */
@@ -2,13 +2,16 @@
 #define IMPLEMENTED_COLLECTIVE_OPERATORS_H
 
 #include "synergia/collective/impedance.h"
+#include "synergia/collective/space_charge_2d_bassetti_erskine.h"
 #include "synergia/collective/space_charge_2d_kv.h"
 #include "synergia/collective/space_charge_2d_open_hockney.h"
+#include "synergia/collective/space_charge_2d_sliced.h"
 
 #ifdef BUILD_FD_SPACE_CHARGE_SOLVER
 #include "synergia/collective/space_charge_3d_fd.h"
 #endif
 
+#include "synergia/collective/space_charge_3d_mg.h"
 #include "synergia/collective/space_charge_3d_open_hockney.h"
 #include "synergia/collective/space_charge_rectangular.h"
 
@@ -9,6 +9,18 @@
 enum class green_fn_t {
     pointlike,
     linear,
+    igf, // integrated over the cells, for coarse or anisotropic grids
+};
+
+// linear solver of the 3d finite difference space charge
+enum class fd_solver_t {
+    petsc,     // PETSc KSP, on the comm_group_size subcommunicators
+    multigrid, // native geometric multigrid, redundant on every rank
+};
+
+enum class mg_cycle_t {
+    V,
+    F,
 };
 
 enum class LongitudinalDistribution {
@@ -16,7 +28,8 @@ enum class LongitudinalDistribution {
     uniform,
 };
 
-#ifdef BUILD_FD_SPACE_CHARGE_SOLVER
+// the petsc solver is only available when built with PETSc, the
+// multigrid solver always is (Space_charge_3d_mg)
 struct Space_charge_3d_fd_options {
 
     std::array<int, 3> shape;
@@ -28,6 +41,22 @@ struct Space_charge_3d_fd_options {
     double kick_scale;
     int comm_group_size;
 
+    // multigrid solver options: cycle type, smoothing sweeps before and
+    // after the coarse grid correction, relative residual tolerance and
+    // maximum number of cycles per solve
+    fd_solver_t solver;
+    mg_cycle_t mg_cycle;
+    int mg_smooth;
+    double mg_rtol;
+    int mg_max_cycles;
+
+    // open boundaries: the potential on the boundary of the grid is the
+    // free space potential of the charge, summed over coarse cells of
+    // open_boundary_coarsening^3 grid cells. With it the grid can hug
+    // the bunch, e.g., n_sigma of 4 to 5
+    bool open_boundary;
+    int open_boundary_coarsening;
+
     Space_charge_3d_fd_options(int gridx = 32,
                                int gridy = 32,
                                int gridz = 64,
@@ -42,6 +71,13 @@ struct Space_charge_3d_fd_options {
         , n_sigma(8.0)
         , kick_scale(1.0)
         , comm_group_size(1)
+        , solver(fd_solver_t::petsc)
+        , mg_cycle(mg_cycle_t::V)
+        , mg_smooth(2)
+        , mg_rtol(1e-8)
+        , mg_max_cycles(20)
+        , open_boundary(false)
+        , open_boundary_coarsening(4)
     {}
 
     void
@@ -60,9 +96,15 @@ struct Space_charge_3d_fd_options {
         ar(shape);
         ar(n_sigma);
         ar(comm_group_size);
+        ar(solver);
+        ar(mg_cycle);
+        ar(mg_smooth);
+        ar(mg_rtol);
+        ar(mg_max_cycles);
+        ar(open_boundary);
+        ar(open_boundary_coarsening);
     }
 };
-#endif
 
 struct Space_charge_3d_open_hockney_options {
 
@@ -79,6 +121,18 @@ struct Space_charge_3d_open_hockney_options {
     bool domain_fixed;
     int comm_group_size;
 
+    // single precision MPI reductions and field arrays. The charge
+    // deposit and the FFTs stay in double
+    bool single_precision;
+
+    // frozen fields: the fields of a kick location are reused for up to
+    // frozen_turns turns, or until the centroid or the size of the bunch
+    // has moved by more than frozen_tolerance (in units of the size at
+    // the solve). 0 solves at every kick. The fields are kept per
+    // bunch, see Frozen_fields
+    int frozen_turns;
+    double frozen_tolerance;
+
     Space_charge_3d_open_hockney_options(int gridx = 32,
                                          int gridy = 32,
                                          int gridz = 64)
@@ -92,6 +146,9 @@ struct Space_charge_3d_open_hockney_options {
         , kick_scale(1.0)
         , domain_fixed(false)
         , comm_group_size(4)
+        , single_precision(false)
+        , frozen_turns(0)
+        , frozen_tolerance(0.05)
     {}
 
     void
@@ -122,6 +179,9 @@ struct Space_charge_3d_open_hockney_options {
         ar(grid_entire_period);
         ar(n_sigma);
         ar(comm_group_size);
+        ar(single_precision);
+        ar(frozen_turns);
+        ar(frozen_tolerance);
     };
 };
 
@@ -135,6 +195,13 @@ struct Space_charge_2d_open_hockney_options {
     double n_sigma;
     int comm_group_size;
 
+    // single precision MPI reductions, see the 3d options
+    bool single_precision;
+
+    // frozen fields, see the 3d options
+    int frozen_turns;
+    double frozen_tolerance;
+
     Space_charge_2d_open_hockney_options(int gridx = 32,
                                          int gridy = 32,
                                          int gridz = 32)
@@ -145,6 +212,9 @@ struct Space_charge_2d_open_hockney_options {
         , grid_entire_period(false)
         , n_sigma(8.0)
         , comm_group_size(4)
+        , single_precision(false)
+        , frozen_turns(0)
+        , frozen_tolerance(0.05)
     {}
 
     template <class Archive>
@@ -158,6 +228,58 @@ struct Space_charge_2d_open_hockney_options {
         ar(grid_entire_period);
         ar(n_sigma);
         ar(comm_group_size);
+        ar(single_precision);
+        ar(frozen_turns);
+        ar(frozen_tolerance);
+    }
+};
+
+// 2.5d space charge: the bunch is cut into gridz longitudinal slices,
+// and every slice gets the transverse 2d open boundary field of its own
+// charge, scaled by its line density. The slices are shared out among
+// the ranks of the bunch and solved with batched 2d FFTs
+struct Space_charge_2d_sliced_options {
+
+    std::array<int, 3> shape;
+    std::array<int, 3> doubled_shape;
+    std::array<double, 3> size;
+    std::array<double, 3> offset;
+    double n_sigma;
+    double kick_scale;
+    bool domain_fixed;
+
+    Space_charge_2d_sliced_options(int gridx = 32,
+                                   int gridy = 32,
+                                   int gridz = 32)
+        : shape{gridx, gridy, gridz}
+        , doubled_shape{gridx * 2, gridy * 2, gridz}
+        , size{1.0, 1.0, 1.0}
+        , offset{0.0, 0.0, 0.0}
+        , n_sigma(8.0)
+        , kick_scale(1.0)
+        , domain_fixed(false)
+    {}
+
+    void
+    set_fixed_domain(std::array<double, 3> offset, std::array<double, 3> size)
+    {
+        this->offset = offset;
+        this->size = size;
+
+        this->domain_fixed = true;
+    }
+
+    template <class Archive>
+    void
+    serialize(Archive& ar)
+    {
+        ar(shape);
+        ar(doubled_shape);
+        ar(size);
+        ar(offset);
+        ar(n_sigma);
+        ar(kick_scale);
+        ar(domain_fixed);
     }
 };
 
@@ -181,6 +303,24 @@ struct Space_charge_2d_kv_options {
     }
 };
 
+struct Space_charge_2d_bassetti_erskine_options {
+    using LD = LongitudinalDistribution;
+
+    // switch to control whether the linear charge density is assumed to be
+    // distributed gaussian or uniform over the bunch length.
+    LD longitudinal_distribution = LD::uniform;
+
+    bool strictly_centered = false;
+
+    template <class Archive>
+    void
+    serialize(Archive& ar)
+    {
+        ar(longitudinal_distribution);
+        ar(strictly_centered);
+    }
+};
+
 struct Space_charge_rectangular_options {
 
     std::array<int, 3> shape;
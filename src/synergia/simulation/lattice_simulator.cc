@@ -316,10 +316,7 @@ namespace Lattice_simulator {
     auto& ref = temp_lattice.get_reference_particle();
 
     // set rfcavity volt to 0 on the copied lattice
-    for (auto& ele : temp_lattice.get_elements()) {
-      if (ele.get_type() == element_type::rfcavity)
-        ele.set_double_attribute("volt", 0.0);
-    }
+    temp_lattice.set_all_double_attribute(element_type::rfcavity, "volt", 0.0);
 
     // setup the propagator
     Propagator propagator(temp_lattice, Independent_stepper_elements(1));
@@ -352,16 +349,16 @@ namespace Lattice_simulator {
     // cdt
     double f = pconstants::c / accum_cdt;
 
-    for (auto& ele : lattice.get_elements()) {
-      if (ele.get_type() == element_type::rfcavity) {
-        // set the frequency of the cavity if it doesn't already have one set
-        // and there is a reasonable harmonic number
-        if (ele.get_double_attribute("freq", -1.0) <= 0.0 &&
-            ele.get_double_attribute("harmon", -1.0) > 0.0) {
-          double harmon = ele.get_double_attribute("harmon");
-          // MAD-X definition of frequency is MHz
-          ele.set_double_attribute("freq", harmon * f * 1.0e-6);
-        }
+    for (int idx : lattice.get_element_indices(element_type::rfcavity)) {
+      auto& ele = lattice.get_element(idx);
+
+      // set the frequency of the cavity if it doesn't already have one set
+      // and there is a reasonable harmonic number
+      if (ele.get_double_attribute("freq", -1.0) <= 0.0 &&
+          ele.get_double_attribute("harmon", -1.0) > 0.0) {
+        double harmon = ele.get_double_attribute("harmon");
+        // MAD-X definition of frequency is MHz
+        ele.set_double_attribute("freq", harmon * f * 1.0e-6);
       }
     }
 
@@ -377,14 +374,13 @@ namespace Lattice_simulator {
       const double dpp;
       Lattice lattice;
 
-      Closed_orbit_params(double dpp, Lattice lattice)
+      Closed_orbit_params(double dpp, Lattice const& lattice)
         : dpp(dpp), lattice(lattice)
       {
         // turn off any RF cavities because they
         // screw up the closed orbit calcation
-        for (auto& ele : lattice.get_elements())
-          if (ele.get_type() == element_type::rfcavity)
-            ele.set_double_attribute("volt", 0.0);
+        this->lattice.set_all_double_attribute(
+          element_type::rfcavity, "volt", 0.0);
       }
     };
 
@@ -504,6 +504,7 @@ Propagator::propagate(Bunch_simulator& sim, Logger& logger, int max_turns)
             if ((turns_since_checkpoint == checkpoint_period) ||
                 ((turn == (sim.max_turns() - 1)) && final_checkpoint)) {
                 // t = simple_timer_current();
+                sim.diag_drain();
                 syn::checkpoint_save(*this, sim);
                 // t = simple_timer_show(t, "propagate-checkpoint_period");
                 turns_since_checkpoint = 0;
@@ -544,6 +545,11 @@ Propagator::propagate(Bunch_simulator& sim, Logger& logger, int max_turns)
 #endif
         }
 
+        // async diagnostics and staged checkpoints are complete on disk
+        // when propagate returns
+        sim.diag_drain();
+        syn::checkpoint_wait();
+
         if (last_turn != total_turns) {
             logger(LoggerV::INFO_TURN)
                 << "Propagator: maximum number of turns reached\n";
@@ -2,6 +2,7 @@
 #define PROPAGATOR_H_
 
 #include "synergia/lattice/lattice.h"
+#include "synergia/simulation/checkpoint.h"
 
 #include "synergia/simulation/independent_stepper_elements.h"
 #include "synergia/simulation/step.h"
@@ -16,6 +17,8 @@ class Propagator {
     static const int PRE_TURN = -1;
     static const int FINAL_STEP = -1;
 
+    // iterates over the slices of all the independent operators in all
+    // the steps, in the order of propagation
     struct Slice_iterator {
         using iterator_category = std::forward_iterator_tag;
         using difference_type = int;
@@ -23,93 +26,28 @@ class Propagator {
         using pointer = Lattice_element_slice*;
         using reference = Lattice_element_slice&;
 
-        Slice_iterator(Propagator& p) : prop(p) {}
+        using base_t = std::vector<Lattice_element_slice*>::const_iterator;
+
+        explicit Slice_iterator(base_t it) : it(it) {}
 
         reference
         operator*() const
         {
-            return *slice_it;
+            return **it;
         }
         pointer
-        operator->()
+        operator->() const
         {
-            return &(*slice_it);
-        }
-
-        void
-        first_slice()
-        {
-            step_it = prop.steps.begin();
-            step_end = prop.steps.end();
-
-            if (step_it == prop.steps.end()) return;
-
-            opr_it = step_it->operators.begin();
-            opr_end = step_it->operators.end();
-
-            if (is_valid_opr()) {
-                auto o = dynamic_cast<Independent_operator*>(opr_it->get());
-                slice_it = o->slices.begin();
-                slice_end = o->slices.end();
-                return;
-            }
-
-            advance_to_next_slice();
-        }
-
-        void
-        end()
-        {
-            step_it = prop.steps.end();
+            return *it;
         }
 
         Slice_iterator&
         operator++()
         {
-            ++slice_it;
-
-            auto o = dynamic_cast<Independent_operator*>(opr_it->get());
-            if (slice_it == o->slices.end()) advance_to_next_slice();
-
+            ++it;
             return *this;
         }
 
-        void
-        advance_to_next_slice()
-        {
-            while (step_it != prop.steps.end()) {
-                if (opr_it == step_it->operators.end()) {
-                    ++step_it;
-                    if (step_it == prop.steps.end()) return;
-
-                    opr_it = step_it->operators.begin();
-                    opr_end = step_it->operators.end();
-                } else {
-                    ++opr_it;
-                }
-
-                if (is_valid_opr()) {
-                    auto o = dynamic_cast<Independent_operator*>(opr_it->get());
-                    slice_it = o->slices.begin();
-                    slice_end = o->slices.end();
-                    return;
-                }
-            }
-
-            // the step is now at the end if reached here
-        }
-
-        bool
-        is_valid_opr()
-        {
-            if (opr_it == step_it->operators.end()) return false;
-
-            auto o = dynamic_cast<Independent_operator*>(opr_it->get());
-            if (o && o->slices.size()) return true;
-
-            return false;
-        }
-
         // iterator++
         Slice_iterator
         operator++(int)
@@ -122,20 +60,7 @@ class Propagator {
         friend bool
         operator==(const Slice_iterator& a, const Slice_iterator& b)
         {
-            if (&a.prop != &b.prop) return false;
-
-            if (a.step_it != b.step_it) return false;
-
-            if (a.step_it != a.step_end && b.step_it != b.step_end &&
-                a.opr_it != b.opr_it)
-                return false;
-
-            if (a.step_it != a.step_end && b.step_it != b.step_end &&
-                a.opr_it != a.opr_end && b.opr_it != b.opr_end &&
-                a.slice_it != b.slice_it)
-                return false;
-
-            return true;
+            return a.it == b.it;
         }
 
         friend bool
@@ -145,38 +70,40 @@ class Propagator {
         }
 
       private:
-        Propagator& prop;
-
-        std::vector<Step>::iterator step_it;
-        std::vector<Step>::iterator step_end;
-
-        std::vector<std::shared_ptr<Operator>>::iterator opr_it;
-        std::vector<std::shared_ptr<Operator>>::iterator opr_end;
-
-        std::vector<Lattice_element_slice>::iterator slice_it;
-        std::vector<Lattice_element_slice>::iterator slice_end;
+        base_t it;
     };
 
+    // flat array of the slices, collected once when the steps are made.
+    // Points into the operators of the steps, which do not change after
     struct Lattice_element_slices {
-        Lattice_element_slices(Propagator& p) : prop(p) {}
-
         Slice_iterator
-        begin()
+        begin() const
         {
-            Slice_iterator it(prop);
-            it.first_slice();
-            return it;
+            return Slice_iterator(flat.begin());
         }
 
         Slice_iterator
-        end()
+        end() const
+        {
+            return Slice_iterator(flat.end());
+        }
+
+        int
+        size() const
         {
-            Slice_iterator it(prop);
-            it.end();
-            return it;
+            return flat.size();
         }
 
-        Propagator& prop;
+        Lattice_element_slice&
+        operator[](int idx) const
+        {
+            return *flat[idx];
+        }
+
+      private:
+        std::vector<Lattice_element_slice*> flat;
+
+        friend class Propagator;
     };
 
   private:
@@ -188,6 +115,7 @@ class Propagator {
 
     int checkpoint_period;
     bool final_checkpoint;
+    syn::checkpoint_options checkpoint_opts;
 
   private:
     void do_before_start(Bunch_simulator& simulator, Logger& logger);
@@ -213,13 +141,15 @@ class Propagator {
                Stepper const& stepper = Independent_stepper_elements(1))
         : lattice(lattice)
         , steps()
-        , slices(*this)
+        , slices()
         , stepper_ptr(stepper.clone())
         , checkpoint_period(-1)
         , final_checkpoint(false)
+        , checkpoint_opts()
     {
         this->lattice.update();
         steps = stepper_ptr->apply(this->lattice);
+        collect_slices();
     }
 
     // max_turns: number of turns in this propagate. -1 run to the end
@@ -254,6 +184,19 @@ class Propagator {
         return final_checkpoint;
     }
 
+    // format and staging of the checkpoints
+    void
+    set_checkpoint_options(syn::checkpoint_options const& opts)
+    {
+        checkpoint_opts = opts;
+    }
+
+    syn::checkpoint_options const&
+    get_checkpoint_options() const
+    {
+        return checkpoint_opts;
+    }
+
     // slices
     Lattice_element_slices&
     get_lattice_element_slices()
@@ -262,7 +205,7 @@ class Propagator {
     }
 
     // elements
-    std::list<Lattice_element> const&
+    Lattice_elements const&
     get_lattice_elements()
     {
         return lattice.get_elements();
@@ -316,9 +259,45 @@ class Propagator {
         return p;
     }
 
+    // binary archive, for the binary checkpoints
+    void
+    dump_binary(std::ostream& os) const
+    {
+        cereal::BinaryOutputArchive ar(os);
+        ar(*this);
+    }
+
+    static Propagator
+    load_binary(std::istream& is)
+    {
+        cereal::BinaryInputArchive ar(is);
+
+        Propagator p;
+        ar(p);
+
+        return p;
+    }
+
   private:
     // default ctor for serialization only
-    Propagator() : lattice(), steps(), slices(*this), stepper_ptr() {}
+    Propagator() : lattice(), steps(), slices(), stepper_ptr() {}
+
+    // fill the flat slice array from the steps
+    void
+    collect_slices()
+    {
+        slices.flat.clear();
+
+        for (auto& step : steps) {
+            for (auto& opr : step.operators) {
+                auto o = dynamic_cast<Independent_operator*>(opr.get());
+                if (!o) continue;
+
+                for (auto& slice : o->slices)
+                    slices.flat.push_back(&slice);
+            }
+        }
+    }
 
     friend class cereal::access;
 
@@ -330,6 +309,7 @@ class Propagator {
         ar(CEREAL_NVP(stepper_ptr));
         ar(CEREAL_NVP(checkpoint_period));
         ar(CEREAL_NVP(final_checkpoint));
+        ar(CEREAL_NVP(checkpoint_opts));
     }
 
     template <class AR>
@@ -340,9 +320,11 @@ class Propagator {
         ar(CEREAL_NVP(stepper_ptr));
         ar(CEREAL_NVP(checkpoint_period));
         ar(CEREAL_NVP(final_checkpoint));
+        ar(CEREAL_NVP(checkpoint_opts));
 
         lattice.update();
         steps = stepper_ptr->apply(lattice);
+        collect_slices();
     }
 };
 
@@ -0,0 +1,153 @@
+#include "synergia/simulation/ramp.h"
+
+#include "synergia/foundation/physical_constants.h"
+#include "synergia/lattice/lattice.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+Ramp_table::Ramp_table(std::vector<double> const& knots,
+                       std::vector<std::vector<double>> const& cs)
+    : knots(knots), coeffs(), order(0)
+{
+    if (knots.size() < 2 || cs.size() != knots.size() - 1) {
+        throw std::runtime_error(
+            "Ramp_table: needs at least two knots and one row of "
+            "coefficients per segment");
+    }
+
+    if (!std::is_sorted(knots.begin(), knots.end())) {
+        throw std::runtime_error(
+            "Ramp_table: the knots must be in increasing order");
+    }
+
+    order = cs[0].size();
+
+    for (auto const& c : cs) {
+        if ((int)c.size() != order || order == 0) {
+            throw std::runtime_error(
+                "Ramp_table: all the segments must have the same, "
+                "non-zero number of coefficients");
+        }
+
+        coeffs.insert(coeffs.end(), c.begin(), c.end());
+    }
+}
+
+Ramp_table
+Ramp_table::linear(std::vector<double> const& xs, std::vector<double> const& ys)
+{
+    if (xs.size() != ys.size()) {
+        throw std::runtime_error(
+            "Ramp_table::linear: xs and ys are of different lengths");
+    }
+
+    std::vector<std::vector<double>> cs;
+
+    for (int i = 0; i + 1 < (int)xs.size(); ++i) {
+        double dx = xs[i + 1] - xs[i];
+        double slope = dx > 0 ? (ys[i + 1] - ys[i]) / dx : 0.0;
+        cs.push_back({ys[i], slope});
+    }
+
+    return Ramp_table(xs, cs);
+}
+
+Ramp_table
+Ramp_table::constant(double v)
+{
+    return Ramp_table({0.0, 1.0}, {{v}});
+}
+
+double
+Ramp_table::operator()(double x) const
+{
+    if (knots.empty()) return 0.0;
+
+    const int nseg = knots.size() - 1;
+    int seg;
+
+    if (x <= knots.front()) {
+        seg = 0;
+        x = knots.front();
+    } else if (x >= knots.back()) {
+        seg = nseg - 1;
+        x = knots.back();
+    } else {
+        seg = std::upper_bound(knots.begin(), knots.end(), x) -
+              knots.begin() - 1;
+    }
+
+    // Horner
+    double const* c = &coeffs[seg * order];
+    double dx = x - knots[seg];
+    double v = 0.0;
+
+    for (int k = order - 1; k >= 0; --k)
+        v = v * dx + c[k];
+
+    return v;
+}
+
+void
+Ramps::add(std::string const& element_name,
+           std::string const& attribute,
+           Ramp_table const& table,
+           Clock clock,
+           bool every_step)
+{
+    ramps.push_back(
+        ramp_t{element_name, attribute, table, clock, every_step, 0.0, false});
+}
+
+void
+Ramps::apply(Lattice& lattice, ramp_t& r, double x)
+{
+    double v = r.table(x);
+    if (r.set && v == r.value) return;
+
+    if (lattice.set_element_double_attribute(r.element, r.attribute, v) ==
+        0) {
+        throw std::runtime_error("Ramps: no element named " + r.element +
+                                 " in the lattice");
+    }
+
+    r.value = v;
+    r.set = true;
+}
+
+void
+Ramps::turn_start(Lattice& lattice, int turn)
+{
+    for (auto& r : ramps)
+        apply(lattice, r, r.clock == Clock::turn ? turn : time);
+}
+
+void
+Ramps::turn_end(Lattice& lattice, int turn, Reference_particle const& ref)
+{
+    if (ramps.empty()) return;
+
+    time += lattice.get_length() / (ref.get_beta() * pconstants::c);
+
+    turn_start(lattice, turn + 1);
+}
+
+void
+Ramps::step_end(Lattice& lattice, int turn, Reference_particle const& ref)
+{
+    double v = ref.get_beta() * pconstants::c;
+
+    double turn_time = lattice.get_length() / v;
+    double time_in_turn = ref.get_s_n() / v;
+
+    // turn ramps are continuous in the fraction of the turn
+    for (auto& r : ramps) {
+        if (!r.every_step) continue;
+
+        apply(lattice,
+              r,
+              r.clock == Clock::turn ? turn + time_in_turn / turn_time
+                                     : time + time_in_turn);
+    }
+}
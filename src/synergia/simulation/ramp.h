@@ -0,0 +1,162 @@
+#ifndef SIMULATION_RAMP_H
+#define SIMULATION_RAMP_H
+
+#include <string>
+#include <vector>
+
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+
+class Lattice;
+class Reference_particle;
+
+// A piecewise polynomial function of one variable. Segment i covers
+// [knots[i], knots[i+1]) and is evaluated as
+//
+//   f(x) = sum_k coeffs[i][k] * (x - knots[i])^k
+//
+// Outside of the knots the function holds its value at the nearest end.
+class Ramp_table {
+  public:
+    Ramp_table() = default;
+
+    // knots in increasing order, and one row of coefficients per
+    // segment (knots.size()-1 rows, all of the same length)
+    Ramp_table(std::vector<double> const& knots,
+               std::vector<std::vector<double>> const& coeffs);
+
+    // linear interpolation through the points (xs[i], ys[i])
+    static Ramp_table linear(std::vector<double> const& xs,
+                             std::vector<double> const& ys);
+
+    // constant value v
+    static Ramp_table constant(double v);
+
+    double operator()(double x) const;
+
+    int
+    get_num_segments() const
+    {
+        return knots.size() - 1;
+    }
+
+    int
+    get_order() const
+    {
+        return order;
+    }
+
+  private:
+    std::vector<double> knots;
+
+    // coefficients of segment i at [i*order, (i+1)*order)
+    std::vector<double> coeffs;
+    int order = 0;
+
+    friend class cereal::access;
+
+    template <class AR>
+    void
+    serialize(AR& ar)
+    {
+        ar(CEREAL_NVP(knots));
+        ar(CEREAL_NVP(coeffs));
+        ar(CEREAL_NVP(order));
+    }
+};
+
+// Ramps drives element attributes from Ramp_tables, in place of the
+// propagate actions that set them turn by turn from Python. The ramps
+// are evaluated against the turn number or the reference time, and are
+// part of the checkpoints.
+class Ramps {
+  public:
+    enum class Clock {
+        turn, // value at the turn number (turns count from 0)
+        time  // value at the reference time (seconds)
+    };
+
+    // ramp attribute of the elements named element_name. With
+    // every_step the value is also updated at the end of every step,
+    // otherwise only at the start of each turn
+    void add(std::string const& element_name,
+             std::string const& attribute,
+             Ramp_table const& table,
+             Clock clock = Clock::turn,
+             bool every_step = false);
+
+    bool
+    empty() const
+    {
+        return ramps.empty();
+    }
+
+    size_t
+    size() const
+    {
+        return ramps.size();
+    }
+
+    // reference time at the start of the current turn
+    double
+    get_time() const
+    {
+        return time;
+    }
+
+    // set the ramped attributes for the start of turn
+    void turn_start(Lattice& lattice, int turn);
+
+    // advance the reference time by one turn of the lattice at the
+    // velocity of the bunch reference particle ref, and set the ramped
+    // attributes for the next turn
+    void turn_end(Lattice& lattice, int turn, Reference_particle const& ref);
+
+    // set the every_step ramps, at the time of the bunch reference
+    // particle ref into the current turn
+    void step_end(Lattice& lattice, int turn, Reference_particle const& ref);
+
+  private:
+    struct ramp_t {
+        std::string element;
+        std::string attribute;
+        Ramp_table table;
+        Clock clock;
+        bool every_step;
+
+        // last value written to the lattice, to leave the element
+        // revision alone when the value does not change
+        double value;
+        bool set;
+
+        template <class AR>
+        void
+        serialize(AR& ar)
+        {
+            ar(CEREAL_NVP(element));
+            ar(CEREAL_NVP(attribute));
+            ar(CEREAL_NVP(table));
+            ar(CEREAL_NVP(clock));
+            ar(CEREAL_NVP(every_step));
+            ar(CEREAL_NVP(value));
+            ar(CEREAL_NVP(set));
+        }
+    };
+
+    void apply(Lattice& lattice, ramp_t& r, double x);
+
+    std::vector<ramp_t> ramps;
+    double time = 0.0;
+
+    friend class cereal::access;
+
+    template <class AR>
+    void
+    serialize(AR& ar)
+    {
+        ar(CEREAL_NVP(ramps));
+        ar(CEREAL_NVP(time));
+    }
+};
+
+#endif
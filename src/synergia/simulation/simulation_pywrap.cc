@@ -5,6 +5,7 @@
 #include <pybind11/stl.h>
 
 #include "synergia/simulation/checkpoint.h"
+#include "synergia/simulation/ensemble.h"
 #include "synergia/simulation/independent_stepper_elements.h"
 #include "synergia/simulation/lattice_simulator.h"
 #include "synergia/simulation/propagator.h"
@@ -36,6 +37,34 @@ PYBIND11_MODULE(simulation, m)
 
   m.def("checkpoint_load", &syn::checkpoint_load);
 
+  m.def("checkpoint_wait", &syn::checkpoint_wait);
+
+  py::enum_<syn::checkpoint_format>(m, "checkpoint_format")
+    .value("json", syn::checkpoint_format::json)
+    .value("binary", syn::checkpoint_format::binary);
+
+  // Ramps
+  py::class_<Ramp_table>(m, "Ramp_table")
+    .def(py::init<std::vector<double> const&,
+                  std::vector<std::vector<double>> const&>(),
+         "Piecewise polynomial with one row of coefficients per segment.",
+         "knots"_a,
+         "coeffs"_a)
+    .def_static("linear", &Ramp_table::linear, "xs"_a, "ys"_a)
+    .def_static("constant", &Ramp_table::constant, "value"_a)
+    .def("__call__", &Ramp_table::operator(), "x"_a)
+    .def("get_num_segments", &Ramp_table::get_num_segments)
+    .def("get_order", &Ramp_table::get_order);
+
+  py::enum_<Ramps::Clock>(m, "Ramp_clock")
+    .value("turn", Ramps::Clock::turn)
+    .value("time", Ramps::Clock::time);
+
+  py::class_<syn::checkpoint_options>(m, "checkpoint_options")
+    .def(py::init<>())
+    .def_readwrite("format", &syn::checkpoint_options::format)
+    .def_readwrite("stage_dir", &syn::checkpoint_options::stage_dir);
+
   // Propagator::Lattice_element_slices
   py::class_<Propagator::Lattice_element_slices>(m, "Lattice_element_slices")
     .def(
@@ -69,6 +98,12 @@ PYBIND11_MODULE(simulation, m)
 
     .def("get_final_checkpoint", &Propagator::get_final_checkpoint)
 
+    .def("set_checkpoint_options",
+         &Propagator::set_checkpoint_options,
+         "options"_a)
+
+    .def("get_checkpoint_options", &Propagator::get_checkpoint_options)
+
     ;
 
   // chormaticities_t
@@ -394,6 +429,15 @@ PYBIND11_MODULE(simulation, m)
       "turn_num)",
       "action"_a)
 
+    .def("reg_ramp",
+         &Bunch_simulator::reg_ramp,
+         "Ramp an attribute of the named elements with a Ramp_table.",
+         "element_name"_a,
+         "attribute"_a,
+         "table"_a,
+         "clock"_a = Ramps::Clock::turn,
+         "every_step"_a = false)
+
     .def(
       "reg_diag_per_turn",
       [](Bunch_simulator& self,
@@ -453,6 +497,16 @@ PYBIND11_MODULE(simulation, m)
          "bunch_idx"_a = 0,
          "train_idx"_a = 0)
 
+    .def("set_diag_async",
+         &Bunch_simulator::set_diag_async,
+         "Write the diagnostics registered afterwards asynchronously, "
+         "in batches of queue_depth updates. 0 turns it off.",
+         "queue_depth"_a)
+
+    .def("diag_drain",
+         &Bunch_simulator::diag_drain,
+         "Write out all queued async diagnostics.")
+
     .def("current_turn",
          &Bunch_simulator::current_turn,
          "Get the current simulation turn.")
@@ -499,4 +553,35 @@ PYBIND11_MODULE(simulation, m)
 
            sim.populate_6d(seed, means, covars);
          });
+
+  // Ensemble
+  py::class_<Ensemble>(m, "Ensemble")
+    .def(py::init<Lattice const&, int, int, Commxx const&>(),
+         "Runs many small independent simulations in one job.",
+         "lattice"_a,
+         "num_members"_a,
+         "group_size"_a = 1,
+         "comm"_a = Commxx())
+
+    .def("run",
+         &Ensemble::run,
+         "Run all the members. fn(idx, lattice, group_comm) returns the "
+         "list of results of member idx.",
+         "fn"_a)
+
+    .def("write",
+         &Ensemble::write,
+         "Write the results of the last run to an hdf5 file.",
+         "filename"_a)
+
+    .def("get_num_members", &Ensemble::get_num_members)
+    .def("get_num_groups", &Ensemble::get_num_groups)
+    .def("get_group", &Ensemble::get_group)
+    .def("get_group_comm",
+         &Ensemble::get_group_comm,
+         py::return_value_policy::reference_internal)
+    .def("get_lattice",
+         &Ensemble::get_lattice,
+         py::return_value_policy::reference_internal)
+    .def("get_results", &Ensemble::get_results);
 }
@@ -1,5 +1,7 @@
 #include "synergia/utils/catch.hpp"
 
+#include <filesystem>
+
 #include "synergia/simulation/bunch_simulator.h"
 #include "synergia/simulation/bunch_simulator_impl.h"
 
@@ -565,17 +567,197 @@ TEST_CASE("serialization of two bunch trains (4 and 2 bunches)", "[Bunch_simulat
     }
 }
 
+TEST_CASE("binary serialization", "[Bunch_simulator]")
+{
+    int mpi_size = Commxx::world_size();
 
+    const size_t nb_pt = 4;
+    const size_t nb_st = 2;
 
+    const double spacing = 1.0;
 
+    if (mpi_size == 1 || mpi_size == 3 || mpi_size == 6)
+    {
+        std::stringstream ss;
 
+        {
+            // save
+            auto comm = Commxx();
+            auto sim = Bunch_simulator::create_two_trains_simulator(
+                    ref, ref, total_num, real_num, nb_pt, nb_st, spacing, spacing, comm );
 
+            sim.set_max_turns(10);
+            sim.inc_turn();
 
+            sim.dump_binary(ss);
+        }
 
+        {
+            // load
+            auto sim = Bunch_simulator::load_binary(ss);
 
+            CHECK(sim.current_turn() == 1);
+            CHECK(sim.max_turns() == 10);
+            CHECK(sim[0].get_num_bunches() == nb_pt);
+            CHECK(sim[1].get_num_bunches() == nb_st);
+        }
+    }
+}
 
+TEST_CASE("global state on a different number of ranks", "[Bunch_simulator]")
+{
+    int mpi_size = Commxx::world_size();
+    int mpi_rank = Commxx::world_rank();
 
+    const size_t nb_pt = 2;
+    const double spacing = 1.0;
 
+    if (mpi_size == 2 || mpi_size == 4 || mpi_size == 6)
+    {
+        const std::string dir = "global_state_cp";
+
+        if (mpi_rank == 0) std::filesystem::create_directories(dir);
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        double id_sum = 0.0;
+
+        {
+            // save on all ranks
+            auto sim = Bunch_simulator::create_bunch_train_simulator(
+                    ref, total_num, real_num, nb_pt, spacing, Commxx() );
+
+            sim.set_max_turns(10);
+            sim.inc_turn();
+
+            for (auto& bunch : sim[0].get_bunches()) {
+                bunch.checkout_particles();
+                auto hp = bunch.get_host_particles();
+
+                for (int p = 0; p < bunch.get_local_num(); ++p)
+                    id_sum += hp(p, Bunch::id);
+            }
+
+            MPI_Allreduce(MPI_IN_PLACE, &id_sum, 1, MPI_DOUBLE, MPI_SUM,
+                    MPI_COMM_WORLD);
+
+            std::stringstream ss;
+
+            Bunch_simulator::set_checkpoint_dir(dir);
+            sim.dump_binary(ss);
+            sim.dump_global_state(dir);
+            Bunch_simulator::set_checkpoint_dir(".");
+        }
+
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        {
+            // load on rank 0 only, which then holds both bunches
+            auto comm = Commxx().group({0});
+
+            if (mpi_rank == 0) {
+                auto sim = Bunch_simulator::load_global_state(dir, comm);
+
+                CHECK(sim.current_turn() == 1);
+                CHECK(sim.max_turns() == 10);
+                CHECK(sim[0].get_num_bunches() == nb_pt);
+                CHECK(sim[0].get_num_local_bunches() == nb_pt);
 
+                double sum = 0.0;
 
+                for (auto& bunch : sim[0].get_bunches()) {
+                    CHECK(bunch.get_total_num() == total_num);
+                    CHECK(bunch.get_local_num() == total_num);
+                    CHECK(bunch.get_real_num() == Approx(real_num));
 
+                    bunch.checkout_particles();
+                    auto hp = bunch.get_host_particles();
+
+                    for (int p = 0; p < bunch.get_local_num(); ++p)
+                        sum += hp(p, Bunch::id);
+                }
+
+                CHECK(sum == id_sum);
+            }
+        }
+    }
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+TEST_CASE("checkpoint particles in the legacy layout", "[Bunch_simulator]")
+{
+    int mpi_size = Commxx::world_size();
+    int mpi_rank = Commxx::world_rank();
+
+    const std::string dir = "legacy_cp_" + std::to_string(mpi_size);
+
+    if (mpi_rank == 0) std::filesystem::create_directories(dir);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    std::string data;
+
+    {
+        auto sim = Bunch_simulator::create_single_bunch_simulator(
+                ref, total_num, real_num, Commxx() );
+
+        auto& bunch = sim.get_bunch();
+        bunch.checkout_particles();
+        auto hp = bunch.get_host_particles();
+
+        for (int p = 0; p < bunch.get_local_num(); ++p)
+            hp(p, Bunch::x) = hp(p, Bunch::id);
+
+        bunch.checkin_particles();
+
+        Bunch_simulator::set_checkpoint_dir(dir);
+        data = sim.dump();
+        Bunch_simulator::set_checkpoint_dir(".");
+
+        // rewrite the particle file as the checkpoints of before the rank
+        // independent layout did, the whole arrays of every rank one after
+        // another
+        Hdf5_file file(dir + "/bunch_simulator.h5",
+                Hdf5_file::Flag::truncate, Commxx());
+
+        for (auto pg : {ParticleGroup::regular, ParticleGroup::spectator}) {
+            auto label = BunchParticles::group_label(pg);
+            auto parts = bunch.get_host_particles(pg);
+            auto masks = bunch.get_host_particle_masks(pg);
+
+            file.write("bunch_particles_" + label + "_parts_0",
+                    parts.data(), parts.span(), true);
+            file.write("bunch_particles_" + label + "_masks_0",
+                    masks.data(), masks.span(), true);
+        }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    {
+        Bunch_simulator::set_checkpoint_dir(dir);
+        auto sim = Bunch_simulator::load_from_string(data);
+        Bunch_simulator::set_checkpoint_dir(".");
+
+        auto& bunch = sim.get_bunch();
+        CHECK(bunch.get_total_num() == total_num);
+
+        bunch.checkout_particles();
+        auto hp = bunch.get_host_particles();
+
+        for (int p = 0; p < bunch.get_local_num(); ++p)
+            CHECK(hp(p, Bunch::x) == hp(p, Bunch::id));
+    }
+}
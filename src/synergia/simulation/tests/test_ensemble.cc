@@ -0,0 +1,65 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/simulation/ensemble.h"
+
+namespace {
+    Lattice
+    make_lattice()
+    {
+        Lattice_element o("drift", "o");
+        o.set_double_attribute("l", 1.5);
+
+        Lattice lattice("ensemble");
+        lattice.append(o);
+        lattice.set_reference_particle(Reference_particle(1, 0.938272, 1.5));
+
+        return lattice;
+    }
+}
+
+TEST_CASE("ensemble run", "[Ensemble]")
+{
+    Commxx comm;
+    const int num_members = 11;
+
+    for (int group_size = 1; group_size <= comm.size(); ++group_size) {
+        if (comm.size() % group_size) continue;
+
+        Ensemble ens(make_lattice(), num_members, group_size);
+
+        CHECK(ens.get_num_groups() == comm.size() / group_size);
+        CHECK(ens.get_group_comm().size() == group_size);
+
+        ens.run([](int idx, Lattice const& lattice, Commxx const& gc) {
+            return std::vector<double>{
+                (double)idx, (double)gc.size(), lattice.get_length()};
+        });
+
+        auto res = ens.get_results();
+
+        REQUIRE(res.extent(0) == num_members);
+        REQUIRE(res.extent(1) == 3);
+
+        // every member ran exactly once, by a group of the right size
+        for (int m = 0; m < num_members; ++m) {
+            CHECK(res(m, 0) == m);
+            CHECK(res(m, 1) == group_size);
+            CHECK(res(m, 2) == Approx(1.5));
+        }
+    }
+}
+
+TEST_CASE("ensemble bad group size", "[Ensemble]")
+{
+    Commxx comm;
+    CHECK_THROWS(Ensemble(make_lattice(), 4, comm.size() + 1));
+}
+
+TEST_CASE("ensemble mismatched results", "[Ensemble]")
+{
+    Ensemble ens(make_lattice(), 4);
+
+    CHECK_THROWS(ens.run([](int idx, Lattice const&, Commxx const&) {
+        return std::vector<double>(idx % 2 + 1, 0.0);
+    }));
+}
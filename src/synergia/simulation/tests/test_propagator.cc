@@ -0,0 +1,103 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/lattice/lattice.h"
+#include "synergia/simulation/independent_stepper_elements.h"
+#include "synergia/simulation/propagator.h"
+
+#include <iterator>
+#include <memory>
+
+namespace {
+    Lattice
+    make_lattice()
+    {
+        Lattice_element q("quadrupole", "q");
+        q.set_double_attribute("l", 0.5);
+        q.set_double_attribute("k1", 0.1);
+
+        Lattice_element o("drift", "o");
+        o.set_double_attribute("l", 2.5);
+
+        Lattice_element m("marker", "m");
+
+        Lattice lattice("slices");
+        lattice.append(q);
+        lattice.append(o);
+        lattice.append(m);
+        lattice.set_reference_particle(Reference_particle(1, 0.938272, 1.5));
+
+        return lattice;
+    }
+
+    // element name, left and right of the slices of two steps per element
+    const std::vector<std::tuple<std::string, double, double>> expected{
+        {"q", 0.0, 0.25},
+        {"q", 0.25, 0.5},
+        {"o", 0.0, 1.25},
+        {"o", 1.25, 2.5},
+        {"m", 0.0, 0.0}};
+
+    void
+    check_slices(Propagator& p)
+    {
+        auto& slices = p.get_lattice_element_slices();
+        REQUIRE(slices.size() == expected.size());
+
+        int i = 0;
+        for (auto const& slice : slices) {
+            CHECK(slice.get_lattice_element().get_name() ==
+                  std::get<0>(expected[i]));
+            CHECK(slice.get_left() == Approx(std::get<1>(expected[i])));
+            CHECK(slice.get_right() == Approx(std::get<2>(expected[i])));
+
+            CHECK(&slices[i] == &slice);
+            ++i;
+        }
+
+        CHECK(i == expected.size());
+    }
+}
+
+TEST_CASE("flat slice array", "[Propagator]")
+{
+    auto p = std::make_unique<Propagator>(make_lattice(),
+                                          Independent_stepper_elements(2));
+    check_slices(*p);
+
+    // the slices point into the steps and the lattice, which move with
+    // the propagator
+    Propagator moved(std::move(*p));
+    p.reset();
+
+    check_slices(moved);
+    CHECK(&moved.get_lattice_element_slices()[0].get_lattice_element() ==
+          &moved.get_lattice_elements().front());
+}
+
+TEST_CASE("Slice_iterator", "[Propagator]")
+{
+    Propagator p(make_lattice(), Independent_stepper_elements(2));
+    auto& slices = p.get_lattice_element_slices();
+
+    auto it = slices.begin();
+    CHECK(it == slices.begin());
+    CHECK(it != slices.end());
+    CHECK(std::distance(slices.begin(), slices.end()) == slices.size());
+
+    // post increment returns the old position
+    auto old = it++;
+    CHECK(old == slices.begin());
+    CHECK(&*old == &slices[0]);
+    CHECK(&*it == &slices[1]);
+
+    ++it;
+    CHECK(it->get_lattice_element().get_name() == "o");
+    CHECK(it->get_left() == Approx(0.0));
+
+    std::advance(it, 3);
+    CHECK(it == slices.end());
+
+    // slices are modifiable through the iterator
+    slices.begin()->set_reference_ct(0.125);
+    CHECK(slices[0].get_reference_ct() == 0.125);
+}
@@ -0,0 +1,130 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/foundation/physical_constants.h"
+#include "synergia/lattice/lattice.h"
+#include "synergia/simulation/ramp.h"
+
+#include <cereal/archives/json.hpp>
+#include <sstream>
+
+namespace {
+    Lattice
+    make_lattice()
+    {
+        Lattice_element q("quadrupole", "q");
+        q.set_double_attribute("l", 0.5);
+        q.set_double_attribute("k1", 0.1);
+
+        Lattice_element o("drift", "o");
+        o.set_double_attribute("l", 2.5);
+
+        Lattice lattice("ramp");
+        lattice.append(q);
+        lattice.append(o);
+        lattice.set_reference_particle(Reference_particle(1, 0.938272, 1.5));
+
+        return lattice;
+    }
+}
+
+TEST_CASE("ramp table", "[Ramp_table]")
+{
+    // 1 + x^2 on [0, 2), then 5 - (x - 2) on [2, 4]
+    Ramp_table t({0.0, 2.0, 4.0}, {{1.0, 0.0, 1.0}, {5.0, -1.0, 0.0}});
+
+    CHECK(t.get_num_segments() == 2);
+    CHECK(t.get_order() == 3);
+
+    CHECK(t(0.0) == Approx(1.0));
+    CHECK(t(1.5) == Approx(3.25));
+    CHECK(t(2.0) == Approx(5.0));
+    CHECK(t(3.0) == Approx(4.0));
+
+    // held at the ends
+    CHECK(t(-1.0) == Approx(1.0));
+    CHECK(t(10.0) == Approx(3.0));
+
+    auto l = Ramp_table::linear({0.0, 10.0, 20.0}, {0.0, 1.0, -1.0});
+    CHECK(l(5.0) == Approx(0.5));
+    CHECK(l(15.0) == Approx(0.0));
+
+    CHECK(Ramp_table::constant(2.5)(100.0) == Approx(2.5));
+
+    CHECK_THROWS(Ramp_table({0.0, 1.0}, {}));
+    CHECK_THROWS(Ramp_table({1.0, 0.0}, {{1.0}}));
+    CHECK_THROWS(Ramp_table({0.0, 1.0, 2.0}, {{1.0}, {1.0, 2.0}}));
+}
+
+TEST_CASE("ramps turn clock", "[Ramps]")
+{
+    auto lattice = make_lattice();
+
+    Ramps ramps;
+    ramps.add("q", "k1", Ramp_table::linear({0.0, 10.0}, {0.0, 1.0}));
+
+    ramps.turn_start(lattice, 0);
+    CHECK(lattice.get_element(0).get_double_attribute("k1") == Approx(0.0));
+
+    for (int turn = 0; turn < 4; ++turn)
+        ramps.turn_end(lattice, turn, lattice.get_reference_particle());
+
+    CHECK(lattice.get_element(0).get_double_attribute("k1") == Approx(0.4));
+
+    // a constant value leaves the element revision alone
+    auto rev = lattice.get_element(0).get_revision();
+    ramps.turn_start(lattice, 4);
+    CHECK(lattice.get_element(0).get_revision() == rev);
+
+    Ramps bad;
+    bad.add("nothere", "k1", Ramp_table::constant(1.0));
+    CHECK_THROWS(bad.turn_start(lattice, 0));
+}
+
+TEST_CASE("ramps time clock", "[Ramps]")
+{
+    auto lattice = make_lattice();
+
+    // the bunch is faster than the lattice reference particle, the clock
+    // follows the bunch
+    Reference_particle ref(1, 0.938272, 3.0);
+    REQUIRE(ref.get_beta() >
+            lattice.get_reference_particle().get_beta() + 0.01);
+
+    double turn_time = lattice.get_length() / (ref.get_beta() * pconstants::c);
+
+    Ramps ramps;
+    ramps.add("q",
+              "k1",
+              Ramp_table::linear({0.0, 100 * turn_time}, {0.0, 1.0}),
+              Ramps::Clock::time,
+              true);
+
+    ramps.turn_start(lattice, 0);
+    ramps.turn_end(lattice, 0, ref);
+    ramps.turn_end(lattice, 1, ref);
+
+    CHECK(ramps.get_time() == Approx(2 * turn_time));
+    CHECK(lattice.get_element(0).get_double_attribute("k1") == Approx(0.02));
+
+    // half way through the turn
+    ref.set_trajectory(2, lattice.get_length(), 0.5 * lattice.get_length());
+
+    ramps.step_end(lattice, 2, ref);
+    CHECK(lattice.get_element(0).get_double_attribute("k1") == Approx(0.025));
+
+    // saved and restored with the checkpoints
+    std::stringstream ss;
+    {
+        cereal::JSONOutputArchive ar(ss);
+        ar(ramps);
+    }
+
+    Ramps loaded;
+    {
+        cereal::JSONInputArchive ar(ss);
+        ar(loaded);
+    }
+
+    CHECK(loaded.size() == 1);
+    CHECK(loaded.get_time() == Approx(ramps.get_time()));
+}
@@ -15,8 +15,13 @@ protected:
   int lower;
   int nx;
 
+  // number of 2d arrays transformed together, stored one after the other
+  int batch;
+
 public:
-  Distributed_fft2d_base() : shape(), comm(Commxx::Null), lower(0), nx(0) {}
+  Distributed_fft2d_base()
+    : shape(), comm(Commxx::Null), lower(0), nx(0), batch(1)
+  {}
 
   virtual ~Distributed_fft2d_base() {}
 
@@ -31,6 +36,12 @@ public:
     return lower + nx;
   }
 
+  int
+  get_batch() const
+  {
+    return batch;
+  }
+
   std::array<int, 2> const&
   get_shape() const
   {
@@ -5,7 +5,8 @@ Distributed_fft2d::Distributed_fft2d() : Distributed_fft2d_base(), plan() {}
 
 void
 Distributed_fft2d::construct(std::array<int, 2> const& new_shape,
-                             Commxx const& new_comm)
+                             Commxx const& new_comm,
+                             int new_batch)
 {
   cufftDestroy(plan);
 
@@ -16,13 +17,26 @@ Distributed_fft2d::construct(std::array<int, 2> const& new_shape,
                              "for CUDA implementation");
   }
 
+  if (new_batch < 1) {
+    throw std::runtime_error("Distributed_fft2d: batch must be >= 1");
+  }
+
   shape = new_shape;
   comm = new_comm;
+  batch = new_batch;
 
   lower = 0;
   nx = shape[0];
 
-  cufftPlan2d(&plan, shape[0], shape[1], CUFFT_Z2Z);
+  if (batch > 1) {
+    int n[2] = {shape[0], shape[1]};
+    int dist = shape[0] * shape[1];
+
+    cufftPlanMany(
+      &plan, 2, n, nullptr, 1, dist, nullptr, 1, dist, CUFFT_Z2Z, batch);
+  } else {
+    cufftPlan2d(&plan, shape[0], shape[1], CUFFT_Z2Z);
+  }
 }
 
 void
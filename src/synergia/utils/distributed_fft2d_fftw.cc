@@ -15,7 +15,8 @@ Distributed_fft2d::Distributed_fft2d()
 
 void
 Distributed_fft2d::construct(std::array<int, 2> const& new_shape,
-                             Commxx const& new_comm)
+                             Commxx const& new_comm,
+                             int new_batch)
 {
   if (data || workspace) {
     fftw_destroy_plan(plan);
@@ -31,6 +32,15 @@ Distributed_fft2d::construct(std::array<int, 2> const& new_shape,
 
   if (new_comm.is_null()) return;
 
+  if (new_batch < 1) {
+    throw std::runtime_error("Distributed_fft2d: batch must be >= 1");
+  }
+
+  if (new_batch > 1 && new_comm.size() != 1) {
+    throw std::runtime_error("Distributed_fft2d: number of processors must "
+                             "be 1 for batched transforms");
+  }
+
   if (new_comm.size() / 2 >= new_shape[0] / 2) {
     throw std::runtime_error("Distributed_fft2d: (number of processors)/2 "
                              "must be <= shape[0]/2");
@@ -38,6 +48,50 @@ Distributed_fft2d::construct(std::array<int, 2> const& new_shape,
 
   shape = new_shape;
   comm = new_comm;
+  batch = new_batch;
+
+  // batched transforms, contiguous arrays on a single rank
+  if (batch > 1) {
+    int n[2] = {shape[0], shape[1]};
+    int dist = shape[0] * shape[1];
+
+    data = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * dist * batch);
+    workspace =
+      (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * dist * batch);
+
+    plan = fftw_plan_many_dft(2,
+                              n,
+                              batch,
+                              data,
+                              nullptr,
+                              1,
+                              dist,
+                              workspace,
+                              nullptr,
+                              1,
+                              dist,
+                              FFTW_FORWARD,
+                              FFTW_ESTIMATE);
+
+    inv_plan = fftw_plan_many_dft(2,
+                                  n,
+                                  batch,
+                                  workspace,
+                                  nullptr,
+                                  1,
+                                  dist,
+                                  data,
+                                  nullptr,
+                                  1,
+                                  dist,
+                                  FFTW_BACKWARD,
+                                  FFTW_ESTIMATE);
+
+    lower = 0;
+    nx = shape[0];
+
+    return;
+  }
 
   ptrdiff_t local_nx, local_x_start;
   ptrdiff_t fftw_local_size =
@@ -71,13 +125,13 @@ Distributed_fft2d::transform(karray1d_dev& in, karray1d_dev& out)
 
   memcpy((void*)data,
          (void*)&in(lower * shape[1] * 2),
-         nx * shape[1] * sizeof(double) * 2);
+         batch * nx * shape[1] * sizeof(double) * 2);
 
   fftw_execute(plan);
 
   memcpy((void*)&out(lower * shape[1] * 2),
          (void*)(workspace),
-         nx * shape[1] * sizeof(double) * 2);
+         batch * nx * shape[1] * sizeof(double) * 2);
 }
 
 void
@@ -88,13 +142,13 @@ Distributed_fft2d::inv_transform(karray1d_dev& in, karray1d_dev& out)
 
   memcpy((void*)workspace,
          (void*)&in(lower * shape[1] * 2),
-         nx * shape[1] * sizeof(double) * 2);
+         batch * nx * shape[1] * sizeof(double) * 2);
 
   fftw_execute(inv_plan);
 
   memcpy((void*)&out(lower * shape[1] * 2),
          (void*)data,
-         nx * shape[1] * sizeof(double) * 2);
+         batch * nx * shape[1] * sizeof(double) * 2);
 }
 
 Distributed_fft2d::~Distributed_fft2d()
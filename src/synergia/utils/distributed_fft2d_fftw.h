@@ -16,7 +16,11 @@ public:
   Distributed_fft2d();
   virtual ~Distributed_fft2d();
 
-  void construct(std::array<int, 2> const& shape, Commxx const& comm);
+  // batch > 1 transforms that many arrays at once, each of the given
+  // shape. Batched transforms are local, the comm must have one rank
+  void construct(std::array<int, 2> const& shape,
+                 Commxx const& comm,
+                 int batch = 1);
 
   void transform(karray1d_dev& in, karray1d_dev& out);
 
@@ -45,6 +45,42 @@ Hdf5_file::Hdf5_file(std::string const& file_name,
     open(flag);
 }
 
+#ifdef USE_PARALLEL_HDF5
+namespace {
+    // MPI-IO hints from the io tuning parameters
+    MPI_Info
+    io_hints(syn::io_tuning_t const& tuning)
+    {
+        if (!tuning.cb_nodes && !tuning.cb_buffer_size && !tuning.alignment)
+            return MPI_INFO_NULL;
+
+        MPI_Info info;
+        MPI_Info_create(&info);
+
+        if (tuning.cb_nodes || tuning.cb_buffer_size) {
+            MPI_Info_set(info, "romio_cb_write", "enable");
+            MPI_Info_set(info, "romio_cb_read", "enable");
+        }
+
+        if (tuning.cb_nodes)
+            MPI_Info_set(
+                info, "cb_nodes", std::to_string(tuning.cb_nodes).c_str());
+
+        if (tuning.cb_buffer_size)
+            MPI_Info_set(info,
+                         "cb_buffer_size",
+                         std::to_string(tuning.cb_buffer_size).c_str());
+
+        if (tuning.alignment)
+            MPI_Info_set(info,
+                         "striping_unit",
+                         std::to_string(tuning.alignment).c_str());
+
+        return info;
+    }
+}
+#endif
+
 void
 Hdf5_file::open(Flag flag)
 {
@@ -60,10 +96,22 @@ Hdf5_file::open(Flag flag)
     while ((attempts < 5) && fail) {
         try {
             Hdf5_handler plist_id = H5Pcreate(H5P_FILE_ACCESS);
+            auto const& tuning = syn::io_tuning();
+
+            // align the large objects, e.g., to the stripes of the fs
+            if (tuning.alignment)
+                H5Pset_alignment(plist_id, tuning.alignment, tuning.alignment);
 
 #ifdef USE_PARALLEL_HDF5
-            MPI_Info info = MPI_INFO_NULL;
+            MPI_Info info = io_hints(tuning);
             H5Pset_fapl_mpio(plist_id, *comm, info);
+            if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+
+#if H5_VERSION_GE(1, 10, 0)
+            // metadata reads and writes are collective
+            H5Pset_all_coll_metadata_ops(plist_id, true);
+            H5Pset_coll_metadata_write(plist_id, true);
+#endif
 #endif
 
             if (flag == Hdf5_file::Flag::truncate) {
@@ -109,9 +109,11 @@ class Hdf5_file {
     //   write_collective("part", part[0:1][0:6]) -> "part" : part[0:3][0:6]
     template <typename T>
     void
-    write_collective(std::string const& name, T const& data) const
+    write_collective(std::string const& name,
+                     T const& data,
+                     syn::storage_t const& storage = {}) const
     {
-        write(name, data, true);
+        write(name, data, true, storage);
     }
 
     // no gather, only the root rank will execute the write
@@ -125,11 +127,16 @@ class Hdf5_file {
         write(name, data, false);
     }
 
+    // storage sets the precision and compression of the dataset in file
     template <typename T>
     void
-    write(std::string const& name, T const& data, bool collective = false) const
+    write(std::string const& name,
+          T const& data,
+          bool collective = false,
+          syn::storage_t const& storage = {}) const
     {
-        Hdf5_writer::write(h5file, name, data, collective, *comm, root_rank);
+        Hdf5_writer::write(
+            h5file, name, data, collective, *comm, root_rank, storage);
     }
 
     template <typename T>
@@ -137,10 +144,11 @@ class Hdf5_file {
     write(std::string const& name,
           T const* data,
           size_t len,
-          bool collective = false) const
+          bool collective = false,
+          syn::storage_t const& storage = {}) const
     {
         Hdf5_writer::write(
-            h5file, name, data, len, collective, *comm, root_rank);
+            h5file, name, data, len, collective, *comm, root_rank, storage);
     }
 
     // same as write_single(), except this will do append instead of overwrite
@@ -174,6 +182,23 @@ class Hdf5_file {
         w->second.append(data, collective);
     }
 
+    // append several slabs in one write, the first dim of data is the
+    // number of slabs
+    template <typename T>
+    void
+    append_slabs(std::string const& name, T const& data, bool collective)
+    {
+        auto w = seq_writers.find(name);
+        if (w == seq_writers.end()) {
+            w = seq_writers
+                    .emplace(name,
+                             Hdf5_seq_writer(h5file, name, *comm, root_rank))
+                    .first;
+        }
+
+        w->second.append_slabs(data, collective);
+    }
+
     // read the dataset to all ranks
     template <typename T>
     T
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
 
 #include "synergia/utils/commxx.h"
 #include "synergia/utils/hdf5_misc.h"
@@ -28,6 +30,111 @@ namespace {
             ranks.begin(), ranks.end(), std::not_equal_to<>());
         return it == ranks.end();
     }
+
+    template <class T>
+    void
+    env_override(char const* name, T& val)
+    {
+        auto str = std::getenv(name);
+        if (!str || !*str) return;
+
+        char* end = nullptr;
+        auto v = std::strtoull(str, &end, 10);
+
+        if (*end)
+            throw std::runtime_error(std::string("invalid value of ") + name +
+                                     ": " + str);
+
+        val = v;
+    }
+
+    syn::io_tuning_t
+    tuning_from_env()
+    {
+        syn::io_tuning_t t;
+
+        env_override("SYNERGIA_HDF5_CHUNK_BYTES", t.chunk_bytes);
+        env_override("SYNERGIA_HDF5_SEQ_CHUNK_BYTES", t.seq_chunk_bytes);
+        env_override("SYNERGIA_HDF5_ALIGNMENT", t.alignment);
+        env_override("SYNERGIA_HDF5_CB_NODES", t.cb_nodes);
+        env_override("SYNERGIA_HDF5_CB_BUFFER_SIZE", t.cb_buffer_size);
+
+        return t;
+    }
+}
+
+syn::io_tuning_t&
+syn::io_tuning()
+{
+    static io_tuning_t t = tuning_from_env();
+    return t;
+}
+
+std::vector<hsize_t>
+syn::chunk_dims(std::vector<hsize_t> const& dims,
+                size_t atomic_size,
+                size_t target_bytes)
+{
+    auto chunk = dims;
+    if (chunk.empty()) return chunk;
+
+    // size of one element of the first dim
+    size_t slab_size = atomic_size;
+    for (int i = 1; i < dims.size(); ++i)
+        slab_size *= dims[i];
+
+    hsize_t n = (slab_size && slab_size < target_bytes)
+                    ? target_bytes / slab_size
+                    : 1;
+
+    // fixed size datasets cannot have chunks larger than the dataset
+    chunk[0] = dims[0] ? std::min(n, dims[0]) : n;
+
+    return chunk;
+}
+
+hid_t
+syn::file_data_type(data_info_t const& di, storage_t const& storage)
+{
+    if (storage.single_precision &&
+        H5Tequal(di.atomic_type, H5T_NATIVE_DOUBLE) > 0)
+        return H5Tcopy(H5T_NATIVE_FLOAT);
+
+    return H5Tcopy(di.atomic_type);
+}
+
+hid_t
+syn::dataset_create_plist(std::vector<hsize_t> const& dims,
+                          data_info_t const& di,
+                          storage_t const& storage)
+{
+    hid_t plist = H5Pcreate(H5P_DATASET_CREATE);
+    if (plist < 0) throw Hdf5_exception();
+
+    // the whole dataset is always written, skip the fill
+    H5Pset_fill_time(plist, H5D_FILL_TIME_NEVER);
+
+    // chunking and filters only for non-empty arrays
+    bool empty = dims.empty();
+    for (auto d : dims)
+        if (d == 0) empty = true;
+
+    if (storage.compression && !empty) {
+#if defined USE_PARALLEL_HDF5 && !H5_VERSION_GE(1, 10, 2)
+        H5Pclose(plist);
+        throw std::runtime_error(
+            "compressed datasets need parallel HDF5 1.10.2 or newer");
+#endif
+
+        auto chunk =
+            chunk_dims(dims, di.atomic_data_size, io_tuning().chunk_bytes);
+
+        H5Pset_chunk(plist, chunk.size(), chunk.data());
+        H5Pset_shuffle(plist);
+        H5Pset_deflate(plist, storage.compression);
+    }
+
+    return plist;
 }
 
 std::vector<hsize_t>
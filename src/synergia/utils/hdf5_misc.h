@@ -171,6 +171,13 @@ hdf5_atomic_data_type<int>()
     return H5Tcopy(H5T_NATIVE_INT);
 }
 
+template <>
+inline hid_t
+hdf5_atomic_data_type<float>()
+{
+    return H5Tcopy(H5T_NATIVE_FLOAT);
+}
+
 template <>
 inline hid_t
 hdf5_atomic_data_type<double>()
@@ -189,6 +196,55 @@ namespace syn {
         size_t size;
     };
 
+    // how a dataset is stored in the file. The data in memory is
+    // converted by the library on write and read
+    struct storage_t {
+        // double precision data is stored as float
+        bool single_precision = false;
+
+        // deflate level (1-9) with byte shuffling, 0 for no compression.
+        // compressed datasets are chunked
+        int compression = 0;
+    };
+
+    // I/O tuning parameters. Defaults can be overridden in the environment,
+    //
+    //   SYNERGIA_HDF5_CHUNK_BYTES      chunk size of bulk (e.g., particle)
+    //                                  datasets, default 1MB
+    //   SYNERGIA_HDF5_SEQ_CHUNK_BYTES  chunk size of appended datasets,
+    //                                  default 8KB
+    //   SYNERGIA_HDF5_ALIGNMENT        align objects larger than this to
+    //                                  multiples of it in the file, usually
+    //                                  the stripe size. default 0 (off)
+    //   SYNERGIA_HDF5_CB_NODES         MPI-IO collective buffering nodes
+    //   SYNERGIA_HDF5_CB_BUFFER_SIZE   MPI-IO collective buffer size
+    //
+    // the MPI-IO hints only apply to the parallel HDF5 builds
+    struct io_tuning_t {
+        size_t chunk_bytes = 1 << 20;
+        size_t seq_chunk_bytes = 8192;
+        size_t alignment = 0;
+        int cb_nodes = 0;
+        size_t cb_buffer_size = 0;
+    };
+
+    // process wide tuning, read from the environment on first use
+    io_tuning_t& io_tuning();
+
+    // chunk dims of a dataset, the dims other than the first are kept
+    // whole and the first dim is sized to about target_bytes per chunk
+    std::vector<hsize_t> chunk_dims(std::vector<hsize_t> const& dims,
+                                    size_t atomic_size,
+                                    size_t target_bytes);
+
+    // type of the dataset in file
+    hid_t file_data_type(data_info_t const& di, storage_t const& storage);
+
+    // dataset creation property list for a fixed size dataset
+    hid_t dataset_create_plist(std::vector<hsize_t> const& dims,
+                               data_info_t const& di,
+                               storage_t const& storage);
+
     template <class T>
     data_info_t
     extract_data_info(T const& t)
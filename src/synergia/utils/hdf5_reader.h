@@ -212,9 +212,13 @@ class Hdf5_reader {
             Hdf5_handler dset = H5Dopen(file, name.c_str(), H5P_DEFAULT);
             Hdf5_handler filespace = H5Dget_space(dset);
 
-            // get and check the datatype
+            // get and check the datatype. floating point data stored
+            // in a different precision gets converted by the library
             Hdf5_handler type = H5Dget_type(dset);
-            if (H5Tequal(type, di.atomic_type) <= 0) {
+            bool both_float = H5Tget_class(type) == H5T_FLOAT &&
+                              H5Tget_class(di.atomic_type) == H5T_FLOAT;
+
+            if (!both_float && H5Tequal(type, di.atomic_type) <= 0) {
                 error = 1;
                 MPI_Bcast(&error, 1, MPI_INT, root_rank, comm);
                 throw std::runtime_error("wrong atomic data type");
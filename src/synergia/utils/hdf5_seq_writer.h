@@ -54,6 +54,50 @@ class Hdf5_seq_writer {
         // collect data dims
         auto all_dims0 = syn::collect_dims(di.dims, collective, comm, root);
 
+        // promote the data dim and set the first dim to 1
+        di.dims.resize(di.dims.size() + 1);
+        for (int i = di.dims.size() - 1; i > 0; --i)
+            di.dims[i] = di.dims[i - 1];
+        di.dims[0] = 1;
+
+        append_impl(di, all_dims0, false);
+    }
+
+    // appends several slabs at once. The first dim of the data is the
+    // number of slabs, the rest is the same as the data of append().
+    // Non-collective slabs are written from the root rank only
+    template <typename T>
+    void
+    append_slabs(T const& data, bool collective)
+    {
+        auto di = syn::extract_data_info(data);
+
+        if (di.dims.size() == 0)
+            throw std::runtime_error(
+                "Hdf5_seq_writer: append_slabs on a scalar");
+
+        // dims of a single slab
+        std::vector<hsize_t> sdims(di.dims.begin() + 1, di.dims.end());
+        if (collective && sdims.size() == 0) {
+            sdims = {1};
+            di.dims.push_back(1);
+        }
+
+        auto all_dims0 = syn::collect_dims(sdims, collective, comm, root);
+
+        // nothing to append
+        if (di.dims[0] == 0) return;
+
+        append_impl(di, all_dims0, !collective);
+    }
+
+  private:
+    // di.dims[0] is the number of slabs
+    void
+    append_impl(syn::data_info_t& di,
+                std::vector<hsize_t> const& all_dims0,
+                bool root_only)
+    {
         // offsets for each rank (offsets of dim0 in the combined array)
         std::vector<hsize_t> offsets(mpi_size, 0);
         for (int r = 0; r < mpi_size - 1; ++r)
@@ -62,12 +106,6 @@ class Hdf5_seq_writer {
         // dim0 of the combined array
         hsize_t dim0 = offsets[mpi_size - 1] + all_dims0[mpi_size - 1];
 
-        // promote the data dim and set the first dim to 1
-        di.dims.resize(di.dims.size() + 1);
-        for (int i = di.dims.size() - 1; i > 0; --i)
-            di.dims[i] = di.dims[i - 1];
-        di.dims[0] = 1;
-
         // setup dataset
         if (!setup) {
             bool has = Hdf5_reader::has_dataset(file, name, comm, root);
@@ -91,9 +129,10 @@ class Hdf5_seq_writer {
             }
         }
 
-        do_append(di, offsets, all_dims0);
+        do_append(di, offsets, all_dims0, root_only);
     }
 
+  public:
     bool
     verify_dims(syn::data_info_t const& di, hsize_t dim0)
     {
@@ -111,7 +150,8 @@ class Hdf5_seq_writer {
                   hsize_t dim0,
                   bool has_dataset)
     {
-        const size_t good_chunk_size = 8192; // pulled out of air
+        // chunks of a few slabs for small slabs, see syn::io_tuning()
+        const size_t good_chunk_size = syn::io_tuning().seq_chunk_bytes;
 
         // extended data rank
         auto d_rank = di.dims.size();
@@ -192,8 +232,12 @@ class Hdf5_seq_writer {
     void
     do_append(syn::data_info_t const& di,
               std::vector<hsize_t> const& offsets,
-              std::vector<hsize_t> const& all_dims0)
+              std::vector<hsize_t> const& all_dims0,
+              bool root_only)
     {
+        // number of slabs in this append
+        hsize_t const nslabs = di.dims[0];
+
 #ifdef USE_PARALLEL_HDF5
         if (!file.valid()) throw std::runtime_error("invalid file handler");
 
@@ -205,8 +249,8 @@ class Hdf5_seq_writer {
         Hdf5_handler mspace =
             H5Screate_simple(dimsm.size(), dimsm.data(), NULL);
 
-        // increment and extend the dataset to the new size (last_dim+1)
-        ++fdims[0];
+        // extend the dataset to the new size (last_dim+nslabs)
+        fdims[0] += nslabs;
         herr_t res = H5Dset_extent(dataset, fdims.data());
         if (res < 0) throw Hdf5_exception();
 
@@ -229,14 +273,14 @@ class Hdf5_seq_writer {
         if (res < 0) throw Hdf5_exception();
 
         // increment the offset
-        ++offset[0];
+        offset[0] += nslabs;
 #else
 
         if (mpi_rank == root) {
             if (!file.valid()) throw std::runtime_error("invalid file handler");
 
-            // increment and extend the dataset to the new size (last_dim+1)
-            ++fdims[0];
+            // extend the dataset to the new size (last_dim+nslabs)
+            fdims[0] += nslabs;
             herr_t res = H5Dset_extent(dataset, fdims.data());
             if (res < 0) throw Hdf5_exception();
 
@@ -248,6 +292,7 @@ class Hdf5_seq_writer {
 
             // loop through ranks, recv and write
             for (int r = 0; r < mpi_size; ++r) {
+                if (root_only && r != root) continue;
                 if (dimsm.size() > 1) dimsm[1] = all_dims0[r];
 
                 // create dataspace for current data block (it looks like
@@ -309,8 +354,8 @@ class Hdf5_seq_writer {
             }
 
             // increment the offset
-            ++offset[0];
-        } else {
+            offset[0] += nslabs;
+        } else if (!root_only) {
             // local dims(counts)
             auto dimsm = di.dims;
             if (dimsm.size() > 1) dimsm[1] = all_dims0[mpi_rank];
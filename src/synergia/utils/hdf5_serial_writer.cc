@@ -22,7 +22,7 @@ Hdf5_serial_writer::do_setup(std::vector<hsize_t> const& data_dims)
     dims[data_rank] = 1;
     max_dims[data_rank] = H5S_UNLIMITED;
 
-    const size_t good_chunk_size = 8192; // pulled out of air
+    const size_t good_chunk_size = syn::io_tuning().seq_chunk_bytes;
     chunk_dims[data_rank] =
         (data_size < good_chunk_size) ? good_chunk_size / data_size : 1;
 
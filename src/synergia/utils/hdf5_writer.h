@@ -14,7 +14,8 @@ class Hdf5_writer {
                            syn::data_info_t const& di,
                            std::vector<hsize_t> const& all_dims_0,
                            Commxx const& comm,
-                           int root_rank);
+                           int root_rank,
+                           syn::storage_t const& storage);
 
   public:
     Hdf5_writer() = delete;
@@ -33,6 +34,9 @@ class Hdf5_writer {
     //   r0->write(10, false),      r1->write(20, false)  => file0: 10
     //   r0->write(10, true),       r1->write(20, true)   => file0: [10, 20]
     //   r0->write([10, 11], true), r1->write([20], true) => file0: [10, 11, 20]
+    //
+    // storage selects the precision and compression of the dataset in the
+    // file, see syn::storage_t
 
     template <class T>
     static void
@@ -41,7 +45,8 @@ class Hdf5_writer {
           T const& data,
           bool collective,
           Commxx const& comm,
-          int root_rank)
+          int root_rank,
+          syn::storage_t const& storage = {})
     {
         auto di = syn::extract_data_info(data);
 
@@ -50,7 +55,7 @@ class Hdf5_writer {
 
         auto all_dim0 = syn::collect_dims(di.dims, collective, comm, root_rank);
 
-        write_impl(file, name, di, all_dim0, comm, root_rank);
+        write_impl(file, name, di, all_dim0, comm, root_rank, storage);
     }
 
     template <class T>
@@ -61,7 +66,8 @@ class Hdf5_writer {
           size_t len,
           bool collective,
           Commxx const& comm,
-          int root_rank)
+          int root_rank,
+          syn::storage_t const& storage = {})
     {
         static_assert(std::is_arithmetic_v<T>,
                       "Hdf5_write<T>::write works only for arithmetic types");
@@ -73,7 +79,7 @@ class Hdf5_writer {
 
         auto all_dim0 = syn::collect_dims(di.dims, collective, comm, root_rank);
 
-        write_impl(file, name, di, all_dim0, comm, root_rank);
+        write_impl(file, name, di, all_dim0, comm, root_rank, storage);
     }
 };
 
@@ -83,7 +89,8 @@ Hdf5_writer::write_impl(Hdf5_handler const& file,
                         syn::data_info_t const& di,
                         std::vector<hsize_t> const& all_dims_0,
                         Commxx const& comm,
-                        int root_rank)
+                        int root_rank,
+                        syn::storage_t const& storage)
 {
     int mpi_size = comm.size();
     int mpi_rank = comm.rank();
@@ -109,13 +116,10 @@ Hdf5_writer::write_impl(Hdf5_handler const& file,
 
     // dataset
     Hdf5_handler filespace = H5Screate_simple(data_rank, dimsf.data(), NULL);
-    Hdf5_handler dset = H5Dcreate(file,
-                                  name.c_str(),
-                                  di.atomic_type,
-                                  filespace,
-                                  H5P_DEFAULT,
-                                  H5P_DEFAULT,
-                                  H5P_DEFAULT);
+    Hdf5_handler ftype = syn::file_data_type(di, storage);
+    Hdf5_handler dcpl = syn::dataset_create_plist(dimsf, di, storage);
+    Hdf5_handler dset = H5Dcreate(
+        file, name.c_str(), ftype, filespace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
 
     // only create the dataset, but do not initiate the write
     // if the total size is 0
@@ -161,12 +165,14 @@ Hdf5_writer::write_impl(Hdf5_handler const& file,
         // dataset
         Hdf5_handler filespace =
             H5Screate_simple(data_rank, dimsf.data(), NULL);
+        Hdf5_handler ftype = syn::file_data_type(di, storage);
+        Hdf5_handler dcpl = syn::dataset_create_plist(dimsf, di, storage);
         Hdf5_handler dset = H5Dcreate(file,
                                       name.c_str(),
-                                      di.atomic_type,
+                                      ftype,
                                       filespace,
                                       H5P_DEFAULT,
-                                      H5P_DEFAULT,
+                                      dcpl,
                                       H5P_DEFAULT);
 
         // only create the dataset, but do not initiate the write
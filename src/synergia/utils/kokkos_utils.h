@@ -5,6 +5,8 @@
 #include "synergia/utils/kokkos_views.h"
 #include "synergia/utils/logger.h"
 
+#include <mpi.h>
+
 namespace ku {
   struct alg_zeroer {
     karray1d_dev arr;
@@ -24,6 +26,52 @@ namespace ku {
     Kokkos::parallel_for(arr.extent(0), alg);
   }
 
+  template <class To, class From>
+  struct alg_converter {
+    To dst;
+    From src;
+
+    KOKKOS_INLINE_FUNCTION
+    void
+    operator()(const int i) const
+    {
+      dst(i) = src(i);
+    }
+  };
+
+  // in place sum of a device array over the ranks of comm, with the
+  // message in single precision. It halves the device to host copies and
+  // the MPI volume of a double reduction, for arrays that do not need
+  // more than float accuracy. buf and hbuf are the float workspaces, of
+  // at least the length of arr
+  inline int
+  allreduce_sum_single(karray1d_dev const& arr,
+                       karray1f_dev const& buf,
+                       karray1f_hst const& hbuf,
+                       MPI_Comm comm)
+  {
+    const int n = arr.extent(0);
+    auto range = std::make_pair(0, n);
+
+    auto dbuf = Kokkos::subview(buf, range);
+    auto hsub = Kokkos::subview(hbuf, range);
+
+    alg_converter<decltype(dbuf), karray1d_dev> narrow{dbuf, arr};
+    Kokkos::parallel_for(n, narrow);
+    Kokkos::deep_copy(hsub, dbuf);
+
+    int err = MPI_Allreduce(
+      MPI_IN_PLACE, (void*)hsub.data(), n, MPI_FLOAT, MPI_SUM, comm);
+
+    Kokkos::deep_copy(dbuf, hsub);
+
+    alg_converter<karray1d_dev, decltype(dbuf)> widen{arr, dbuf};
+    Kokkos::parallel_for(n, widen);
+    Kokkos::fence();
+
+    return err;
+  }
+
   inline void
   print_arr_sum(Logger& logger,
                 karray1d_hst const& arr,
@@ -181,6 +181,13 @@ typedef Kokkos::View<Kokkos::complex<double>***,
                      Kokkos::DefaultHostExecutionSpace::memory_space>
     karray3dc_row;
 
+// single precision arrays
+typedef Kokkos::
+    View<float*, Kokkos::LayoutLeft, Kokkos::DefaultExecutionSpace::memory_space>
+        karray1f_dev;
+
+typedef karray1f_dev::HostMirror karray1f_hst;
+
 // atomic arrays
 typedef Kokkos::
     View<double*, Kokkos::LayoutLeft, Kokkos::MemoryTraits<Kokkos::Atomic>>
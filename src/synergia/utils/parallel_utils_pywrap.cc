@@ -57,4 +57,15 @@ PYBIND11_MODULE(parallel_utils, m)
                                   [](py::object) { return Commxx::Null; });
 
   m.def("simple_timer_print", &simple_timer_print, "logger"_a);
+
+  m.def("simple_timer_write_json", &simple_timer_write_json, "filename"_a);
+
+  m.def("simple_timer_write_trace", &simple_timer_write_trace, "filename"_a);
+
+  m.def("simple_timer_enable_trace",
+        &simple_timer_counter::enable_trace,
+        "enable"_a = true,
+        "max_events"_a = 1 << 20);
+
+  m.def("simple_timer_reset", &simple_timer_counter::reset);
 }
@@ -0,0 +1,105 @@
+#ifndef PHILOX_H_
+#define PHILOX_H_
+
+#include <cmath>
+#include <cstdint>
+
+#include <Kokkos_Core.hpp>
+
+// Philox4x32-10 counter based random number generator (Salmon et al.,
+// "Parallel random numbers: as easy as 1, 2, 3", SC11).
+//
+// The generator is stateless, the numbers are a pure function of the
+// key and the counter. Keyed with the seed and counted with the particle
+// id, every particle gets its own stream no matter which rank or thread
+// it is generated on.
+namespace philox {
+  struct ctr_t {
+    uint32_t v[4];
+  };
+
+  KOKKOS_INLINE_FUNCTION
+  void
+  mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo)
+  {
+    uint64_t p = (uint64_t)a * b;
+    hi = (uint32_t)(p >> 32);
+    lo = (uint32_t)p;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  ctr_t
+  philox4x32(ctr_t c, uint32_t k0, uint32_t k1)
+  {
+    constexpr uint32_t M0 = 0xD2511F53;
+    constexpr uint32_t M1 = 0xCD9E8D57;
+    constexpr uint32_t W0 = 0x9E3779B9;
+    constexpr uint32_t W1 = 0xBB67AE85;
+
+    for (int r = 0; r < 10; ++r) {
+      uint32_t hi0, lo0, hi1, lo1;
+      mulhilo(M0, c.v[0], hi0, lo0);
+      mulhilo(M1, c.v[2], hi1, lo1);
+
+      c = ctr_t{{hi1 ^ c.v[1] ^ k0, lo1, hi0 ^ c.v[3] ^ k1, lo0}};
+
+      k0 += W0;
+      k1 += W1;
+    }
+
+    return c;
+  }
+
+  // uniform double in the open interval (0, 1) from 64 random bits
+  KOKKOS_INLINE_FUNCTION
+  double
+  u01(uint32_t hi, uint32_t lo)
+  {
+    uint64_t x = ((uint64_t)hi << 32) | lo;
+    return ((x >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+  }
+
+  // stream of random numbers for one (seed, id) pair. stream tells
+  // apart independent uses of the same id, e.g. the rejection rounds
+  // of a truncated distribution
+  struct rng {
+    uint32_t k0, k1;
+    ctr_t ctr;
+
+    KOKKOS_INLINE_FUNCTION
+    rng(uint64_t seed, uint64_t id, uint32_t stream = 0)
+      : k0((uint32_t)seed)
+      , k1((uint32_t)(seed >> 32))
+      , ctr{{(uint32_t)id, (uint32_t)(id >> 32), stream, 0}}
+    {}
+
+    // two uniform numbers in (0, 1)
+    KOKKOS_INLINE_FUNCTION
+    void
+    uniform2(double& a, double& b)
+    {
+      ctr_t r = philox4x32(ctr, k0, k1);
+      ++ctr.v[3];
+
+      a = u01(r.v[0], r.v[1]);
+      b = u01(r.v[2], r.v[3]);
+    }
+
+    // two independent unit gaussians (Box-Muller)
+    KOKKOS_INLINE_FUNCTION
+    void
+    normal2(double& a, double& b)
+    {
+      constexpr double two_pi = 6.283185307179586476925286766559;
+
+      double u1, u2;
+      uniform2(u1, u2);
+
+      double r = sqrt(-2.0 * log(u1));
+      a = r * cos(two_pi * u2);
+      b = r * sin(two_pi * u2);
+    }
+  };
+}
+
+#endif
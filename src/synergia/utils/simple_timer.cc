@@ -1,9 +1,342 @@
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#include <Kokkos_Core.hpp>
+
+#include "synergia/utils/json.h"
 #include "synergia/utils/simple_timer.h"
 
-std::map<std::string, simple_timer_counter::timing>
-  simple_timer_counter::timings =
-    std::map<std::string, simple_timer_counter::timing>();
+namespace {
+  // separator of path components. It sorts before any printable
+  // character so that children always follow their parent
+  constexpr char path_sep = '\x1f';
+
+  std::mutex registry_mutex;
+  std::vector<std::unique_ptr<simple_timer_counter::thread_timings>> registry;
+
+  std::atomic<bool> trace_on(false);
+  std::atomic<size_t> trace_max_events(1 << 20);
+
+  template <class STR>
+  int
+  find_or_add_child(simple_timer_counter::thread_timings& tt,
+                    int parent,
+                    STR const& label)
+  {
+    for (int c : tt.nodes[parent].children)
+      if (tt.nodes[c].label == label) return c;
+
+    int const child = tt.nodes.size();
+    tt.nodes.push_back(simple_timer_counter::timing{
+      std::string(label),
+      parent,
+      0.0,
+      std::numeric_limits<double>::max(),
+      0.0,
+      0.0,
+      0,
+      {}});
+
+    tt.nodes[parent].children.push_back(child);
+    return child;
+  }
+
+  template <class STR>
+  void
+  do_start(STR const& label, double t0)
+  {
+    auto& tt = simple_timer_counter::local();
+    int const node = find_or_add_child(tt, tt.stack.back(), label);
+
+    tt.nodes[node].start = t0;
+    tt.stack.push_back(node);
+
+    if (Kokkos::Profiling::profileLibraryLoaded())
+      Kokkos::Profiling::pushRegion(tt.nodes[node].label);
+  }
+
+  template <class STR>
+  void
+  do_stop(STR const& label, double t1)
+  {
+    auto& tt = simple_timer_counter::local();
+
+    // look for the matching scope, the root (index 0) never matches.
+    // Unmatched stops are ignored
+    int level = tt.stack.size() - 1;
+    while (level > 0 && tt.nodes[tt.stack[level]].label != label)
+      --level;
+
+    if (level == 0) return;
+
+    // close the matching scope and anything left open inside it
+    bool const trace = trace_on.load(std::memory_order_relaxed);
+    size_t const max_events = trace_max_events.load(std::memory_order_relaxed);
+
+    while ((int)tt.stack.size() > level) {
+      int const node = tt.stack.back();
+      auto& t = tt.nodes[node];
+      double const dt = t1 - t.start;
+
+      t.sum += dt;
+      t.min = std::min(t.min, dt);
+      t.max = std::max(t.max, dt);
+      ++t.count;
+
+      if (trace && tt.events.size() < max_events)
+        tt.events.push_back(simple_timer_counter::event{node, t.start, t1});
+
+      if (Kokkos::Profiling::profileLibraryLoaded())
+        Kokkos::Profiling::popRegion();
+
+      tt.stack.pop_back();
+    }
+  }
+
+  struct reduced_timing {
+    std::string path;
+    int depth;
+    int count;
+    double min;
+    double avg;
+    double max;
+    double imbalance;
+  };
+
+  // concatenate a string from every rank onto rank 0
+  std::string
+  gather_to_root(std::string const& local, MPI_Comm comm)
+  {
+    int rank = 0, size = 1;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    int len = local.size();
+    std::vector<int> lens(size), displs(size);
+    MPI_Gather(&len, 1, MPI_INT, lens.data(), 1, MPI_INT, 0, comm);
+
+    int total = 0;
+    for (int r = 0; r < size; ++r) {
+      displs[r] = total;
+      total += lens[r];
+    }
+
+    std::string all(rank == 0 ? total : 0, '\0');
+    MPI_Gatherv(local.data(),
+                len,
+                MPI_CHAR,
+                &all[0],
+                lens.data(),
+                displs.data(),
+                MPI_CHAR,
+                0,
+                comm);
+
+    return all;
+  }
+
+  // sum and count of every scope path on this rank, merged over threads
+  std::map<std::string, std::pair<double, int>>
+  local_totals()
+  {
+    std::map<std::string, std::pair<double, int>> totals;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    for (auto const& tt : registry) {
+      for (int n = 1; n < (int)tt->nodes.size(); ++n) {
+        auto& tot = totals[simple_timer_counter::path(*tt, n)];
+        tot.first += tt->nodes[n].sum;
+        tot.second += tt->nodes[n].count;
+      }
+    }
+
+    return totals;
+  }
+
+  // reduce the timings over all ranks of MPI_COMM_WORLD. The result is
+  // only valid on rank 0
+  std::vector<reduced_timing>
+  reduce_timings()
+  {
+    MPI_Comm comm = MPI_COMM_WORLD;
+
+    int rank = 0, size = 1;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    auto const totals = local_totals();
+
+    // the union of paths over all ranks, built on rank 0
+    std::string local_paths;
+    for (auto const& t : totals)
+      local_paths += t.first + '\n';
+
+    std::string const all_paths = gather_to_root(local_paths, comm);
+
+    std::set<std::string> paths;
+    if (rank == 0) {
+      std::istringstream iss(all_paths);
+      std::string p;
+      while (std::getline(iss, p))
+        paths.insert(p);
+    }
+
+    std::string union_paths;
+    for (auto const& p : paths)
+      union_paths += p + '\n';
+
+    int union_len = union_paths.size();
+    MPI_Bcast(&union_len, 1, MPI_INT, 0, comm);
+    union_paths.resize(union_len);
+    MPI_Bcast(&union_paths[0], union_len, MPI_CHAR, 0, comm);
+
+    std::vector<std::string> ordered;
+    {
+      std::istringstream iss(union_paths);
+      std::string p;
+      while (std::getline(iss, p))
+        ordered.push_back(p);
+    }
+
+    size_t const np = ordered.size();
+    std::vector<double> sums(np, 0.0), mins(np), maxs(np), avgs(np);
+    std::vector<int> counts(np, 0), max_counts(np);
+
+    for (size_t i = 0; i < np; ++i) {
+      auto it = totals.find(ordered[i]);
+      if (it == totals.end()) continue;
+      sums[i] = it->second.first;
+      counts[i] = it->second.second;
+    }
+
+    MPI_Reduce(sums.data(), mins.data(), np, MPI_DOUBLE, MPI_MIN, 0, comm);
+    MPI_Reduce(sums.data(), maxs.data(), np, MPI_DOUBLE, MPI_MAX, 0, comm);
+    MPI_Reduce(sums.data(), avgs.data(), np, MPI_DOUBLE, MPI_SUM, 0, comm);
+    MPI_Reduce(counts.data(), max_counts.data(), np, MPI_INT, MPI_MAX, 0, comm);
+
+    std::vector<reduced_timing> reduced;
+    if (rank != 0) return reduced;
+
+    for (size_t i = 0; i < np; ++i) {
+      double const avg = avgs[i] / size;
+      reduced.push_back(reduced_timing{
+        ordered[i],
+        (int)std::count(ordered[i].begin(), ordered[i].end(), path_sep),
+        max_counts[i],
+        mins[i],
+        avg,
+        maxs[i],
+        avg > 0.0 ? maxs[i] / avg : 1.0});
+    }
+
+    return reduced;
+  }
+
+  std::string
+  leaf_label(std::string const& path)
+  {
+    auto pos = path.rfind(path_sep);
+    return pos == std::string::npos ? path : path.substr(pos + 1);
+  }
+
+  std::string
+  display_path(std::string path)
+  {
+    std::replace(path.begin(), path.end(), path_sep, '/');
+    return path;
+  }
+}
+
+simple_timer_counter::thread_timings::thread_timings()
+  : nodes(1, timing{"", -1, 0.0, 0.0, 0.0, 0.0, 0, {}})
+  , stack(1, 0)
+  , events()
+  , tid(0)
+{}
+
+simple_timer_counter::thread_timings&
+simple_timer_counter::local()
+{
+  thread_local thread_timings* tt = nullptr;
+
+  if (!tt) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.emplace_back(new thread_timings());
+    tt = registry.back().get();
+    tt->tid = registry.size() - 1;
+  }
+
+  return *tt;
+}
+
+void
+simple_timer_counter::start(char const* label, double t0)
+{
+  do_start(label, t0);
+}
+
+void
+simple_timer_counter::start(std::string const& label, double t0)
+{
+  do_start(label, t0);
+}
+
+void
+simple_timer_counter::stop(char const* label, double t1)
+{
+  do_stop(label, t1);
+}
+
+void
+simple_timer_counter::stop(std::string const& label, double t1)
+{
+  do_stop(label, t1);
+}
+
+std::string
+simple_timer_counter::path(thread_timings const& tt, int node)
+{
+  std::string p = tt.nodes[node].label;
+
+  for (int n = tt.nodes[node].parent; n > 0; n = tt.nodes[n].parent)
+    p = tt.nodes[n].label + path_sep + p;
+
+  return p;
+}
+
+void
+simple_timer_counter::enable_trace(bool enable, size_t max_events)
+{
+  trace_max_events = max_events;
+  trace_on = enable;
+}
+
+bool
+simple_timer_counter::trace_enabled()
+{
+  return trace_on;
+}
+
+void
+simple_timer_counter::reset()
+{
+  std::lock_guard<std::mutex> lock(registry_mutex);
+
+  for (auto& tt : registry) {
+    int const tid = tt->tid;
+    *tt = thread_timings();
+    tt->tid = tid;
+  }
+}
 
 void
 simple_timer_print(Logger& logger)
@@ -11,18 +344,97 @@ simple_timer_print(Logger& logger)
 #ifdef SIMPLE_TIMER
   using namespace std;
 
-  logger(LoggerV::INFO)
-    //<< std::scientific
-    << std::setprecision(8) << left << setw(30) << "timer label" << setw(20)
-    << "time(s)" << setw(12) << "cout"
-    << "\n"
-    << std::string(62, '-') << "\n";
+  auto const timings = reduce_timings();
+
+  logger(LoggerV::INFO) << std::setprecision(6) << left << setw(40)
+                        << "timer label" << right << setw(10) << "count"
+                        << setw(14) << "min(s)" << setw(14) << "avg(s)"
+                        << setw(14) << "max(s)" << setw(10) << "imbal"
+                        << "\n"
+                        << std::string(102, '-') << "\n";
 
-  for (auto const& timing : simple_timer_counter::timings) {
-    logger << left << std::setw(30) << timing.first << std::setw(20)
-           << timing.second.sum << std::setw(12) << timing.second.count << "\n";
+  for (auto const& t : timings) {
+    std::string const label =
+      std::string(2 * t.depth, ' ') + leaf_label(t.path);
+
+    logger << left << setw(40) << label << right << setw(10) << t.count
+           << setw(14) << t.min << setw(14) << t.avg << setw(14) << t.max
+           << setw(10) << std::setprecision(3) << t.imbalance
+           << std::setprecision(6) << "\n";
   }
 
   logger << "\n";
 #endif
 }
+
+void
+simple_timer_write_json(std::string const& filename)
+{
+  auto const timings = reduce_timings();
+  if (Commxx::world_rank() != 0) return;
+
+  syn::json doc = syn::json::array();
+
+  for (auto const& t : timings) {
+    doc.push_back({{"path", display_path(t.path)},
+                   {"label", leaf_label(t.path)},
+                   {"depth", t.depth},
+                   {"count", t.count},
+                   {"min", t.min},
+                   {"avg", t.avg},
+                   {"max", t.max},
+                   {"imbalance", t.imbalance}});
+  }
+
+  std::ofstream out(filename);
+  out << syn::json{{"ranks", Commxx::world_size()}, {"timers", doc}}.dump(2)
+      << "\n";
+}
+
+void
+simple_timer_write_trace(std::string const& filename)
+{
+  MPI_Comm comm = MPI_COMM_WORLD;
+  int const rank = Commxx::world_rank();
+
+  // earliest event time of all ranks is the origin of the timeline
+  double local_t0 = std::numeric_limits<double>::max();
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto const& tt : registry)
+      for (auto const& e : tt->events)
+        local_t0 = std::min(local_t0, e.start);
+  }
+
+  double t0 = 0.0;
+  MPI_Allreduce(&local_t0, &t0, 1, MPI_DOUBLE, MPI_MIN, comm);
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(3);
+
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto const& tt : registry) {
+      for (auto const& e : tt->events) {
+        auto const& node = tt->nodes[e.node];
+        oss << "{\"name\":" << syn::json(node.label).dump()
+            << ",\"cat\":\"synergia\",\"ph\":\"X\""
+            << ",\"ts\":" << (e.start - t0) * 1.0e6
+            << ",\"dur\":" << (e.stop - e.start) * 1.0e6
+            << ",\"pid\":" << rank << ",\"tid\":" << tt->tid << "},\n";
+      }
+    }
+  }
+
+  std::string const all = gather_to_root(oss.str(), comm);
+  if (rank != 0) return;
+
+  std::ofstream out(filename);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+  // drop the trailing ",\n" of the last event
+  if (all.size() > 2)
+    out.write(all.data(), all.size() - 2);
+
+  out << "\n]}\n";
+}
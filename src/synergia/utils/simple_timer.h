@@ -2,69 +2,145 @@
 #define SIMPLE_TIMER_H
 
 #include <iomanip>
-#include <map>
+#include <string>
+#include <vector>
 
 #include "logger.h"
 
+// Hierarchical, barrier-free timer.
+//
+// Timers form a tree of nested scopes: a timer started while another one
+// is running is recorded as a child of the running timer. Each thread keeps
+// its own tree and scope stack, so start/stop never lock or communicate.
+// After the first visit of a scope, start and stop do not allocate.
+//
+// The per-rank trees are merged and reduced across MPI_COMM_WORLD only when
+// a report is produced (simple_timer_print, simple_timer_write_json,
+// simple_timer_write_trace), which report the min/avg/max over ranks and
+// the load imbalance (max/avg) for every scope path.
+//
+// When built with SIMPLE_TIMER every scope is also forwarded to
+// Kokkos::Profiling as a region, so that the Kokkos tools see the same
+// hierarchy.
 struct simple_timer_counter {
   struct timing {
+    std::string label;
+    int parent;
     double sum;
+    double min;
+    double max;
     double start;
     int count;
+    std::vector<int> children;
   };
-  static std::map<std::string, timing> timings;
 
-  static void
-  start(std::string const& label, double t0)
-  {
-    timings.emplace(label, timing{0.0, t0, 0}).first->second.start = t0;
-  }
+  struct event {
+    int node;
+    double start;
+    double stop;
+  };
 
-  static void
-  stop(std::string const& label, double t1)
-  {
-    auto iter = timings.emplace(label, timing{0.0, t1, 0}).first;
-    iter->second.sum += t1 - iter->second.start;
-    ++iter->second.count;
-  }
+  // one per thread, accumulates without locking
+  struct thread_timings {
+    std::vector<timing> nodes;
+    std::vector<int> stack;
+    std::vector<event> events;
+    int tid;
+
+    thread_timings();
+  };
+
+  static thread_timings& local();
+
+  static void start(char const* label, double t0);
+  static void start(std::string const& label, double t0);
+
+  static void stop(char const* label, double t1);
+  static void stop(std::string const& label, double t1);
+
+  // the full path ("parent/child/...") of a node in the given tree
+  static std::string path(thread_timings const& tt, int node);
+
+  // turn recording of the timeline on or off. At most max_events
+  // per thread are kept, later events are dropped
+  static void enable_trace(bool enable, size_t max_events = 1 << 20);
+  static bool trace_enabled();
+
+  // discards all the accumulated timings on every thread
+  static void reset();
 };
 
+inline void
+simple_timer_start(char const* label)
+{
+#ifdef SIMPLE_TIMER
+  simple_timer_counter::start(label, MPI_Wtime());
+#endif
+}
+
 inline void
 simple_timer_start(std::string const& label)
 {
 #ifdef SIMPLE_TIMER
-  MPI_Barrier(MPI_COMM_WORLD);
   simple_timer_counter::start(label, MPI_Wtime());
 #endif
 }
 
+inline void
+simple_timer_stop(char const* label)
+{
+#ifdef SIMPLE_TIMER
+  simple_timer_counter::stop(label, MPI_Wtime());
+#endif
+}
+
 inline void
 simple_timer_stop(std::string const& label)
 {
 #ifdef SIMPLE_TIMER
-  MPI_Barrier(MPI_COMM_WORLD);
   simple_timer_counter::stop(label, MPI_Wtime());
 #endif
 }
 
 struct scoped_simple_timer {
 #ifdef SIMPLE_TIMER
-  std::string const label;
+  char const* const label;
+  std::string const slabel;
 
-  scoped_simple_timer(std::string const& label) : label(label)
+  scoped_simple_timer(char const* label) : label(label), slabel()
   {
     simple_timer_start(label);
   }
 
+  scoped_simple_timer(std::string const& label) : label(nullptr), slabel(label)
+  {
+    simple_timer_start(slabel);
+  }
+
   ~scoped_simple_timer()
   {
-    simple_timer_stop(label);
+    if (label)
+      simple_timer_stop(label);
+    else
+      simple_timer_stop(slabel);
   }
 #else
+  scoped_simple_timer(char const*) {}
   scoped_simple_timer(std::string const&) {}
 #endif
 };
 
+// print the timer tree with min/avg/max/imbalance across ranks.
+// Collective over MPI_COMM_WORLD.
 void simple_timer_print(Logger& logger);
 
+// write the reduced timer tree as a JSON document (rank 0 writes).
+// Collective over MPI_COMM_WORLD.
+void simple_timer_write_json(std::string const& filename);
+
+// write the recorded timeline of all ranks in the Chrome trace event
+// format (chrome://tracing, Perfetto). Requires enable_trace(true).
+// Collective over MPI_COMM_WORLD.
+void simple_timer_write_trace(std::string const& filename);
+
 #endif
@@ -0,0 +1,130 @@
+#include "synergia/utils/catch.hpp"
+
+#include "synergia/utils/json.h"
+#include "synergia/utils/simple_timer.h"
+
+#include <fstream>
+
+TEST_CASE("nested scopes", "[simple_timer]")
+{
+  simple_timer_counter::reset();
+
+  simple_timer_counter::start("outer", 1.0);
+  simple_timer_counter::start("inner", 1.5);
+  simple_timer_counter::stop("inner", 2.0);
+  simple_timer_counter::start("inner", 2.5);
+  simple_timer_counter::stop("inner", 3.5);
+  simple_timer_counter::stop("outer", 4.0);
+
+  auto const& tt = simple_timer_counter::local();
+
+  // root + outer + inner
+  REQUIRE(tt.nodes.size() == 3);
+  REQUIRE(tt.stack.size() == 1);
+
+  auto const& outer = tt.nodes[1];
+  CHECK(outer.label == "outer");
+  CHECK(outer.parent == 0);
+  CHECK(outer.count == 1);
+  CHECK(outer.sum == Approx(3.0));
+
+  auto const& inner = tt.nodes[2];
+  CHECK(inner.label == "inner");
+  CHECK(inner.parent == 1);
+  CHECK(inner.count == 2);
+  CHECK(inner.sum == Approx(1.5));
+  CHECK(inner.min == Approx(0.5));
+  CHECK(inner.max == Approx(1.0));
+}
+
+TEST_CASE("same label under different parents", "[simple_timer]")
+{
+  simple_timer_counter::reset();
+
+  simple_timer_counter::start("a", 0.0);
+  simple_timer_counter::start("x", 0.0);
+  simple_timer_counter::stop("x", 1.0);
+  simple_timer_counter::stop("a", 1.0);
+
+  simple_timer_counter::start(std::string("b"), 0.0);
+  simple_timer_counter::start(std::string("x"), 0.0);
+  simple_timer_counter::stop(std::string("x"), 2.0);
+  simple_timer_counter::stop(std::string("b"), 2.0);
+
+  auto const& tt = simple_timer_counter::local();
+  REQUIRE(tt.nodes.size() == 5);
+
+  CHECK(simple_timer_counter::path(tt, 2) != simple_timer_counter::path(tt, 4));
+  CHECK(tt.nodes[2].sum == Approx(1.0));
+  CHECK(tt.nodes[4].sum == Approx(2.0));
+}
+
+TEST_CASE("unbalanced stops", "[simple_timer]")
+{
+  simple_timer_counter::reset();
+
+  // stopping the outer scope closes the inner one as well
+  simple_timer_counter::start("outer", 0.0);
+  simple_timer_counter::start("inner", 1.0);
+  simple_timer_counter::stop("outer", 3.0);
+
+  // a stop without start is ignored
+  simple_timer_counter::stop("never_started", 4.0);
+
+  auto const& tt = simple_timer_counter::local();
+  REQUIRE(tt.nodes.size() == 3);
+  CHECK(tt.stack.size() == 1);
+  CHECK(tt.nodes[1].sum == Approx(3.0));
+  CHECK(tt.nodes[2].sum == Approx(2.0));
+}
+
+TEST_CASE("reduced json report", "[simple_timer]")
+{
+  simple_timer_counter::reset();
+
+  int const rank = Commxx::world_rank();
+  int const size = Commxx::world_size();
+
+  // rank r spends r+1 seconds
+  simple_timer_counter::start("work", 0.0);
+  simple_timer_counter::stop("work", rank + 1.0);
+
+  simple_timer_write_json("test_simple_timer.json");
+
+  if (rank == 0) {
+    std::ifstream in("test_simple_timer.json");
+    auto const doc = syn::json::parse(in);
+
+    CHECK(doc["ranks"] == size);
+    REQUIRE(doc["timers"].size() == 1);
+
+    auto const& t = doc["timers"][0];
+    CHECK(t["label"] == "work");
+    CHECK(t["min"].get<double>() == Approx(1.0));
+    CHECK(t["max"].get<double>() == Approx(size));
+    CHECK(t["avg"].get<double>() == Approx((size + 1) / 2.0));
+  }
+}
+
+TEST_CASE("chrome trace", "[simple_timer]")
+{
+  simple_timer_counter::reset();
+  simple_timer_counter::enable_trace(true);
+
+  simple_timer_counter::start("traced", 10.0);
+  simple_timer_counter::stop("traced", 10.5);
+
+  simple_timer_counter::enable_trace(false);
+  simple_timer_write_trace("test_simple_timer_trace.json");
+
+  if (Commxx::world_rank() == 0) {
+    std::ifstream in("test_simple_timer_trace.json");
+    auto const doc = syn::json::parse(in);
+
+    auto const& events = doc["traceEvents"];
+    REQUIRE(events.size() == Commxx::world_size());
+    CHECK(events[0]["name"] == "traced");
+    CHECK(events[0]["ph"] == "X");
+    CHECK(events[0]["dur"].get<double>() == Approx(0.5e6));
+  }
+}